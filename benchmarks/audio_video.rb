@@ -0,0 +1,392 @@
+#!/usr/bin/env ruby
+# frozen_string_literal: true
+
+# Sends synthetic audio and video over calls between pairs of clients
+# connected through a local fake network and reports, for every resolution:
+#
+#   encode  - average time of send_*_frame per frame (toxav encodes there)
+#   decode  - average time of receiving iterations per received frame
+#   latency - average and 95th percentile delay of video frames, which
+#             carry their sequence number in a band of black and white
+#             blocks
+#   loss    - frames sent but never received
+#   cpu     - process CPU time per call, in percent of one core
+#
+# Parameters can be changed with environment variables:
+#
+#   RESOLUTIONS    - comma separated WIDTHxHEIGHT (default: 320x240,640x480,
+#                    1280x720)
+#   FPS            - video frames per second (default: 30)
+#   CALLS          - number of parallel calls (default: 1)
+#   DURATION       - seconds to send frames for (default: 10)
+#   AUDIO_BIT_RATE - kbit/sec (default: 48)
+#   VIDEO_BIT_RATE - kbit/sec (default: 2000)
+#   TIMEOUT        - seconds to wait for calls to be established
+#                    (default: 60)
+
+require 'bundler/setup'
+
+$LOAD_PATH.unshift File.expand_path(File.join('..', 'spec'), __dir__)
+
+require 'tox'
+
+require 'support/fake_bootstrap_network'
+
+RESOLUTIONS = ENV.fetch('RESOLUTIONS', '320x240,640x480,1280x720')
+                 .split(',').map { |s| s.split('x').map { |v| Integer(v) } }
+
+FPS            = Integer(ENV.fetch('FPS', 30))
+CALLS          = Integer(ENV.fetch('CALLS', 1))
+DURATION       = Float(ENV.fetch('DURATION', 10))
+AUDIO_BIT_RATE = Integer(ENV.fetch('AUDIO_BIT_RATE', 48))
+VIDEO_BIT_RATE = Integer(ENV.fetch('VIDEO_BIT_RATE', 2000))
+TIMEOUT        = Integer(ENV.fetch('TIMEOUT', 60))
+
+AUDIO_INTERVAL = 0.02
+SAMPLE_COUNT   = 960
+
+MARKER_BITS = 16
+MARKER_LOW  = 16
+MARKER_HIGH = 235
+
+##
+# Counters of one direction of a call.
+#
+Measurement = Struct.new(
+  :audio_sent, :video_sent, :audio_received, :video_received,
+  :encode_time, :decode_time, :latencies, :sent_at
+) do
+  def initialize
+    super 0, 0, 0, 0, 0.0, 0.0, [], {}
+  end
+end
+
+def now
+  Process.clock_gettime Process::CLOCK_MONOTONIC
+end
+
+def cpu_time
+  Process.clock_gettime Process::CLOCK_PROCESS_CPUTIME_ID
+end
+
+def new_client
+  options = Tox::Options.new
+  options.local_discovery_enabled = false
+
+  Tox::Client.new(options).tap do |client|
+    Support::FakeBootstrapNetwork.bootstrap_nodes.each do |node|
+      client.bootstrap '127.0.0.1', node.port, node.public_key
+    end
+  end
+end
+
+def iterate(clients)
+  sleep clients.flat_map { |c| [c, c.audio_video] }
+                .map(&:iteration_interval).min
+  clients.each do |client|
+    client.iterate
+    client.audio_video.iterate
+  end
+end
+
+# A 1 kHz tone repeats exactly in every 20 ms frame of 48 kHz stereo.
+def audio_frame
+  pcm = Array.new(SAMPLE_COUNT) do |index|
+    value = (Math.sin(2 * Math::PI * 1000 * index / 48_000) * 8000).round
+    [value, value]
+  end
+
+  Tox::AudioFrame.new.tap do |frame|
+    frame.pcm           = pcm.flatten.pack('s<*')
+    frame.sample_count  = SAMPLE_COUNT
+    frame.channels      = 2
+    frame.sampling_rate = 48_000
+  end
+end
+
+# Diagonal stripes which move every frame keep the encoder busy, the band
+# on top carries the sequence number.
+class VideoSource
+  attr_reader :width, :height, :band_height, :block_width
+
+  def initialize(width, height)
+    @width       = width
+    @height      = height
+    @block_width = width / MARKER_BITS
+    @band_height = [16, height / 8].max
+    @pattern     = (0...(width + 256)).map { |i| i & 0xff }.pack('C*')
+    @chroma      = ("\x80".b * ((width / 2) * (height / 2))).freeze
+  end
+
+  def frame(sequence)
+    Tox::VideoFrame.new.tap do |frame|
+      frame.width   = width
+      frame.height  = height
+      frame.y_plane = band(sequence) + stripes(sequence)
+      frame.u_plane = @chroma
+      frame.v_plane = @chroma
+    end
+  end
+
+  def sequence(frame)
+    y_plane = frame.y_plane
+    row = band_height / 2
+
+    (0...MARKER_BITS).reduce(0) do |sequence, bit|
+      x = bit * block_width + block_width / 2
+      luma = y_plane.getbyte(row * width + x)
+      luma > 128 ? sequence | (1 << bit) : sequence
+    end
+  end
+
+private
+
+  def band(sequence)
+    row = (0...MARKER_BITS).map do |bit|
+      luma = sequence[bit] == 1 ? MARKER_HIGH : MARKER_LOW
+      luma.chr * block_width
+    end.join
+
+    row << (MARKER_LOW.chr * (width - row.bytesize))
+    row * band_height
+  end
+
+  def stripes(sequence)
+    (band_height...height).map do |row|
+      @pattern.byteslice((row + sequence * 4) % 256, width)
+    end.join
+  end
+end
+
+def answer_calls(callee, measurement, source)
+  callee.audio_video.on_call do |friend_call_request|
+    friend_call_request.answer AUDIO_BIT_RATE, VIDEO_BIT_RATE
+  end
+
+  callee.audio_video.on_audio_frame do |_friend_call, _audio_frame|
+    measurement.audio_received += 1
+  end
+
+  callee.audio_video.on_video_frame do |_friend_call, video_frame|
+    measurement.video_received += 1
+    sent_at = measurement.sent_at.delete source.sequence(video_frame)
+    measurement.latencies << now - sent_at if sent_at
+  end
+end
+
+def track_established(caller, established, index)
+  caller.audio_video.on_call_state_change do |_friend_call, state|
+    if state.accepting_video? || state.sending_video?
+      established << index unless established.include? index
+    end
+  end
+end
+
+# Calls the first friend, iterating until it is connected.
+def call(caller, clients, deadline)
+  friend = caller.friend(caller.friend_numbers.first)
+
+  begin
+    friend.call audio_bit_rate: AUDIO_BIT_RATE,
+                video_bit_rate: VIDEO_BIT_RATE
+  rescue Tox::Friend::NotConnectedError
+    raise if now > deadline
+    iterate clients
+    retry
+  end
+end
+
+def establish(pairs, measurements, source, clients)
+  established = []
+  deadline    = now + TIMEOUT
+
+  friend_calls = pairs.each_with_index.map do |(caller, callee), index|
+    answer_calls callee, measurements[index], source
+    track_established caller, established, index
+    call caller, clients, deadline
+  end
+
+  iterate clients until established.size == pairs.size || now > deadline
+  raise 'Calls were not established' unless established.size == pairs.size
+
+  friend_calls
+end
+
+##
+# Sends frames of the calls whenever they are due.
+#
+class FrameSender
+  def initialize(friend_calls, measurements, source)
+    @friend_calls = friend_calls
+    @measurements = measurements
+    @source       = source
+    @audio        = audio_frame
+    @next_audio   = now
+    @next_video   = @next_audio
+    @sequence     = 0
+  end
+
+  # Time the next frame is due at.
+  def next_at
+    [@next_audio, @next_video].min
+  end
+
+  def send_due
+    send_audio if now >= @next_audio
+    send_video if now >= @next_video
+  end
+
+private
+
+  def send_audio
+    each_call do |friend_call, measurement|
+      friend_call.send_audio_frame @audio
+      measurement.audio_sent += 1
+    end
+
+    @next_audio += AUDIO_INTERVAL
+  end
+
+  def send_video
+    sequence = frame_sequence @sequence
+    frame = @source.frame sequence
+
+    each_call do |friend_call, measurement|
+      measurement.sent_at[sequence] = now
+      friend_call.send_video_frame frame
+      measurement.video_sent += 1
+    end
+
+    @sequence += 1
+    @next_video += 1.0 / FPS
+  end
+
+  # The block runs for every call and is timed as encoding.
+  def each_call
+    @friend_calls.zip(@measurements).each do |friend_call, measurement|
+      t = now
+      yield friend_call, measurement
+      measurement.encode_time += now - t
+    end
+  end
+end
+
+def pump(friend_calls, measurements, source, clients)
+  sender = FrameSender.new friend_calls, measurements, source
+  started_at = now
+
+  while now - started_at < DURATION
+    sender.send_due
+    receive clients, measurements, sender.next_at
+  end
+
+  # Frames on the way are given a second to arrive.
+  drain_until = now + 1
+  receive clients, measurements, drain_until while now < drain_until
+end
+
+def frame_sequence(sequence)
+  sequence & ((1 << MARKER_BITS) - 1)
+end
+
+# Receiving iterations of callees are timed separately, toxav decodes there.
+# Sleeping never goes past the next frame to send.
+def receive(clients, measurements, wake_at)
+  interval = clients.flat_map { |c| [c, c.audio_video] }
+                    .map(&:iteration_interval).min
+  sleep [[interval, wake_at - now].min, 0].max
+
+  clients.each(&:iterate)
+
+  clients.each_slice(2).with_index do |(caller, callee), index|
+    caller.audio_video.iterate
+    t = now
+    callee.audio_video.iterate
+    measurements[index].decode_time += now - t
+  end
+end
+
+def total(values)
+  values.reduce(0, :+)
+end
+
+def frame_counts(measurements)
+  [
+    total(measurements.map { |m| m.audio_sent + m.video_sent }),
+    total(measurements.map { |m| m.audio_received + m.video_received }),
+  ]
+end
+
+# Average encode and decode time per frame and percent of frames lost.
+def frame_times(measurements)
+  sent, received = frame_counts measurements
+
+  encode = total(measurements.map(&:encode_time)) / [sent, 1].max
+  decode = total(measurements.map(&:decode_time)) / [received, 1].max
+  loss   = sent.zero? ? 0.0 : (sent - received).fdiv(sent) * 100
+
+  [encode, decode, loss]
+end
+
+# Average and 95th percentile latency.
+def latency(measurements)
+  latencies = measurements.flat_map(&:latencies).sort
+  return [0.0, 0.0] if latencies.empty?
+
+  [total(latencies) / latencies.size, latencies[(latencies.size * 0.95).floor]]
+end
+
+def report(width, height, measurements, cpu)
+  encode, decode, loss = frame_times measurements
+  average, p95 = latency measurements
+
+  format(
+    '%4dx%-4d encode %6.2f ms  decode %6.2f ms  ' \
+    'latency %6.1f ms (p95 %6.1f ms)  loss %5.1f%%  cpu %5.1f%%/call',
+    width, height, encode * 1000, decode * 1000,
+    average * 1000, p95 * 1000, loss, cpu * 100,
+  )
+end
+
+def connected_pairs
+  Array.new(CALLS) { [new_client, new_client] }.each do |caller, callee|
+    caller.friend_add_norequest callee.public_key
+    callee.friend_add_norequest caller.public_key
+  end
+end
+
+# Process CPU time per call while the block runs, in parts of one core.
+def cpu_per_call
+  cpu_started_at = cpu_time
+  started_at = now
+
+  yield
+
+  (cpu_time - cpu_started_at) / (now - started_at) / CALLS
+end
+
+def run(width, height)
+  pairs = connected_pairs
+  clients = pairs.flatten
+
+  source = VideoSource.new width, height
+  measurements = Array.new(CALLS) { Measurement.new }
+
+  friend_calls = establish pairs, measurements, source, clients
+  cpu = cpu_per_call { pump friend_calls, measurements, source, clients }
+
+  report width, height, measurements, cpu
+end
+
+Support::FakeBootstrapNetwork.start
+
+begin
+  puts "#{CALLS} calls, #{FPS} fps, #{AUDIO_BIT_RATE}/#{VIDEO_BIT_RATE} " \
+       "kbit/sec, #{DURATION} s"
+
+  RESOLUTIONS.each do |width, height|
+    puts run(width, height)
+  end
+ensure
+  Support::FakeBootstrapNetwork.stop
+end
@@ -0,0 +1,148 @@
+#!/usr/bin/env ruby
+# frozen_string_literal: true
+
+# Sends many files in parallel between two clients connected through a local
+# fake network and reports the throughput of every available file I/O
+# backend. Parameters can be changed with environment variables:
+#
+#   TRANSFERS - number of parallel transfers (default: 32)
+#   FILE_SIZE - size of each file in bytes (default: 4 MiB)
+#   TIMEOUT   - seconds to wait for a run to finish (default: 300)
+
+require 'bundler/setup'
+
+$LOAD_PATH.unshift File.expand_path(File.join('..', 'spec'), __dir__)
+
+require 'fileutils'
+require 'securerandom'
+require 'tmpdir'
+
+require 'tox'
+
+require 'support/fake_bootstrap_network'
+
+TRANSFERS = Integer(ENV.fetch('TRANSFERS', 32))
+FILE_SIZE = Integer(ENV.fetch('FILE_SIZE', 4 * 1024 * 1024))
+TIMEOUT   = Integer(ENV.fetch('TIMEOUT', 300))
+
+def new_client
+  options = Tox::Options.new
+  options.local_discovery_enabled = false
+
+  Tox::Client.new(options).tap do |client|
+    Support::FakeBootstrapNetwork.bootstrap_nodes.each do |node|
+      client.bootstrap '127.0.0.1', node.port, node.public_key
+    end
+  end
+end
+
+def iterate(clients)
+  sleep clients.map(&:iteration_interval).min
+  clients.each(&:iterate)
+end
+
+def send_files(friend, paths, clients)
+  deadline = Time.now + TIMEOUT
+
+  paths.map do |path|
+    begin
+      friend.send_local_file path
+    rescue Tox::Friend::NotConnectedError
+      raise if Time.now > deadline
+      iterate clients
+      retry
+    end
+  end
+end
+
+def connected_clients(backend)
+  sender   = new_client
+  receiver = new_client
+
+  sender.file_io_backend   = backend
+  receiver.file_io_backend = backend
+
+  sender.friend_add_norequest receiver.public_key
+  receiver.friend_add_norequest sender.public_key
+
+  [sender, receiver]
+end
+
+# Receives files into the directory. Returns the count of finished files,
+# in an array so it changes as they finish.
+def receive_files(receiver, dir)
+  received = [0]
+
+  receiver.on_file_recv_request do |in_friend_file, _kind, _size, filename|
+    in_friend_file.receive_to File.join(dir, "#{filename}.recv")
+    in_friend_file.control Tox::FileControl::RESUME
+  end
+
+  receiver.on_file_recv_chunk do |_in_friend_file, _position, data|
+    received[0] += 1 if data.empty?
+  end
+
+  received
+end
+
+# Sends the files and waits until the count of finished files is reached.
+# Returns the seconds it took.
+def transfer(clients, paths, received, count)
+  sender = clients.first
+  started_at = Time.now
+  deadline = started_at + TIMEOUT
+
+  send_files sender.friend(sender.friend_numbers.first), paths, clients
+
+  iterate clients until received[0] >= count || Time.now > deadline
+
+  Time.now - started_at
+end
+
+def report(backend, count, total, elapsed)
+  mib = count * FILE_SIZE / 1024.0 / 1024.0
+
+  format(
+    '%-9s %3d/%d transfers  %8.2f MiB  %7.2f s  %8.2f MiB/s',
+    backend, count, total, mib, elapsed, mib / elapsed,
+  )
+end
+
+def run(backend, paths, dir)
+  clients  = connected_clients backend
+  received = receive_files clients.last, dir
+
+  transfer clients, [paths.first], received, 1
+  raise 'Warm-up transfer did not finish' unless received[0] == 1
+
+  elapsed = transfer clients, paths, received, paths.size + 1
+
+  report backend, received[0] - 1, paths.size, elapsed
+end
+
+dir = Dir.mktmpdir 'tox-benchmark-'
+
+Support::FakeBootstrapNetwork.start
+
+begin
+  paths = Array.new(TRANSFERS) do |index|
+    File.join(dir, "file-#{index}").tap do |path|
+      File.binwrite path, SecureRandom.random_bytes(FILE_SIZE)
+    end
+  end
+
+  backends = [Tox::FileIOBackend::PREAD, Tox::FileIOBackend::IO_URING]
+
+  puts "#{TRANSFERS} parallel transfers of #{FILE_SIZE} bytes"
+
+  backends.each do |backend|
+    begin
+      puts run(backend, paths, dir)
+    rescue NotImplementedError
+      puts format('%-9s not available', backend)
+    end
+  end
+ensure
+  Support::FakeBootstrapNetwork.stop
+  FileUtils.remove_entry dir
+end
@@ -71,6 +71,7 @@ do |in_friend_file, file_kind, file_size, filename|
 
   $file = File.open FILE_NAME, 'w'
 
+  in_friend_file.enable_digest
   in_friend_file.control Tox::FileControl::RESUME
 end
 
@@ -99,7 +100,10 @@ tox_client.on_file_recv_chunk do |in_friend_file, position, data|
   puts
 
   if data.bytesize.zero?
+    digest = in_friend_file.digest
+
     puts 'Empty chunk. Closing file...'
+    puts "SHA-256:       #{digest ? digest.unpack('H*').first : 'unknown'}"
     puts
 
     $file.close
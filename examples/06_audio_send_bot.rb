@@ -4,7 +4,6 @@
 require 'bundler/setup'
 
 require 'tox'
-require 'opus_file'
 
 NAME = 'AudioSendBot'
 STATUS_MESSAGE = 'Call me'
@@ -13,8 +12,6 @@ TEST_FILE = File.expand_path('../multimedia/opus.ogg', __dir__).freeze
 
 AUDIO_BIT_RATE = 48
 
-opus_files = {}
-
 tox_client = Tox::Client.new
 
 tox_client.name = NAME
@@ -44,39 +41,10 @@ tox_client.audio_video.on_call do |friend_call_request|
 
   friend_call_request.answer AUDIO_BIT_RATE, nil
 
-  opus_files[friend_call_request.friend_number] = OpusFile.new TEST_FILE
-end
-
-tox_client.audio_video.on_call_state_change do |friend_call, friend_call_state|
-  next unless friend_call_state.error? || friend_call_state.finished?
-  opus_files[friend_call.friend_number] = nil
-end
-
-tox_client.audio_video.on_audio_frame do |friend_call, _audio_frame|
-  new_audio_frame = Tox::AudioFrame.new
-
-  opus_file = opus_files[friend_call.friend_number]
-
-  next if opus_file.nil?
-
-  unless opus_file.pcm_total(-1) > opus_file.pcm_tell
-    puts 'EOF, seeking to start'
-    puts
-
-    opus_file.pcm_seek 0
-  end
-
-  new_audio_frame.pcm           = opus_file.read 1920
-  new_audio_frame.sample_count  = 960
-  new_audio_frame.channels      = 2
-  new_audio_frame.sampling_rate = AUDIO_BIT_RATE * 1000
-
-  begin
-    friend_call.send_audio_frame new_audio_frame
-  rescue
-    # Just ignore errors.
-    nil
-  end
+  Tox::FriendCall.new(
+    tox_client.audio_video,
+    friend_call_request.friend_number,
+  ).stream_file TEST_FILE
 end
 
 puts 'Running. Send me friend request, I\'ll accept it immediately. ' \
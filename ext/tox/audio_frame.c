@@ -2,10 +2,14 @@
 
 // Memory management
 static VALUE mTox_cAudioFrame_alloc(VALUE klass);
-static void  mTox_cAudioFrame_free(mTox_cAudioFrame_CDATA *free_cdata);
+static void  mTox_cAudioFrame_mark(void *mark_cdata);
+static void  mTox_cAudioFrame_free(void *free_cdata);
 
 // Public methods
 
+static VALUE mTox_cAudioFrame_pcm(VALUE self);
+static VALUE mTox_cAudioFrame_pcm_ASSIGN(VALUE self, VALUE pcm);
+
 static VALUE mTox_cAudioFrame_sample_count(VALUE self);
 static VALUE mTox_cAudioFrame_sample_count_ASSIGN(VALUE self, VALUE sample_count);
 
@@ -15,6 +19,50 @@ static VALUE mTox_cAudioFrame_channels_ASSIGN(VALUE self, VALUE channels);
 static VALUE mTox_cAudioFrame_sampling_rate(VALUE self);
 static VALUE mTox_cAudioFrame_sampling_rate_ASSIGN(VALUE self, VALUE sampling_rate);
 
+static VALUE mTox_cAudioFrame_valid_QUESTION(VALUE self);
+
+static VALUE mTox_cAudioFrame_rms(VALUE self);
+static VALUE mTox_cAudioFrame_peak(VALUE self);
+static VALUE mTox_cAudioFrame_clipped_count(VALUE self);
+
+#ifdef HAVE_RUBY_MEMORY_VIEW_H
+// Memory view
+static bool mTox_cAudioFrame_memory_view_get(VALUE self, rb_memory_view_t *view, int flags);
+static bool mTox_cAudioFrame_memory_view_release(VALUE self, rb_memory_view_t *view);
+static bool mTox_cAudioFrame_memory_view_available_p(VALUE self);
+#endif
+
+// Private functions
+
+static size_t mTox_cAudioFrame_LEVEL(VALUE self, mTox_AUDIO_LEVEL *level);
+
+// Sampling rates and lengths in tenths of milliseconds which toxav accepts.
+static const uint32_t mTox_cAudioFrame_SAMPLING_RATES[] = {
+  8000, 12000, 16000, 24000, 48000,
+};
+
+static const uint32_t mTox_cAudioFrame_AUDIO_LENGTHS[] = {
+  25, 50, 100, 200, 400, 600,
+};
+
+const rb_data_type_t mTox_cAudioFrame_TYPE = {
+  .wrap_struct_name = "Tox::AudioFrame",
+  .function = {
+    .dmark = mTox_cAudioFrame_mark,
+    .dfree = mTox_cAudioFrame_free,
+  },
+  .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+#ifdef HAVE_RUBY_MEMORY_VIEW_H
+// Samples by channel as a matrix of native 16-bit integers.
+static const rb_memory_view_entry_t mTox_cAudioFrame_MEMORY_VIEW = {
+  .get_func         = mTox_cAudioFrame_memory_view_get,
+  .release_func     = mTox_cAudioFrame_memory_view_release,
+  .available_p_func = mTox_cAudioFrame_memory_view_available_p,
+};
+#endif
+
 /*************************************************************
  * Initialization
  *************************************************************/
@@ -26,6 +74,9 @@ void mTox_cAudioFrame_INIT()
 
   // Public methods
 
+  rb_define_method(mTox_cAudioFrame, "pcm",  mTox_cAudioFrame_pcm,        0);
+  rb_define_method(mTox_cAudioFrame, "pcm=", mTox_cAudioFrame_pcm_ASSIGN, 1);
+
   rb_define_method(mTox_cAudioFrame, "sample_count",  mTox_cAudioFrame_sample_count,        0);
   rb_define_method(mTox_cAudioFrame, "sample_count=", mTox_cAudioFrame_sample_count_ASSIGN, 1);
 
@@ -34,22 +85,50 @@ void mTox_cAudioFrame_INIT()
 
   rb_define_method(mTox_cAudioFrame, "sampling_rate",  mTox_cAudioFrame_sampling_rate,        0);
   rb_define_method(mTox_cAudioFrame, "sampling_rate=", mTox_cAudioFrame_sampling_rate_ASSIGN, 1);
+
+  rb_define_method(mTox_cAudioFrame, "valid?", mTox_cAudioFrame_valid_QUESTION, 0);
+
+  rb_define_method(mTox_cAudioFrame, "rms",           mTox_cAudioFrame_rms,           0);
+  rb_define_method(mTox_cAudioFrame, "peak",          mTox_cAudioFrame_peak,          0);
+  rb_define_method(mTox_cAudioFrame, "clipped_count", mTox_cAudioFrame_clipped_count, 0);
+
+#ifdef HAVE_RUBY_MEMORY_VIEW_H
+  // Memory view
+  rb_memory_view_register(mTox_cAudioFrame, &mTox_cAudioFrame_MEMORY_VIEW);
+#endif
 }
 
 /*************************************************************
  * Memory management
  *************************************************************/
 
+// Fresh frames hold frozen empty PCM, so received frames get new buffers.
 VALUE mTox_cAudioFrame_alloc(const VALUE klass)
 {
   mTox_cAudioFrame_CDATA *alloc_cdata = ALLOC(mTox_cAudioFrame_CDATA);
 
   memset(alloc_cdata, 0, sizeof(mTox_cAudioFrame_CDATA));
 
-  return Data_Wrap_Struct(klass, NULL, mTox_cAudioFrame_free, alloc_cdata);
+  alloc_cdata->pcm     = Qnil;
+  alloc_cdata->exports = Qnil;
+
+  const VALUE self =
+    TypedData_Wrap_Struct(klass, &mTox_cAudioFrame_TYPE, alloc_cdata);
+
+  mTox_cAudioFrame_SET_PCM(self, alloc_cdata, rb_obj_freeze(rb_str_new(NULL, 0)));
+
+  return self;
 }
 
-void mTox_cAudioFrame_free(mTox_cAudioFrame_CDATA *const free_cdata)
+void mTox_cAudioFrame_mark(void *const mark_cdata)
+{
+  const mTox_cAudioFrame_CDATA *const cdata = mark_cdata;
+
+  rb_gc_mark(cdata->pcm);
+  rb_gc_mark(cdata->exports);
+}
+
+void mTox_cAudioFrame_free(void *const free_cdata)
 {
   free(free_cdata);
 }
@@ -58,10 +137,30 @@ void mTox_cAudioFrame_free(mTox_cAudioFrame_CDATA *const free_cdata)
  * Public methods
  *************************************************************/
 
+// Tox::AudioFrame#pcm
+VALUE mTox_cAudioFrame_pcm(const VALUE self)
+{
+  AUDIO_FRAME_CDATA(self, self_cdata);
+
+  return self_cdata->pcm;
+}
+
+// Tox::AudioFrame#pcm=
+VALUE mTox_cAudioFrame_pcm_ASSIGN(const VALUE self, const VALUE pcm)
+{
+  Check_Type(pcm, T_STRING);
+
+  AUDIO_FRAME_CDATA(self, self_cdata);
+
+  mTox_cAudioFrame_SET_PCM(self, self_cdata, pcm);
+
+  return Qnil;
+}
+
 // Tox::AudioFrame#sample_count
 VALUE mTox_cAudioFrame_sample_count(const VALUE self)
 {
-  CDATA(self, mTox_cAudioFrame_CDATA, self_cdata);
+  AUDIO_FRAME_CDATA(self, self_cdata);
 
   return LONG2NUM(self_cdata->sample_count);
 }
@@ -69,9 +168,14 @@ VALUE mTox_cAudioFrame_sample_count(const VALUE self)
 // Tox::AudioFrame#sample_count=
 VALUE mTox_cAudioFrame_sample_count_ASSIGN(const VALUE self, const VALUE sample_count)
 {
-  CDATA(self, mTox_cAudioFrame_CDATA, self_cdata);
+  AUDIO_FRAME_CDATA(self, self_cdata);
 
-  self_cdata->sample_count = NUM2LONG(sample_count);
+  mTox_cAudioFrame_SET_FORMAT(
+    self_cdata,
+    NUM2LONG(sample_count),
+    self_cdata->channels,
+    self_cdata->sampling_rate
+  );
 
   return Qnil;
 }
@@ -79,7 +183,7 @@ VALUE mTox_cAudioFrame_sample_count_ASSIGN(const VALUE self, const VALUE sample_
 // Tox::AudioFrame#channels
 VALUE mTox_cAudioFrame_channels(const VALUE self)
 {
-  CDATA(self, mTox_cAudioFrame_CDATA, self_cdata);
+  AUDIO_FRAME_CDATA(self, self_cdata);
 
   return UINT2NUM(self_cdata->channels);
 }
@@ -87,9 +191,14 @@ VALUE mTox_cAudioFrame_channels(const VALUE self)
 // Tox::AudioFrame#channels=
 VALUE mTox_cAudioFrame_channels_ASSIGN(const VALUE self, const VALUE channels)
 {
-  CDATA(self, mTox_cAudioFrame_CDATA, self_cdata);
+  AUDIO_FRAME_CDATA(self, self_cdata);
 
-  self_cdata->channels = NUM2UINT(channels);
+  mTox_cAudioFrame_SET_FORMAT(
+    self_cdata,
+    self_cdata->sample_count,
+    NUM2UINT(channels),
+    self_cdata->sampling_rate
+  );
 
   return Qnil;
 }
@@ -97,7 +206,7 @@ VALUE mTox_cAudioFrame_channels_ASSIGN(const VALUE self, const VALUE channels)
 // Tox::AudioFrame#sampling_rate
 VALUE mTox_cAudioFrame_sampling_rate(const VALUE self)
 {
-  CDATA(self, mTox_cAudioFrame_CDATA, self_cdata);
+  AUDIO_FRAME_CDATA(self, self_cdata);
 
   return ULONG2NUM(self_cdata->sampling_rate);
 }
@@ -105,9 +214,225 @@ VALUE mTox_cAudioFrame_sampling_rate(const VALUE self)
 // Tox::AudioFrame#sampling_rate=
 VALUE mTox_cAudioFrame_sampling_rate_ASSIGN(const VALUE self, const VALUE sampling_rate)
 {
-  CDATA(self, mTox_cAudioFrame_CDATA, self_cdata);
+  AUDIO_FRAME_CDATA(self, self_cdata);
 
-  self_cdata->sampling_rate = NUM2ULONG(sampling_rate);
+  mTox_cAudioFrame_SET_FORMAT(
+    self_cdata,
+    self_cdata->sample_count,
+    self_cdata->channels,
+    NUM2ULONG(sampling_rate)
+  );
 
   return Qnil;
 }
+
+// Tox::AudioFrame#valid?
+VALUE mTox_cAudioFrame_valid_QUESTION(const VALUE self)
+{
+  AUDIO_FRAME_CDATA(self, self_cdata);
+
+  if (mTox_cAudioFrame_VALID(self_cdata)) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::AudioFrame#rms
+VALUE mTox_cAudioFrame_rms(const VALUE self)
+{
+  mTox_AUDIO_LEVEL level;
+
+  const size_t length = mTox_cAudioFrame_LEVEL(self, &level);
+
+  return DBL2NUM(mTox_AUDIO_LEVEL_RMS(&level, length));
+}
+
+// Tox::AudioFrame#peak
+VALUE mTox_cAudioFrame_peak(const VALUE self)
+{
+  mTox_AUDIO_LEVEL level;
+
+  mTox_cAudioFrame_LEVEL(self, &level);
+
+  return DBL2NUM(mTox_AUDIO_LEVEL_PEAK(&level));
+}
+
+// Tox::AudioFrame#clipped_count
+VALUE mTox_cAudioFrame_clipped_count(const VALUE self)
+{
+  mTox_AUDIO_LEVEL level;
+
+  mTox_cAudioFrame_LEVEL(self, &level);
+
+  return SIZET2NUM(level.clipped);
+}
+
+/*************************************************************
+ * Memory view
+ *************************************************************/
+
+#ifdef HAVE_RUBY_MEMORY_VIEW_H
+bool mTox_cAudioFrame_memory_view_get(
+  const VALUE self,
+  rb_memory_view_t *const view,
+  const int flags
+)
+{
+  AUDIO_FRAME_CDATA(self, self_cdata);
+
+  const VALUE pcm = self_cdata->pcm;
+
+  const bool readonly = OBJ_FROZEN(pcm);
+
+  if (readonly && (flags & RUBY_MEMORY_VIEW_WRITABLE)) {
+    return false;
+  }
+
+  // Writes must not reach strings which share the buffer.
+  if (!readonly && !mTox_MEMORY_VIEW_EXPORTED(self_cdata->exports, pcm)) {
+    rb_str_modify(pcm);
+  }
+
+  // Shape followed by strides.
+  ssize_t *const layout = ALLOC_N(ssize_t, 4);
+
+  layout[0] = self_cdata->sample_count;
+  layout[1] = self_cdata->channels;
+  layout[2] = self_cdata->channels * sizeof(int16_t);
+  layout[3] = sizeof(int16_t);
+
+  mTox_MEMORY_VIEW_EXPORT(self, &self_cdata->exports, pcm);
+
+  view->obj                  = self;
+  view->data                 = RSTRING_PTR(pcm);
+  view->byte_size            = self_cdata->pcm_size;
+  view->readonly             = readonly;
+  view->format               = "s";
+  view->item_size            = sizeof(int16_t);
+  view->item_desc.components = NULL;
+  view->item_desc.length     = 0;
+  view->ndim                 = 2;
+  view->shape                = &layout[0];
+  view->strides              = &layout[2];
+  view->sub_offsets          = NULL;
+  view->private_data         = (void*)pcm;
+
+  return true;
+}
+
+bool mTox_cAudioFrame_memory_view_release(
+  const VALUE self,
+  rb_memory_view_t *const view
+)
+{
+  AUDIO_FRAME_CDATA(self, self_cdata);
+
+  mTox_MEMORY_VIEW_UNEXPORT(self_cdata->exports, (VALUE)view->private_data);
+
+  xfree((void*)view->shape);
+
+  return true;
+}
+
+// Views cover whole frames, so PCM must have all of their samples.
+bool mTox_cAudioFrame_memory_view_available_p(const VALUE self)
+{
+  AUDIO_FRAME_CDATA(self, self_cdata);
+
+  return self_cdata->pcm_size > 0 &&
+    (size_t)RSTRING_LEN(self_cdata->pcm) >= self_cdata->pcm_size;
+}
+#endif
+
+/*************************************************************
+ * Frames
+ *************************************************************/
+
+bool mTox_cAudioFrame_IS(const VALUE value)
+{
+  return rb_typeddata_is_kind_of(value, &mTox_cAudioFrame_TYPE);
+}
+
+void mTox_cAudioFrame_SET_PCM(
+  const VALUE self,
+  mTox_cAudioFrame_CDATA *const self_cdata,
+  const VALUE pcm
+)
+{
+  RB_OBJ_WRITE(self, &self_cdata->pcm, pcm);
+}
+
+// Validity of the format is only computed here, so sending a frame costs
+// a couple of comparisons.
+VALUE mTox_cAudioFrame_REUSABLE_PCM(
+  const mTox_cAudioFrame_CDATA *const self_cdata
+)
+{
+  if (mTox_MEMORY_VIEW_EXPORTED(self_cdata->exports, self_cdata->pcm)) {
+    return Qnil;
+  }
+
+  return self_cdata->pcm;
+}
+
+void mTox_cAudioFrame_SET_FORMAT(
+  mTox_cAudioFrame_CDATA *const self_cdata,
+  const size_t sample_count,
+  const uint8_t channels,
+  const uint32_t sampling_rate
+)
+{
+  self_cdata->sample_count  = sample_count;
+  self_cdata->channels      = channels;
+  self_cdata->sampling_rate = sampling_rate;
+  self_cdata->pcm_size      = sample_count * channels * sizeof(int16_t);
+  self_cdata->format_valid  = false;
+
+  bool sampling_rate_valid = false;
+
+  for (size_t i = 0; i < sizeof(mTox_cAudioFrame_SAMPLING_RATES) / sizeof(uint32_t); ++i) {
+    if (sampling_rate == mTox_cAudioFrame_SAMPLING_RATES[i]) {
+      sampling_rate_valid = true;
+      break;
+    }
+  }
+
+  if (!sampling_rate_valid) {
+    return;
+  }
+
+  for (size_t i = 0; i < sizeof(mTox_cAudioFrame_AUDIO_LENGTHS) / sizeof(uint32_t); ++i) {
+    if ((uint64_t)sample_count * 10000 ==
+        (uint64_t)sampling_rate * mTox_cAudioFrame_AUDIO_LENGTHS[i]) {
+      self_cdata->format_valid = true;
+      break;
+    }
+  }
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+// Measures the samples which the frame has, up to its sample count, and
+// returns their number.
+size_t mTox_cAudioFrame_LEVEL(const VALUE self, mTox_AUDIO_LEVEL *const level)
+{
+  AUDIO_FRAME_CDATA(self, self_cdata);
+
+  size_t length = RSTRING_LEN(self_cdata->pcm) / sizeof(int16_t);
+
+  if (length > self_cdata->sample_count * self_cdata->channels) {
+    length = self_cdata->sample_count * self_cdata->channels;
+  }
+
+  mTox_AUDIO_LEVEL_MEASURE(
+    (const int16_t*)RSTRING_PTR(self_cdata->pcm),
+    length,
+    level
+  );
+
+  return length;
+}
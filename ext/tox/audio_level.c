@@ -0,0 +1,305 @@
+#include "tox.h"
+
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+typedef struct {
+  uint64_t energy;
+  size_t   length;
+  uint16_t peak;
+} mTox_AUDIO_METER_FRAME;
+
+struct mTox_AUDIO_METER {
+  uint32_t friend_number;
+
+  size_t                 next;
+  mTox_AUDIO_METER_FRAME frames[mTox_AUDIO_METER_WINDOW_FRAMES];
+
+  uint64_t total_frames;
+  uint64_t total_clipped;
+};
+
+// Memory management
+static VALUE mTox_cAudioMeter_alloc(VALUE klass);
+static void  mTox_cAudioMeter_free(mTox_cAudioMeter_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cAudioMeter_initialize(VALUE self);
+static VALUE mTox_cAudioMeter_push(VALUE self, VALUE audio_frame);
+static VALUE mTox_cAudioMeter_stats(VALUE self);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cAudioMeter_INIT()
+{
+  // Meters like the ones of Tox::FriendCall#audio_level_stats. Private,
+  // only the specs create meters of their own.
+  mTox_cAudioMeter = rb_define_class_under(mTox, "AudioMeter", rb_cObject);
+  rb_funcall(mTox, rb_intern("private_constant"), 1, ID2SYM(rb_intern("AudioMeter")));
+
+  // Memory management
+  rb_define_alloc_func(mTox_cAudioMeter, mTox_cAudioMeter_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cAudioMeter, "initialize", mTox_cAudioMeter_initialize, 0);
+  rb_define_method(mTox_cAudioMeter, "push",       mTox_cAudioMeter_push,       1);
+  rb_define_method(mTox_cAudioMeter, "stats",      mTox_cAudioMeter_stats,      0);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cAudioMeter_alloc(const VALUE klass)
+{
+  mTox_cAudioMeter_CDATA *alloc_cdata = ALLOC(mTox_cAudioMeter_CDATA);
+
+  alloc_cdata->audio_meter = NULL;
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cAudioMeter_free, alloc_cdata);
+}
+
+void mTox_cAudioMeter_free(mTox_cAudioMeter_CDATA *const free_cdata)
+{
+  mTox_AUDIO_METER_FREE(free_cdata->audio_meter);
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::AudioMeter#initialize
+VALUE mTox_cAudioMeter_initialize(const VALUE self)
+{
+  CDATA(self, mTox_cAudioMeter_CDATA, self_cdata);
+
+  mTox_AUDIO_METER_FREE(self_cdata->audio_meter);
+
+  self_cdata->audio_meter = mTox_AUDIO_METER_NEW(0);
+
+  return self;
+}
+
+// Tox::AudioMeter#push
+VALUE mTox_cAudioMeter_push(const VALUE self, const VALUE audio_frame)
+{
+  if (!mTox_cAudioFrame_IS(audio_frame)) {
+    RAISE_TYPECHECK("Tox::AudioMeter#push", "audio_frame", "Tox::AudioFrame");
+  }
+
+  CDATA(self, mTox_cAudioMeter_CDATA, self_cdata);
+
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  if (!mTox_cAudioFrame_VALID(audio_frame_cdata)) {
+    rb_raise(rb_eArgError, "audio frame is invalid");
+  }
+
+  mTox_AUDIO_METER_PUSH(
+    self_cdata->audio_meter,
+    (const int16_t*)RSTRING_PTR(audio_frame_cdata->pcm),
+    audio_frame_cdata->sample_count * audio_frame_cdata->channels
+  );
+
+  return self;
+}
+
+// Tox::AudioMeter#stats
+VALUE mTox_cAudioMeter_stats(const VALUE self)
+{
+  CDATA(self, mTox_cAudioMeter_CDATA, self_cdata);
+
+  return mTox_AUDIO_METER_STATS_HASH(self_cdata->audio_meter);
+}
+
+/*************************************************************
+ * Levels
+ *************************************************************/
+
+// Squares of two samples of full scale make 2^31, so sums of pairs are
+// widened as unsigned.
+void mTox_AUDIO_LEVEL_MEASURE(
+  const int16_t *const pcm,
+  const size_t length,
+  mTox_AUDIO_LEVEL *const level
+)
+{
+  uint64_t energy  = 0;
+  uint16_t peak    = 0;
+  size_t   clipped = 0;
+  size_t   i       = 0;
+
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i full = _mm_set1_epi16(INT16_MAX);
+
+  __m128i vector_energy = _mm_setzero_si128();
+  __m128i vector_peak   = _mm_setzero_si128();
+
+  for (; i + 8 <= length; i += 8) {
+    const __m128i samples = _mm_loadu_si128((const __m128i*)&pcm[i]);
+    const __m128i squares = _mm_madd_epi16(samples, samples);
+
+    vector_energy =
+      _mm_add_epi64(vector_energy, _mm_unpacklo_epi32(squares, zero));
+    vector_energy =
+      _mm_add_epi64(vector_energy, _mm_unpackhi_epi32(squares, zero));
+
+    const __m128i magnitudes =
+      _mm_max_epi16(samples, _mm_subs_epi16(zero, samples));
+
+    vector_peak = _mm_max_epi16(vector_peak, magnitudes);
+
+    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(magnitudes, full));
+
+    clipped += __builtin_popcount(mask) / 2;
+  }
+
+  uint64_t energies[2];
+  int16_t  peaks[8];
+
+  _mm_storeu_si128((__m128i*)energies, vector_energy);
+  _mm_storeu_si128((__m128i*)peaks,    vector_peak);
+
+  energy = energies[0] + energies[1];
+
+  for (size_t j = 0; j < 8; ++j) {
+    if (peaks[j] > peak) {
+      peak = peaks[j];
+    }
+  }
+#endif
+
+  for (; i < length; ++i) {
+    const int32_t sample = pcm[i];
+    const uint16_t magnitude =
+      sample < -INT16_MAX ? INT16_MAX : (sample < 0 ? -sample : sample);
+
+    energy += sample * sample;
+
+    if (magnitude > peak) {
+      peak = magnitude;
+    }
+
+    if (magnitude == INT16_MAX) {
+      ++clipped;
+    }
+  }
+
+  level->energy  = energy;
+  level->peak    = peak;
+  level->clipped = clipped;
+}
+
+double mTox_AUDIO_LEVEL_RMS(
+  const mTox_AUDIO_LEVEL *const level,
+  const size_t length
+)
+{
+  if (length == 0) {
+    return 0;
+  }
+
+  return sqrt((double)level->energy / length) / mTox_AUDIO_LEVEL_FULL_SCALE;
+}
+
+double mTox_AUDIO_LEVEL_PEAK(const mTox_AUDIO_LEVEL *const level)
+{
+  return level->peak / mTox_AUDIO_LEVEL_FULL_SCALE;
+}
+
+/*************************************************************
+ * Meters
+ *************************************************************/
+
+mTox_AUDIO_METER *mTox_AUDIO_METER_NEW(const uint32_t friend_number)
+{
+  mTox_AUDIO_METER *const meter = ALLOC(mTox_AUDIO_METER);
+
+  memset(meter, 0, sizeof(mTox_AUDIO_METER));
+
+  meter->friend_number = friend_number;
+
+  return meter;
+}
+
+void mTox_AUDIO_METER_FREE(mTox_AUDIO_METER *const meter)
+{
+  free(meter);
+}
+
+uint32_t mTox_AUDIO_METER_FRIEND_NUMBER(const mTox_AUDIO_METER *const meter)
+{
+  return meter->friend_number;
+}
+
+void mTox_AUDIO_METER_PUSH(
+  mTox_AUDIO_METER *const meter,
+  const int16_t *const pcm,
+  const size_t length
+)
+{
+  mTox_AUDIO_LEVEL level;
+
+  mTox_AUDIO_LEVEL_MEASURE(pcm, length, &level);
+
+  mTox_AUDIO_METER_FRAME *const frame = &meter->frames[meter->next];
+
+  frame->energy = level.energy;
+  frame->length = length;
+  frame->peak   = level.peak;
+
+  meter->next = (meter->next + 1) % mTox_AUDIO_METER_WINDOW_FRAMES;
+
+  ++meter->total_frames;
+  meter->total_clipped += level.clipped;
+}
+
+void mTox_AUDIO_METER_GET_STATS(
+  const mTox_AUDIO_METER *const meter,
+  mTox_AUDIO_METER_STATS *const stats
+)
+{
+  mTox_AUDIO_LEVEL level = { 0, 0, 0 };
+  size_t length = 0;
+
+  for (size_t i = 0; i < mTox_AUDIO_METER_WINDOW_FRAMES; ++i) {
+    const mTox_AUDIO_METER_FRAME *const frame = &meter->frames[i];
+
+    level.energy += frame->energy;
+    length       += frame->length;
+
+    if (frame->peak > level.peak) {
+      level.peak = frame->peak;
+    }
+  }
+
+  stats->rms     = mTox_AUDIO_LEVEL_RMS(&level, length);
+  stats->peak    = mTox_AUDIO_LEVEL_PEAK(&level);
+  stats->frames  = meter->total_frames;
+  stats->clipped = meter->total_clipped;
+}
+
+VALUE mTox_AUDIO_METER_STATS_HASH(const mTox_AUDIO_METER *const meter)
+{
+  mTox_AUDIO_METER_STATS stats;
+
+  mTox_AUDIO_METER_GET_STATS(meter, &stats);
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("rms")),     DBL2NUM(stats.rms));
+  rb_hash_aset(result, ID2SYM(rb_intern("peak")),    DBL2NUM(stats.peak));
+  rb_hash_aset(result, ID2SYM(rb_intern("frames")),  ULL2NUM(stats.frames));
+  rb_hash_aset(result, ID2SYM(rb_intern("clipped")), ULL2NUM(stats.clipped));
+
+  return result;
+}
@@ -0,0 +1,54 @@
+// Levels of audio. Energy, peak and clipped samples of a frame are measured
+// in one pass over its samples. Meters keep the levels of the last frames
+// received from a friend, so levels can be read without touching samples.
+
+#define mTox_AUDIO_LEVEL_FULL_SCALE 32768.0
+
+// Meters average this many of the last frames.
+#define mTox_AUDIO_METER_WINDOW_FRAMES 50
+
+typedef struct {
+  uint64_t energy;
+  uint16_t peak;
+  size_t   clipped;
+} mTox_AUDIO_LEVEL;
+
+typedef struct mTox_AUDIO_METER mTox_AUDIO_METER;
+
+typedef struct {
+  double   rms;
+  double   peak;
+  uint64_t frames;
+  uint64_t clipped;
+} mTox_AUDIO_METER_STATS;
+
+// Peaks saturate at 32767, which also counts as clipped.
+void mTox_AUDIO_LEVEL_MEASURE(
+  const int16_t *pcm,
+  size_t length,
+  mTox_AUDIO_LEVEL *level
+);
+
+// Relative to full scale.
+double mTox_AUDIO_LEVEL_RMS(const mTox_AUDIO_LEVEL *level, size_t length);
+double mTox_AUDIO_LEVEL_PEAK(const mTox_AUDIO_LEVEL *level);
+
+mTox_AUDIO_METER *mTox_AUDIO_METER_NEW(uint32_t friend_number);
+
+void mTox_AUDIO_METER_FREE(mTox_AUDIO_METER *meter);
+
+uint32_t mTox_AUDIO_METER_FRIEND_NUMBER(const mTox_AUDIO_METER *meter);
+
+void mTox_AUDIO_METER_PUSH(
+  mTox_AUDIO_METER *meter,
+  const int16_t *pcm,
+  size_t length
+);
+
+void mTox_AUDIO_METER_GET_STATS(
+  const mTox_AUDIO_METER *meter,
+  mTox_AUDIO_METER_STATS *stats
+);
+
+// Stats for Ruby, relative to full scale.
+VALUE mTox_AUDIO_METER_STATS_HASH(const mTox_AUDIO_METER *meter);
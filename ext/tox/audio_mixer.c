@@ -0,0 +1,462 @@
+#include "tox.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Memory management
+static VALUE mTox_cAudioMixer_alloc(VALUE klass);
+static void  mTox_cAudioMixer_free(mTox_cAudioMixer_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cAudioMixer_sampling_rate(VALUE self);
+static VALUE mTox_cAudioMixer_channels(VALUE self);
+
+static VALUE mTox_cAudioMixer_push(VALUE self, VALUE source, VALUE audio_frame);
+static VALUE mTox_cAudioMixer_delete(VALUE self, VALUE source);
+static VALUE mTox_cAudioMixer_sources(VALUE self);
+static VALUE mTox_cAudioMixer_buffered(VALUE self, VALUE source);
+static VALUE mTox_cAudioMixer_mix(VALUE self, VALUE sample_count);
+
+// Private methods
+
+static VALUE mTox_cAudioMixer_initialize_with(VALUE self, VALUE sampling_rate, VALUE channels);
+
+// Private functions
+
+static mTox_cAudioMixer_SOURCE *mTox_cAudioMixer_SOURCE_GET(
+  mTox_cAudioMixer_CDATA *self_cdata,
+  uint32_t source_data,
+  bool create
+);
+
+static void mTox_cAudioMixer_ACCUMULATE(int32_t *total, const int16_t *samples, size_t length);
+static void mTox_cAudioMixer_SUBTRACT(int16_t *mix, const int32_t *total, const int16_t *samples, size_t length);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cAudioMixer_INIT()
+{
+  // Memory management
+  rb_define_alloc_func(mTox_cAudioMixer, mTox_cAudioMixer_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cAudioMixer, "sampling_rate", mTox_cAudioMixer_sampling_rate, 0);
+  rb_define_method(mTox_cAudioMixer, "channels",      mTox_cAudioMixer_channels,      0);
+
+  rb_define_method(mTox_cAudioMixer, "push",     mTox_cAudioMixer_push,     2);
+  rb_define_method(mTox_cAudioMixer, "delete",   mTox_cAudioMixer_delete,   1);
+  rb_define_method(mTox_cAudioMixer, "sources",  mTox_cAudioMixer_sources,  0);
+  rb_define_method(mTox_cAudioMixer, "buffered", mTox_cAudioMixer_buffered, 1);
+  rb_define_method(mTox_cAudioMixer, "mix",      mTox_cAudioMixer_mix,      1);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cAudioMixer, "initialize_with", mTox_cAudioMixer_initialize_with, 2);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cAudioMixer_alloc(const VALUE klass)
+{
+  mTox_cAudioMixer_CDATA *alloc_cdata = ALLOC(mTox_cAudioMixer_CDATA);
+
+  memset(alloc_cdata, 0, sizeof(mTox_cAudioMixer_CDATA));
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cAudioMixer_free, alloc_cdata);
+}
+
+void mTox_cAudioMixer_free(mTox_cAudioMixer_CDATA *const free_cdata)
+{
+  for (size_t i = 0; i < free_cdata->sources_size; ++i) {
+    free(free_cdata->sources[i].samples);
+  }
+
+  free(free_cdata->sources);
+  free(free_cdata->total);
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::AudioMixer#sampling_rate
+VALUE mTox_cAudioMixer_sampling_rate(const VALUE self)
+{
+  CDATA(self, mTox_cAudioMixer_CDATA, self_cdata);
+
+  return ULONG2NUM(self_cdata->sampling_rate);
+}
+
+// Tox::AudioMixer#channels
+VALUE mTox_cAudioMixer_channels(const VALUE self)
+{
+  CDATA(self, mTox_cAudioMixer_CDATA, self_cdata);
+
+  return UINT2NUM(self_cdata->channels);
+}
+
+// Tox::AudioMixer#push
+VALUE mTox_cAudioMixer_push(
+  const VALUE self,
+  const VALUE source,
+  const VALUE audio_frame
+)
+{
+  if (!mTox_cAudioFrame_IS(audio_frame)) {
+    RAISE_TYPECHECK(
+      "Tox::AudioMixer#push",
+      "audio_frame",
+      "Tox::AudioFrame"
+    );
+  }
+
+  const uint32_t source_data = NUM2ULONG(source);
+
+  CDATA(self, mTox_cAudioMixer_CDATA, self_cdata);
+
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  if (audio_frame_cdata->sampling_rate != self_cdata->sampling_rate ||
+      audio_frame_cdata->channels      != self_cdata->channels) {
+    rb_raise(rb_eArgError, "audio frame format does not match the mixer");
+  }
+
+  const VALUE pcm = audio_frame_cdata->pcm;
+
+  size_t length = audio_frame_cdata->sample_count * self_cdata->channels;
+
+  if ((size_t)RSTRING_LEN(pcm) < length * sizeof(int16_t)) {
+    rb_raise(rb_eArgError, "audio frame is invalid");
+  }
+
+  const int16_t *samples = (const int16_t*)RSTRING_PTR(pcm);
+
+  // Sources which are ahead of the mix lose their oldest samples.
+  const size_t capacity =
+    self_cdata->sampling_rate / 1000 * mTox_cAudioMixer_MAX_DELAY_MSEC *
+    self_cdata->channels;
+
+  if (length > capacity) {
+    samples += length - capacity;
+    length   = capacity;
+  }
+
+  mTox_cAudioMixer_SOURCE *const source_cdata =
+    mTox_cAudioMixer_SOURCE_GET(self_cdata, source_data, true);
+
+  if (source_cdata->size + length > capacity) {
+    const size_t dropped = source_cdata->size + length - capacity;
+
+    memmove(
+      source_cdata->samples,
+      &source_cdata->samples[dropped],
+      (source_cdata->size - dropped) * sizeof(int16_t)
+    );
+
+    source_cdata->size -= dropped;
+  }
+
+  if (source_cdata->capacity < capacity) {
+    REALLOC_N(source_cdata->samples, int16_t, capacity);
+    source_cdata->capacity = capacity;
+  }
+
+  memcpy(
+    &source_cdata->samples[source_cdata->size],
+    samples,
+    length * sizeof(int16_t)
+  );
+
+  source_cdata->size += length;
+
+  return Qnil;
+}
+
+// Tox::AudioMixer#delete
+VALUE mTox_cAudioMixer_delete(const VALUE self, const VALUE source)
+{
+  const uint32_t source_data = NUM2ULONG(source);
+
+  CDATA(self, mTox_cAudioMixer_CDATA, self_cdata);
+
+  for (size_t i = 0; i < self_cdata->sources_size; ++i) {
+    if (self_cdata->sources[i].id == source_data) {
+      free(self_cdata->sources[i].samples);
+
+      self_cdata->sources[i] = self_cdata->sources[--self_cdata->sources_size];
+
+      return Qtrue;
+    }
+  }
+
+  return Qfalse;
+}
+
+// Tox::AudioMixer#sources
+VALUE mTox_cAudioMixer_sources(const VALUE self)
+{
+  CDATA(self, mTox_cAudioMixer_CDATA, self_cdata);
+
+  const VALUE sources = rb_ary_new_capa(self_cdata->sources_size);
+
+  for (size_t i = 0; i < self_cdata->sources_size; ++i) {
+    rb_ary_push(sources, ULONG2NUM(self_cdata->sources[i].id));
+  }
+
+  return sources;
+}
+
+// Tox::AudioMixer#buffered
+VALUE mTox_cAudioMixer_buffered(const VALUE self, const VALUE source)
+{
+  const uint32_t source_data = NUM2ULONG(source);
+
+  CDATA(self, mTox_cAudioMixer_CDATA, self_cdata);
+
+  const mTox_cAudioMixer_SOURCE *const source_cdata =
+    mTox_cAudioMixer_SOURCE_GET(self_cdata, source_data, false);
+
+  if (!source_cdata) {
+    return LONG2FIX(0);
+  }
+
+  return ULONG2NUM(source_cdata->size / self_cdata->channels);
+}
+
+// Tox::AudioMixer#mix
+//
+// Every source gets the sum of all the other sources, so nobody hears
+// themselves. The sum is built once and the own samples of each source are
+// subtracted from it. Mixes are computed and the buffers consumed before
+// the block is called, so the block can push and delete sources.
+VALUE mTox_cAudioMixer_mix(const VALUE self, const VALUE sample_count)
+{
+  rb_need_block();
+
+  const size_t sample_count_data = NUM2ULONG(sample_count);
+
+  CDATA(self, mTox_cAudioMixer_CDATA, self_cdata);
+
+  const size_t sources_size = self_cdata->sources_size;
+  const size_t length       = sample_count_data * self_cdata->channels;
+
+  if (sources_size == 0 || length == 0) {
+    return Qnil;
+  }
+
+  if (self_cdata->total_capacity < length) {
+    REALLOC_N(self_cdata->total, int32_t, length);
+    self_cdata->total_capacity = length;
+  }
+
+  int32_t *const total = self_cdata->total;
+
+  memset(total, 0, length * sizeof(int32_t));
+
+  for (size_t i = 0; i < sources_size; ++i) {
+    const mTox_cAudioMixer_SOURCE *const source_cdata = &self_cdata->sources[i];
+
+    mTox_cAudioMixer_ACCUMULATE(
+      total,
+      source_cdata->samples,
+      source_cdata->size < length ? source_cdata->size : length
+    );
+  }
+
+  // Hidden string, so an exception in the block leaves nothing to free.
+  const VALUE mixes = rb_str_tmp_new(
+    sources_size * (sizeof(uint32_t) + length * sizeof(int16_t))
+  );
+
+  uint32_t *const ids = (uint32_t*)RSTRING_PTR(mixes);
+  int16_t  *const mix = (int16_t*)&ids[sources_size];
+
+  for (size_t i = 0; i < sources_size; ++i) {
+    mTox_cAudioMixer_SOURCE *const source_cdata = &self_cdata->sources[i];
+
+    const size_t available =
+      source_cdata->size < length ? source_cdata->size : length;
+
+    ids[i] = source_cdata->id;
+
+    mTox_cAudioMixer_SUBTRACT(
+      &mix[i * length],
+      total,
+      source_cdata->samples,
+      available
+    );
+
+    for (size_t j = available; j < length; ++j) {
+      const int32_t value = total[j];
+      mix[i * length + j] =
+        value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value;
+    }
+
+    memmove(
+      source_cdata->samples,
+      &source_cdata->samples[available],
+      (source_cdata->size - available) * sizeof(int16_t)
+    );
+
+    source_cdata->size -= available;
+  }
+
+  const VALUE audio_frame = rb_funcall(mTox_cAudioFrame, rb_intern("new"), 0);
+
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  mTox_cAudioFrame_SET_FORMAT(
+    audio_frame_cdata,
+    sample_count_data,
+    self_cdata->channels,
+    self_cdata->sampling_rate
+  );
+
+  VALUE pcm = rb_str_new(NULL, length * sizeof(int16_t));
+
+  mTox_cAudioFrame_SET_PCM(audio_frame, audio_frame_cdata, pcm);
+
+  for (size_t i = 0; i < sources_size; ++i) {
+    // A memory view taken in the block holds the previous mix.
+    if (mTox_MEMORY_VIEW_EXPORTED(audio_frame_cdata->exports, pcm)) {
+      pcm = rb_str_new(NULL, length * sizeof(int16_t));
+      mTox_cAudioFrame_SET_PCM(audio_frame, audio_frame_cdata, pcm);
+    }
+
+    rb_str_resize(pcm, length * sizeof(int16_t));
+
+    memcpy(RSTRING_PTR(pcm), &mix[i * length], length * sizeof(int16_t));
+
+    rb_yield_values(2, ULONG2NUM(ids[i]), audio_frame);
+  }
+
+  RB_GC_GUARD(mixes);
+
+  return Qnil;
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::AudioMixer#initialize_with
+VALUE mTox_cAudioMixer_initialize_with(
+  const VALUE self,
+  const VALUE sampling_rate,
+  const VALUE channels
+)
+{
+  CDATA(self, mTox_cAudioMixer_CDATA, self_cdata);
+
+  self_cdata->sampling_rate = NUM2ULONG(sampling_rate);
+  self_cdata->channels      = NUM2UINT(channels);
+
+  return self;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+mTox_cAudioMixer_SOURCE *mTox_cAudioMixer_SOURCE_GET(
+  mTox_cAudioMixer_CDATA *const self_cdata,
+  const uint32_t source_data,
+  const bool create
+)
+{
+  for (size_t i = 0; i < self_cdata->sources_size; ++i) {
+    if (self_cdata->sources[i].id == source_data) {
+      return &self_cdata->sources[i];
+    }
+  }
+
+  if (!create) {
+    return NULL;
+  }
+
+  REALLOC_N(
+    self_cdata->sources,
+    mTox_cAudioMixer_SOURCE,
+    self_cdata->sources_size + 1
+  );
+
+  mTox_cAudioMixer_SOURCE *const source_cdata =
+    &self_cdata->sources[self_cdata->sources_size++];
+
+  memset(source_cdata, 0, sizeof(mTox_cAudioMixer_SOURCE));
+
+  source_cdata->id = source_data;
+
+  return source_cdata;
+}
+
+void mTox_cAudioMixer_ACCUMULATE(
+  int32_t *const total,
+  const int16_t *const samples,
+  const size_t length
+)
+{
+  size_t i = 0;
+
+#ifdef __SSE2__
+  for (; i + 8 <= length; i += 8) {
+    const __m128i value = _mm_loadu_si128((const __m128i*)&samples[i]);
+
+    // Sign extension of the low and high halves.
+    const __m128i low  = _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+    const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16);
+
+    __m128i *const destination = (__m128i*)&total[i];
+
+    _mm_storeu_si128(&destination[0], _mm_add_epi32(_mm_loadu_si128(&destination[0]), low));
+    _mm_storeu_si128(&destination[1], _mm_add_epi32(_mm_loadu_si128(&destination[1]), high));
+  }
+#endif
+
+  for (; i < length; ++i) {
+    total[i] += samples[i];
+  }
+}
+
+// Mix without the own samples, saturated to 16 bits.
+void mTox_cAudioMixer_SUBTRACT(
+  int16_t *const mix,
+  const int32_t *const total,
+  const int16_t *const samples,
+  const size_t length
+)
+{
+  size_t i = 0;
+
+#ifdef __SSE2__
+  for (; i + 8 <= length; i += 8) {
+    const __m128i value = _mm_loadu_si128((const __m128i*)&samples[i]);
+
+    const __m128i low  = _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+    const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16);
+
+    const __m128i *const source = (const __m128i*)&total[i];
+
+    const __m128i result = _mm_packs_epi32(
+      _mm_sub_epi32(_mm_loadu_si128(&source[0]), low),
+      _mm_sub_epi32(_mm_loadu_si128(&source[1]), high)
+    );
+
+    _mm_storeu_si128((__m128i*)&mix[i], result);
+  }
+#endif
+
+  for (; i < length; ++i) {
+    const int32_t value = total[i] - samples[i];
+    mix[i] =
+      value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : value;
+  }
+}
@@ -0,0 +1,220 @@
+#include "tox.h"
+
+#include <time.h>
+
+#include <opus/opusfile.h>
+
+struct mTox_AUDIO_STREAM {
+  uint32_t friend_number;
+  bool     loop;
+  bool     finished;
+  uint64_t deadline;
+
+  OggOpusFile *file;
+
+  int16_t pcm[mTox_AUDIO_STREAM_SAMPLE_COUNT * mTox_AUDIO_STREAM_CHANNELS];
+};
+
+// Private functions
+
+static bool mTox_AUDIO_STREAM_DECODE(mTox_AUDIO_STREAM *stream);
+
+/*************************************************************
+ * Streams
+ *************************************************************/
+
+mTox_AUDIO_STREAM *mTox_AUDIO_STREAM_OPEN(
+  const char *const path,
+  const uint32_t friend_number,
+  const bool loop,
+  int *const error
+)
+{
+  OggOpusFile *const file = op_open_file(path, error);
+
+  if (!file) {
+    return NULL;
+  }
+
+  mTox_AUDIO_STREAM *const stream = ALLOC(mTox_AUDIO_STREAM);
+
+  stream->friend_number = friend_number;
+  stream->loop          = loop;
+  stream->finished      = false;
+  stream->deadline      = mTox_AUDIO_STREAM_NOW();
+  stream->file          = file;
+
+  return stream;
+}
+
+void mTox_AUDIO_STREAM_CLOSE(mTox_AUDIO_STREAM *const stream)
+{
+  if (!stream) {
+    return;
+  }
+
+  op_free(stream->file);
+
+  free(stream);
+}
+
+uint32_t mTox_AUDIO_STREAM_FRIEND_NUMBER(const mTox_AUDIO_STREAM *const stream)
+{
+  return stream->friend_number;
+}
+
+uint64_t mTox_AUDIO_STREAM_DEADLINE(const mTox_AUDIO_STREAM *const stream)
+{
+  return stream->deadline;
+}
+
+// Frames which toxcore drops because of a busy call or a failed packet are
+// still counted, so the stream keeps its pace.
+bool mTox_AUDIO_STREAM_PUMP(
+  mTox_AUDIO_STREAM *const stream,
+  ToxAV *const tox_av,
+  mTox_VOICE_GATE *const voice_gate,
+  mTox_CALL_STATS *const call_stats,
+  const bool held,
+  const uint64_t now,
+  size_t *const failures
+)
+{
+  if (now > stream->deadline + mTox_AUDIO_STREAM_MAX_LAG_USEC) {
+    stream->deadline = now;
+  }
+
+  while (stream->deadline <= now) {
+    if (!mTox_AUDIO_STREAM_DECODE(stream)) {
+      return false;
+    }
+
+    // Held streams are still decoded, so they go on from where they would
+    // be when sending resumes.
+    if (
+      held || (
+        voice_gate &&
+        !mTox_VOICE_GATE_PASS(
+          voice_gate,
+          stream->pcm,
+          mTox_AUDIO_STREAM_SAMPLE_COUNT,
+          mTox_AUDIO_STREAM_CHANNELS,
+          mTox_AUDIO_STREAM_SAMPLING_RATE
+        )
+      )
+    ) {
+      stream->deadline += mTox_AUDIO_STREAM_FRAME_USEC;
+      continue;
+    }
+
+    const uint64_t started = call_stats ? mTox_AUDIO_STREAM_NOW() : 0;
+
+    TOXAV_ERR_SEND_FRAME error;
+
+    toxav_audio_send_frame(
+      tox_av,
+      stream->friend_number,
+      stream->pcm,
+      mTox_AUDIO_STREAM_SAMPLE_COUNT,
+      mTox_AUDIO_STREAM_CHANNELS,
+      mTox_AUDIO_STREAM_SAMPLING_RATE,
+      &error
+    );
+
+    if (call_stats) {
+      mTox_CALL_STATS_SENT(
+        call_stats,
+        mTox_CALL_STATS_AUDIO,
+        error,
+        started,
+        mTox_AUDIO_STREAM_NOW(),
+        mTox_AUDIO_STREAM_FRAME_USEC
+      );
+    }
+
+    switch (error) {
+      case TOXAV_ERR_SEND_FRAME_SYNC:
+      case TOXAV_ERR_SEND_FRAME_RTP_FAILED:
+        ++*failures;
+        break;
+      case TOXAV_ERR_SEND_FRAME_OK:
+      case TOXAV_ERR_SEND_FRAME_PAYLOAD_TYPE_DISABLED:
+        break;
+      default:
+        return false;
+    }
+
+    stream->deadline += mTox_AUDIO_STREAM_FRAME_USEC;
+  }
+
+  return true;
+}
+
+uint64_t mTox_AUDIO_STREAM_NOW()
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return (uint64_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+// Fills the next frame. The last frame of a file which is not looped is
+// padded with silence.
+bool mTox_AUDIO_STREAM_DECODE(mTox_AUDIO_STREAM *const stream)
+{
+  if (stream->finished) {
+    return false;
+  }
+
+  int  filled  = 0;
+  bool rewound = false;
+
+  while (filled < mTox_AUDIO_STREAM_SAMPLE_COUNT) {
+    const int result = op_read_stereo(
+      stream->file,
+      &stream->pcm[filled * mTox_AUDIO_STREAM_CHANNELS],
+      (mTox_AUDIO_STREAM_SAMPLE_COUNT - filled) * mTox_AUDIO_STREAM_CHANNELS
+    );
+
+    if (result == OP_HOLE) {
+      continue;
+    }
+
+    if (result < 0) {
+      return false;
+    }
+
+    if (result > 0) {
+      filled += result;
+      rewound = false;
+      continue;
+    }
+
+    // A file without samples would rewind forever.
+    if (stream->loop && !rewound && op_pcm_seek(stream->file, 0) == 0) {
+      rewound = true;
+      continue;
+    }
+
+    if (filled == 0) {
+      return false;
+    }
+
+    memset(
+      &stream->pcm[filled * mTox_AUDIO_STREAM_CHANNELS],
+      0,
+      (mTox_AUDIO_STREAM_SAMPLE_COUNT - filled) *
+        mTox_AUDIO_STREAM_CHANNELS * sizeof(int16_t)
+    );
+
+    stream->finished = true;
+    break;
+  }
+
+  return true;
+}
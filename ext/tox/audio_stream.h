@@ -0,0 +1,49 @@
+// Native audio streams of calls. Files are decoded with libopusfile and
+// sent as 20 ms frames of 48 kHz stereo audio, without calling Ruby. Every
+// stream keeps its own schedule on the monotonic clock; the audio/video
+// instance sends the frames which are due each time it iterates, so late
+// iterations are caught up and the rate never drifts.
+
+#define mTox_AUDIO_STREAM_SAMPLING_RATE 48000
+#define mTox_AUDIO_STREAM_CHANNELS      2
+#define mTox_AUDIO_STREAM_SAMPLE_COUNT  960
+#define mTox_AUDIO_STREAM_FRAME_USEC    20000
+
+// Streams which fall this far behind restart their schedule instead of
+// sending the missed frames in a burst.
+#define mTox_AUDIO_STREAM_MAX_LAG_USEC  200000
+
+typedef struct mTox_AUDIO_STREAM mTox_AUDIO_STREAM;
+
+// Returns NULL and sets "error" to the libopusfile error code when the
+// file can not be opened.
+mTox_AUDIO_STREAM *mTox_AUDIO_STREAM_OPEN(
+  const char *path,
+  uint32_t friend_number,
+  bool loop,
+  int *error
+);
+
+void mTox_AUDIO_STREAM_CLOSE(mTox_AUDIO_STREAM *stream);
+
+uint32_t mTox_AUDIO_STREAM_FRIEND_NUMBER(const mTox_AUDIO_STREAM *stream);
+uint64_t mTox_AUDIO_STREAM_DEADLINE(const mTox_AUDIO_STREAM *stream);
+
+// Sends the frames which are due. Returns false when the stream has ended
+// or can not continue. Frames which toxav failed to queue or send because
+// of congestion are counted in "failures". Frames which the voice gate, if
+// any, suppresses and all frames while the stream is held are skipped in
+// time, without encoding. Sent frames are counted in the call stats, if
+// any.
+bool mTox_AUDIO_STREAM_PUMP(
+  mTox_AUDIO_STREAM *stream,
+  ToxAV *tox_av,
+  mTox_VOICE_GATE *voice_gate,
+  mTox_CALL_STATS *call_stats,
+  bool held,
+  uint64_t now,
+  size_t *failures
+);
+
+// Monotonic time in microseconds.
+uint64_t mTox_AUDIO_STREAM_NOW();
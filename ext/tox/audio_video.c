@@ -1,5 +1,64 @@
 #include "tox.h"
 
+#include <ruby/thread.h>
+
+// A relayed frame for one sink.
+typedef struct {
+  uint32_t             sink;
+  bool                 left;
+  TOXAV_ERR_SEND_FRAME error;
+  uint64_t             started;
+  uint64_t             finished;
+} mTox_cAudioVideo_RELAY_SEND;
+
+// What the sends of a relayed frame need without the GVL.
+typedef struct {
+  ToxAV *tox_av;
+
+  size_t                       sends_size;
+  mTox_cAudioVideo_RELAY_SEND *sends;
+
+  const int16_t *pcm;
+  size_t         sample_count;
+  uint8_t        channels;
+  uint32_t       sampling_rate;
+
+  uint16_t       width;
+  uint16_t       height;
+  const uint8_t *y;
+  const uint8_t *u;
+  const uint8_t *v;
+  uint64_t       started;
+} mTox_cAudioVideo_RELAY_ARGS;
+
+// A frame taken from the video queue of a friend.
+typedef struct {
+  uint32_t             friend_number;
+  uint16_t             width;
+  uint16_t             height;
+  const uint8_t       *y;
+  const uint8_t       *u;
+  const uint8_t       *v;
+  uint8_t             *planes;
+  TOXAV_ERR_SEND_FRAME error;
+  uint64_t             started;
+  uint64_t             finished;
+} mTox_cAudioVideo_QUEUED_SEND;
+
+// What the sends of queued frames need without the GVL.
+typedef struct {
+  ToxAV                        *tox_av;
+  mTox_cAudioVideo_QUEUED_SEND *sends;
+} mTox_cAudioVideo_QUEUED_ARGS;
+
+// Sends run on the send pool.
+typedef struct {
+  mTox_SEND_POOL *send_pool;
+  void          (*send)(void *data, size_t index);
+  void           *data;
+  size_t          size;
+} mTox_cAudioVideo_SEND_BATCH;
+
 // Memory management
 
 static VALUE mTox_cAudioVideo_alloc(VALUE klass);
@@ -16,6 +75,24 @@ static VALUE mTox_cAudioVideo_iterate(VALUE self);
 
 static VALUE mTox_cAudioVideo_initialize_with(VALUE self, VALUE client);
 
+// Private functions
+
+static void mTox_cAudioVideo_SEND_WITHOUT_GVL(mTox_SEND_POOL *send_pool, void (*send)(void *data, size_t index), void *data, size_t size);
+static void *mTox_cAudioVideo_SEND_RUN(void *data);
+static void mTox_cAudioVideo_RELAY_AUDIO_SEND(void *data, size_t index);
+static void mTox_cAudioVideo_RELAY_VIDEO_SEND(void *data, size_t index);
+static void mTox_cAudioVideo_QUEUED_VIDEO_SEND(void *data, size_t index);
+
+static void mTox_cAudioVideo_CALL_FREE(mTox_cAudioVideo_CALL *call);
+
+static void mTox_cAudioVideo_STREAMS_PUMP(mTox_cAudioVideo_CDATA *self_cdata);
+static void mTox_cAudioVideo_JITTER_BUFFERS_PUMP(VALUE self, mTox_cAudioVideo_CDATA *self_cdata);
+static void mTox_cAudioVideo_MEDIA_RELAYS_PUMP(mTox_cAudioVideo_CDATA *self_cdata);
+static void mTox_cAudioVideo_RELAY_AUDIO_FRAME(mTox_cAudioVideo_CDATA *self_cdata, uint32_t friend_number_data, const int16_t *pcm, size_t sample_count, uint8_t channels, uint32_t sampling_rate);
+static void mTox_cAudioVideo_RELAY_VIDEO_FRAME(mTox_cAudioVideo_CDATA *self_cdata, uint32_t friend_number_data, uint16_t width, uint16_t height, const uint8_t *planes);
+static void mTox_cAudioVideo_BIT_RATE_CONTROLS_PUMP(mTox_cAudioVideo_CDATA *self_cdata);
+static void mTox_cAudioVideo_VIDEO_QUEUES_PUMP(mTox_cAudioVideo_CDATA *self_cdata);
+
 /*************************************************************
  * Initialization
  *************************************************************/
@@ -45,13 +122,24 @@ VALUE mTox_cAudioVideo_alloc(const VALUE klass)
 {
   mTox_cAudioVideo_CDATA *alloc_cdata = ALLOC(mTox_cAudioVideo_CDATA);
 
-  alloc_cdata->tox_av = NULL;
+  alloc_cdata->tox_av     = NULL;
+  alloc_cdata->calls_size = 0;
+  alloc_cdata->calls      = NULL;
+  alloc_cdata->send_pool  = NULL;
 
   return Data_Wrap_Struct(klass, NULL, mTox_cAudioVideo_free, alloc_cdata);
 }
 
 void mTox_cAudioVideo_free(mTox_cAudioVideo_CDATA *const free_cdata)
 {
+  for (size_t i = 0; i < free_cdata->calls_size; ++i) {
+    mTox_cAudioVideo_CALL_FREE(free_cdata->calls[i]);
+  }
+
+  free(free_cdata->calls);
+
+  mTox_SEND_POOL_FREE(free_cdata->send_pool);
+
   if (free_cdata->tox_av) {
     toxav_kill(free_cdata->tox_av);
   }
@@ -79,6 +167,51 @@ VALUE mTox_cAudioVideo_iteration_interval(const VALUE self)
   uint32_t iteration_interval_msec_data =
     toxav_iteration_interval(self_cdata->tox_av);
 
+  // Wake up in time for the next frame of streams, jitter buffers and
+  // video queues.
+  const uint64_t now = mTox_AUDIO_STREAM_NOW();
+
+  uint64_t deadline = UINT64_MAX;
+
+  for (size_t i = 0; i < self_cdata->calls_size; ++i) {
+    const mTox_cAudioVideo_CALL *const call = self_cdata->calls[i];
+
+    if (call->stream) {
+      const uint64_t stream_deadline = mTox_AUDIO_STREAM_DEADLINE(call->stream);
+
+      if (stream_deadline < deadline) {
+        deadline = stream_deadline;
+      }
+    }
+
+    if (call->jitter_buffer) {
+      const uint64_t jitter_buffer_deadline =
+        mTox_JITTER_BUFFER_DEADLINE(call->jitter_buffer);
+
+      if (jitter_buffer_deadline < deadline) {
+        deadline = jitter_buffer_deadline;
+      }
+    }
+
+    if (call->video_queue) {
+      const uint64_t video_queue_deadline =
+        mTox_VIDEO_QUEUE_DEADLINE(call->video_queue);
+
+      if (video_queue_deadline < deadline) {
+        deadline = video_queue_deadline;
+      }
+    }
+  }
+
+  if (deadline != UINT64_MAX) {
+    const uint64_t interval_msec_data =
+      deadline > now ? (deadline - now) / 1000 : 0;
+
+    if (interval_msec_data < iteration_interval_msec_data) {
+      iteration_interval_msec_data = interval_msec_data;
+    }
+  }
+
   const double iteration_interval_sec_data =
     ((double)iteration_interval_msec_data) * 0.001;
 
@@ -94,6 +227,12 @@ VALUE mTox_cAudioVideo_iterate(const VALUE self)
 
   toxav_iterate(self_cdata->tox_av);
 
+  mTox_cAudioVideo_STREAMS_PUMP(self_cdata);
+  mTox_cAudioVideo_JITTER_BUFFERS_PUMP(self, self_cdata);
+  mTox_cAudioVideo_MEDIA_RELAYS_PUMP(self_cdata);
+  mTox_cAudioVideo_VIDEO_QUEUES_PUMP(self_cdata);
+  mTox_cAudioVideo_BIT_RATE_CONTROLS_PUMP(self_cdata);
+
   return Qnil;
 }
 
@@ -149,6 +288,922 @@ VALUE mTox_cAudioVideo_initialize_with(const VALUE self, const VALUE client)
   toxav_callback_call_state         (self_cdata->tox_av, on_call_state_change, self);
   toxav_callback_audio_receive_frame(self_cdata->tox_av, on_audio_frame,       self);
   toxav_callback_video_receive_frame(self_cdata->tox_av, on_video_frame,       self);
+  toxav_callback_audio_bit_rate     (self_cdata->tox_av, on_audio_bit_rate,    self);
+  toxav_callback_video_bit_rate     (self_cdata->tox_av, on_video_bit_rate,    self);
 
   return self;
 }
+
+/*************************************************************
+ * Call state
+ *************************************************************/
+
+mTox_cAudioVideo_CALL *mTox_cAudioVideo_CALL_GET(
+  const mTox_cAudioVideo_CDATA *const audio_video_cdata,
+  const uint32_t friend_number_data
+)
+{
+  for (size_t i = 0; i < audio_video_cdata->calls_size; ++i) {
+    mTox_cAudioVideo_CALL *const call = audio_video_cdata->calls[i];
+
+    if (call->friend_number == friend_number_data) {
+      return call;
+    }
+  }
+
+  return NULL;
+}
+
+mTox_cAudioVideo_CALL *mTox_cAudioVideo_CALL_FETCH(
+  mTox_cAudioVideo_CDATA *const audio_video_cdata,
+  const uint32_t friend_number_data
+)
+{
+  mTox_cAudioVideo_CALL *call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (call) {
+    return call;
+  }
+
+  REALLOC_N(
+    audio_video_cdata->calls,
+    mTox_cAudioVideo_CALL*,
+    audio_video_cdata->calls_size + 1
+  );
+
+  call = ALLOC(mTox_cAudioVideo_CALL);
+
+  memset(call, 0, sizeof(mTox_cAudioVideo_CALL));
+
+  call->friend_number = friend_number_data;
+
+  audio_video_cdata->calls[audio_video_cdata->calls_size++] = call;
+
+  return call;
+}
+
+mTox_cAudioVideo_CALL *mTox_cAudioVideo_CALL_START(
+  mTox_cAudioVideo_CDATA *const audio_video_cdata,
+  const uint32_t friend_number_data,
+  const uint32_t audio_bit_rate,
+  const uint32_t video_bit_rate
+)
+{
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  mTox_CALL_STATS_FREE(call->call_stats);
+
+  call->in_call    = true;
+  call->call_stats = mTox_CALL_STATS_NEW(
+    friend_number_data,
+    audio_bit_rate,
+    video_bit_rate,
+    mTox_AUDIO_STREAM_NOW()
+  );
+
+  return call;
+}
+
+bool mTox_cAudioVideo_IN_CALL(
+  const mTox_cAudioVideo_CDATA *const audio_video_cdata,
+  const uint32_t friend_number_data
+)
+{
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  return call && call->in_call;
+}
+
+bool mTox_cAudioVideo_SENDS_AUDIO(const mTox_cAudioVideo_CALL *const call)
+{
+  return !call || !(call->paused || call->audio_muted || call->audio_refused);
+}
+
+bool mTox_cAudioVideo_SENDS_VIDEO(const mTox_cAudioVideo_CALL *const call)
+{
+  return !call || !(call->paused || call->video_hidden || call->video_refused);
+}
+
+void mTox_cAudioVideo_SEND_POOL_START(
+  mTox_cAudioVideo_CDATA *const audio_video_cdata
+)
+{
+  if (!audio_video_cdata->send_pool) {
+    audio_video_cdata->send_pool = mTox_SEND_POOL_NEW();
+  }
+}
+
+// Frames are only copied here, in toxav callbacks. The next iteration
+// sends them with mTox_cAudioVideo_MEDIA_RELAYS_PUMP once toxav_iterate
+// has returned.
+void mTox_cAudioVideo_RELAY_AUDIO(
+  mTox_cAudioVideo_CALL *const call,
+  const int16_t *const pcm,
+  const size_t sample_count,
+  const uint8_t channels,
+  const uint32_t sampling_rate
+)
+{
+  if (!call || !call->media_relay) {
+    return;
+  }
+
+  mTox_MEDIA_RELAY_AUDIO_RECEIVED(call->media_relay);
+
+  if (mTox_MEDIA_RELAY_SINKS_SIZE(call->media_relay) == 0) {
+    return;
+  }
+
+  mTox_MEDIA_RELAY_PUSH_AUDIO(
+    call->media_relay,
+    pcm,
+    sample_count,
+    channels,
+    sampling_rate
+  );
+}
+
+void mTox_cAudioVideo_RELAY_VIDEO(
+  mTox_cAudioVideo_CALL *const call,
+  const uint16_t width,
+  const uint16_t height,
+  const uint8_t *const y,
+  const uint8_t *const u,
+  const uint8_t *const v,
+  const int32_t ystride,
+  const int32_t ustride,
+  const int32_t vstride
+)
+{
+  if (!call || !call->media_relay) {
+    return;
+  }
+
+  mTox_MEDIA_RELAY_VIDEO_RECEIVED(call->media_relay);
+
+  if (mTox_MEDIA_RELAY_SINKS_SIZE(call->media_relay) == 0) {
+    return;
+  }
+
+  mTox_MEDIA_RELAY_PUSH_VIDEO(
+    call->media_relay,
+    width,
+    height,
+    y,
+    u,
+    v,
+    ystride,
+    ustride,
+    vstride
+  );
+}
+
+// Recorders are not waited for, they finish in the background.
+void mTox_cAudioVideo_CALL_END(
+  mTox_cAudioVideo_CDATA *const audio_video_cdata,
+  const uint32_t friend_number_data
+)
+{
+  for (size_t i = 0; i < audio_video_cdata->calls_size; ++i) {
+    if (audio_video_cdata->calls[i]->friend_number == friend_number_data) {
+      mTox_cAudioVideo_CALL_FREE(audio_video_cdata->calls[i]);
+
+      audio_video_cdata->calls[i] =
+        audio_video_cdata->calls[--audio_video_cdata->calls_size];
+
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < audio_video_cdata->calls_size; ++i) {
+    if (audio_video_cdata->calls[i]->media_relay) {
+      mTox_MEDIA_RELAY_REMOVE_SINK(
+        audio_video_cdata->calls[i]->media_relay,
+        friend_number_data
+      );
+    }
+  }
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+// Sends can not be interrupted: taken frames must be given back. Ruby keeps
+// the GVL when interrupts are pending, then they run with it.
+void mTox_cAudioVideo_SEND_WITHOUT_GVL(
+  mTox_SEND_POOL *const send_pool,
+  void (*const send)(void *data, size_t index),
+  void *const data,
+  const size_t size
+)
+{
+  if (size == 0) {
+    return;
+  }
+
+  mTox_cAudioVideo_SEND_BATCH batch;
+
+  batch.send_pool = send_pool;
+  batch.send      = send;
+  batch.data      = data;
+  batch.size      = size;
+
+  if (!rb_thread_call_without_gvl2(mTox_cAudioVideo_SEND_RUN, &batch, NULL, NULL)) {
+    mTox_cAudioVideo_SEND_RUN(&batch);
+  }
+}
+
+void *mTox_cAudioVideo_SEND_RUN(void *const data)
+{
+  const mTox_cAudioVideo_SEND_BATCH *const batch = data;
+
+  mTox_SEND_POOL_RUN(batch->send_pool, batch->send, batch->data, batch->size);
+
+  return data;
+}
+
+void mTox_cAudioVideo_RELAY_AUDIO_SEND(void *const data, const size_t index)
+{
+  const mTox_cAudioVideo_RELAY_ARGS *const args = data;
+
+  mTox_cAudioVideo_RELAY_SEND *const send = &args->sends[index];
+
+  send->started = mTox_AUDIO_STREAM_NOW();
+
+  toxav_audio_send_frame(
+    args->tox_av,
+    send->sink,
+    args->pcm,
+    args->sample_count,
+    args->channels,
+    args->sampling_rate,
+    &send->error
+  );
+
+  send->finished = mTox_AUDIO_STREAM_NOW();
+}
+
+void mTox_cAudioVideo_RELAY_VIDEO_SEND(void *const data, const size_t index)
+{
+  const mTox_cAudioVideo_RELAY_ARGS *const args = data;
+
+  mTox_cAudioVideo_RELAY_SEND *const send = &args->sends[index];
+
+  send->started = mTox_AUDIO_STREAM_NOW();
+  send->left    =
+    send->started - args->started > mTox_MEDIA_RELAY_VIDEO_BUDGET_USEC;
+
+  if (send->left) {
+    return;
+  }
+
+  toxav_video_send_frame(
+    args->tox_av,
+    send->sink,
+    args->width,
+    args->height,
+    args->y,
+    args->u,
+    args->v,
+    &send->error
+  );
+
+  send->finished = mTox_AUDIO_STREAM_NOW();
+}
+
+void mTox_cAudioVideo_QUEUED_VIDEO_SEND(void *const data, const size_t index)
+{
+  const mTox_cAudioVideo_QUEUED_ARGS *const args = data;
+
+  mTox_cAudioVideo_QUEUED_SEND *const send = &args->sends[index];
+
+  send->started = mTox_AUDIO_STREAM_NOW();
+
+  toxav_video_send_frame(
+    args->tox_av,
+    send->friend_number,
+    send->width,
+    send->height,
+    send->y,
+    send->u,
+    send->v,
+    &send->error
+  );
+
+  send->finished = mTox_AUDIO_STREAM_NOW();
+}
+
+void mTox_cAudioVideo_CALL_FREE(mTox_cAudioVideo_CALL *const call)
+{
+  mTox_AUDIO_STREAM_CLOSE(call->stream);
+  mTox_JITTER_BUFFER_FREE(call->jitter_buffer);
+  mTox_BIT_RATE_CONTROL_FREE(call->bit_rate_control);
+  mTox_CALL_RECORDER_DETACH(call->recorder);
+  mTox_VOICE_GATE_FREE(call->voice_gate);
+  mTox_AUDIO_METER_FREE(call->audio_meter);
+  mTox_MEDIA_RELAY_FREE(call->media_relay);
+  mTox_VIDEO_QUEUE_FREE(call->video_queue);
+  mTox_CALL_STATS_FREE(call->call_stats);
+
+  free(call);
+}
+
+void mTox_cAudioVideo_STREAMS_PUMP(mTox_cAudioVideo_CDATA *const self_cdata)
+{
+  const uint64_t now = mTox_AUDIO_STREAM_NOW();
+
+  for (size_t i = 0; i < self_cdata->calls_size; ++i) {
+    mTox_cAudioVideo_CALL *const call = self_cdata->calls[i];
+
+    if (!call->stream) {
+      continue;
+    }
+
+    size_t failures = 0;
+
+    const bool result =
+      mTox_AUDIO_STREAM_PUMP(
+        call->stream,
+        self_cdata->tox_av,
+        call->voice_gate,
+        call->call_stats,
+        !mTox_cAudioVideo_SENDS_AUDIO(call),
+        now,
+        &failures
+      );
+
+    for (size_t j = 0; call->bit_rate_control && j < failures; ++j) {
+      mTox_BIT_RATE_CONTROL_FAILED(
+        call->bit_rate_control,
+        mTox_BIT_RATE_CONTROL_AUDIO
+      );
+    }
+
+    if (!result) {
+      mTox_AUDIO_STREAM_CLOSE(call->stream);
+      call->stream = NULL;
+    }
+  }
+}
+
+// Handlers can enable and disable jitter buffers and end calls, so calls
+// are looked up by friend number again after every frame.
+void mTox_cAudioVideo_JITTER_BUFFERS_PUMP(
+  const VALUE self,
+  mTox_cAudioVideo_CDATA *const self_cdata
+)
+{
+  if (self_cdata->calls_size == 0) {
+    return;
+  }
+
+  VALUE friend_numbers_buffer;
+
+  uint32_t *const friend_numbers =
+    ALLOCV_N(uint32_t, friend_numbers_buffer, self_cdata->calls_size);
+
+  size_t size = 0;
+
+  for (size_t i = 0; i < self_cdata->calls_size; ++i) {
+    if (self_cdata->calls[i]->jitter_buffer) {
+      friend_numbers[size++] = self_cdata->calls[i]->friend_number;
+    }
+  }
+
+  const uint64_t now = mTox_AUDIO_STREAM_NOW();
+
+  for (size_t i = 0; i < size; ++i) {
+    const mTox_cAudioVideo_CALL *call;
+
+    const int16_t *pcm_data;
+    size_t         sample_count_data;
+    uint8_t        channels_data;
+    uint32_t       sampling_rate_data;
+
+    while (
+      (call = mTox_cAudioVideo_CALL_GET(self_cdata, friend_numbers[i])) &&
+      call->jitter_buffer &&
+      mTox_JITTER_BUFFER_POP(
+        call->jitter_buffer,
+        now,
+        &pcm_data,
+        &sample_count_data,
+        &channels_data,
+        &sampling_rate_data
+      )
+    ) {
+      on_audio_frame_ready(
+        self,
+        friend_numbers[i],
+        pcm_data,
+        sample_count_data,
+        channels_data,
+        sampling_rate_data
+      );
+    }
+  }
+
+  ALLOCV_END(friend_numbers_buffer);
+}
+
+// Frames which the relays copied while toxav iterated or the jitter
+// buffers were pumped are sent from them, oldest audio first. Sends
+// release the GVL, so calls are looked up by friend number again after
+// every frame.
+void mTox_cAudioVideo_MEDIA_RELAYS_PUMP(mTox_cAudioVideo_CDATA *const self_cdata)
+{
+  if (self_cdata->calls_size == 0) {
+    return;
+  }
+
+  VALUE friend_numbers_buffer;
+
+  uint32_t *const friend_numbers =
+    ALLOCV_N(uint32_t, friend_numbers_buffer, self_cdata->calls_size);
+
+  size_t size = 0;
+
+  for (size_t i = 0; i < self_cdata->calls_size; ++i) {
+    if (self_cdata->calls[i]->media_relay) {
+      friend_numbers[size++] = self_cdata->calls[i]->friend_number;
+    }
+  }
+
+  for (size_t i = 0; i < size; ++i) {
+    mTox_cAudioVideo_CALL *call;
+
+    int16_t *pcm;
+    size_t   sample_count;
+    uint8_t  channels;
+    uint32_t sampling_rate;
+
+    while (
+      (call = mTox_cAudioVideo_CALL_GET(self_cdata, friend_numbers[i])) &&
+      call->media_relay &&
+      (pcm = mTox_MEDIA_RELAY_TAKE_AUDIO(
+        call->media_relay,
+        &sample_count,
+        &channels,
+        &sampling_rate
+      ))
+    ) {
+      mTox_cAudioVideo_RELAY_AUDIO_FRAME(
+        self_cdata,
+        friend_numbers[i],
+        pcm,
+        sample_count,
+        channels,
+        sampling_rate
+      );
+
+      free(pcm);
+    }
+
+    if (!call || !call->media_relay) {
+      continue;
+    }
+
+    uint16_t width;
+    uint16_t height;
+
+    uint8_t *const planes =
+      mTox_MEDIA_RELAY_TAKE_VIDEO(call->media_relay, &width, &height);
+
+    if (!planes) {
+      continue;
+    }
+
+    mTox_cAudioVideo_RELAY_VIDEO_FRAME(
+      self_cdata,
+      friend_numbers[i],
+      width,
+      height,
+      planes
+    );
+
+    call = mTox_cAudioVideo_CALL_GET(self_cdata, friend_numbers[i]);
+
+    mTox_MEDIA_RELAY_VIDEO_DONE(
+      call ? call->media_relay : NULL,
+      planes,
+      width,
+      height
+    );
+  }
+
+  ALLOCV_END(friend_numbers_buffer);
+}
+
+// Sinks are held back like calls of their own. Errors of sinks which are
+// not in a call any more are ignored, the end of their calls removes them.
+// What the sends need of the relay is copied before and their results are
+// applied after, when the relay may have changed.
+void mTox_cAudioVideo_RELAY_AUDIO_FRAME(
+  mTox_cAudioVideo_CDATA *const self_cdata,
+  const uint32_t friend_number_data,
+  const int16_t *const pcm,
+  const size_t sample_count,
+  const uint8_t channels,
+  const uint32_t sampling_rate
+)
+{
+  const mTox_cAudioVideo_CALL *call =
+    mTox_cAudioVideo_CALL_GET(self_cdata, friend_number_data);
+
+  const size_t sinks_size = mTox_MEDIA_RELAY_SINKS_SIZE(call->media_relay);
+
+  if (sinks_size == 0) {
+    return;
+  }
+
+  mTox_cAudioVideo_RELAY_ARGS args;
+
+  args.tox_av        = self_cdata->tox_av;
+  args.sends_size    = 0;
+  args.sends         = ALLOC_N(mTox_cAudioVideo_RELAY_SEND, sinks_size);
+  args.pcm           = pcm;
+  args.sample_count  = sample_count;
+  args.channels      = channels;
+  args.sampling_rate = sampling_rate;
+
+  for (size_t i = 0; i < sinks_size; ++i) {
+    const uint32_t sink = mTox_MEDIA_RELAY_SINK(call->media_relay, i);
+
+    const mTox_cAudioVideo_CALL *const sink_call =
+      mTox_cAudioVideo_CALL_GET(self_cdata, sink);
+
+    if (!mTox_cAudioVideo_SENDS_AUDIO(sink_call)) {
+      continue;
+    }
+
+    if (
+      sink_call &&
+      sink_call->voice_gate &&
+      !mTox_VOICE_GATE_PASS(
+        sink_call->voice_gate,
+        pcm,
+        sample_count,
+        channels,
+        sampling_rate
+      )
+    ) {
+      continue;
+    }
+
+    args.sends[args.sends_size].sink = sink;
+    args.sends[args.sends_size].left = false;
+    ++args.sends_size;
+  }
+
+  mTox_cAudioVideo_SEND_WITHOUT_GVL(
+    self_cdata->send_pool,
+    mTox_cAudioVideo_RELAY_AUDIO_SEND,
+    &args,
+    args.sends_size
+  );
+
+  call = mTox_cAudioVideo_CALL_GET(self_cdata, friend_number_data);
+
+  mTox_MEDIA_RELAY *const media_relay = call ? call->media_relay : NULL;
+
+  for (size_t i = 0; i < args.sends_size; ++i) {
+    const mTox_cAudioVideo_RELAY_SEND *const send = &args.sends[i];
+
+    const mTox_cAudioVideo_CALL *const sink_call =
+      mTox_cAudioVideo_CALL_GET(self_cdata, send->sink);
+
+    if (sink_call && sink_call->call_stats) {
+      mTox_CALL_STATS_SENT(
+        sink_call->call_stats,
+        mTox_CALL_STATS_AUDIO,
+        send->error,
+        send->started,
+        send->finished,
+        (uint64_t)sample_count * 1000000 / sampling_rate
+      );
+    }
+
+    const bool congested =
+      send->error == TOXAV_ERR_SEND_FRAME_SYNC ||
+      send->error == TOXAV_ERR_SEND_FRAME_RTP_FAILED;
+
+    if (send->error != TOXAV_ERR_SEND_FRAME_OK && !congested) {
+      continue;
+    }
+
+    if (media_relay) {
+      mTox_MEDIA_RELAY_AUDIO_SENT(media_relay, send->sink, congested);
+    }
+
+    if (congested && sink_call && sink_call->bit_rate_control) {
+      mTox_BIT_RATE_CONTROL_FAILED(
+        sink_call->bit_rate_control,
+        mTox_BIT_RATE_CONTROL_AUDIO
+      );
+    }
+  }
+
+  free(args.sends);
+}
+
+// Sinks are tried from the first one, and once the frame is over its
+// budget the rest are left.
+void mTox_cAudioVideo_RELAY_VIDEO_FRAME(
+  mTox_cAudioVideo_CDATA *const self_cdata,
+  const uint32_t friend_number_data,
+  const uint16_t width,
+  const uint16_t height,
+  const uint8_t *const planes
+)
+{
+  const mTox_cAudioVideo_CALL *call =
+    mTox_cAudioVideo_CALL_GET(self_cdata, friend_number_data);
+
+  mTox_MEDIA_RELAY *media_relay = call->media_relay;
+
+  const size_t sinks_size = mTox_MEDIA_RELAY_SINKS_SIZE(media_relay);
+
+  if (sinks_size == 0) {
+    return;
+  }
+
+  const size_t y_size  = (size_t)width * height;
+  const size_t uv_size = (size_t)(width / 2) * (height / 2);
+
+  mTox_cAudioVideo_RELAY_ARGS args;
+
+  args.tox_av     = self_cdata->tox_av;
+  args.sends_size = 0;
+  args.sends      = ALLOC_N(mTox_cAudioVideo_RELAY_SEND, sinks_size);
+  args.width      = width;
+  args.height     = height;
+  args.y          = planes;
+  args.u          = &planes[y_size];
+  args.v          = &planes[y_size + uv_size];
+
+  const size_t first = mTox_MEDIA_RELAY_VIDEO_FIRST(media_relay);
+
+  for (size_t k = 0; k < sinks_size; ++k) {
+    const size_t   i    = (first + k) % sinks_size;
+    const uint32_t sink = mTox_MEDIA_RELAY_SINK(media_relay, i);
+
+    const mTox_cAudioVideo_CALL *const sink_call =
+      mTox_cAudioVideo_CALL_GET(self_cdata, sink);
+
+    if (!mTox_cAudioVideo_SENDS_VIDEO(sink_call)) {
+      continue;
+    }
+
+    if (!mTox_MEDIA_RELAY_VIDEO_DUE(media_relay, i)) {
+      continue;
+    }
+
+    args.sends[args.sends_size].sink = sink;
+    args.sends[args.sends_size].left = false;
+    ++args.sends_size;
+  }
+
+  args.started = mTox_AUDIO_STREAM_NOW();
+
+  mTox_cAudioVideo_SEND_WITHOUT_GVL(
+    self_cdata->send_pool,
+    mTox_cAudioVideo_RELAY_VIDEO_SEND,
+    &args,
+    args.sends_size
+  );
+
+  call        = mTox_cAudioVideo_CALL_GET(self_cdata, friend_number_data);
+  media_relay = call ? call->media_relay : NULL;
+
+  for (size_t i = 0; i < args.sends_size; ++i) {
+    const mTox_cAudioVideo_RELAY_SEND *const send = &args.sends[i];
+
+    if (send->left) {
+      if (media_relay) {
+        mTox_MEDIA_RELAY_VIDEO_LEFT(media_relay, send->sink);
+      }
+
+      continue;
+    }
+
+    const mTox_cAudioVideo_CALL *const sink_call =
+      mTox_cAudioVideo_CALL_GET(self_cdata, send->sink);
+
+    if (sink_call && sink_call->call_stats) {
+      mTox_CALL_STATS_SENT(
+        sink_call->call_stats,
+        mTox_CALL_STATS_VIDEO,
+        send->error,
+        send->started,
+        send->finished,
+        0
+      );
+    }
+
+    const bool congested =
+      send->error == TOXAV_ERR_SEND_FRAME_SYNC ||
+      send->error == TOXAV_ERR_SEND_FRAME_RTP_FAILED;
+
+    if (send->error != TOXAV_ERR_SEND_FRAME_OK && !congested) {
+      continue;
+    }
+
+    if (media_relay) {
+      mTox_MEDIA_RELAY_VIDEO_SENT(media_relay, send->sink, congested);
+    }
+
+    if (sink_call && sink_call->bit_rate_control) {
+      mTox_BIT_RATE_CONTROL_VIDEO_SENT(
+        sink_call->bit_rate_control,
+        send->finished - send->started,
+        send->started
+      );
+
+      if (congested) {
+        mTox_BIT_RATE_CONTROL_FAILED(
+          sink_call->bit_rate_control,
+          mTox_BIT_RATE_CONTROL_VIDEO
+        );
+      }
+    }
+  }
+
+  free(args.sends);
+}
+
+// Due frames are taken from their queues and encoded on the send pool
+// without the GVL, so calls may be gone afterwards. Errors other than
+// congestion are ignored, the end of the call drops the queue.
+void mTox_cAudioVideo_VIDEO_QUEUES_PUMP(mTox_cAudioVideo_CDATA *const self_cdata)
+{
+  if (self_cdata->calls_size == 0) {
+    return;
+  }
+
+  const uint64_t now = mTox_AUDIO_STREAM_NOW();
+
+  mTox_cAudioVideo_QUEUED_ARGS args;
+
+  VALUE sends_buffer;
+
+  args.tox_av = self_cdata->tox_av;
+  args.sends  = ALLOCV_N(
+    mTox_cAudioVideo_QUEUED_SEND,
+    sends_buffer,
+    self_cdata->calls_size
+  );
+
+  size_t sends_size = 0;
+
+  for (size_t i = 0; i < self_cdata->calls_size; ++i) {
+    const mTox_cAudioVideo_CALL *const call = self_cdata->calls[i];
+
+    if (!call->video_queue) {
+      continue;
+    }
+
+    if (!mTox_cAudioVideo_SENDS_VIDEO(call)) {
+      mTox_VIDEO_QUEUE_CLEAR(call->video_queue);
+      continue;
+    }
+
+    mTox_cAudioVideo_QUEUED_SEND *const send = &args.sends[sends_size];
+
+    send->planes = mTox_VIDEO_QUEUE_NEXT(
+      call->video_queue,
+      now,
+      &send->width,
+      &send->height,
+      &send->y,
+      &send->u,
+      &send->v
+    );
+
+    if (!send->planes) {
+      continue;
+    }
+
+    send->friend_number = call->friend_number;
+    ++sends_size;
+  }
+
+  mTox_cAudioVideo_SEND_WITHOUT_GVL(
+    self_cdata->send_pool,
+    mTox_cAudioVideo_QUEUED_VIDEO_SEND,
+    &args,
+    sends_size
+  );
+
+  for (size_t i = 0; i < sends_size; ++i) {
+    const mTox_cAudioVideo_QUEUED_SEND *const send = &args.sends[i];
+
+    const mTox_cAudioVideo_CALL *const call =
+      mTox_cAudioVideo_CALL_GET(self_cdata, send->friend_number);
+
+    mTox_VIDEO_QUEUE_DONE(call ? call->video_queue : NULL, send->planes);
+
+    if (!call) {
+      continue;
+    }
+
+    if (call->video_queue) {
+      mTox_VIDEO_QUEUE_SENT(
+        call->video_queue,
+        send->error != TOXAV_ERR_SEND_FRAME_OK
+      );
+    }
+
+    if (call->call_stats) {
+      mTox_CALL_STATS_SENT(
+        call->call_stats,
+        mTox_CALL_STATS_VIDEO,
+        send->error,
+        send->started,
+        send->finished,
+        0
+      );
+    }
+
+    if (call->bit_rate_control) {
+      mTox_BIT_RATE_CONTROL_VIDEO_SENT(
+        call->bit_rate_control,
+        send->finished - send->started,
+        send->started
+      );
+
+      if (send->error == TOXAV_ERR_SEND_FRAME_SYNC ||
+          send->error == TOXAV_ERR_SEND_FRAME_RTP_FAILED) {
+        mTox_BIT_RATE_CONTROL_FAILED(
+          call->bit_rate_control,
+          mTox_BIT_RATE_CONTROL_VIDEO
+        );
+      }
+    }
+  }
+
+  ALLOCV_END(sends_buffer);
+}
+
+// Errors are ignored, the call may have ended since the last iteration.
+void mTox_cAudioVideo_BIT_RATE_CONTROLS_PUMP(
+  mTox_cAudioVideo_CDATA *const self_cdata
+)
+{
+  const uint64_t now = mTox_AUDIO_STREAM_NOW();
+
+  for (size_t i = 0; i < self_cdata->calls_size; ++i) {
+    const mTox_cAudioVideo_CALL *const call = self_cdata->calls[i];
+
+    if (!call->bit_rate_control) {
+      continue;
+    }
+
+    uint32_t audio_bit_rate_data = UINT32_MAX;
+    uint32_t video_bit_rate_data = UINT32_MAX;
+
+    if (!mTox_BIT_RATE_CONTROL_UPDATE(
+      call->bit_rate_control,
+      now,
+      &audio_bit_rate_data,
+      &video_bit_rate_data
+    )) {
+      continue;
+    }
+
+    TOXAV_ERR_BIT_RATE_SET error;
+
+    if (audio_bit_rate_data != UINT32_MAX &&
+        toxav_audio_set_bit_rate(
+          self_cdata->tox_av,
+          call->friend_number,
+          audio_bit_rate_data,
+          &error
+        ) &&
+        call->call_stats) {
+      mTox_CALL_STATS_BIT_RATE(
+        call->call_stats,
+        mTox_CALL_STATS_AUDIO,
+        audio_bit_rate_data
+      );
+    }
+
+    if (video_bit_rate_data != UINT32_MAX &&
+        toxav_video_set_bit_rate(
+          self_cdata->tox_av,
+          call->friend_number,
+          video_bit_rate_data,
+          &error
+        ) &&
+        call->call_stats) {
+      mTox_CALL_STATS_BIT_RATE(
+        call->call_stats,
+        mTox_CALL_STATS_VIDEO,
+        video_bit_rate_data
+      );
+    }
+  }
+}
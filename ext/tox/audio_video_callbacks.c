@@ -1,5 +1,10 @@
 #include "tox.h"
 
+static VALUE FRIEND_CALL(VALUE self, VALUE frame_pool, VALUE friend_number);
+static VALUE FRAME(VALUE frame_pool, VALUE klass, const char *acquire);
+static VALUE FRAME_BUFFER(VALUE buffer, long length);
+static void  BIT_RATE(VALUE self, uint32_t friend_number_data, uint32_t bit_rate_data, mTox_BIT_RATE_CONTROL_KIND kind, const char *ivar_name);
+
 /******************************************************************************
  * Callbacks
  ******************************************************************************/
@@ -48,6 +53,22 @@ void on_call_state_change(
   const VALUE self
 )
 {
+  CDATA(self, mTox_cAudioVideo_CDATA, self_cdata);
+
+  if (state_data & (TOXAV_FRIEND_CALL_STATE_ERROR |
+                    TOXAV_FRIEND_CALL_STATE_FINISHED)) {
+    mTox_cAudioVideo_CALL_END(self_cdata, friend_number_data);
+  }
+  else {
+    // Kinds which the friend does not accept are not even encoded.
+    mTox_cAudioVideo_CALL *const call =
+      mTox_cAudioVideo_CALL_FETCH(self_cdata, friend_number_data);
+
+    call->in_call       = true;
+    call->audio_refused = !(state_data & TOXAV_FRIEND_CALL_STATE_ACCEPTING_A);
+    call->video_refused = !(state_data & TOXAV_FRIEND_CALL_STATE_ACCEPTING_V);
+  }
+
   const VALUE ivar_on_call_state_change =
     rb_iv_get(self, "@on_call_state_change");
 
@@ -93,36 +114,124 @@ void on_audio_frame(
   const VALUE self
 )
 {
+  CDATA(self, mTox_cAudioVideo_CDATA, self_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(self_cdata, friend_number_data);
+
+  // Arrivals are timed before the jitter buffer smooths them out.
+  if (call && call->call_stats && sampling_rate_data > 0) {
+    mTox_CALL_STATS_RECEIVED(
+      call->call_stats,
+      mTox_CALL_STATS_AUDIO,
+      mTox_AUDIO_STREAM_NOW(),
+      (uint64_t)sample_count_data * 1000000 / sampling_rate_data
+    );
+  }
+
+  // The frame is handled when the jitter buffer plays it.
+  if (call && call->jitter_buffer) {
+    mTox_JITTER_BUFFER_PUSH(
+      call->jitter_buffer,
+      mTox_JITTER_BUFFER_IN_ORDER,
+      (const int16_t*)pcm_data,
+      sample_count_data,
+      channels_data,
+      sampling_rate_data,
+      mTox_AUDIO_STREAM_NOW()
+    );
+
+    return;
+  }
+
+  on_audio_frame_ready(
+    self,
+    friend_number_data,
+    (const int16_t*)pcm_data,
+    sample_count_data,
+    channels_data,
+    sampling_rate_data
+  );
+}
+
+void on_audio_frame_ready(
+  const VALUE self,
+  const uint32_t friend_number_data,
+  const int16_t *const pcm_data,
+  const size_t sample_count_data,
+  const uint8_t channels_data,
+  const uint32_t sampling_rate_data
+)
+{
+  CDATA(self, mTox_cAudioVideo_CDATA, self_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(self_cdata, friend_number_data);
+
+  // Recorded as played, after the jitter buffer.
+  if (call->recorder) {
+    mTox_CALL_RECORDER_PUSH(
+      call->recorder,
+      pcm_data,
+      sample_count_data,
+      channels_data,
+      sampling_rate_data
+    );
+  }
+
+  // Every call gets a meter with its first frame.
+  if (!call->audio_meter) {
+    call->audio_meter = mTox_AUDIO_METER_NEW(friend_number_data);
+  }
+
+  mTox_AUDIO_METER_PUSH(
+    call->audio_meter,
+    pcm_data,
+    sample_count_data * channels_data
+  );
+
+  mTox_cAudioVideo_RELAY_AUDIO(
+    call,
+    pcm_data,
+    sample_count_data,
+    channels_data,
+    sampling_rate_data
+  );
+
   const VALUE ivar_on_audio_frame = rb_iv_get(self, "@on_audio_frame");
 
   if (Qnil == ivar_on_audio_frame) {
     return;
   }
 
+  const VALUE ivar_frame_pool = rb_iv_get(self, "@frame_pool");
+
   const VALUE friend_number = LONG2FIX(friend_number_data);
 
-  const VALUE friend_call = rb_funcall(
-    mTox_cFriendCall,
-    rb_intern("new"),
-    2,
-    self,
-    friend_number
-  );
+  const VALUE friend_call =
+    FRIEND_CALL(self, ivar_frame_pool, friend_number);
 
-  const VALUE audio_frame = rb_funcall(mTox_cAudioFrame, rb_intern("new"), 0);
+  const VALUE audio_frame =
+    FRAME(ivar_frame_pool, mTox_cAudioFrame, "audio_frame");
 
-  CDATA(audio_frame, mTox_cAudioFrame_CDATA, audio_frame_cdata);
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
 
-  const VALUE pcm = rb_str_new(
-    pcm_data,
-    sample_count_data * channels_data * (sizeof(uint16_t) / sizeof(char))
+  mTox_cAudioFrame_SET_FORMAT(
+    audio_frame_cdata,
+    sample_count_data,
+    channels_data,
+    sampling_rate_data
   );
 
-  rb_iv_set(audio_frame, "@pcm", pcm);
+  const VALUE pcm =
+    FRAME_BUFFER(
+      mTox_cAudioFrame_REUSABLE_PCM(audio_frame_cdata),
+      audio_frame_cdata->pcm_size
+    );
 
-  audio_frame_cdata->sample_count  = sample_count_data;
-  audio_frame_cdata->channels      = channels_data;
-  audio_frame_cdata->sampling_rate = sampling_rate_data;
+  mTox_cAudioFrame_SET_PCM(audio_frame, audio_frame_cdata, pcm);
+
+  memcpy(RSTRING_PTR(pcm), pcm_data, audio_frame_cdata->pcm_size);
 
   rb_funcall(
     ivar_on_audio_frame,
@@ -131,6 +240,10 @@ void on_audio_frame(
     friend_call,
     audio_frame
   );
+
+  if (Qnil != ivar_frame_pool) {
+    rb_funcall(ivar_frame_pool, rb_intern("recycle"), 1, audio_frame);
+  }
 }
 
 void on_video_frame(
@@ -147,29 +260,20 @@ void on_video_frame(
   const VALUE self
 )
 {
-  const VALUE ivar_on_video_frame = rb_iv_get(self, "@on_video_frame");
-
-  if (Qnil == ivar_on_video_frame) {
-    return;
+  CDATA(self, mTox_cAudioVideo_CDATA, self_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(self_cdata, friend_number_data);
+
+  if (call && call->call_stats) {
+    mTox_CALL_STATS_RECEIVED(
+      call->call_stats,
+      mTox_CALL_STATS_VIDEO,
+      mTox_AUDIO_STREAM_NOW(),
+      0
+    );
   }
 
-  const VALUE friend_number = LONG2FIX(friend_number_data);
-
-  const VALUE friend_call = rb_funcall(
-    mTox_cFriendCall,
-    rb_intern("new"),
-    2,
-    self,
-    friend_number
-  );
-
-  const VALUE video_frame = rb_funcall(mTox_cVideoFrame, rb_intern("new"), 0);
-
-  CDATA(video_frame, mTox_cVideoFrame_CDATA, video_frame_cdata);
-
-  video_frame_cdata->width  = width_data;
-  video_frame_cdata->height = height_data;
-
   ystride_data = abs(ystride_data);
   ustride_data = abs(ustride_data);
   vstride_data = abs(vstride_data);
@@ -179,13 +283,70 @@ void on_video_frame(
     return;
   }
 
-  const VALUE y_plane = rb_str_new("", 0);
-  const VALUE u_plane = rb_str_new("", 0);
-  const VALUE v_plane = rb_str_new("", 0);
+  mTox_cAudioVideo_RELAY_VIDEO(
+    call,
+    width_data,
+    height_data,
+    y_data,
+    u_data,
+    v_data,
+    ystride_data,
+    ustride_data,
+    vstride_data
+  );
+
+  const VALUE ivar_on_video_frame = rb_iv_get(self, "@on_video_frame");
+
+  if (Qnil == ivar_on_video_frame) {
+    return;
+  }
 
-  rb_str_resize(y_plane, width_data * height_data);
-  rb_str_resize(u_plane, width_data * height_data / 4);
-  rb_str_resize(v_plane, width_data * height_data / 4);
+  const VALUE ivar_frame_pool = rb_iv_get(self, "@frame_pool");
+
+  const VALUE friend_number = LONG2FIX(friend_number_data);
+
+  const VALUE friend_call =
+    FRIEND_CALL(self, ivar_frame_pool, friend_number);
+
+  const VALUE video_frame =
+    FRAME(ivar_frame_pool, mTox_cVideoFrame, "video_frame");
+
+  VIDEO_FRAME_CDATA(video_frame, video_frame_cdata);
+
+  mTox_cVideoFrame_SET_SIZE(video_frame_cdata, width_data, height_data);
+
+  const VALUE y_plane =
+    FRAME_BUFFER(
+      mTox_cVideoFrame_REUSABLE_PLANE(
+        video_frame_cdata,
+        video_frame_cdata->y_plane
+      ),
+      video_frame_cdata->y_size
+    );
+  const VALUE u_plane =
+    FRAME_BUFFER(
+      mTox_cVideoFrame_REUSABLE_PLANE(
+        video_frame_cdata,
+        video_frame_cdata->u_plane
+      ),
+      video_frame_cdata->uv_size
+    );
+  const VALUE v_plane =
+    FRAME_BUFFER(
+      mTox_cVideoFrame_REUSABLE_PLANE(
+        video_frame_cdata,
+        video_frame_cdata->v_plane
+      ),
+      video_frame_cdata->uv_size
+    );
+
+  mTox_cVideoFrame_SET_PLANES(
+    video_frame,
+    video_frame_cdata,
+    y_plane,
+    u_plane,
+    v_plane
+  );
 
   char *const y_plane_data = RSTRING_PTR(y_plane);
   char *const u_plane_data = RSTRING_PTR(u_plane);
@@ -200,10 +361,6 @@ void on_video_frame(
     memcpy(&v_plane_data[h * width_data / 2], &v_data[h * vstride_data], width_data / 2);
   }
 
-  rb_iv_set(video_frame, "@y_plane", y_plane);
-  rb_iv_set(video_frame, "@u_plane", u_plane);
-  rb_iv_set(video_frame, "@v_plane", v_plane);
-
   rb_funcall(
     ivar_on_video_frame,
     rb_intern("call"),
@@ -211,4 +368,122 @@ void on_video_frame(
     friend_call,
     video_frame
   );
+
+  if (Qnil != ivar_frame_pool) {
+    rb_funcall(ivar_frame_pool, rb_intern("recycle"), 1, video_frame);
+  }
+}
+
+void on_audio_bit_rate(
+  ToxAV *const tox_av,
+  const uint32_t friend_number_data,
+  const uint32_t audio_bit_rate_data,
+  const VALUE self
+)
+{
+  BIT_RATE(
+    self,
+    friend_number_data,
+    audio_bit_rate_data,
+    mTox_BIT_RATE_CONTROL_AUDIO,
+    "@on_audio_bit_rate"
+  );
+}
+
+void on_video_bit_rate(
+  ToxAV *const tox_av,
+  const uint32_t friend_number_data,
+  const uint32_t video_bit_rate_data,
+  const VALUE self
+)
+{
+  BIT_RATE(
+    self,
+    friend_number_data,
+    video_bit_rate_data,
+    mTox_BIT_RATE_CONTROL_VIDEO,
+    "@on_video_bit_rate"
+  );
+}
+
+/******************************************************************************
+ * Helpers
+ ******************************************************************************/
+
+// Suggested bit rates go to the bit rate control of the friend, if any,
+// before the handler.
+void BIT_RATE(
+  const VALUE self,
+  const uint32_t friend_number_data,
+  const uint32_t bit_rate_data,
+  const mTox_BIT_RATE_CONTROL_KIND kind,
+  const char *const ivar_name
+)
+{
+  CDATA(self, mTox_cAudioVideo_CDATA, self_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(self_cdata, friend_number_data);
+
+  if (call && call->bit_rate_control) {
+    mTox_BIT_RATE_CONTROL_SUGGESTED(call->bit_rate_control, kind, bit_rate_data);
+  }
+
+  const VALUE ivar_on_bit_rate = rb_iv_get(self, ivar_name);
+
+  if (Qnil == ivar_on_bit_rate) {
+    return;
+  }
+
+  const VALUE friend_number = LONG2FIX(friend_number_data);
+
+  const VALUE friend_call =
+    rb_funcall(mTox_cFriendCall, rb_intern("new"), 2, self, friend_number);
+
+  const VALUE bit_rate = ULONG2NUM(bit_rate_data);
+
+  rb_funcall(
+    ivar_on_bit_rate,
+    rb_intern("call"),
+    2,
+    friend_call,
+    bit_rate
+  );
+}
+
+// Friend calls are cached by the frame pool, if any.
+VALUE FRIEND_CALL(
+  const VALUE self,
+  const VALUE frame_pool,
+  const VALUE friend_number
+)
+{
+  if (Qnil != frame_pool) {
+    return rb_funcall(frame_pool, rb_intern("friend_call"), 1, friend_number);
+  }
+
+  return rb_funcall(mTox_cFriendCall, rb_intern("new"), 2, self, friend_number);
+}
+
+VALUE FRAME(const VALUE frame_pool, const VALUE klass, const char *const acquire)
+{
+  if (Qnil != frame_pool) {
+    return rb_funcall(frame_pool, rb_intern(acquire), 0);
+  }
+
+  return rb_funcall(klass, rb_intern("new"), 0);
+}
+
+// Reuses the buffer of a recycled frame. Fresh frames hold frozen empty
+// strings, so they get new ones, as do frames whose buffers are held by
+// memory views.
+VALUE FRAME_BUFFER(const VALUE buffer, const long length)
+{
+  if (OBJ_FROZEN(buffer)) {
+    return rb_str_new(NULL, length);
+  }
+
+  rb_str_resize(buffer, length);
+
+  return buffer;
 }
@@ -23,6 +23,16 @@ void on_audio_frame(
   VALUE self
 );
 
+// Hands a frame to the handler, from toxav or from the jitter buffer.
+void on_audio_frame_ready(
+  VALUE self,
+  uint32_t friend_number_data,
+  const int16_t *pcm_data,
+  size_t sample_count_data,
+  uint8_t channels_data,
+  uint32_t sampling_rate_data
+);
+
 void on_video_frame(
   ToxAV *tox_av,
   uint32_t friend_number_data,
@@ -36,3 +46,17 @@ void on_video_frame(
   int32_t vstride,
   VALUE self
 );
+
+void on_audio_bit_rate(
+  ToxAV *tox_av,
+  uint32_t friend_number_data,
+  uint32_t audio_bit_rate_data,
+  VALUE self
+);
+
+void on_video_bit_rate(
+  ToxAV *tox_av,
+  uint32_t friend_number_data,
+  uint32_t video_bit_rate_data,
+  VALUE self
+);
@@ -0,0 +1,548 @@
+#include "tox.h"
+
+#include <math.h>
+
+typedef struct {
+  uint32_t min;
+  uint32_t max;
+  uint32_t current;
+  bool     held;
+
+  size_t   failures;
+  uint32_t suggested;
+  bool     congested;
+  uint64_t last_congestion;
+} mTox_BIT_RATE_CONTROL_RATE;
+
+struct mTox_BIT_RATE_CONTROL {
+  uint32_t friend_number;
+
+  bool     pending;
+  uint64_t last_update;
+
+  uint64_t last_video_frame;
+  uint64_t video_interval;
+  uint64_t video_duration;
+
+  mTox_BIT_RATE_CONTROL_RATE rates[2];
+
+  mTox_BIT_RATE_CONTROL_STATS stats;
+};
+
+// Memory management
+static VALUE mTox_cBitRateControl_alloc(VALUE klass);
+static void  mTox_cBitRateControl_free(mTox_cBitRateControl_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cBitRateControl_update(VALUE self, VALUE time);
+static VALUE mTox_cBitRateControl_stats(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cBitRateControl_initialize_with(VALUE self, VALUE audio_min, VALUE audio_max, VALUE video_min, VALUE video_max);
+static VALUE mTox_cBitRateControl_hold_with(VALUE self, VALUE kind, VALUE bit_rate);
+static VALUE mTox_cBitRateControl_failed_with(VALUE self, VALUE kind);
+static VALUE mTox_cBitRateControl_suggested_with(VALUE self, VALUE kind, VALUE bit_rate);
+static VALUE mTox_cBitRateControl_video_sent_with(VALUE self, VALUE duration, VALUE time);
+
+// Private functions
+
+static bool mTox_BIT_RATE_CONTROL_RATE_UPDATE(mTox_BIT_RATE_CONTROL *bit_rate_control, mTox_BIT_RATE_CONTROL_RATE *rate, bool congested, uint64_t now);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cBitRateControl_INIT()
+{
+  // Defined here and kept private, spec/support/bit_rate_control.rb wraps it.
+  mTox_cBitRateControl = rb_define_class_under(mTox, "BitRateControl", rb_cObject);
+  rb_funcall(mTox, rb_intern("private_constant"), 1, ID2SYM(rb_intern("BitRateControl")));
+
+  // Memory management
+  rb_define_alloc_func(mTox_cBitRateControl, mTox_cBitRateControl_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cBitRateControl, "update", mTox_cBitRateControl_update, 1);
+  rb_define_method(mTox_cBitRateControl, "stats",  mTox_cBitRateControl_stats,  0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cBitRateControl, "initialize_with", mTox_cBitRateControl_initialize_with, 4);
+  rb_define_private_method(mTox_cBitRateControl, "hold_with",       mTox_cBitRateControl_hold_with,       2);
+  rb_define_private_method(mTox_cBitRateControl, "failed_with",     mTox_cBitRateControl_failed_with,     1);
+  rb_define_private_method(mTox_cBitRateControl, "suggested_with",  mTox_cBitRateControl_suggested_with,  2);
+  rb_define_private_method(mTox_cBitRateControl, "video_sent_with", mTox_cBitRateControl_video_sent_with, 2);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cBitRateControl_alloc(const VALUE klass)
+{
+  mTox_cBitRateControl_CDATA *alloc_cdata = ALLOC(mTox_cBitRateControl_CDATA);
+
+  alloc_cdata->bit_rate_control = NULL;
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cBitRateControl_free, alloc_cdata);
+}
+
+void mTox_cBitRateControl_free(mTox_cBitRateControl_CDATA *const free_cdata)
+{
+  mTox_BIT_RATE_CONTROL_FREE(free_cdata->bit_rate_control);
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::BitRateControl#update
+VALUE mTox_cBitRateControl_update(const VALUE self, const VALUE time)
+{
+  const uint64_t now = llround(NUM2DBL(time) * 1000000);
+
+  CDATA(self, mTox_cBitRateControl_CDATA, self_cdata);
+
+  uint32_t audio_bit_rate_data = UINT32_MAX;
+  uint32_t video_bit_rate_data = UINT32_MAX;
+
+  const VALUE result = rb_hash_new();
+
+  if (!mTox_BIT_RATE_CONTROL_UPDATE(
+        self_cdata->bit_rate_control,
+        now,
+        &audio_bit_rate_data,
+        &video_bit_rate_data
+      )) {
+    return result;
+  }
+
+  if (audio_bit_rate_data != UINT32_MAX) {
+    rb_hash_aset(result, ID2SYM(rb_intern("audio")), ULONG2NUM(audio_bit_rate_data));
+  }
+
+  if (video_bit_rate_data != UINT32_MAX) {
+    rb_hash_aset(result, ID2SYM(rb_intern("video")), ULONG2NUM(video_bit_rate_data));
+  }
+
+  return result;
+}
+
+// Tox::BitRateControl#stats
+VALUE mTox_cBitRateControl_stats(const VALUE self)
+{
+  CDATA(self, mTox_cBitRateControl_CDATA, self_cdata);
+
+  return mTox_BIT_RATE_CONTROL_STATS_HASH(self_cdata->bit_rate_control);
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::BitRateControl#initialize_with
+VALUE mTox_cBitRateControl_initialize_with(
+  const VALUE self,
+  const VALUE audio_min,
+  const VALUE audio_max,
+  const VALUE video_min,
+  const VALUE video_max
+)
+{
+  CDATA(self, mTox_cBitRateControl_CDATA, self_cdata);
+
+  mTox_BIT_RATE_CONTROL_FREE(self_cdata->bit_rate_control);
+
+  self_cdata->bit_rate_control = mTox_BIT_RATE_CONTROL_NEW(
+    0,
+    NUM2ULONG(audio_min),
+    NUM2ULONG(audio_max),
+    NUM2ULONG(video_min),
+    NUM2ULONG(video_max)
+  );
+
+  return self;
+}
+
+// Tox::BitRateControl#hold_with
+VALUE mTox_cBitRateControl_hold_with(
+  const VALUE self,
+  const VALUE kind,
+  const VALUE bit_rate
+)
+{
+  CDATA(self, mTox_cBitRateControl_CDATA, self_cdata);
+
+  mTox_BIT_RATE_CONTROL_HOLD(
+    self_cdata->bit_rate_control,
+    NUM2INT(kind),
+    NUM2ULONG(bit_rate)
+  );
+
+  return self;
+}
+
+// Tox::BitRateControl#failed_with
+VALUE mTox_cBitRateControl_failed_with(const VALUE self, const VALUE kind)
+{
+  CDATA(self, mTox_cBitRateControl_CDATA, self_cdata);
+
+  mTox_BIT_RATE_CONTROL_FAILED(self_cdata->bit_rate_control, NUM2INT(kind));
+
+  return self;
+}
+
+// Tox::BitRateControl#suggested_with
+VALUE mTox_cBitRateControl_suggested_with(
+  const VALUE self,
+  const VALUE kind,
+  const VALUE bit_rate
+)
+{
+  CDATA(self, mTox_cBitRateControl_CDATA, self_cdata);
+
+  mTox_BIT_RATE_CONTROL_SUGGESTED(
+    self_cdata->bit_rate_control,
+    NUM2INT(kind),
+    NUM2ULONG(bit_rate)
+  );
+
+  return self;
+}
+
+// Tox::BitRateControl#video_sent_with
+VALUE mTox_cBitRateControl_video_sent_with(
+  const VALUE self,
+  const VALUE duration,
+  const VALUE time
+)
+{
+  const uint64_t duration_data = llround(NUM2DBL(duration) * 1000000);
+  const uint64_t now           = llround(NUM2DBL(time)     * 1000000);
+
+  CDATA(self, mTox_cBitRateControl_CDATA, self_cdata);
+
+  mTox_BIT_RATE_CONTROL_VIDEO_SENT(
+    self_cdata->bit_rate_control,
+    duration_data,
+    now
+  );
+
+  return self;
+}
+
+/*************************************************************
+ * Bit rate control
+ *************************************************************/
+
+mTox_BIT_RATE_CONTROL *mTox_BIT_RATE_CONTROL_NEW(
+  const uint32_t friend_number,
+  const uint32_t audio_min,
+  const uint32_t audio_max,
+  const uint32_t video_min,
+  const uint32_t video_max
+)
+{
+  mTox_BIT_RATE_CONTROL *const bit_rate_control =
+    ALLOC(mTox_BIT_RATE_CONTROL);
+
+  memset(bit_rate_control, 0, sizeof(mTox_BIT_RATE_CONTROL));
+
+  bit_rate_control->friend_number = friend_number;
+  bit_rate_control->pending       = true;
+
+  mTox_BIT_RATE_CONTROL_RATE *const audio =
+    &bit_rate_control->rates[mTox_BIT_RATE_CONTROL_AUDIO];
+
+  mTox_BIT_RATE_CONTROL_RATE *const video =
+    &bit_rate_control->rates[mTox_BIT_RATE_CONTROL_VIDEO];
+
+  audio->min     = audio_min;
+  audio->max     = audio_max;
+  audio->current = audio_max;
+  audio->held    = audio_max == 0;
+
+  video->min     = video_min;
+  video->max     = video_max;
+  video->current = video_max;
+  video->held    = video_max == 0;
+
+  bit_rate_control->stats.audio_bit_rate = audio_max;
+  bit_rate_control->stats.video_bit_rate = video_max;
+
+  return bit_rate_control;
+}
+
+void mTox_BIT_RATE_CONTROL_FREE(mTox_BIT_RATE_CONTROL *const bit_rate_control)
+{
+  free(bit_rate_control);
+}
+
+uint32_t mTox_BIT_RATE_CONTROL_FRIEND_NUMBER(
+  const mTox_BIT_RATE_CONTROL *const bit_rate_control
+)
+{
+  return bit_rate_control->friend_number;
+}
+
+void mTox_BIT_RATE_CONTROL_HOLD(
+  mTox_BIT_RATE_CONTROL *const bit_rate_control,
+  const mTox_BIT_RATE_CONTROL_KIND kind,
+  const uint32_t bit_rate
+)
+{
+  mTox_BIT_RATE_CONTROL_RATE *const rate = &bit_rate_control->rates[kind];
+
+  rate->held    = true;
+  rate->current = bit_rate;
+
+  if (kind == mTox_BIT_RATE_CONTROL_AUDIO) {
+    bit_rate_control->stats.audio_bit_rate = bit_rate;
+  }
+  else {
+    bit_rate_control->stats.video_bit_rate = bit_rate;
+  }
+}
+
+void mTox_BIT_RATE_CONTROL_FAILED(
+  mTox_BIT_RATE_CONTROL *const bit_rate_control,
+  const mTox_BIT_RATE_CONTROL_KIND kind
+)
+{
+  ++bit_rate_control->rates[kind].failures;
+  ++bit_rate_control->stats.failures;
+}
+
+void mTox_BIT_RATE_CONTROL_SUGGESTED(
+  mTox_BIT_RATE_CONTROL *const bit_rate_control,
+  const mTox_BIT_RATE_CONTROL_KIND kind,
+  const uint32_t bit_rate
+)
+{
+  mTox_BIT_RATE_CONTROL_RATE *const rate = &bit_rate_control->rates[kind];
+
+  ++bit_rate_control->stats.suggestions;
+
+  if (bit_rate < rate->current &&
+      (rate->suggested == 0 || bit_rate < rate->suggested)) {
+    rate->suggested = bit_rate;
+  }
+}
+
+// Intervals and durations are smoothed, so single slow frames, like key
+// frames, do not count as overload.
+void mTox_BIT_RATE_CONTROL_VIDEO_SENT(
+  mTox_BIT_RATE_CONTROL *const bit_rate_control,
+  const uint64_t duration,
+  const uint64_t now
+)
+{
+  const uint64_t last_video_frame = bit_rate_control->last_video_frame;
+
+  bit_rate_control->last_video_frame = now;
+
+  if (last_video_frame == 0 ||
+      now - last_video_frame > mTox_BIT_RATE_CONTROL_INTERVAL_USEC) {
+    bit_rate_control->video_interval = 0;
+    bit_rate_control->video_duration = duration;
+    return;
+  }
+
+  const uint64_t interval = now - last_video_frame;
+
+  if (bit_rate_control->video_interval == 0) {
+    bit_rate_control->video_interval = interval;
+  }
+  else {
+    bit_rate_control->video_interval =
+      (bit_rate_control->video_interval * 7 + interval) / 8;
+  }
+
+  bit_rate_control->video_duration =
+    (bit_rate_control->video_duration * 7 + duration) / 8;
+
+  mTox_BIT_RATE_CONTROL_RATE *const video =
+    &bit_rate_control->rates[mTox_BIT_RATE_CONTROL_VIDEO];
+
+  if (!video->congested &&
+      bit_rate_control->video_duration * 4 >
+      bit_rate_control->video_interval * 3) {
+    video->congested = true;
+    ++bit_rate_control->stats.overloads;
+  }
+}
+
+bool mTox_BIT_RATE_CONTROL_UPDATE(
+  mTox_BIT_RATE_CONTROL *const bit_rate_control,
+  const uint64_t now,
+  uint32_t *const audio_bit_rate,
+  uint32_t *const video_bit_rate
+)
+{
+  mTox_BIT_RATE_CONTROL_RATE *const audio =
+    &bit_rate_control->rates[mTox_BIT_RATE_CONTROL_AUDIO];
+
+  mTox_BIT_RATE_CONTROL_RATE *const video =
+    &bit_rate_control->rates[mTox_BIT_RATE_CONTROL_VIDEO];
+
+  if (bit_rate_control->pending) {
+    bit_rate_control->pending     = false;
+    bit_rate_control->last_update = now;
+    audio->last_congestion        = now;
+    video->last_congestion        = now;
+
+    if (!audio->held) {
+      *audio_bit_rate = audio->current;
+    }
+
+    if (!video->held) {
+      *video_bit_rate = video->current;
+    }
+
+    return !audio->held || !video->held;
+  }
+
+  if (now - bit_rate_control->last_update <
+      mTox_BIT_RATE_CONTROL_INTERVAL_USEC) {
+    return false;
+  }
+
+  bit_rate_control->last_update = now;
+
+  const bool audio_congested =
+    audio->failures >= mTox_BIT_RATE_CONTROL_MAX_FAILURES ||
+    audio->suggested != 0 ||
+    audio->congested;
+
+  const bool video_congested =
+    video->failures >= mTox_BIT_RATE_CONTROL_MAX_FAILURES ||
+    video->suggested != 0 ||
+    video->congested ||
+    audio_congested;
+
+  const bool audio_changed = mTox_BIT_RATE_CONTROL_RATE_UPDATE(
+    bit_rate_control,
+    audio,
+    audio_congested,
+    now
+  );
+
+  const bool video_changed = mTox_BIT_RATE_CONTROL_RATE_UPDATE(
+    bit_rate_control,
+    video,
+    video_congested,
+    now
+  );
+
+  if (audio_changed) {
+    *audio_bit_rate = audio->current;
+  }
+
+  if (video_changed) {
+    *video_bit_rate = video->current;
+  }
+
+  bit_rate_control->stats.audio_bit_rate = audio->current;
+  bit_rate_control->stats.video_bit_rate = video->current;
+
+  return audio_changed || video_changed;
+}
+
+void mTox_BIT_RATE_CONTROL_GET_STATS(
+  const mTox_BIT_RATE_CONTROL *const bit_rate_control,
+  mTox_BIT_RATE_CONTROL_STATS *const stats
+)
+{
+  *stats = bit_rate_control->stats;
+}
+
+VALUE mTox_BIT_RATE_CONTROL_STATS_HASH(
+  const mTox_BIT_RATE_CONTROL *const bit_rate_control
+)
+{
+  mTox_BIT_RATE_CONTROL_STATS stats;
+
+  mTox_BIT_RATE_CONTROL_GET_STATS(bit_rate_control, &stats);
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("audio_bit_rate")), ULONG2NUM(stats.audio_bit_rate));
+  rb_hash_aset(result, ID2SYM(rb_intern("video_bit_rate")), ULONG2NUM(stats.video_bit_rate));
+  rb_hash_aset(result, ID2SYM(rb_intern("failures")),       ULL2NUM(stats.failures));
+  rb_hash_aset(result, ID2SYM(rb_intern("suggestions")),    ULL2NUM(stats.suggestions));
+  rb_hash_aset(result, ID2SYM(rb_intern("overloads")),      ULL2NUM(stats.overloads));
+  rb_hash_aset(result, ID2SYM(rb_intern("decreases")),      ULL2NUM(stats.decreases));
+  rb_hash_aset(result, ID2SYM(rb_intern("increases")),      ULL2NUM(stats.increases));
+
+  return result;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+bool mTox_BIT_RATE_CONTROL_RATE_UPDATE(
+  mTox_BIT_RATE_CONTROL *const bit_rate_control,
+  mTox_BIT_RATE_CONTROL_RATE *const rate,
+  const bool congested,
+  const uint64_t now
+)
+{
+  const uint32_t suggested = rate->suggested;
+
+  rate->failures  = 0;
+  rate->suggested = 0;
+  rate->congested = false;
+
+  if (rate->held) {
+    return false;
+  }
+
+  uint32_t bit_rate = rate->current;
+
+  if (congested) {
+    rate->last_congestion = now;
+
+    bit_rate = (uint64_t)bit_rate *
+      mTox_BIT_RATE_CONTROL_DECREASE_NUM / mTox_BIT_RATE_CONTROL_DECREASE_DEN;
+
+    if (suggested != 0 && suggested < bit_rate) {
+      bit_rate = suggested;
+    }
+
+    if (bit_rate < rate->min) {
+      bit_rate = rate->min;
+    }
+
+    if (bit_rate == rate->current) {
+      return false;
+    }
+
+    ++bit_rate_control->stats.decreases;
+  }
+  else {
+    if (rate->current >= rate->max ||
+        now - rate->last_congestion < mTox_BIT_RATE_CONTROL_QUIET_USEC) {
+      return false;
+    }
+
+    uint32_t step = (rate->max - rate->min) / mTox_BIT_RATE_CONTROL_STEPS;
+
+    if (step == 0) {
+      step = 1;
+    }
+
+    bit_rate = rate->max - rate->current > step ? rate->current + step
+                                                : rate->max;
+
+    ++bit_rate_control->stats.increases;
+  }
+
+  rate->current = bit_rate;
+
+  return true;
+}
@@ -0,0 +1,95 @@
+// Adaptive bit rates of calls. Sending reports congestion when toxav can
+// not queue or send a frame, toxav suggests lower bit rates when packets
+// are lost, and video frames which take longer to send than the interval
+// between them mean the encoder can not keep up. Once in an interval bit
+// rates are decreased multiplicatively when any of these happened, and
+// increased additively after a quiet period, between the given limits in
+// kbit/sec. Congestion of audio also decreases video, which takes most of
+// the bandwidth. Held kinds, the ones disabled in the call or set by the
+// user, are left alone.
+
+#define mTox_BIT_RATE_CONTROL_INTERVAL_USEC 1000000
+#define mTox_BIT_RATE_CONTROL_QUIET_USEC    5000000
+
+// Failed frames per interval which mean congestion.
+#define mTox_BIT_RATE_CONTROL_MAX_FAILURES 3
+
+// Decrease factor and number of increase steps between the limits.
+#define mTox_BIT_RATE_CONTROL_DECREASE_NUM 3
+#define mTox_BIT_RATE_CONTROL_DECREASE_DEN 4
+#define mTox_BIT_RATE_CONTROL_STEPS        16
+
+typedef enum {
+  mTox_BIT_RATE_CONTROL_AUDIO = 0,
+  mTox_BIT_RATE_CONTROL_VIDEO = 1,
+} mTox_BIT_RATE_CONTROL_KIND;
+
+typedef struct mTox_BIT_RATE_CONTROL mTox_BIT_RATE_CONTROL;
+
+typedef struct {
+  uint32_t audio_bit_rate;
+  uint32_t video_bit_rate;
+  uint64_t failures;
+  uint64_t suggestions;
+  uint64_t overloads;
+  uint64_t decreases;
+  uint64_t increases;
+} mTox_BIT_RATE_CONTROL_STATS;
+
+// Zero limits hold the kind. Bit rates start at the maximums.
+mTox_BIT_RATE_CONTROL *mTox_BIT_RATE_CONTROL_NEW(
+  uint32_t friend_number,
+  uint32_t audio_min,
+  uint32_t audio_max,
+  uint32_t video_min,
+  uint32_t video_max
+);
+
+void mTox_BIT_RATE_CONTROL_FREE(mTox_BIT_RATE_CONTROL *bit_rate_control);
+
+uint32_t mTox_BIT_RATE_CONTROL_FRIEND_NUMBER(
+  const mTox_BIT_RATE_CONTROL *bit_rate_control
+);
+
+// The kind was set to "bit_rate" elsewhere, zero disables it. It is not
+// changed any more.
+void mTox_BIT_RATE_CONTROL_HOLD(
+  mTox_BIT_RATE_CONTROL *bit_rate_control,
+  mTox_BIT_RATE_CONTROL_KIND kind,
+  uint32_t bit_rate
+);
+
+void mTox_BIT_RATE_CONTROL_FAILED(
+  mTox_BIT_RATE_CONTROL *bit_rate_control,
+  mTox_BIT_RATE_CONTROL_KIND kind
+);
+
+void mTox_BIT_RATE_CONTROL_SUGGESTED(
+  mTox_BIT_RATE_CONTROL *bit_rate_control,
+  mTox_BIT_RATE_CONTROL_KIND kind,
+  uint32_t bit_rate
+);
+
+// A video frame took "duration" to send, starting at "now".
+void mTox_BIT_RATE_CONTROL_VIDEO_SENT(
+  mTox_BIT_RATE_CONTROL *bit_rate_control,
+  uint64_t duration,
+  uint64_t now
+);
+
+// Returns true and sets the bit rates of the kinds which have changed;
+// the others are left untouched.
+bool mTox_BIT_RATE_CONTROL_UPDATE(
+  mTox_BIT_RATE_CONTROL *bit_rate_control,
+  uint64_t now,
+  uint32_t *audio_bit_rate,
+  uint32_t *video_bit_rate
+);
+
+void mTox_BIT_RATE_CONTROL_GET_STATS(
+  const mTox_BIT_RATE_CONTROL *bit_rate_control,
+  mTox_BIT_RATE_CONTROL_STATS *stats
+);
+
+// Stats for Ruby, in kbit/sec.
+VALUE mTox_BIT_RATE_CONTROL_STATS_HASH(const mTox_BIT_RATE_CONTROL *bit_rate_control);
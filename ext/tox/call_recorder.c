@@ -0,0 +1,699 @@
+#include "tox.h"
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <opus/opus.h>
+
+// Lacing values of a page and its largest body.
+#define mTox_CALL_RECORDER_PAGE_SEGMENTS 255
+#define mTox_CALL_RECORDER_PAGE_SIZE     (255 * 255)
+
+#define mTox_CALL_RECORDER_PAGE_BOS 0x02
+#define mTox_CALL_RECORDER_PAGE_EOS 0x04
+
+// Largest packet of a single 20 ms Opus frame.
+#define mTox_CALL_RECORDER_MAX_PACKET 1275
+
+// Interrupts of a thread waiting for a recorder to close are checked this
+// often.
+#define mTox_CALL_RECORDER_WAIT_NSEC 10000000
+
+struct mTox_CALL_RECORDER {
+  uint32_t friend_number;
+  uint32_t bit_rate;
+  int      fd;
+
+  pthread_t       thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  pthread_cond_t  finished_cond;
+
+  // Shared with the thread, guarded by the mutex.
+
+  bool closing;
+  bool finished;
+  bool detached;
+
+  uint32_t sampling_rate;
+  uint8_t  channels;
+
+  size_t   head;
+  size_t   size;
+  size_t   capacity;
+  int16_t *samples;
+
+  mTox_CALL_RECORDER_STATS stats;
+
+  // Owned by the thread.
+
+  OpusEncoder *encoder;
+  uint32_t     serial;
+  uint32_t     pre_skip;
+  uint64_t     granule;
+  uint32_t     page_sequence;
+  int          error;
+
+  size_t  page_packets;
+  size_t  page_segments_size;
+  size_t  page_size;
+  uint8_t page_segments[mTox_CALL_RECORDER_PAGE_SEGMENTS];
+  uint8_t page[mTox_CALL_RECORDER_PAGE_SIZE];
+};
+
+typedef struct {
+  mTox_CALL_RECORDER *recorder;
+  volatile bool       interrupted;
+  bool                finished;
+} mTox_CALL_RECORDER_WAIT_ARGS;
+
+static uint32_t       mTox_CALL_RECORDER_CRC_TABLE[256];
+static pthread_once_t mTox_CALL_RECORDER_CRC_ONCE = PTHREAD_ONCE_INIT;
+
+// Private functions
+
+static void *mTox_CALL_RECORDER_RUN(void *data);
+static void *mTox_CALL_RECORDER_WAIT(void *data);
+static int   mTox_CALL_RECORDER_DESTROY(mTox_CALL_RECORDER *recorder);
+
+static bool mTox_CALL_RECORDER_START(mTox_CALL_RECORDER *recorder, uint32_t sampling_rate, uint8_t channels);
+static void mTox_CALL_RECORDER_ENCODE(mTox_CALL_RECORDER *recorder, const int16_t *frame, size_t sample_count, size_t duration);
+
+static void mTox_CALL_RECORDER_PACKET(mTox_CALL_RECORDER *recorder, const uint8_t *data, size_t length);
+static void mTox_CALL_RECORDER_PAGE(mTox_CALL_RECORDER *recorder, uint8_t flags);
+static void mTox_CALL_RECORDER_WRITE(mTox_CALL_RECORDER *recorder, const uint8_t *data, size_t length);
+
+static void     mTox_CALL_RECORDER_CRC_INIT();
+static uint32_t mTox_CALL_RECORDER_CRC(uint32_t crc, const uint8_t *data, size_t length);
+
+static void mTox_CALL_RECORDER_PUT_LE16(uint8_t *data, uint16_t value);
+static void mTox_CALL_RECORDER_PUT_LE32(uint8_t *data, uint32_t value);
+static void mTox_CALL_RECORDER_PUT_LE64(uint8_t *data, uint64_t value);
+
+/*************************************************************
+ * Recorders
+ *************************************************************/
+
+mTox_CALL_RECORDER *mTox_CALL_RECORDER_NEW(
+  const uint32_t friend_number,
+  const int fd,
+  const uint32_t bit_rate,
+  int *const error
+)
+{
+  pthread_once(&mTox_CALL_RECORDER_CRC_ONCE, mTox_CALL_RECORDER_CRC_INIT);
+
+  mTox_CALL_RECORDER *const recorder = ALLOC(mTox_CALL_RECORDER);
+
+  memset(recorder, 0, sizeof(mTox_CALL_RECORDER));
+
+  recorder->friend_number = friend_number;
+  recorder->bit_rate      = bit_rate;
+  recorder->fd            = fd;
+  recorder->serial        = randombytes_random();
+
+  pthread_mutex_init(&recorder->mutex, NULL);
+  pthread_cond_init(&recorder->cond, NULL);
+  pthread_cond_init(&recorder->finished_cond, NULL);
+
+  *error = pthread_create(
+    &recorder->thread,
+    NULL,
+    mTox_CALL_RECORDER_RUN,
+    recorder
+  );
+
+  if (*error) {
+    pthread_cond_destroy(&recorder->finished_cond);
+    pthread_cond_destroy(&recorder->cond);
+    pthread_mutex_destroy(&recorder->mutex);
+    free(recorder);
+    return NULL;
+  }
+
+  return recorder;
+}
+
+// The recorder thread is waited for without the GVL. When an exception
+// interrupts the wait, the recorder is detached before it is raised.
+int mTox_CALL_RECORDER_CLOSE(mTox_CALL_RECORDER *const recorder)
+{
+  if (!recorder) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&recorder->mutex);
+  recorder->closing = true;
+  pthread_cond_signal(&recorder->cond);
+  pthread_mutex_unlock(&recorder->mutex);
+
+  mTox_CALL_RECORDER_WAIT_ARGS args;
+
+  args.recorder    = recorder;
+  args.interrupted = false;
+  args.finished    = false;
+
+  const int state = mTox_FILE_IO_WITHOUT_GVL(
+    mTox_CALL_RECORDER_WAIT,
+    &args,
+    &args.interrupted,
+    &args.finished
+  );
+
+  if (state) {
+    mTox_CALL_RECORDER_DETACH(recorder);
+    rb_jump_tag(state);
+  }
+
+  // The thread only has to return.
+  pthread_join(recorder->thread, NULL);
+
+  const int error       = recorder->error;
+  const int close_error = mTox_CALL_RECORDER_DESTROY(recorder);
+
+  return error ? error : close_error;
+}
+
+// The thread frees the recorder when it finishes, unless it already has.
+void mTox_CALL_RECORDER_DETACH(mTox_CALL_RECORDER *const recorder)
+{
+  if (!recorder) {
+    return;
+  }
+
+  pthread_mutex_lock(&recorder->mutex);
+  recorder->closing  = true;
+  recorder->detached = true;
+  pthread_cond_signal(&recorder->cond);
+  const bool finished = recorder->finished;
+  pthread_mutex_unlock(&recorder->mutex);
+
+  if (finished) {
+    pthread_join(recorder->thread, NULL);
+    mTox_CALL_RECORDER_DESTROY(recorder);
+  }
+  else {
+    pthread_detach(recorder->thread);
+  }
+}
+
+uint32_t mTox_CALL_RECORDER_FRIEND_NUMBER(
+  const mTox_CALL_RECORDER *const recorder
+)
+{
+  return recorder->friend_number;
+}
+
+void mTox_CALL_RECORDER_PUSH(
+  mTox_CALL_RECORDER *const recorder,
+  const int16_t *const pcm,
+  const size_t sample_count,
+  const uint8_t channels,
+  const uint32_t sampling_rate
+)
+{
+  if (channels < 1 || channels > 2) {
+    return;
+  }
+
+  // The first frame chooses the format; the buffer is allocated here, under
+  // the GVL, as the thread must not allocate with Ruby. Only this function
+  // sets it, so it is checked and allocated before locking, as allocation
+  // may raise or run the GC.
+  int16_t *samples = NULL;
+  size_t   capacity = 0;
+
+  if (!recorder->samples) {
+    capacity =
+      (size_t)sampling_rate / 1000 * mTox_CALL_RECORDER_BUFFER_MSEC * channels;
+    samples = ALLOC_N(int16_t, capacity);
+  }
+
+  pthread_mutex_lock(&recorder->mutex);
+
+  ++recorder->stats.received;
+
+  if (samples) {
+    recorder->sampling_rate = sampling_rate;
+    recorder->channels      = channels;
+    recorder->capacity      = capacity;
+    recorder->samples       = samples;
+
+    recorder->stats.sampling_rate = sampling_rate;
+    recorder->stats.channels      = channels;
+  }
+
+  const size_t length = sample_count * recorder->channels;
+
+  if (sampling_rate != recorder->sampling_rate ||
+      recorder->capacity - recorder->size < length) {
+    ++recorder->stats.dropped;
+    pthread_mutex_unlock(&recorder->mutex);
+    return;
+  }
+
+  size_t tail = (recorder->head + recorder->size) % recorder->capacity;
+
+  for (size_t i = 0; i < sample_count; ++i) {
+    if (channels == recorder->channels) {
+      for (uint8_t c = 0; c < channels; ++c) {
+        recorder->samples[tail] = pcm[i * channels + c];
+        tail = (tail + 1) % recorder->capacity;
+      }
+    }
+    else if (channels == 2) {
+      recorder->samples[tail] = (pcm[i * 2] + pcm[i * 2 + 1]) / 2;
+      tail = (tail + 1) % recorder->capacity;
+    }
+    else {
+      recorder->samples[tail] = pcm[i];
+      tail = (tail + 1) % recorder->capacity;
+      recorder->samples[tail] = pcm[i];
+      tail = (tail + 1) % recorder->capacity;
+    }
+  }
+
+  recorder->size += length;
+
+  const size_t frame_size =
+    (size_t)recorder->sampling_rate / 1000 * mTox_CALL_RECORDER_FRAME_MSEC *
+      recorder->channels;
+
+  if (recorder->size >= frame_size) {
+    pthread_cond_signal(&recorder->cond);
+  }
+
+  pthread_mutex_unlock(&recorder->mutex);
+}
+
+void mTox_CALL_RECORDER_GET_STATS(
+  mTox_CALL_RECORDER *const recorder,
+  mTox_CALL_RECORDER_STATS *const stats
+)
+{
+  pthread_mutex_lock(&recorder->mutex);
+  *stats = recorder->stats;
+  pthread_mutex_unlock(&recorder->mutex);
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+// Thread of a recorder. Frames are taken out of the buffer under the lock
+// and encoded without it; when the recorder closes, the rest is padded
+// with silence which the final granule position trims, and the last page
+// ends the stream.
+void *mTox_CALL_RECORDER_RUN(void *const data)
+{
+  mTox_CALL_RECORDER *const recorder = data;
+
+  int16_t *frame = NULL;
+
+  pthread_mutex_lock(&recorder->mutex);
+
+  for (;;) {
+    const size_t frame_size =
+      (size_t)recorder->sampling_rate / 1000 * mTox_CALL_RECORDER_FRAME_MSEC *
+        recorder->channels;
+
+    if (!recorder->closing && (frame_size == 0 || recorder->size < frame_size)) {
+      pthread_cond_wait(&recorder->cond, &recorder->mutex);
+      continue;
+    }
+
+    // Closing with nothing left.
+    if (frame_size == 0 || recorder->size == 0) {
+      break;
+    }
+
+    if (!frame) {
+      frame = malloc(frame_size * sizeof(int16_t));
+
+      if (!frame) {
+        recorder->stats.error = recorder->error = ENOMEM;
+        break;
+      }
+    }
+
+    const size_t length =
+      recorder->size < frame_size ? recorder->size : frame_size;
+
+    for (size_t i = 0; i < length; ++i) {
+      frame[i] = recorder->samples[(recorder->head + i) % recorder->capacity];
+    }
+
+    memset(&frame[length], 0, (frame_size - length) * sizeof(int16_t));
+
+    recorder->head  = (recorder->head + length) % recorder->capacity;
+    recorder->size -= length;
+
+    const uint32_t sampling_rate = recorder->sampling_rate;
+    const uint8_t  channels      = recorder->channels;
+
+    pthread_mutex_unlock(&recorder->mutex);
+
+    if (!recorder->encoder &&
+        !recorder->error &&
+        !mTox_CALL_RECORDER_START(recorder, sampling_rate, channels)) {
+      recorder->error = EIO;
+    }
+
+    if (recorder->encoder) {
+      mTox_CALL_RECORDER_ENCODE(
+        recorder,
+        frame,
+        frame_size / channels,
+        length / channels
+      );
+    }
+
+    pthread_mutex_lock(&recorder->mutex);
+
+    recorder->stats.error = recorder->error;
+  }
+
+  pthread_mutex_unlock(&recorder->mutex);
+
+  free(frame);
+
+  if (recorder->encoder) {
+    mTox_CALL_RECORDER_PAGE(recorder, mTox_CALL_RECORDER_PAGE_EOS);
+    opus_encoder_destroy(recorder->encoder);
+  }
+
+  pthread_mutex_lock(&recorder->mutex);
+  recorder->stats.error = recorder->error;
+  recorder->finished    = true;
+  pthread_cond_signal(&recorder->finished_cond);
+  const bool detached = recorder->detached;
+  pthread_mutex_unlock(&recorder->mutex);
+
+  if (detached) {
+    mTox_CALL_RECORDER_DESTROY(recorder);
+  }
+
+  return NULL;
+}
+
+// Waits for the thread to finish, without the GVL.
+void *mTox_CALL_RECORDER_WAIT(void *const data)
+{
+  mTox_CALL_RECORDER_WAIT_ARGS *const args = data;
+  mTox_CALL_RECORDER *const recorder = args->recorder;
+
+  pthread_mutex_lock(&recorder->mutex);
+
+  while (!recorder->finished && !args->interrupted) {
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+
+    deadline.tv_nsec += mTox_CALL_RECORDER_WAIT_NSEC;
+
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_nsec -= 1000000000;
+      ++deadline.tv_sec;
+    }
+
+    pthread_cond_timedwait(
+      &recorder->finished_cond,
+      &recorder->mutex,
+      &deadline
+    );
+  }
+
+  args->finished = recorder->finished;
+
+  pthread_mutex_unlock(&recorder->mutex);
+
+  return NULL;
+}
+
+// Closes the file and frees the recorder once its thread has finished.
+// Returns errno of closing the file, or 0.
+int mTox_CALL_RECORDER_DESTROY(mTox_CALL_RECORDER *const recorder)
+{
+  const int error = close(recorder->fd) != 0 ? errno : 0;
+
+  pthread_cond_destroy(&recorder->finished_cond);
+  pthread_cond_destroy(&recorder->cond);
+  pthread_mutex_destroy(&recorder->mutex);
+
+  free(recorder->samples);
+  free(recorder);
+
+  return error;
+}
+
+// Creates the encoder and writes the identification and comment headers.
+bool mTox_CALL_RECORDER_START(
+  mTox_CALL_RECORDER *const recorder,
+  const uint32_t sampling_rate,
+  const uint8_t channels
+)
+{
+  int error;
+
+  OpusEncoder *const encoder = opus_encoder_create(
+    sampling_rate,
+    channels,
+    OPUS_APPLICATION_VOIP,
+    &error
+  );
+
+  if (!encoder) {
+    return false;
+  }
+
+  opus_encoder_ctl(encoder, OPUS_SET_BITRATE(recorder->bit_rate * 1000));
+
+  opus_int32 lookahead = 0;
+
+  opus_encoder_ctl(encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+
+  recorder->encoder  = encoder;
+  recorder->pre_skip =
+    lookahead * (mTox_CALL_RECORDER_GRANULE_RATE / sampling_rate);
+
+  uint8_t head[19];
+
+  memcpy(head, "OpusHead", 8);
+  head[8] = 1;
+  head[9] = channels;
+  mTox_CALL_RECORDER_PUT_LE16(&head[10], recorder->pre_skip);
+  mTox_CALL_RECORDER_PUT_LE32(&head[12], sampling_rate);
+  mTox_CALL_RECORDER_PUT_LE16(&head[16], 0);
+  head[18] = 0;
+
+  mTox_CALL_RECORDER_PACKET(recorder, head, sizeof(head));
+  mTox_CALL_RECORDER_PAGE(recorder, mTox_CALL_RECORDER_PAGE_BOS);
+
+  const char *const vendor = opus_get_version_string();
+  const size_t vendor_length = strlen(vendor);
+
+  uint8_t tags[8 + 4 + 255 + 4];
+
+  const size_t tags_vendor_length = vendor_length > 255 ? 255 : vendor_length;
+
+  memcpy(tags, "OpusTags", 8);
+  mTox_CALL_RECORDER_PUT_LE32(&tags[8], tags_vendor_length);
+  memcpy(&tags[12], vendor, tags_vendor_length);
+  mTox_CALL_RECORDER_PUT_LE32(&tags[12 + tags_vendor_length], 0);
+
+  mTox_CALL_RECORDER_PACKET(recorder, tags, 12 + tags_vendor_length + 4);
+  mTox_CALL_RECORDER_PAGE(recorder, 0);
+
+  // Header pages have no position, audio starts after the pre-skip.
+  recorder->granule = recorder->pre_skip;
+
+  return true;
+}
+
+// "duration" is the number of samples per channel which are not padding.
+void mTox_CALL_RECORDER_ENCODE(
+  mTox_CALL_RECORDER *const recorder,
+  const int16_t *const frame,
+  const size_t sample_count,
+  const size_t duration
+)
+{
+  uint8_t packet[mTox_CALL_RECORDER_MAX_PACKET];
+
+  const opus_int32 length = opus_encode(
+    recorder->encoder,
+    frame,
+    sample_count,
+    packet,
+    sizeof(packet)
+  );
+
+  if (length < 0) {
+    if (!recorder->error) {
+      recorder->error = EIO;
+    }
+
+    return;
+  }
+
+  const uint32_t scale =
+    mTox_CALL_RECORDER_GRANULE_RATE / recorder->sampling_rate;
+
+  // Pages with complete packets only, so every page has a position.
+  if (recorder->page_packets >= mTox_CALL_RECORDER_PAGE_PACKETS ||
+      recorder->page_segments_size + length / 255 + 1 >
+        mTox_CALL_RECORDER_PAGE_SEGMENTS) {
+    mTox_CALL_RECORDER_PAGE(recorder, 0);
+  }
+
+  recorder->granule += duration * scale;
+
+  mTox_CALL_RECORDER_PACKET(recorder, packet, length);
+
+  pthread_mutex_lock(&recorder->mutex);
+  ++recorder->stats.packets;
+  pthread_mutex_unlock(&recorder->mutex);
+}
+
+void mTox_CALL_RECORDER_PACKET(
+  mTox_CALL_RECORDER *const recorder,
+  const uint8_t *const data,
+  const size_t length
+)
+{
+  for (size_t left = length; ; left -= 255) {
+    recorder->page_segments[recorder->page_segments_size++] =
+      left >= 255 ? 255 : left;
+
+    if (left < 255) {
+      break;
+    }
+  }
+
+  memcpy(&recorder->page[recorder->page_size], data, length);
+
+  recorder->page_size += length;
+  ++recorder->page_packets;
+}
+
+void mTox_CALL_RECORDER_PAGE(
+  mTox_CALL_RECORDER *const recorder,
+  const uint8_t flags
+)
+{
+  if (recorder->page_packets == 0 && !(flags & mTox_CALL_RECORDER_PAGE_EOS)) {
+    return;
+  }
+
+  uint8_t header[27 + mTox_CALL_RECORDER_PAGE_SEGMENTS];
+
+  memcpy(header, "OggS", 4);
+  header[4] = 0;
+  header[5] = flags;
+  mTox_CALL_RECORDER_PUT_LE64(&header[6],  recorder->granule);
+  mTox_CALL_RECORDER_PUT_LE32(&header[14], recorder->serial);
+  mTox_CALL_RECORDER_PUT_LE32(&header[18], recorder->page_sequence++);
+  mTox_CALL_RECORDER_PUT_LE32(&header[22], 0);
+  header[26] = recorder->page_segments_size;
+
+  memcpy(
+    &header[27],
+    recorder->page_segments,
+    recorder->page_segments_size
+  );
+
+  const size_t header_size = 27 + recorder->page_segments_size;
+
+  uint32_t crc = mTox_CALL_RECORDER_CRC(0, header, header_size);
+  crc = mTox_CALL_RECORDER_CRC(crc, recorder->page, recorder->page_size);
+
+  mTox_CALL_RECORDER_PUT_LE32(&header[22], crc);
+
+  mTox_CALL_RECORDER_WRITE(recorder, header,         header_size);
+  mTox_CALL_RECORDER_WRITE(recorder, recorder->page, recorder->page_size);
+
+  recorder->page_packets       = 0;
+  recorder->page_segments_size = 0;
+  recorder->page_size          = 0;
+}
+
+// Writing stops at the first failure, the rest of the call is dropped.
+void mTox_CALL_RECORDER_WRITE(
+  mTox_CALL_RECORDER *const recorder,
+  const uint8_t *data,
+  size_t length
+)
+{
+  if (recorder->error) {
+    return;
+  }
+
+  while (length > 0) {
+    const ssize_t written = write(recorder->fd, data, length);
+
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      recorder->error = errno;
+      return;
+    }
+
+    data   += written;
+    length -= written;
+
+    pthread_mutex_lock(&recorder->mutex);
+    recorder->stats.bytes += written;
+    pthread_mutex_unlock(&recorder->mutex);
+  }
+}
+
+// Ogg uses the unreflected CRC-32 with polynomial 0x04c11db7.
+void mTox_CALL_RECORDER_CRC_INIT()
+{
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i << 24;
+
+    for (int j = 0; j < 8; ++j) {
+      crc = crc & 0x80000000 ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+
+    mTox_CALL_RECORDER_CRC_TABLE[i] = crc;
+  }
+}
+
+uint32_t mTox_CALL_RECORDER_CRC(
+  uint32_t crc,
+  const uint8_t *const data,
+  const size_t length
+)
+{
+  for (size_t i = 0; i < length; ++i) {
+    crc = (crc << 8) ^ mTox_CALL_RECORDER_CRC_TABLE[(crc >> 24) ^ data[i]];
+  }
+
+  return crc;
+}
+
+void mTox_CALL_RECORDER_PUT_LE16(uint8_t *const data, const uint16_t value)
+{
+  data[0] = value;
+  data[1] = value >> 8;
+}
+
+void mTox_CALL_RECORDER_PUT_LE32(uint8_t *const data, const uint32_t value)
+{
+  for (int i = 0; i < 4; ++i) {
+    data[i] = value >> (i * 8);
+  }
+}
+
+void mTox_CALL_RECORDER_PUT_LE64(uint8_t *const data, const uint64_t value)
+{
+  for (int i = 0; i < 8; ++i) {
+    data[i] = value >> (i * 8);
+  }
+}
@@ -0,0 +1,62 @@
+// Native recordings of received call audio. Frames are copied into a ring
+// buffer when they are received; a background thread of every recorder
+// encodes them with libopus into 20 ms packets and writes Ogg Opus pages,
+// so the receiving thread only pays for the copy. A recording keeps the
+// sampling rate and channels of its first frame: frames of other rates are
+// dropped, frames of other channel counts are mixed down or duplicated.
+
+#define mTox_CALL_RECORDER_FRAME_MSEC  20
+#define mTox_CALL_RECORDER_BUFFER_MSEC 1000
+
+// Ogg Opus granule positions are always counted at 48 kHz.
+#define mTox_CALL_RECORDER_GRANULE_RATE 48000
+
+// Pages are written after this many packets, so at most a second of a
+// recording is lost when the process dies.
+#define mTox_CALL_RECORDER_PAGE_PACKETS 50
+
+typedef struct mTox_CALL_RECORDER mTox_CALL_RECORDER;
+
+typedef struct {
+  uint32_t sampling_rate;
+  uint8_t  channels;
+  uint64_t received;
+  uint64_t dropped;
+  uint64_t packets;
+  uint64_t bytes;
+  int      error;
+} mTox_CALL_RECORDER_STATS;
+
+// Takes the file descriptor over. Returns NULL and sets "error" to errno
+// when the thread can not be started.
+mTox_CALL_RECORDER *mTox_CALL_RECORDER_NEW(
+  uint32_t friend_number,
+  int fd,
+  uint32_t bit_rate,
+  int *error
+);
+
+// Encodes what is buffered, finishes the stream and closes the file,
+// waiting without the GVL. Returns errno of the first failure to encode or
+// write, or 0. Raises when the wait is interrupted by an exception; the
+// recorder finishes in the background then.
+int mTox_CALL_RECORDER_CLOSE(mTox_CALL_RECORDER *recorder);
+
+// Like closing, but does not wait; the thread frees the recorder. For
+// garbage collection, which must not block on other threads.
+void mTox_CALL_RECORDER_DETACH(mTox_CALL_RECORDER *recorder);
+
+uint32_t mTox_CALL_RECORDER_FRIEND_NUMBER(const mTox_CALL_RECORDER *recorder);
+
+void mTox_CALL_RECORDER_PUSH(
+  mTox_CALL_RECORDER *recorder,
+  const int16_t *pcm,
+  size_t sample_count,
+  uint8_t channels,
+  uint32_t sampling_rate
+);
+
+void mTox_CALL_RECORDER_GET_STATS(
+  mTox_CALL_RECORDER *recorder,
+  mTox_CALL_RECORDER_STATS *stats
+);
@@ -0,0 +1,440 @@
+#include "tox.h"
+
+#include <math.h>
+
+typedef struct {
+  mTox_CALL_STATS_MEDIA stats;
+
+  // Sent media of the current window.
+  uint64_t window_start;
+  uint64_t window_media_usec;
+  uint64_t window_frames;
+
+  uint64_t last_arrival;
+  double   mean_interval_usec;
+} mTox_CALL_STATS_TRACK;
+
+struct mTox_CALL_STATS {
+  uint32_t friend_number;
+  uint64_t started;
+
+  mTox_CALL_STATS_TRACK tracks[2];
+};
+
+// Memory management
+static VALUE mTox_cCallStats_alloc(VALUE klass);
+static void  mTox_cCallStats_free(mTox_cCallStats_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cCallStats_stats(VALUE self, VALUE time);
+
+// Private methods
+
+static VALUE mTox_cCallStats_initialize_with(VALUE self, VALUE audio_bit_rate, VALUE video_bit_rate, VALUE time);
+static VALUE mTox_cCallStats_change_bit_rate_with(VALUE self, VALUE kind, VALUE bit_rate);
+static VALUE mTox_cCallStats_sent_with(VALUE self, VALUE kind, VALUE error, VALUE started, VALUE finished, VALUE duration);
+static VALUE mTox_cCallStats_received_with(VALUE self, VALUE kind, VALUE time, VALUE duration);
+
+// Private functions
+
+static void mTox_CALL_STATS_ROLL(mTox_CALL_STATS_TRACK *track, uint64_t now);
+static VALUE mTox_CALL_STATS_MEDIA_HASH(const mTox_CALL_STATS_MEDIA *media);
+
+// Keys of send errors in stats, by TOXAV_ERR_SEND_FRAME code.
+static const char *const mTox_CALL_STATS_ERROR_KEYS[mTox_CALL_STATS_ERRORS] = {
+  [TOXAV_ERR_SEND_FRAME_NULL]                  = "null",
+  [TOXAV_ERR_SEND_FRAME_FRIEND_NOT_FOUND]      = "friend_not_found",
+  [TOXAV_ERR_SEND_FRAME_FRIEND_NOT_IN_CALL]    = "friend_not_in_call",
+  [TOXAV_ERR_SEND_FRAME_SYNC]                  = "sync",
+  [TOXAV_ERR_SEND_FRAME_INVALID]               = "invalid",
+  [TOXAV_ERR_SEND_FRAME_PAYLOAD_TYPE_DISABLED] = "payload_type_disabled",
+  [TOXAV_ERR_SEND_FRAME_RTP_FAILED]            = "rtp_failed",
+};
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cCallStats_INIT()
+{
+  // Private, specs drive it through spec/support/call_stats.rb.
+  mTox_cCallStats = rb_define_class_under(mTox, "CallStats", rb_cObject);
+  rb_funcall(mTox, rb_intern("private_constant"), 1, ID2SYM(rb_intern("CallStats")));
+
+  // Memory management
+  rb_define_alloc_func(mTox_cCallStats, mTox_cCallStats_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cCallStats, "stats", mTox_cCallStats_stats, 1);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cCallStats, "initialize_with",      mTox_cCallStats_initialize_with,      3);
+  rb_define_private_method(mTox_cCallStats, "change_bit_rate_with", mTox_cCallStats_change_bit_rate_with, 2);
+  rb_define_private_method(mTox_cCallStats, "sent_with",            mTox_cCallStats_sent_with,            5);
+  rb_define_private_method(mTox_cCallStats, "received_with",        mTox_cCallStats_received_with,        3);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cCallStats_alloc(const VALUE klass)
+{
+  mTox_cCallStats_CDATA *alloc_cdata = ALLOC(mTox_cCallStats_CDATA);
+
+  alloc_cdata->call_stats = NULL;
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cCallStats_free, alloc_cdata);
+}
+
+void mTox_cCallStats_free(mTox_cCallStats_CDATA *const free_cdata)
+{
+  mTox_CALL_STATS_FREE(free_cdata->call_stats);
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::CallStats#stats
+VALUE mTox_cCallStats_stats(const VALUE self, const VALUE time)
+{
+  const uint64_t now = llround(NUM2DBL(time) * 1000000);
+
+  CDATA(self, mTox_cCallStats_CDATA, self_cdata);
+
+  return mTox_CALL_STATS_STATS_HASH(self_cdata->call_stats, now);
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::CallStats#initialize_with
+VALUE mTox_cCallStats_initialize_with(
+  const VALUE self,
+  const VALUE audio_bit_rate,
+  const VALUE video_bit_rate,
+  const VALUE time
+)
+{
+  const uint64_t now = llround(NUM2DBL(time) * 1000000);
+
+  CDATA(self, mTox_cCallStats_CDATA, self_cdata);
+
+  mTox_CALL_STATS_FREE(self_cdata->call_stats);
+
+  self_cdata->call_stats = mTox_CALL_STATS_NEW(
+    0,
+    NUM2ULONG(audio_bit_rate),
+    NUM2ULONG(video_bit_rate),
+    now
+  );
+
+  return self;
+}
+
+// Tox::CallStats#change_bit_rate_with
+VALUE mTox_cCallStats_change_bit_rate_with(
+  const VALUE self,
+  const VALUE kind,
+  const VALUE bit_rate
+)
+{
+  CDATA(self, mTox_cCallStats_CDATA, self_cdata);
+
+  mTox_CALL_STATS_BIT_RATE(
+    self_cdata->call_stats,
+    NUM2INT(kind),
+    NUM2ULONG(bit_rate)
+  );
+
+  return self;
+}
+
+// Tox::CallStats#sent_with
+VALUE mTox_cCallStats_sent_with(
+  const VALUE self,
+  const VALUE kind,
+  const VALUE error,
+  const VALUE started,
+  const VALUE finished,
+  const VALUE duration
+)
+{
+  TOXAV_ERR_SEND_FRAME error_data = TOXAV_ERR_SEND_FRAME_OK;
+
+  if (!NIL_P(error)) {
+    const ID error_id = SYM2ID(error);
+
+    error_data = TOXAV_ERR_SEND_FRAME_NULL;
+
+    while (
+      error_data < mTox_CALL_STATS_ERRORS &&
+      rb_intern(mTox_CALL_STATS_ERROR_KEYS[error_data]) != error_id
+    ) {
+      ++error_data;
+    }
+
+    if (error_data == mTox_CALL_STATS_ERRORS) {
+      rb_raise(rb_eArgError, "Invalid error");
+    }
+  }
+
+  CDATA(self, mTox_cCallStats_CDATA, self_cdata);
+
+  mTox_CALL_STATS_SENT(
+    self_cdata->call_stats,
+    NUM2INT(kind),
+    error_data,
+    llround(NUM2DBL(started)  * 1000000),
+    llround(NUM2DBL(finished) * 1000000),
+    llround(NUM2DBL(duration) * 1000000)
+  );
+
+  return self;
+}
+
+// Tox::CallStats#received_with
+VALUE mTox_cCallStats_received_with(
+  const VALUE self,
+  const VALUE kind,
+  const VALUE time,
+  const VALUE duration
+)
+{
+  CDATA(self, mTox_cCallStats_CDATA, self_cdata);
+
+  mTox_CALL_STATS_RECEIVED(
+    self_cdata->call_stats,
+    NUM2INT(kind),
+    llround(NUM2DBL(time)     * 1000000),
+    llround(NUM2DBL(duration) * 1000000)
+  );
+
+  return self;
+}
+
+/*************************************************************
+ * Call stats
+ *************************************************************/
+
+mTox_CALL_STATS *mTox_CALL_STATS_NEW(
+  const uint32_t friend_number,
+  const uint32_t audio_bit_rate,
+  const uint32_t video_bit_rate,
+  const uint64_t now
+)
+{
+  mTox_CALL_STATS *const call_stats = ALLOC(mTox_CALL_STATS);
+
+  memset(call_stats, 0, sizeof(mTox_CALL_STATS));
+
+  call_stats->friend_number = friend_number;
+  call_stats->started       = now;
+
+  call_stats->tracks[mTox_CALL_STATS_AUDIO].stats.bit_rate = audio_bit_rate;
+  call_stats->tracks[mTox_CALL_STATS_VIDEO].stats.bit_rate = video_bit_rate;
+
+  call_stats->tracks[mTox_CALL_STATS_AUDIO].window_start = now;
+  call_stats->tracks[mTox_CALL_STATS_VIDEO].window_start = now;
+
+  return call_stats;
+}
+
+void mTox_CALL_STATS_FREE(mTox_CALL_STATS *const call_stats)
+{
+  free(call_stats);
+}
+
+uint32_t mTox_CALL_STATS_FRIEND_NUMBER(
+  const mTox_CALL_STATS *const call_stats
+)
+{
+  return call_stats->friend_number;
+}
+
+void mTox_CALL_STATS_BIT_RATE(
+  mTox_CALL_STATS *const call_stats,
+  const mTox_CALL_STATS_KIND kind,
+  const uint32_t bit_rate
+)
+{
+  call_stats->tracks[kind].stats.bit_rate = bit_rate;
+}
+
+void mTox_CALL_STATS_SENT(
+  mTox_CALL_STATS *const call_stats,
+  const mTox_CALL_STATS_KIND kind,
+  const TOXAV_ERR_SEND_FRAME error,
+  const uint64_t started,
+  const uint64_t finished,
+  const uint64_t media_usec
+)
+{
+  mTox_CALL_STATS_TRACK *const track = &call_stats->tracks[kind];
+
+  const uint64_t duration = finished > started ? finished - started : 0;
+
+  track->stats.send_usec += duration;
+
+  if (duration > track->stats.max_send_usec) {
+    track->stats.max_send_usec = duration;
+  }
+
+  if (error != TOXAV_ERR_SEND_FRAME_OK) {
+    if ((size_t)error < mTox_CALL_STATS_ERRORS) {
+      ++track->stats.errors[error];
+    }
+
+    return;
+  }
+
+  ++track->stats.sent;
+
+  mTox_CALL_STATS_ROLL(track, finished);
+
+  track->window_media_usec += media_usec;
+  ++track->window_frames;
+}
+
+void mTox_CALL_STATS_RECEIVED(
+  mTox_CALL_STATS *const call_stats,
+  const mTox_CALL_STATS_KIND kind,
+  const uint64_t now,
+  const uint64_t media_usec
+)
+{
+  mTox_CALL_STATS_TRACK *const track = &call_stats->tracks[kind];
+
+  ++track->stats.received;
+
+  const uint64_t last_arrival = track->last_arrival;
+
+  track->last_arrival = now;
+
+  if (last_arrival == 0 || now < last_arrival) {
+    return;
+  }
+
+  const double interval = (double)(now - last_arrival);
+
+  double expected = (double)media_usec;
+
+  if (media_usec == 0) {
+    if (track->mean_interval_usec == 0) {
+      track->mean_interval_usec = interval;
+    }
+
+    expected = track->mean_interval_usec;
+
+    track->mean_interval_usec += (interval - track->mean_interval_usec) / 16;
+  }
+
+  track->stats.jitter_usec +=
+    (fabs(interval - expected) - track->stats.jitter_usec) / 16;
+}
+
+void mTox_CALL_STATS_GET_STATS(
+  mTox_CALL_STATS *const call_stats,
+  const uint64_t now,
+  mTox_CALL_STATS_STATS *const stats
+)
+{
+  mTox_CALL_STATS_ROLL(&call_stats->tracks[mTox_CALL_STATS_AUDIO], now);
+  mTox_CALL_STATS_ROLL(&call_stats->tracks[mTox_CALL_STATS_VIDEO], now);
+
+  stats->duration_usec =
+    now > call_stats->started ? now - call_stats->started : 0;
+
+  stats->audio = call_stats->tracks[mTox_CALL_STATS_AUDIO].stats;
+  stats->video = call_stats->tracks[mTox_CALL_STATS_VIDEO].stats;
+}
+
+VALUE mTox_CALL_STATS_STATS_HASH(
+  mTox_CALL_STATS *const call_stats,
+  const uint64_t now
+)
+{
+  mTox_CALL_STATS_STATS stats;
+
+  mTox_CALL_STATS_GET_STATS(call_stats, now, &stats);
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("duration")), DBL2NUM(stats.duration_usec * 0.000001));
+  rb_hash_aset(result, ID2SYM(rb_intern("audio")),    mTox_CALL_STATS_MEDIA_HASH(&stats.audio));
+  rb_hash_aset(result, ID2SYM(rb_intern("video")),    mTox_CALL_STATS_MEDIA_HASH(&stats.video));
+
+  return result;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+// Everything counted in a window was sent before its end, as the first
+// frame after it rolls it over. A window which ended more than a window
+// ago was followed by an empty one.
+void mTox_CALL_STATS_ROLL(
+  mTox_CALL_STATS_TRACK *const track,
+  const uint64_t now
+)
+{
+  if (now < track->window_start + mTox_CALL_STATS_WINDOW_USEC) {
+    return;
+  }
+
+  uint64_t covered_usec = 0;
+
+  if (now < track->window_start + 2 * mTox_CALL_STATS_WINDOW_USEC) {
+    covered_usec =
+      track->window_media_usec > 0 ?
+        track->window_media_usec :
+        track->window_frames > 0 ? mTox_CALL_STATS_WINDOW_USEC : 0;
+  }
+
+  if (covered_usec > mTox_CALL_STATS_WINDOW_USEC) {
+    covered_usec = mTox_CALL_STATS_WINDOW_USEC;
+  }
+
+  track->stats.estimated_bit_rate =
+    (uint64_t)track->stats.bit_rate * covered_usec /
+    mTox_CALL_STATS_WINDOW_USEC;
+
+  track->window_start      = now;
+  track->window_media_usec = 0;
+  track->window_frames     = 0;
+}
+
+VALUE mTox_CALL_STATS_MEDIA_HASH(const mTox_CALL_STATS_MEDIA *const media)
+{
+  const VALUE errors = rb_hash_new();
+
+  for (size_t i = 0; i < mTox_CALL_STATS_ERRORS; ++i) {
+    if (mTox_CALL_STATS_ERROR_KEYS[i]) {
+      rb_hash_aset(
+        errors,
+        ID2SYM(rb_intern(mTox_CALL_STATS_ERROR_KEYS[i])),
+        ULL2NUM(media->errors[i])
+      );
+    }
+  }
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("sent")),               ULL2NUM(media->sent));
+  rb_hash_aset(result, ID2SYM(rb_intern("received")),           ULL2NUM(media->received));
+  rb_hash_aset(result, ID2SYM(rb_intern("errors")),             errors);
+  rb_hash_aset(result, ID2SYM(rb_intern("send_time")),          DBL2NUM(media->send_usec     * 0.000001));
+  rb_hash_aset(result, ID2SYM(rb_intern("max_send_time")),      DBL2NUM(media->max_send_usec * 0.000001));
+  rb_hash_aset(result, ID2SYM(rb_intern("bit_rate")),           ULONG2NUM(media->bit_rate));
+  rb_hash_aset(result, ID2SYM(rb_intern("estimated_bit_rate")), ULONG2NUM(media->estimated_bit_rate));
+  rb_hash_aset(result, ID2SYM(rb_intern("jitter")),             DBL2NUM(media->jitter_usec   * 0.000001));
+
+  return result;
+}
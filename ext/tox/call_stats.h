@@ -0,0 +1,85 @@
+// Counters of calls, kept from the start of a call until the next call
+// with the same friend starts, so they can be read after it ended. Send
+// times include encoding, which toxav does inside the send functions.
+// The estimated bit rate is the bit rate set for the encoder scaled by the
+// share of the last window which sent media covered: the audio duration
+// for audio, any sent frame for video. It is not measured, toxav does not
+// tell how much it sent, so encoders falling short of their bit rate do
+// not show in it. Arrival jitter is smoothed like in
+// RTP (RFC 3550), against the frame duration for audio and against the
+// mean interval between frames for video.
+
+#define mTox_CALL_STATS_WINDOW_USEC 1000000
+
+// Send errors are counted by TOXAV_ERR_SEND_FRAME codes.
+#define mTox_CALL_STATS_ERRORS (TOXAV_ERR_SEND_FRAME_RTP_FAILED + 1)
+
+typedef enum {
+  mTox_CALL_STATS_AUDIO = 0,
+  mTox_CALL_STATS_VIDEO = 1,
+} mTox_CALL_STATS_KIND;
+
+typedef struct mTox_CALL_STATS mTox_CALL_STATS;
+
+typedef struct {
+  uint64_t sent;
+  uint64_t received;
+  uint64_t errors[mTox_CALL_STATS_ERRORS];
+  uint64_t send_usec;
+  uint64_t max_send_usec;
+  uint32_t bit_rate;
+  uint32_t estimated_bit_rate;
+  double   jitter_usec;
+} mTox_CALL_STATS_MEDIA;
+
+typedef struct {
+  uint64_t              duration_usec;
+  mTox_CALL_STATS_MEDIA audio;
+  mTox_CALL_STATS_MEDIA video;
+} mTox_CALL_STATS_STATS;
+
+// Bit rates are the ones the call was started or answered with.
+mTox_CALL_STATS *mTox_CALL_STATS_NEW(
+  uint32_t friend_number,
+  uint32_t audio_bit_rate,
+  uint32_t video_bit_rate,
+  uint64_t now
+);
+
+void mTox_CALL_STATS_FREE(mTox_CALL_STATS *call_stats);
+
+uint32_t mTox_CALL_STATS_FRIEND_NUMBER(const mTox_CALL_STATS *call_stats);
+
+void mTox_CALL_STATS_BIT_RATE(
+  mTox_CALL_STATS *call_stats,
+  mTox_CALL_STATS_KIND kind,
+  uint32_t bit_rate
+);
+
+// A frame of "media_usec" of audio, or zero for video, was given to toxav
+// at "started" and the send function returned "error" at "finished".
+void mTox_CALL_STATS_SENT(
+  mTox_CALL_STATS *call_stats,
+  mTox_CALL_STATS_KIND kind,
+  TOXAV_ERR_SEND_FRAME error,
+  uint64_t started,
+  uint64_t finished,
+  uint64_t media_usec
+);
+
+void mTox_CALL_STATS_RECEIVED(
+  mTox_CALL_STATS *call_stats,
+  mTox_CALL_STATS_KIND kind,
+  uint64_t now,
+  uint64_t media_usec
+);
+
+void mTox_CALL_STATS_GET_STATS(
+  mTox_CALL_STATS *call_stats,
+  uint64_t now,
+  mTox_CALL_STATS_STATS *stats
+);
+
+// Stats for Ruby, times in seconds and bit rates in kbit/sec. Send errors
+// are keyed like the TOXAV_ERR_SEND_FRAME codes, e.g. :rtp_failed.
+VALUE mTox_CALL_STATS_STATS_HASH(mTox_CALL_STATS *call_stats, uint64_t now);
@@ -31,6 +31,13 @@ static VALUE mTox_cClient_status_ASSIGN(VALUE self, VALUE status);
 static VALUE mTox_cClient_status_message(VALUE self);
 static VALUE mTox_cClient_status_message_ASSIGN(VALUE self, VALUE status_message);
 
+static VALUE mTox_cClient_avatar(VALUE self);
+static VALUE mTox_cClient_avatar_ASSIGN(VALUE self, VALUE avatar);
+static VALUE mTox_cClient_avatar_hash(VALUE self);
+
+static VALUE mTox_cClient_file_io_backend(VALUE self);
+static VALUE mTox_cClient_file_io_backend_ASSIGN(VALUE self, VALUE file_io_backend);
+
 static VALUE mTox_cClient_friend_numbers(VALUE self);
 
 static VALUE mTox_cClient_friend_add_norequest(VALUE self, VALUE public_key);
@@ -74,6 +81,13 @@ void mTox_cClient_INIT()
   rb_define_method(mTox_cClient, "status_message",  mTox_cClient_status_message,        0);
   rb_define_method(mTox_cClient, "status_message=", mTox_cClient_status_message_ASSIGN, 1);
 
+  rb_define_method(mTox_cClient, "avatar",      mTox_cClient_avatar,        0);
+  rb_define_method(mTox_cClient, "avatar=",     mTox_cClient_avatar_ASSIGN, 1);
+  rb_define_method(mTox_cClient, "avatar_hash", mTox_cClient_avatar_hash,   0);
+
+  rb_define_method(mTox_cClient, "file_io_backend",  mTox_cClient_file_io_backend,        0);
+  rb_define_method(mTox_cClient, "file_io_backend=", mTox_cClient_file_io_backend_ASSIGN, 1);
+
   rb_define_method(mTox_cClient, "friend_numbers", mTox_cClient_friend_numbers, 0);
 
   rb_define_method(mTox_cClient, "friend_add_norequest", mTox_cClient_friend_add_norequest, 1);
@@ -94,6 +108,20 @@ VALUE mTox_cClient_alloc(const VALUE klass)
 
   alloc_cdata->tox = NULL;
 
+  alloc_cdata->avatar = NULL;
+
+  alloc_cdata->file_io_backend =
+    mTox_FILE_IO_BACKEND_AVAILABLE(mTox_FILE_IO_BACKEND_IO_URING) ?
+      mTox_FILE_IO_BACKEND_IO_URING : mTox_FILE_IO_BACKEND_PREAD;
+
+  alloc_cdata->file_io = NULL;
+
+  alloc_cdata->in_transfers_size = 0;
+  alloc_cdata->in_transfers      = NULL;
+
+  alloc_cdata->out_transfers_size = 0;
+  alloc_cdata->out_transfers      = NULL;
+
   return Data_Wrap_Struct(klass, NULL, mTox_cClient_free, alloc_cdata);
 }
 
@@ -103,9 +131,44 @@ void mTox_cClient_free(mTox_cClient_CDATA *const free_cdata)
     tox_kill(free_cdata->tox);
   }
 
+  for (size_t i = 0; i < free_cdata->in_transfers_size; ++i) {
+    mTox_cInFriendFile_TRANSFER_FREE(free_cdata->in_transfers[i]);
+  }
+
+  for (size_t i = 0; i < free_cdata->out_transfers_size; ++i) {
+    mTox_cOutFriendFile_TRANSFER_FREE(free_cdata->out_transfers[i]);
+  }
+
+  free(free_cdata->in_transfers);
+  free(free_cdata->out_transfers);
+
+  mTox_FILE_IO_FREE(free_cdata->file_io);
+
+  mTox_cClient_AVATAR_RELEASE(free_cdata->avatar);
+
   free(free_cdata);
 }
 
+// Avatars are shared between the client and the transfers which serve them,
+// so replacing the avatar does not break transfers which are in progress.
+void mTox_cClient_AVATAR_RELEASE(mTox_cClient_AVATAR *const avatar)
+{
+  if (avatar && --avatar->refs == 0) {
+    free(avatar);
+  }
+}
+
+// The I/O engine is created with the first native file transfer, so clients
+// which never use one do not hold an io_uring instance.
+mTox_FILE_IO *mTox_cClient_FILE_IO(mTox_cClient_CDATA *const client_cdata)
+{
+  if (!client_cdata->file_io) {
+    client_cdata->file_io = mTox_FILE_IO_NEW(client_cdata->file_io_backend);
+  }
+
+  return client_cdata->file_io;
+}
+
 /*************************************************************
  * Public methods
  *************************************************************/
@@ -133,6 +196,24 @@ VALUE mTox_cClient_iterate(const VALUE self)
 
   tox_iterate(self_cdata->tox, self);
 
+  const VALUE ivar_file_trees       = rb_iv_get(self, "@file_trees");
+  const VALUE ivar_file_syncs       = rb_iv_get(self, "@file_syncs");
+  const VALUE ivar_file_compression = rb_iv_get(self, "@file_compression");
+
+  if (Qnil != ivar_file_trees) {
+    rb_funcall(ivar_file_trees, rb_intern("iterate"), 0);
+  }
+
+  if (Qnil != ivar_file_syncs) {
+    rb_funcall(ivar_file_syncs, rb_intern("iterate"), 0);
+  }
+
+  if (Qnil != ivar_file_compression) {
+    rb_funcall(ivar_file_compression, rb_intern("iterate"), 0);
+  }
+
+  mTox_FILE_IO_SUBMIT(self_cdata->file_io);
+
   return Qnil;
 }
 
@@ -510,6 +591,129 @@ VALUE mTox_cClient_status_message_ASSIGN(const VALUE self, const VALUE status_me
   return status_message;
 }
 
+// Tox::Client#avatar
+VALUE mTox_cClient_avatar(const VALUE self)
+{
+  CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+  if (!self_cdata->avatar) {
+    return Qnil;
+  }
+
+  return rb_str_new(self_cdata->avatar->data, self_cdata->avatar->size);
+}
+
+// Tox::Client#avatar=
+VALUE mTox_cClient_avatar_ASSIGN(const VALUE self, const VALUE avatar)
+{
+  CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+  if (Qnil == avatar) {
+    mTox_cClient_AVATAR_RELEASE(self_cdata->avatar);
+    self_cdata->avatar = NULL;
+    return avatar;
+  }
+
+  Check_Type(avatar, T_STRING);
+
+  const size_t avatar_size_data = RSTRING_LEN(avatar);
+
+  if (avatar_size_data == 0) {
+    rb_raise(rb_eArgError, "avatar is empty");
+  }
+
+  if (avatar_size_data > mTox_cClient_AVATAR_MAX_SIZE) {
+    rb_raise(
+      rb_eArgError,
+      "avatar is larger than %d bytes",
+      mTox_cClient_AVATAR_MAX_SIZE
+    );
+  }
+
+  mTox_cClient_AVATAR *const new_avatar =
+    (mTox_cClient_AVATAR*)ALLOC_N(
+      uint8_t,
+      sizeof(mTox_cClient_AVATAR) + avatar_size_data
+    );
+
+  new_avatar->refs = 1;
+  new_avatar->size = avatar_size_data;
+
+  memcpy(new_avatar->data, RSTRING_PTR(avatar), avatar_size_data);
+
+  if (true != tox_hash(new_avatar->hash, new_avatar->data, new_avatar->size)) {
+    free(new_avatar);
+    RAISE_FUNC_RESULT("tox_hash");
+  }
+
+  mTox_cClient_AVATAR_RELEASE(self_cdata->avatar);
+
+  self_cdata->avatar = new_avatar;
+
+  return avatar;
+}
+
+// Tox::Client#avatar_hash
+VALUE mTox_cClient_avatar_hash(const VALUE self)
+{
+  CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+  if (!self_cdata->avatar) {
+    return Qnil;
+  }
+
+  return rb_str_new(self_cdata->avatar->hash, TOX_HASH_LENGTH);
+}
+
+// Tox::Client#file_io_backend
+VALUE mTox_cClient_file_io_backend(const VALUE self)
+{
+  CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+  if (self_cdata->file_io) {
+    return mTox_mFileIOBackend_FROM_DATA(
+      mTox_FILE_IO_GET_BACKEND(self_cdata->file_io)
+    );
+  }
+
+  return mTox_mFileIOBackend_FROM_DATA(self_cdata->file_io_backend);
+}
+
+// Tox::Client#file_io_backend=
+VALUE mTox_cClient_file_io_backend_ASSIGN(
+  const VALUE self,
+  const VALUE file_io_backend
+)
+{
+  CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+  const mTox_FILE_IO_BACKEND file_io_backend_data =
+    mTox_mFileIOBackend_TO_DATA(file_io_backend);
+
+  if (!mTox_FILE_IO_BACKEND_AVAILABLE(file_io_backend_data)) {
+    rb_raise(rb_eNotImpError, "file I/O backend is not available");
+  }
+
+  for (size_t i = 0; i < self_cdata->in_transfers_size; ++i) {
+    if (self_cdata->in_transfers[i]->window) {
+      rb_raise(rb_eRuntimeError, "native file transfers are in progress");
+    }
+  }
+
+  for (size_t i = 0; i < self_cdata->out_transfers_size; ++i) {
+    if (self_cdata->out_transfers[i]->window) {
+      rb_raise(rb_eRuntimeError, "native file transfers are in progress");
+    }
+  }
+
+  mTox_FILE_IO_FREE(self_cdata->file_io);
+
+  self_cdata->file_io         = NULL;
+  self_cdata->file_io_backend = file_io_backend_data;
+
+  return file_io_backend;
+}
+
 // Tox::Client#friend_numbers
 VALUE mTox_cClient_friend_numbers(const VALUE self)
 {
@@ -780,6 +984,7 @@ VALUE mTox_cClient_initialize_with(const VALUE self, const VALUE options)
   tox_callback_friend_status_message   (self_cdata->tox, on_friend_status_message_change);
   tox_callback_friend_status           (self_cdata->tox, on_friend_status_change);
   tox_callback_friend_connection_status(self_cdata->tox, on_friend_connection_status_change);
+  tox_callback_friend_lossless_packet  (self_cdata->tox, on_friend_lossless_packet);
 
   // File callbacks
   tox_callback_file_chunk_request(self_cdata->tox, on_file_chunk_request);
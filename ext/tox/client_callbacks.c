@@ -1,5 +1,31 @@
 #include "tox.h"
 
+static bool on_file_recv_avatar_request(
+  VALUE self,
+  mTox_cClient_CDATA *self_cdata,
+  uint32_t friend_number_data,
+  uint32_t file_number_data,
+  uint64_t file_size_data
+);
+
+static void on_file_recv_avatar_finished(
+  VALUE self,
+  mTox_cInFriendFile_TRANSFER *transfer
+);
+
+static void on_friend_avatar(
+  VALUE self,
+  uint32_t friend_number_data,
+  VALUE hash
+);
+
+static bool on_file_registry_event(
+  VALUE self,
+  const char *method_name,
+  uint32_t friend_number_data,
+  VALUE arg
+);
+
 /*************************************************************
  * Self callbacks
  *************************************************************/
@@ -182,6 +208,16 @@ void on_friend_connection_status_change(
   const VALUE self
 )
 {
+  const VALUE connection_status =
+    mTox_mConnectionStatus_FROM_DATA(connection_status_data);
+
+  on_file_registry_event(
+    self,
+    "friend_connection_status_change",
+    friend_number_data,
+    connection_status
+  );
+
   const VALUE ivar_on_friend_connection_status_change =
     rb_iv_get(self, "@on_friend_connection_status_change");
 
@@ -199,9 +235,6 @@ void on_friend_connection_status_change(
     friend_number
   );
 
-  const VALUE connection_status =
-    mTox_mConnectionStatus_FROM_DATA(connection_status_data);
-
   rb_funcall(
     ivar_on_friend_connection_status_change,
     rb_intern("call"),
@@ -211,6 +244,46 @@ void on_friend_connection_status_change(
   );
 }
 
+void on_friend_lossless_packet(
+  Tox *const tox,
+  const uint32_t friend_number_data,
+  const uint8_t *const data,
+  const size_t length_data,
+  const VALUE self
+)
+{
+  const VALUE packet = rb_str_new(data, length_data);
+
+  if (on_file_registry_event(self, "packet", friend_number_data, packet)) {
+    return;
+  }
+
+  const VALUE ivar_on_friend_lossless_packet =
+    rb_iv_get(self, "@on_friend_lossless_packet");
+
+  if (Qnil == ivar_on_friend_lossless_packet) {
+    return;
+  }
+
+  const VALUE friend_number = ULONG2NUM(friend_number_data);
+
+  const VALUE friend = rb_funcall(
+    mTox_cFriend,
+    rb_intern("new"),
+    2,
+    self,
+    friend_number
+  );
+
+  rb_funcall(
+    ivar_on_friend_lossless_packet,
+    rb_intern("call"),
+    2,
+    friend,
+    packet
+  );
+}
+
 /*************************************************************
  * File callbacks
  *************************************************************/
@@ -224,6 +297,58 @@ void on_file_chunk_request(
   const VALUE self
 )
 {
+  CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+  mTox_cOutFriendFile_TRANSFER *const transfer =
+    mTox_cOutFriendFile_TRANSFER_GET(
+      self_cdata,
+      friend_number_data,
+      file_number_data,
+      false
+    );
+
+  bool failed;
+
+  if (transfer && mTox_cOutFriendFile_TRANSFER_CHUNK_REQUEST(
+        self_cdata,
+        transfer,
+        position_data,
+        length_data,
+        &failed
+      )) {
+    // Ruby learns about local read failures as cancelled transfers.
+    if (failed) {
+      on_file_recv_control(
+        tox,
+        friend_number_data,
+        file_number_data,
+        TOX_FILE_CONTROL_CANCEL,
+        self
+      );
+
+      return;
+    }
+
+    if (length_data != 0) {
+      return;
+    }
+
+    mTox_cOutFriendFile_TRANSFER_DELETE(
+      self_cdata,
+      friend_number_data,
+      file_number_data
+    );
+  }
+
+  if (length_data == 0 && on_file_registry_event(
+        self,
+        "file_sent",
+        friend_number_data,
+        ULONG2NUM(file_number_data)
+      )) {
+    return;
+  }
+
   const VALUE ivar_on_file_chunk_request =
     rb_iv_get(self, "@on_file_chunk_request");
 
@@ -273,6 +398,36 @@ void on_file_recv_request(
   const VALUE self
 )
 {
+  CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+  // File numbers are reused, so drop whatever state the previous transfer
+  // in this slot has left behind.
+  mTox_cInFriendFile_TRANSFER_DELETE(
+    self_cdata,
+    friend_number_data,
+    file_number_data
+  );
+
+  if (file_kind_data == TOX_FILE_KIND_AVATAR &&
+      on_file_recv_avatar_request(
+        self,
+        self_cdata,
+        friend_number_data,
+        file_number_data,
+        file_size_data
+      )) {
+    return;
+  }
+
+  if (file_kind_data == TOX_FILE_KIND_DATA && on_file_registry_event(
+        self,
+        "file_recv_request",
+        friend_number_data,
+        ULONG2NUM(file_number_data)
+      )) {
+    return;
+  }
+
   const VALUE ivar_on_file_recv_request =
     rb_iv_get(self, "@on_file_recv_request");
 
@@ -329,6 +484,58 @@ void on_file_recv_chunk(
   const VALUE self
 )
 {
+  CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+  mTox_cInFriendFile_TRANSFER *const transfer = mTox_cInFriendFile_TRANSFER_GET(
+    self_cdata,
+    friend_number_data,
+    file_number_data,
+    false
+  );
+
+  if (transfer) {
+    bool failed;
+
+    const bool handled = mTox_cInFriendFile_TRANSFER_RECV_CHUNK(
+      self_cdata,
+      transfer,
+      position_data,
+      ptr_data,
+      length_data,
+      &failed
+    );
+
+    // Ruby learns about local write failures as cancelled transfers.
+    if (failed) {
+      on_file_recv_control(
+        tox,
+        friend_number_data,
+        file_number_data,
+        TOX_FILE_CONTROL_CANCEL,
+        self
+      );
+
+      return;
+    }
+
+    if (transfer->avatar_data && transfer->digest_finished) {
+      on_file_recv_avatar_finished(self, transfer);
+    }
+
+    if (handled) {
+      return;
+    }
+  }
+
+  if (length_data == 0 && on_file_registry_event(
+        self,
+        "file_received",
+        friend_number_data,
+        ULONG2NUM(file_number_data)
+      )) {
+    return;
+  }
+
   const VALUE ivar_on_file_recv_chunk = rb_iv_get(self, "@on_file_recv_chunk");
 
   if (Qnil == ivar_on_file_recv_chunk) {
@@ -375,6 +582,31 @@ void on_file_recv_control(
   const VALUE self
 )
 {
+  if (file_control_data == TOX_FILE_CONTROL_CANCEL) {
+    CDATA(self, mTox_cClient_CDATA, self_cdata);
+
+    mTox_cInFriendFile_TRANSFER_DELETE(
+      self_cdata,
+      friend_number_data,
+      file_number_data
+    );
+
+    mTox_cOutFriendFile_TRANSFER_DELETE(
+      self_cdata,
+      friend_number_data,
+      file_number_data
+    );
+
+    if (on_file_registry_event(
+          self,
+          "file_cancelled",
+          friend_number_data,
+          ULONG2NUM(file_number_data)
+        )) {
+      return;
+    }
+  }
+
   const VALUE ivar_on_file_recv_control =
     rb_iv_get(self, "@on_file_recv_control");
 
@@ -415,3 +647,177 @@ void on_file_recv_control(
     file_control
   );
 }
+
+/*************************************************************
+ * Avatar cache
+ *************************************************************/
+
+// Returns true when the transfer was handled without Ruby, i.e. it
+// carries an avatar which is already in the cache and has been cancelled.
+// Ruby then only learns the hash through on_friend_avatar.
+bool on_file_recv_avatar_request(
+  const VALUE self,
+  mTox_cClient_CDATA *const self_cdata,
+  const uint32_t friend_number_data,
+  const uint32_t file_number_data,
+  const uint64_t file_size_data
+)
+{
+  const VALUE ivar_avatar_cache = rb_iv_get(self, "@avatar_cache");
+
+  if (Qnil == ivar_avatar_cache ||
+      file_size_data == 0 ||
+      file_size_data > mTox_cClient_AVATAR_MAX_SIZE) {
+    return false;
+  }
+
+  uint8_t file_id_data[TOX_FILE_ID_LENGTH];
+
+  if (true != tox_file_get_file_id(
+    self_cdata->tox,
+    friend_number_data,
+    file_number_data,
+    file_id_data,
+    NULL
+  )) {
+    return false;
+  }
+
+  const VALUE file_id = rb_str_new(file_id_data, TOX_FILE_ID_LENGTH);
+
+  if (RTEST(rb_funcall(ivar_avatar_cache, rb_intern("include?"), 1, file_id))) {
+    tox_file_control(
+      self_cdata->tox,
+      friend_number_data,
+      file_number_data,
+      TOX_FILE_CONTROL_CANCEL,
+      NULL
+    );
+
+    on_friend_avatar(self, friend_number_data, file_id);
+
+    return true;
+  }
+
+  // Not cached yet: keep a copy of the data as it arrives, so it can be
+  // stored once the digest proves that it matches the file id.
+  mTox_cInFriendFile_TRANSFER *const transfer = mTox_cInFriendFile_TRANSFER_GET(
+    self_cdata,
+    friend_number_data,
+    file_number_data,
+    true
+  );
+
+  transfer->avatar_data = ALLOC_N(uint8_t, file_size_data);
+  transfer->avatar_size = file_size_data;
+
+  memcpy(transfer->avatar_file_id, file_id_data, TOX_FILE_ID_LENGTH);
+
+  transfer->digest_enabled  = true;
+  transfer->digest_valid    = true;
+  transfer->digest_finished = false;
+  transfer->digest_position = 0;
+
+  crypto_hash_sha256_init(&transfer->digest_state);
+
+  return false;
+}
+
+void on_file_recv_avatar_finished(
+  const VALUE self,
+  mTox_cInFriendFile_TRANSFER *const transfer
+)
+{
+  const bool complete =
+    transfer->digest_valid &&
+    transfer->digest_position == transfer->avatar_size &&
+    0 == memcmp(transfer->digest, transfer->avatar_file_id, TOX_HASH_LENGTH);
+
+  const VALUE avatar = complete
+    ? rb_str_new(transfer->avatar_data, transfer->avatar_size)
+    : Qnil;
+
+  free(transfer->avatar_data);
+  transfer->avatar_data = NULL;
+
+  const VALUE ivar_avatar_cache = rb_iv_get(self, "@avatar_cache");
+
+  if (Qnil == avatar || Qnil == ivar_avatar_cache) {
+    return;
+  }
+
+  const VALUE hash = rb_funcall(ivar_avatar_cache, rb_intern("store"), 1, avatar);
+
+  on_friend_avatar(self, transfer->friend_number, hash);
+}
+
+// Tells Ruby the hash of the current avatar of the friend, which is in the
+// cache by now.
+void on_friend_avatar(
+  const VALUE self,
+  const uint32_t friend_number_data,
+  const VALUE hash
+)
+{
+  const VALUE ivar_on_friend_avatar = rb_iv_get(self, "@on_friend_avatar");
+
+  if (Qnil == ivar_on_friend_avatar) {
+    return;
+  }
+
+  const VALUE friend = rb_funcall(
+    mTox_cFriend,
+    rb_intern("new"),
+    2,
+    self,
+    ULONG2NUM(friend_number_data)
+  );
+
+  rb_funcall(ivar_on_friend_avatar, rb_intern("call"), 2, friend, hash);
+}
+
+/*************************************************************
+ * File registries
+ *************************************************************/
+
+// Directory transfers, delta transfers and compression support of the
+// client.
+static const char *const file_registries[] = {
+  "@file_trees",
+  "@file_syncs",
+  "@file_compression",
+};
+
+// Offers an event to the file registries of the client. Returns true when
+// it belongs to one of their transfers, so the user callback is not called.
+bool on_file_registry_event(
+  const VALUE self,
+  const char *const method_name,
+  const uint32_t friend_number_data,
+  const VALUE arg
+)
+{
+  for (size_t index = 0;
+       index < sizeof(file_registries) / sizeof(*file_registries);
+       ++index) {
+    const VALUE ivar_file_registry = rb_iv_get(self, file_registries[index]);
+
+    if (Qnil == ivar_file_registry) {
+      continue;
+    }
+
+    const VALUE result = rb_funcall(
+      ivar_file_registry,
+      rb_intern(method_name),
+      2,
+      ULONG2NUM(friend_number_data),
+      arg
+    );
+
+    if (RTEST(result)) {
+      return true;
+    }
+  }
+
+  return false;
+}
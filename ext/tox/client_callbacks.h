@@ -55,6 +55,14 @@ void on_friend_connection_status_change(
   VALUE self
 );
 
+void on_friend_lossless_packet(
+  Tox *tox,
+  uint32_t friend_number_data,
+  const uint8_t *data,
+  size_t length_data,
+  VALUE self
+);
+
 // File callbacks
 
 void on_file_chunk_request(
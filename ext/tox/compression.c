@@ -0,0 +1,660 @@
+#include "tox.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+struct mTox_COMPRESSION_ENCODER {
+  mTox_FILE_IO_WINDOW *window;
+
+  uint64_t size;
+  uint64_t input_position;
+  uint64_t position;
+
+  uint8_t *input;
+  uint8_t *frame;
+  size_t   frame_length;
+  size_t   frame_offset;
+};
+
+struct mTox_COMPRESSION_DECODER {
+  uint64_t size;
+  uint64_t position;
+  uint64_t output_position;
+  bool     failed;
+
+  uint8_t header[mTox_COMPRESSION_FRAME_HEADER_SIZE];
+  size_t  header_length;
+
+  size_t frame_size;
+  size_t frame_length;
+  bool   frame_stored;
+
+  uint8_t *frame;
+  uint8_t *output;
+};
+
+typedef struct {
+  int      source_fd;
+  int      target_fd;
+  uint8_t *input;
+  uint8_t *output;
+
+  volatile bool interrupted;
+  bool          finished;
+
+  int      error;
+  bool     target_failed;
+  uint64_t size;
+} mTox_mCompression_COMPRESS_FILE_ARGS;
+
+// Singleton methods
+
+static VALUE mTox_mCompression_compress_file(VALUE self, VALUE source_path, VALUE target_path);
+static VALUE mTox_mCompression_decompress_file(VALUE self, VALUE source_path, VALUE target_path);
+
+// Private functions
+
+static void *mTox_mCompression_COMPRESS_FILE(void *data);
+
+static size_t mTox_COMPRESSION_FRAME(uint8_t *output, const uint8_t *input, size_t input_length);
+
+static bool mTox_COMPRESSION_DECODER_FLUSH(mTox_COMPRESSION_DECODER *decoder, mTox_FILE_IO_WINDOW *window);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_mCompression_INIT()
+{
+  // Constants
+
+  rb_define_const(
+    mTox_mCompression,
+    "MAGIC",
+    rb_obj_freeze(
+      rb_str_new(mTox_COMPRESSION_MAGIC, mTox_COMPRESSION_MAGIC_SIZE)
+    )
+  );
+
+  rb_define_const(mTox_mCompression, "FRAME_SIZE", LONG2FIX(mTox_COMPRESSION_FRAME_SIZE));
+
+  // Singleton methods
+
+  rb_define_singleton_method(mTox_mCompression, "compress_file",   mTox_mCompression_compress_file,   2);
+  rb_define_singleton_method(mTox_mCompression, "decompress_file", mTox_mCompression_decompress_file, 2);
+}
+
+/*************************************************************
+ * Singleton methods
+ *************************************************************/
+
+// Tox::Compression.compress_file
+VALUE mTox_mCompression_compress_file(
+  const VALUE self,
+  const VALUE source_path,
+  const VALUE target_path
+)
+{
+  Check_Type(source_path, T_STRING);
+  Check_Type(target_path, T_STRING);
+
+  const char *const source_path_data = StringValueCStr(source_path);
+  const char *const target_path_data = StringValueCStr(target_path);
+
+  const int source_fd = open(source_path_data, O_RDONLY | O_CLOEXEC);
+
+  if (source_fd == -1) {
+    rb_sys_fail_str(source_path);
+  }
+
+  const int target_fd = open(
+    target_path_data,
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0600
+  );
+
+  if (target_fd == -1) {
+    const int error = errno;
+    close(source_fd);
+    errno = error;
+    rb_sys_fail_str(target_path);
+  }
+
+  mTox_mCompression_COMPRESS_FILE_ARGS args;
+
+  args.source_fd     = source_fd;
+  args.target_fd     = target_fd;
+  args.input         = ALLOC_N(uint8_t, mTox_COMPRESSION_FRAME_SIZE);
+  args.output        = ALLOC_N(
+    uint8_t,
+    mTox_COMPRESSION_FRAME_HEADER_SIZE +
+      compressBound(mTox_COMPRESSION_FRAME_SIZE)
+  );
+  args.interrupted   = false;
+  args.finished      = false;
+  args.error         = 0;
+  args.target_failed = false;
+  args.size          = 0;
+
+  // Files can be large, so other threads run while they are compressed.
+  const int state = mTox_FILE_IO_WITHOUT_GVL(
+    mTox_mCompression_COMPRESS_FILE,
+    &args,
+    &args.interrupted,
+    &args.finished
+  );
+
+  if (close(target_fd) != 0 && !args.error) {
+    args.error = errno;
+    args.target_failed = true;
+  }
+
+  close(source_fd);
+  free(args.input);
+  free(args.output);
+
+  // A partial stream must not be taken for the whole file.
+  if (state || args.error) {
+    unlink(target_path_data);
+  }
+
+  if (state) {
+    rb_jump_tag(state);
+  }
+
+  if (args.error) {
+    errno = args.error;
+    rb_sys_fail_str(args.target_failed ? target_path : source_path);
+  }
+
+  return ULL2NUM(args.size);
+}
+
+// Tox::Compression.decompress_file
+VALUE mTox_mCompression_decompress_file(
+  const VALUE self,
+  const VALUE source_path,
+  const VALUE target_path
+)
+{
+  Check_Type(source_path, T_STRING);
+  Check_Type(target_path, T_STRING);
+
+  const char *const source_path_data = StringValueCStr(source_path);
+  const char *const target_path_data = StringValueCStr(target_path);
+
+  const int source_fd = open(source_path_data, O_RDONLY | O_CLOEXEC);
+
+  if (source_fd == -1) {
+    rb_sys_fail_str(source_path);
+  }
+
+  const int target_fd = open(
+    target_path_data,
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0644
+  );
+
+  if (target_fd == -1) {
+    const int error = errno;
+    close(source_fd);
+    errno = error;
+    rb_sys_fail_str(target_path);
+  }
+
+  mTox_FILE_IO *const io = mTox_FILE_IO_NEW(mTox_FILE_IO_BACKEND_PREAD);
+  mTox_FILE_IO_WINDOW *const window =
+    mTox_FILE_IO_WINDOW_NEW(io, target_fd, 0, true);
+  mTox_COMPRESSION_DECODER *const decoder =
+    mTox_COMPRESSION_DECODER_NEW(UINT64_MAX);
+
+  uint8_t *const buffer = ALLOC_N(uint8_t, mTox_COMPRESSION_FRAME_SIZE);
+
+  uint64_t position = 0;
+  bool ok = true;
+  bool read_failed = false;
+
+  while (ok) {
+    const ssize_t result =
+      read(source_fd, buffer, mTox_COMPRESSION_FRAME_SIZE);
+
+    if (result == -1 && errno == EINTR) {
+      continue;
+    }
+
+    if (result <= 0) {
+      read_failed = result == -1;
+      ok = !read_failed;
+      break;
+    }
+
+    ok = mTox_COMPRESSION_DECODER_FEED(
+      decoder,
+      window,
+      position,
+      buffer,
+      result
+    );
+
+    position += result;
+  }
+
+  const int error = errno;
+
+  const uint64_t size = decoder->output_position;
+
+  ok = ok && mTox_COMPRESSION_DECODER_FINISHED(decoder);
+  ok = mTox_FILE_IO_WINDOW_CLOSE(window) && ok;
+
+  mTox_COMPRESSION_DECODER_FREE(decoder);
+  mTox_FILE_IO_FREE(io);
+  free(buffer);
+  close(source_fd);
+
+  if (read_failed) {
+    errno = error;
+    rb_sys_fail_str(source_path);
+  }
+
+  if (!ok) {
+    rb_raise(rb_eArgError, "Invalid compressed stream");
+  }
+
+  return ULL2NUM(size);
+}
+
+/*************************************************************
+ * File ids
+ *************************************************************/
+
+// Magic prefix, original size in big-endian order, then random bytes.
+void mTox_COMPRESSION_FILE_ID(
+  uint8_t *const file_id,
+  const uint64_t original_size
+)
+{
+  memcpy(file_id, mTox_COMPRESSION_MAGIC, mTox_COMPRESSION_MAGIC_SIZE);
+
+  for (size_t index = 0; index < mTox_COMPRESSION_ORIGINAL_SIZE_SIZE; ++index) {
+    file_id[mTox_COMPRESSION_MAGIC_SIZE + index] =
+      original_size >> (8 * (mTox_COMPRESSION_ORIGINAL_SIZE_SIZE - 1 - index));
+  }
+
+  randombytes_buf(
+    &file_id[mTox_COMPRESSION_MAGIC_SIZE + mTox_COMPRESSION_ORIGINAL_SIZE_SIZE],
+    TOX_FILE_ID_LENGTH -
+      mTox_COMPRESSION_MAGIC_SIZE -
+      mTox_COMPRESSION_ORIGINAL_SIZE_SIZE
+  );
+}
+
+// The file id has to start with the magic prefix.
+uint64_t mTox_COMPRESSION_ORIGINAL_SIZE(const uint8_t *const file_id)
+{
+  uint64_t original_size = 0;
+
+  for (size_t index = 0; index < mTox_COMPRESSION_ORIGINAL_SIZE_SIZE; ++index) {
+    original_size =
+      (original_size << 8) | file_id[mTox_COMPRESSION_MAGIC_SIZE + index];
+  }
+
+  return original_size;
+}
+
+/*************************************************************
+ * Encoder
+ *************************************************************/
+
+// Takes the window of the original file, which has the given size.
+mTox_COMPRESSION_ENCODER *mTox_COMPRESSION_ENCODER_NEW(
+  mTox_FILE_IO_WINDOW *const window,
+  const uint64_t size
+)
+{
+  uint8_t *const input = ALLOC_N(uint8_t, mTox_COMPRESSION_FRAME_SIZE);
+  uint8_t *const frame = ALLOC_N(
+    uint8_t,
+    mTox_COMPRESSION_FRAME_HEADER_SIZE +
+      compressBound(mTox_COMPRESSION_FRAME_SIZE)
+  );
+
+  mTox_COMPRESSION_ENCODER *const encoder = ALLOC(mTox_COMPRESSION_ENCODER);
+
+  memset(encoder, 0, sizeof(mTox_COMPRESSION_ENCODER));
+
+  encoder->window = window;
+  encoder->size   = size;
+  encoder->input  = input;
+  encoder->frame  = frame;
+
+  return encoder;
+}
+
+void mTox_COMPRESSION_ENCODER_FREE(mTox_COMPRESSION_ENCODER *const encoder)
+{
+  if (!encoder) {
+    return;
+  }
+
+  mTox_FILE_IO_WINDOW_CLOSE(encoder->window);
+  free(encoder->input);
+  free(encoder->frame);
+  free(encoder);
+}
+
+// Compresses the next frame whenever the previous one has been read.
+// Chunks have to be requested in order, as they are in toxcore transfers.
+// Sets "read_length" below "length" at the end of the stream. Returns
+// false when the original file could not be read.
+bool mTox_COMPRESSION_ENCODER_READ(
+  mTox_COMPRESSION_ENCODER *const encoder,
+  const uint64_t position,
+  uint8_t *const data,
+  const size_t length,
+  size_t *const read_length
+)
+{
+  *read_length = 0;
+
+  if (position != encoder->position) {
+    return false;
+  }
+
+  while (*read_length < length) {
+    if (encoder->frame_offset == encoder->frame_length) {
+      if (encoder->input_position == encoder->size) {
+        break;
+      }
+
+      const uint64_t remaining = encoder->size - encoder->input_position;
+
+      const size_t input_length =
+        remaining < mTox_COMPRESSION_FRAME_SIZE
+        ? remaining
+        : mTox_COMPRESSION_FRAME_SIZE;
+
+      if (!mTox_FILE_IO_WINDOW_READ(
+            encoder->window,
+            encoder->input_position,
+            encoder->input,
+            input_length
+          )) {
+        return false;
+      }
+
+      encoder->input_position += input_length;
+
+      encoder->frame_length = mTox_COMPRESSION_FRAME(
+        encoder->frame,
+        encoder->input,
+        input_length
+      );
+
+      encoder->frame_offset = 0;
+    }
+
+    size_t chunk = encoder->frame_length - encoder->frame_offset;
+
+    if (chunk > length - *read_length) {
+      chunk = length - *read_length;
+    }
+
+    memcpy(&data[*read_length], &encoder->frame[encoder->frame_offset], chunk);
+
+    encoder->frame_offset += chunk;
+    *read_length          += chunk;
+  }
+
+  encoder->position += *read_length;
+
+  return true;
+}
+
+/*************************************************************
+ * Decoder
+ *************************************************************/
+
+// The size of the original file is UINT64_MAX when it is unknown.
+mTox_COMPRESSION_DECODER *mTox_COMPRESSION_DECODER_NEW(const uint64_t size)
+{
+  mTox_COMPRESSION_DECODER *const decoder = ALLOC(mTox_COMPRESSION_DECODER);
+
+  memset(decoder, 0, sizeof(mTox_COMPRESSION_DECODER));
+
+  decoder->size = size;
+
+  decoder->frame  = ALLOC_N(uint8_t, compressBound(mTox_COMPRESSION_FRAME_SIZE));
+  decoder->output = ALLOC_N(uint8_t, mTox_COMPRESSION_FRAME_SIZE);
+
+  return decoder;
+}
+
+void mTox_COMPRESSION_DECODER_FREE(mTox_COMPRESSION_DECODER *const decoder)
+{
+  if (!decoder) {
+    return;
+  }
+
+  free(decoder->frame);
+  free(decoder->output);
+  free(decoder);
+}
+
+// Chunks have to arrive in order, as they do in toxcore transfers. Returns
+// false when the stream is malformed or the window could not be written.
+bool mTox_COMPRESSION_DECODER_FEED(
+  mTox_COMPRESSION_DECODER *const decoder,
+  mTox_FILE_IO_WINDOW *const window,
+  const uint64_t position,
+  const uint8_t *data,
+  size_t length
+)
+{
+  if (decoder->failed || position != decoder->position) {
+    decoder->failed = true;
+    return false;
+  }
+
+  decoder->position += length;
+
+  while (length > 0) {
+    if (decoder->header_length < mTox_COMPRESSION_FRAME_HEADER_SIZE) {
+      decoder->header[decoder->header_length++] = *data++;
+      --length;
+
+      if (decoder->header_length < mTox_COMPRESSION_FRAME_HEADER_SIZE) {
+        continue;
+      }
+
+      const uint32_t header =
+        ((uint32_t)decoder->header[0] << 24) |
+        ((uint32_t)decoder->header[1] << 16) |
+        ((uint32_t)decoder->header[2] << 8)  |
+         (uint32_t)decoder->header[3];
+
+      decoder->frame_stored = header & mTox_COMPRESSION_FRAME_STORED;
+      decoder->frame_size   = header & ~mTox_COMPRESSION_FRAME_STORED;
+      decoder->frame_length = 0;
+
+      if (decoder->frame_size == 0 ||
+          decoder->frame_size > (decoder->frame_stored
+                                 ? mTox_COMPRESSION_FRAME_SIZE
+                                 : compressBound(mTox_COMPRESSION_FRAME_SIZE))) {
+        decoder->failed = true;
+        return false;
+      }
+
+      continue;
+    }
+
+    size_t chunk = decoder->frame_size - decoder->frame_length;
+
+    if (chunk > length) {
+      chunk = length;
+    }
+
+    memcpy(&decoder->frame[decoder->frame_length], data, chunk);
+
+    decoder->frame_length += chunk;
+    data   += chunk;
+    length -= chunk;
+
+    if (decoder->frame_length == decoder->frame_size &&
+        !mTox_COMPRESSION_DECODER_FLUSH(decoder, window)) {
+      decoder->failed = true;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// The stream has to end at a frame boundary, with the original size.
+bool mTox_COMPRESSION_DECODER_FINISHED(
+  const mTox_COMPRESSION_DECODER *const decoder
+)
+{
+  return !decoder->failed && decoder->header_length == 0 &&
+         (decoder->size == UINT64_MAX ||
+          decoder->size == decoder->output_position);
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+bool mTox_COMPRESSION_DECODER_FLUSH(
+  mTox_COMPRESSION_DECODER *const decoder,
+  mTox_FILE_IO_WINDOW *const window
+)
+{
+  const uint8_t *output = decoder->frame;
+  uLongf output_length = decoder->frame_size;
+
+  if (!decoder->frame_stored) {
+    output = decoder->output;
+    output_length = mTox_COMPRESSION_FRAME_SIZE;
+
+    if (uncompress(
+          decoder->output,
+          &output_length,
+          decoder->frame,
+          decoder->frame_size
+        ) != Z_OK) {
+      return false;
+    }
+  }
+
+  decoder->header_length = 0;
+
+  if (decoder->size != UINT64_MAX &&
+      output_length > decoder->size - decoder->output_position) {
+    return false;
+  }
+
+  if (!mTox_FILE_IO_WINDOW_WRITE(
+        window,
+        decoder->output_position,
+        output,
+        output_length
+      )) {
+    return false;
+  }
+
+  decoder->output_position += output_length;
+
+  return true;
+}
+
+// Compresses one frame with its header. The output has to have room for
+// the header and the bound of the compressed frame.
+size_t mTox_COMPRESSION_FRAME(
+  uint8_t *const output,
+  const uint8_t *const input,
+  const size_t input_length
+)
+{
+  uLongf frame_size = compressBound(mTox_COMPRESSION_FRAME_SIZE);
+  uint32_t header;
+
+  if (compress2(
+        &output[mTox_COMPRESSION_FRAME_HEADER_SIZE],
+        &frame_size,
+        input,
+        input_length,
+        Z_DEFAULT_COMPRESSION
+      ) == Z_OK && frame_size < input_length) {
+    header = frame_size;
+  }
+  else {
+    memcpy(&output[mTox_COMPRESSION_FRAME_HEADER_SIZE], input, input_length);
+    frame_size = input_length;
+    header = frame_size | mTox_COMPRESSION_FRAME_STORED;
+  }
+
+  output[0] = header >> 24;
+  output[1] = header >> 16;
+  output[2] = header >> 8;
+  output[3] = header;
+
+  return mTox_COMPRESSION_FRAME_HEADER_SIZE + frame_size;
+}
+
+// Runs without the GVL, so it must not call Ruby. It returns between
+// frames when interrupted.
+void *mTox_mCompression_COMPRESS_FILE(void *const data)
+{
+  mTox_mCompression_COMPRESS_FILE_ARGS *const args = data;
+
+  uint8_t *const input  = args->input;
+  uint8_t *const output = args->output;
+
+  while (!args->interrupted) {
+    size_t input_length = 0;
+
+    while (input_length < mTox_COMPRESSION_FRAME_SIZE) {
+      const ssize_t result = read(
+        args->source_fd,
+        &input[input_length],
+        mTox_COMPRESSION_FRAME_SIZE - input_length
+      );
+
+      if (result == -1 && errno == EINTR) {
+        continue;
+      }
+
+      if (result == -1) {
+        args->error = errno;
+        args->finished = true;
+        return NULL;
+      }
+
+      if (result == 0) {
+        break;
+      }
+
+      input_length += result;
+    }
+
+    if (input_length == 0) {
+      args->finished = true;
+      return NULL;
+    }
+
+    const size_t output_length =
+      mTox_COMPRESSION_FRAME(output, input, input_length);
+
+    if (!mTox_FILE_IO_WRITE(args->target_fd, output, output_length)) {
+      args->error = errno;
+      args->target_failed = true;
+      args->finished = true;
+      return NULL;
+    }
+
+    args->size += input_length;
+  }
+
+  return NULL;
+}
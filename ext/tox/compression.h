@@ -0,0 +1,48 @@
+// Compressed streams of file transfers. Files are split into frames which
+// are compressed independently with zlib, so the receiver can decompress
+// chunks as they arrive without knowing the whole stream. Every frame
+// starts with its length in big-endian order; frames which do not shrink
+// are stored as is, marked with the highest bit of the length.
+//
+// Compressed transfers are streams of unknown size which are compressed as
+// chunks are requested. They carry the magic prefix and the original size
+// in their file ids.
+
+#define mTox_COMPRESSION_MAGIC      "TXZ\x01"
+#define mTox_COMPRESSION_MAGIC_SIZE 4
+
+#define mTox_COMPRESSION_ORIGINAL_SIZE_SIZE 8
+
+#define mTox_COMPRESSION_FRAME_SIZE        (64 * 1024)
+#define mTox_COMPRESSION_FRAME_HEADER_SIZE 4
+#define mTox_COMPRESSION_FRAME_STORED      0x80000000
+
+typedef struct mTox_COMPRESSION_ENCODER mTox_COMPRESSION_ENCODER;
+typedef struct mTox_COMPRESSION_DECODER mTox_COMPRESSION_DECODER;
+
+void     mTox_COMPRESSION_FILE_ID(uint8_t *file_id, uint64_t original_size);
+uint64_t mTox_COMPRESSION_ORIGINAL_SIZE(const uint8_t *file_id);
+
+mTox_COMPRESSION_ENCODER *mTox_COMPRESSION_ENCODER_NEW(mTox_FILE_IO_WINDOW *window, uint64_t size);
+void                      mTox_COMPRESSION_ENCODER_FREE(mTox_COMPRESSION_ENCODER *encoder);
+
+bool mTox_COMPRESSION_ENCODER_READ(
+  mTox_COMPRESSION_ENCODER *encoder,
+  uint64_t position,
+  uint8_t *data,
+  size_t length,
+  size_t *read_length
+);
+
+mTox_COMPRESSION_DECODER *mTox_COMPRESSION_DECODER_NEW(uint64_t size);
+void                      mTox_COMPRESSION_DECODER_FREE(mTox_COMPRESSION_DECODER *decoder);
+
+bool mTox_COMPRESSION_DECODER_FEED(
+  mTox_COMPRESSION_DECODER *decoder,
+  mTox_FILE_IO_WINDOW *window,
+  uint64_t position,
+  const uint8_t *data,
+  size_t length
+);
+
+bool mTox_COMPRESSION_DECODER_FINISHED(const mTox_COMPRESSION_DECODER *decoder);
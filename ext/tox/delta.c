@@ -0,0 +1,1025 @@
+#include "tox.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Block size of signature, then weak and strong checksum of every whole
+// block of the basis file.
+#define mTox_mDelta_SIGNATURE_HEADER_SIZE 4
+#define mTox_mDelta_STRONG_SIZE           16
+#define mTox_mDelta_ENTRY_SIZE            (4 + mTox_mDelta_STRONG_SIZE)
+
+// Block size, size and SHA-256 of the new file, then instructions to copy
+// blocks of the basis file or to insert literal data.
+#define mTox_mDelta_HEADER_SIZE (4 + 8 + crypto_hash_sha256_BYTES)
+
+#define mTox_mDelta_OP_COPY    'C'
+#define mTox_mDelta_OP_LITERAL 'L'
+
+#define mTox_mDelta_MAX_LITERAL_SIZE (1024 * 1024)
+#define mTox_mDelta_BUFFER_SIZE      (64 * 1024)
+
+// Interrupts are checked between steps of this size while whole files are
+// hashed.
+#define mTox_mDelta_HASH_STEP_SIZE (1024 * 1024)
+
+typedef struct {
+  int     fd;
+  size_t  length;
+  uint8_t data[mTox_mDelta_BUFFER_SIZE];
+} mTox_mDelta_OUTPUT;
+
+typedef struct {
+  const uint8_t *data;
+  size_t         block_size;
+  size_t         blocks;
+  uint8_t       *entries;
+
+  volatile bool interrupted;
+  bool          finished;
+
+  size_t index;
+} mTox_mDelta_SIGNATURE_ARGS;
+
+typedef struct {
+  const uint8_t *data;
+  size_t         size;
+
+  const uint8_t *entries;
+  size_t         blocks;
+  size_t         block_size;
+
+  const int64_t *heads;
+  const int64_t *chain;
+  size_t         buckets;
+
+  mTox_mDelta_OUTPUT *output;
+
+  volatile bool interrupted;
+  bool          finished;
+
+  bool ok;
+  int  error;
+
+  crypto_hash_sha256_state digest_state;
+  size_t                   digested;
+  bool                     header_written;
+
+  size_t   position;
+  size_t   literal;
+  int64_t  copy_index;
+  uint32_t copy_count;
+
+  // Rolling checksum of the window at the current position.
+  uint32_t a;
+  uint32_t b;
+  bool     rolling;
+} mTox_mDelta_GENERATE_ARGS;
+
+typedef struct {
+  const uint8_t *delta;
+  size_t         delta_size;
+  int            basis_fd;
+  uint64_t       basis_size;
+  size_t         block_size;
+  int            out_fd;
+  uint8_t       *buffer;
+
+  volatile bool interrupted;
+  bool          finished;
+
+  int  error;
+  bool basis_failed;
+  bool corrupt;
+
+  crypto_hash_sha256_state digest_state;
+  size_t                   offset;
+  uint64_t                 written;
+
+  // Rest of the current copy instruction.
+  uint64_t source;
+  uint64_t remaining;
+} mTox_mDelta_PATCH_ARGS;
+
+// Singleton methods
+
+static VALUE mTox_mDelta_signature(VALUE self, VALUE path, VALUE block_size);
+static VALUE mTox_mDelta_generate(VALUE self, VALUE path, VALUE signature, VALUE delta_path);
+static VALUE mTox_mDelta_patch(VALUE self, VALUE basis_path, VALUE delta_path, VALUE out_path, VALUE block_size);
+
+// Private functions
+
+static void *mTox_mDelta_SIGNATURE(void *data);
+static void *mTox_mDelta_GENERATE(void *data);
+static void *mTox_mDelta_PATCH(void *data);
+
+static uint32_t mTox_mDelta_WEAK(const uint8_t *data, size_t length);
+static void     mTox_mDelta_STRONG(uint8_t *strong, const uint8_t *data, size_t length);
+
+static uint32_t mTox_mDelta_LOAD32(const uint8_t *data);
+static uint64_t mTox_mDelta_LOAD64(const uint8_t *data);
+static void     mTox_mDelta_STORE32(uint8_t *data, uint32_t value);
+static void     mTox_mDelta_STORE64(uint8_t *data, uint64_t value);
+
+static bool mTox_mDelta_OUTPUT_WRITE(mTox_mDelta_OUTPUT *output, const uint8_t *data, size_t length);
+static bool mTox_mDelta_OUTPUT_FLUSH(mTox_mDelta_OUTPUT *output);
+static bool mTox_mDelta_OUTPUT_COPY(mTox_mDelta_OUTPUT *output, uint32_t index, uint32_t count);
+static bool mTox_mDelta_OUTPUT_LITERAL(mTox_mDelta_OUTPUT *output, const uint8_t *data, size_t length);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_mDelta_INIT()
+{
+  // Constants
+
+  rb_define_const(mTox_mDelta, "STRONG_SIZE", LONG2FIX(mTox_mDelta_STRONG_SIZE));
+
+  // Singleton methods
+
+  rb_define_singleton_method(mTox_mDelta, "signature", mTox_mDelta_signature, 2);
+  rb_define_singleton_method(mTox_mDelta, "generate",  mTox_mDelta_generate,  3);
+  rb_define_singleton_method(mTox_mDelta, "patch",     mTox_mDelta_patch,     4);
+}
+
+/*************************************************************
+ * Singleton methods
+ *************************************************************/
+
+// Tox::Delta.signature
+VALUE mTox_mDelta_signature(
+  const VALUE self,
+  const VALUE path,
+  const VALUE block_size
+)
+{
+  Check_Type(path, T_STRING);
+
+  const long block_size_data = NUM2LONG(block_size);
+
+  if (block_size_data <= 0 || block_size_data > mTox_mDelta_BUFFER_SIZE) {
+    rb_raise(rb_eArgError, "Invalid block size");
+  }
+
+  const int fd = open(StringValueCStr(path), O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1) {
+    rb_sys_fail_str(path);
+  }
+
+  const uint8_t *data;
+  size_t size;
+
+  if (!mTox_FILE_IO_MAP(fd, &data, &size)) {
+    const int error = errno;
+    close(fd);
+    errno = error;
+    rb_sys_fail_str(path);
+  }
+
+  close(fd);
+
+  mTox_mDelta_SIGNATURE_ARGS args;
+
+  args.data        = data;
+  args.block_size  = block_size_data;
+  args.blocks      = size / block_size_data;
+  args.interrupted = false;
+  args.finished    = false;
+  args.index       = 0;
+
+  const VALUE signature = rb_str_new(
+    NULL,
+    mTox_mDelta_SIGNATURE_HEADER_SIZE + args.blocks * mTox_mDelta_ENTRY_SIZE
+  );
+
+  uint8_t *const signature_data = (uint8_t*)RSTRING_PTR(signature);
+
+  mTox_mDelta_STORE32(signature_data, block_size_data);
+
+  args.entries = &signature_data[mTox_mDelta_SIGNATURE_HEADER_SIZE];
+
+  // Files can be large, so other threads run while their blocks are
+  // checksummed.
+  const int state = mTox_FILE_IO_WITHOUT_GVL(
+    mTox_mDelta_SIGNATURE,
+    &args,
+    &args.interrupted,
+    &args.finished
+  );
+
+  if (size > 0) {
+    munmap((void*)data, size);
+  }
+
+  if (state) {
+    rb_jump_tag(state);
+  }
+
+  return signature;
+}
+
+// Tox::Delta.generate
+VALUE mTox_mDelta_generate(
+  const VALUE self,
+  const VALUE path,
+  const VALUE signature,
+  const VALUE delta_path
+)
+{
+  Check_Type(path, T_STRING);
+  Check_Type(signature, T_STRING);
+  Check_Type(delta_path, T_STRING);
+
+  const char *const path_data       = StringValueCStr(path);
+  const char *const delta_path_data = StringValueCStr(delta_path);
+
+  // Other threads can change the string while the delta is generated.
+  const VALUE signature_copy = rb_str_new_frozen(signature);
+
+  const uint8_t *const signature_data =
+    (const uint8_t*)RSTRING_PTR(signature_copy);
+  const size_t signature_size = RSTRING_LEN(signature_copy);
+
+  if (signature_size < mTox_mDelta_SIGNATURE_HEADER_SIZE ||
+      (signature_size - mTox_mDelta_SIGNATURE_HEADER_SIZE) %
+        mTox_mDelta_ENTRY_SIZE != 0) {
+    rb_raise(rb_eArgError, "Invalid signature");
+  }
+
+  const size_t block_size = mTox_mDelta_LOAD32(signature_data);
+
+  if (block_size == 0 || block_size > mTox_mDelta_BUFFER_SIZE) {
+    rb_raise(rb_eArgError, "Invalid block size");
+  }
+
+  const size_t blocks =
+    (signature_size - mTox_mDelta_SIGNATURE_HEADER_SIZE) /
+    mTox_mDelta_ENTRY_SIZE;
+
+  if (blocks > UINT32_MAX) {
+    rb_raise(rb_eArgError, "Invalid signature");
+  }
+
+  const uint8_t *const entries =
+    &signature_data[mTox_mDelta_SIGNATURE_HEADER_SIZE];
+
+  // Blocks by weak checksum, chained in a hash table.
+  size_t buckets = 16;
+
+  while (buckets < blocks * 2) {
+    buckets *= 2;
+  }
+
+  int64_t *const heads = ALLOC_N(int64_t, buckets);
+  int64_t *const chain = ALLOC_N(int64_t, blocks ? blocks : 1);
+
+  for (size_t bucket = 0; bucket < buckets; ++bucket) {
+    heads[bucket] = -1;
+  }
+
+  // Reversed, so earlier blocks come first in the chains.
+  for (size_t index = blocks; index-- > 0;) {
+    const uint32_t weak =
+      mTox_mDelta_LOAD32(&entries[index * mTox_mDelta_ENTRY_SIZE]);
+
+    chain[index] = heads[weak & (buckets - 1)];
+    heads[weak & (buckets - 1)] = index;
+  }
+
+  const int fd = open(path_data, O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1) {
+    const int error = errno;
+    free(heads);
+    free(chain);
+    errno = error;
+    rb_sys_fail_str(path);
+  }
+
+  const uint8_t *data;
+  size_t size;
+
+  if (!mTox_FILE_IO_MAP(fd, &data, &size)) {
+    const int error = errno;
+    close(fd);
+    free(heads);
+    free(chain);
+    errno = error;
+    rb_sys_fail_str(path);
+  }
+
+  close(fd);
+
+  mTox_mDelta_OUTPUT *const output = ALLOC(mTox_mDelta_OUTPUT);
+
+  output->length = 0;
+  output->fd = open(
+    delta_path_data,
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0600
+  );
+
+  mTox_mDelta_GENERATE_ARGS args;
+
+  memset(&args, 0, sizeof(args));
+
+  args.data       = data;
+  args.size       = size;
+  args.entries    = entries;
+  args.blocks     = blocks;
+  args.block_size = block_size;
+  args.heads      = heads;
+  args.chain      = chain;
+  args.buckets    = buckets;
+  args.output     = output;
+  args.ok         = output->fd != -1;
+  args.error      = errno;
+  args.copy_index = -1;
+
+  crypto_hash_sha256_init(&args.digest_state);
+
+  // Files can be large, so other threads run while the delta is generated.
+  const int state = args.ok
+    ? mTox_FILE_IO_WITHOUT_GVL(
+        mTox_mDelta_GENERATE,
+        &args,
+        &args.interrupted,
+        &args.finished
+      )
+    : 0;
+
+  RB_GC_GUARD(signature_copy);
+
+  bool ok = args.ok && !state;
+  int error = args.error;
+  uint64_t delta_size = 0;
+
+  if (ok) {
+    const off_t end = lseek(output->fd, 0, SEEK_CUR);
+    ok = end != -1;
+    error = errno;
+    delta_size = end;
+  }
+
+  if (output->fd != -1 && close(output->fd) != 0 && ok) {
+    ok = false;
+    error = errno;
+  }
+
+  if (size > 0) {
+    munmap((void*)data, size);
+  }
+
+  free(output);
+  free(heads);
+  free(chain);
+
+  if (state) {
+    rb_jump_tag(state);
+  }
+
+  if (!ok) {
+    errno = error;
+    rb_sys_fail_str(delta_path);
+  }
+
+  return ULL2NUM(delta_size);
+}
+
+// Tox::Delta.patch
+VALUE mTox_mDelta_patch(
+  const VALUE self,
+  const VALUE basis_path,
+  const VALUE delta_path,
+  const VALUE out_path,
+  const VALUE block_size
+)
+{
+  if (Qnil != basis_path) {
+    Check_Type(basis_path, T_STRING);
+  }
+
+  Check_Type(delta_path, T_STRING);
+  Check_Type(out_path, T_STRING);
+
+  const long block_size_data = NUM2LONG(block_size);
+
+  if (block_size_data <= 0 || block_size_data > mTox_mDelta_BUFFER_SIZE) {
+    rb_raise(rb_eArgError, "Invalid block size");
+  }
+
+  const char *const basis_path_data =
+    Qnil == basis_path ? NULL : StringValueCStr(basis_path);
+  const char *const delta_path_data = StringValueCStr(delta_path);
+  const char *const out_path_data   = StringValueCStr(out_path);
+
+  const int delta_fd = open(delta_path_data, O_RDONLY | O_CLOEXEC);
+
+  if (delta_fd == -1) {
+    rb_sys_fail_str(delta_path);
+  }
+
+  const uint8_t *delta;
+  size_t delta_size;
+
+  if (!mTox_FILE_IO_MAP(delta_fd, &delta, &delta_size)) {
+    const int error = errno;
+    close(delta_fd);
+    errno = error;
+    rb_sys_fail_str(delta_path);
+  }
+
+  close(delta_fd);
+
+  int basis_fd = -1;
+
+  if (Qnil != basis_path) {
+    basis_fd = open(basis_path_data, O_RDONLY | O_CLOEXEC);
+
+    if (basis_fd == -1) {
+      const int error = errno;
+      if (delta_size > 0) {
+        munmap((void*)delta, delta_size);
+      }
+      errno = error;
+      rb_sys_fail_str(basis_path);
+    }
+  }
+
+  const int out_fd = open(
+    out_path_data,
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0666
+  );
+
+  VALUE failed_path = Qnil;
+  int error = 0;
+  uint64_t basis_size = 0;
+
+  if (out_fd == -1) {
+    failed_path = out_path;
+    error = errno;
+  }
+
+  // The new copy keeps the permissions of the old one. Nothing has been
+  // written yet, so the umask only applies to new files.
+  if (Qnil == failed_path && basis_fd != -1) {
+    struct stat basis_stat;
+
+    if (fstat(basis_fd, &basis_stat) != 0) {
+      failed_path = basis_path;
+      error = errno;
+    }
+    else if (fchmod(out_fd, basis_stat.st_mode & 0777) != 0) {
+      failed_path = out_path;
+      error = errno;
+    }
+    else {
+      basis_size = basis_stat.st_size;
+    }
+  }
+
+  mTox_mDelta_PATCH_ARGS args;
+
+  memset(&args, 0, sizeof(args));
+
+  args.delta      = delta;
+  args.delta_size = delta_size;
+  args.basis_fd   = basis_fd;
+  args.basis_size = basis_size;
+  args.block_size = block_size_data;
+  args.out_fd     = out_fd;
+  args.buffer     = ALLOC_N(uint8_t, mTox_mDelta_BUFFER_SIZE);
+  args.offset     = mTox_mDelta_HEADER_SIZE;
+
+  crypto_hash_sha256_init(&args.digest_state);
+
+  // Files can be large, so other threads run while the delta is applied.
+  const int state = Qnil == failed_path
+    ? mTox_FILE_IO_WITHOUT_GVL(
+        mTox_mDelta_PATCH,
+        &args,
+        &args.interrupted,
+        &args.finished
+      )
+    : 0;
+
+  if (Qnil == failed_path && args.error) {
+    failed_path = args.basis_failed ? basis_path : out_path;
+    error = args.error;
+  }
+
+  if (out_fd != -1 && close(out_fd) != 0 && Qnil == failed_path) {
+    failed_path = out_path;
+    error = errno;
+  }
+
+  if (basis_fd != -1) {
+    close(basis_fd);
+  }
+
+  if (delta_size > 0) {
+    munmap((void*)delta, delta_size);
+  }
+
+  free(args.buffer);
+
+  if (state) {
+    rb_jump_tag(state);
+  }
+
+  if (Qnil != failed_path) {
+    errno = error;
+    rb_sys_fail_str(failed_path);
+  }
+
+  if (args.corrupt) {
+    rb_raise(mTox_mDelta_eCorruptError, "Delta does not match basis file");
+  }
+
+  return Qnil;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+// The work of the singleton methods runs without the GVL, so it must not
+// call Ruby. It returns when interrupted and continues where it stopped.
+
+void *mTox_mDelta_SIGNATURE(void *const data)
+{
+  mTox_mDelta_SIGNATURE_ARGS *const args = data;
+
+  for (; args->index < args->blocks; ++args->index) {
+    if (args->interrupted) {
+      return NULL;
+    }
+
+    const uint8_t *const block = &args->data[args->index * args->block_size];
+    uint8_t *const entry = &args->entries[args->index * mTox_mDelta_ENTRY_SIZE];
+
+    mTox_mDelta_STORE32(entry, mTox_mDelta_WEAK(block, args->block_size));
+    mTox_mDelta_STRONG(&entry[4], block, args->block_size);
+  }
+
+  args->finished = true;
+
+  return NULL;
+}
+
+void *mTox_mDelta_GENERATE(void *const args_data)
+{
+  mTox_mDelta_GENERATE_ARGS *const args = args_data;
+
+  const uint8_t *const data       = args->data;
+  const size_t         size       = args->size;
+  const uint8_t *const entries    = args->entries;
+  const size_t         blocks     = args->blocks;
+  const size_t         block_size = args->block_size;
+  const int64_t *const heads      = args->heads;
+  const int64_t *const chain      = args->chain;
+  const size_t         buckets    = args->buckets;
+
+  mTox_mDelta_OUTPUT *const output = args->output;
+
+  // The header has the digest of the whole file.
+  while (args->digested < size) {
+    if (args->interrupted) {
+      return NULL;
+    }
+
+    const size_t length =
+      size - args->digested < mTox_mDelta_HASH_STEP_SIZE
+      ? size - args->digested
+      : mTox_mDelta_HASH_STEP_SIZE;
+
+    crypto_hash_sha256_update(
+      &args->digest_state,
+      &data[args->digested],
+      length
+    );
+
+    args->digested += length;
+  }
+
+  bool ok = true;
+
+  if (!args->header_written) {
+    uint8_t header[mTox_mDelta_HEADER_SIZE];
+
+    mTox_mDelta_STORE32(header, block_size);
+    mTox_mDelta_STORE64(&header[4], size);
+    crypto_hash_sha256_final(&args->digest_state, &header[12]);
+
+    ok = mTox_mDelta_OUTPUT_WRITE(output, header, mTox_mDelta_HEADER_SIZE);
+
+    args->header_written = true;
+  }
+
+  size_t position = args->position;
+  size_t literal  = args->literal;
+
+  int64_t  copy_index = args->copy_index;
+  uint32_t copy_count = args->copy_count;
+
+  uint32_t a = args->a;
+  uint32_t b = args->b;
+  bool rolling = args->rolling;
+
+  while (ok && blocks > 0 && position + block_size <= size) {
+    if (args->interrupted) {
+      args->position   = position;
+      args->literal    = literal;
+      args->copy_index = copy_index;
+      args->copy_count = copy_count;
+      args->a          = a;
+      args->b          = b;
+      args->rolling    = rolling;
+
+      return NULL;
+    }
+
+    if (!rolling) {
+      const uint32_t weak = mTox_mDelta_WEAK(&data[position], block_size);
+      a = weak & 0xffff;
+      b = weak >> 16;
+      rolling = true;
+    }
+
+    const uint32_t weak = (b << 16) | a;
+
+    int64_t match = -1;
+    bool strong_ready = false;
+    uint8_t strong[mTox_mDelta_STRONG_SIZE];
+
+    // Continuing the previous copy keeps the delta small, and checking it
+    // first keeps repetitive files from walking long chains.
+    const int64_t next = copy_index + copy_count;
+
+    if (copy_count > 0 && literal == position && next < (int64_t)blocks &&
+        mTox_mDelta_LOAD32(&entries[next * mTox_mDelta_ENTRY_SIZE]) == weak) {
+      mTox_mDelta_STRONG(strong, &data[position], block_size);
+      strong_ready = true;
+
+      if (memcmp(strong, &entries[next * mTox_mDelta_ENTRY_SIZE + 4],
+                 mTox_mDelta_STRONG_SIZE) == 0) {
+        match = next;
+      }
+    }
+
+    for (int64_t index = match == -1 ? heads[weak & (buckets - 1)] : -1;
+         index != -1;
+         index = chain[index]) {
+      const uint8_t *const entry = &entries[index * mTox_mDelta_ENTRY_SIZE];
+
+      if (mTox_mDelta_LOAD32(entry) != weak) {
+        continue;
+      }
+
+      if (!strong_ready) {
+        mTox_mDelta_STRONG(strong, &data[position], block_size);
+        strong_ready = true;
+      }
+
+      if (memcmp(strong, &entry[4], mTox_mDelta_STRONG_SIZE) == 0) {
+        match = index;
+        break;
+      }
+    }
+
+    if (match != -1) {
+      if (literal < position) {
+        ok = ok &&
+          (copy_count == 0 ||
+           mTox_mDelta_OUTPUT_COPY(output, copy_index, copy_count)) &&
+          mTox_mDelta_OUTPUT_LITERAL(
+            output,
+            &data[literal],
+            position - literal
+          );
+
+        copy_count = 0;
+      }
+
+      if (copy_count > 0 &&
+          match == copy_index + copy_count &&
+          copy_count < UINT32_MAX) {
+        ++copy_count;
+      }
+      else {
+        ok = ok &&
+          (copy_count == 0 ||
+           mTox_mDelta_OUTPUT_COPY(output, copy_index, copy_count));
+
+        copy_index = match;
+        copy_count = 1;
+      }
+
+      position += block_size;
+      literal = position;
+      rolling = false;
+
+      continue;
+    }
+
+    if (position + block_size == size) {
+      break;
+    }
+
+    const uint32_t out = data[position];
+    const uint32_t in  = data[position + block_size];
+
+    a = (a - out + in) & 0xffff;
+    b = (b - block_size * out + a) & 0xffff;
+
+    ++position;
+  }
+
+  ok = ok &&
+    (copy_count == 0 ||
+     mTox_mDelta_OUTPUT_COPY(output, copy_index, copy_count)) &&
+    (literal == size ||
+     mTox_mDelta_OUTPUT_LITERAL(output, &data[literal], size - literal)) &&
+    mTox_mDelta_OUTPUT_FLUSH(output);
+
+  args->ok       = ok;
+  args->error    = errno;
+  args->finished = true;
+
+  return NULL;
+}
+
+void *mTox_mDelta_PATCH(void *const data)
+{
+  mTox_mDelta_PATCH_ARGS *const args = data;
+
+  const uint8_t *const delta      = args->delta;
+  const size_t         delta_size = args->delta_size;
+  uint8_t *const       buffer     = args->buffer;
+
+  args->finished = true;
+
+  if (delta_size < mTox_mDelta_HEADER_SIZE) {
+    args->corrupt = true;
+    return NULL;
+  }
+
+  const size_t   block_size    = mTox_mDelta_LOAD32(delta);
+  const uint64_t expected_size = mTox_mDelta_LOAD64(&delta[4]);
+
+  // The delta comes from the peer. It must use the block size of the
+  // signature it was made against, and every instruction is checked against
+  // the sizes of both files before it writes, so the output can not grow
+  // past the size of the new file.
+  if (block_size != args->block_size) {
+    args->corrupt = true;
+    return NULL;
+  }
+
+  for (;;) {
+    while (args->remaining > 0) {
+      if (args->interrupted) {
+        args->finished = false;
+        return NULL;
+      }
+
+      const size_t length =
+        args->remaining < mTox_mDelta_BUFFER_SIZE
+        ? args->remaining
+        : mTox_mDelta_BUFFER_SIZE;
+
+      const ssize_t result =
+        pread(args->basis_fd, buffer, length, args->source);
+
+      if (result == -1 && errno == EINTR) {
+        continue;
+      }
+
+      if (result == -1) {
+        args->error = errno;
+        args->basis_failed = true;
+        return NULL;
+      }
+
+      // The basis file has changed since its signature was sent.
+      if (result == 0) {
+        args->corrupt = true;
+        return NULL;
+      }
+
+      if (!mTox_FILE_IO_WRITE(args->out_fd, buffer, result)) {
+        args->error = errno;
+        return NULL;
+      }
+
+      crypto_hash_sha256_update(&args->digest_state, buffer, result);
+
+      args->source    += result;
+      args->written   += result;
+      args->remaining -= result;
+    }
+
+    if (args->offset >= delta_size) {
+      break;
+    }
+
+    if (args->interrupted) {
+      args->finished = false;
+      return NULL;
+    }
+
+    const size_t offset = args->offset;
+    const uint8_t op = delta[offset];
+
+    if (op == mTox_mDelta_OP_COPY && delta_size - offset >= 9) {
+      const uint64_t index = mTox_mDelta_LOAD32(&delta[offset + 1]);
+      const uint64_t count = mTox_mDelta_LOAD32(&delta[offset + 5]);
+
+      args->offset += 9;
+
+      if (args->basis_fd == -1) {
+        args->corrupt = true;
+        return NULL;
+      }
+
+      args->source    = index * block_size;
+      args->remaining = count * block_size;
+
+      // Signatures only cover whole blocks of the basis file.
+      if (args->source + args->remaining > args->basis_size ||
+          args->remaining > expected_size - args->written) {
+        args->corrupt = true;
+        return NULL;
+      }
+    }
+    else if (op == mTox_mDelta_OP_LITERAL && delta_size - offset >= 5) {
+      const size_t length = mTox_mDelta_LOAD32(&delta[offset + 1]);
+
+      if (delta_size - offset - 5 < length ||
+          length > expected_size - args->written) {
+        args->corrupt = true;
+        return NULL;
+      }
+
+      if (!mTox_FILE_IO_WRITE(args->out_fd, &delta[offset + 5], length)) {
+        args->error = errno;
+        return NULL;
+      }
+
+      crypto_hash_sha256_update(
+        &args->digest_state,
+        &delta[offset + 5],
+        length
+      );
+
+      args->offset  += 5 + length;
+      args->written += length;
+    }
+    else {
+      args->corrupt = true;
+      return NULL;
+    }
+  }
+
+  uint8_t digest[crypto_hash_sha256_BYTES];
+
+  crypto_hash_sha256_final(&args->digest_state, digest);
+
+  args->corrupt =
+    args->written != expected_size ||
+    memcmp(digest, &delta[12], crypto_hash_sha256_BYTES) != 0;
+
+  return NULL;
+}
+
+// Checksum of rsync: it can be rolled over the file byte by byte.
+uint32_t mTox_mDelta_WEAK(const uint8_t *const data, const size_t length)
+{
+  uint32_t a = 0;
+  uint32_t b = 0;
+
+  for (size_t index = 0; index < length; ++index) {
+    a += data[index];
+    b += (length - index) * data[index];
+  }
+
+  return ((b & 0xffff) << 16) | (a & 0xffff);
+}
+
+void mTox_mDelta_STRONG(
+  uint8_t *const strong,
+  const uint8_t *const data,
+  const size_t length
+)
+{
+  crypto_generichash(strong, mTox_mDelta_STRONG_SIZE, data, length, NULL, 0);
+}
+
+uint32_t mTox_mDelta_LOAD32(const uint8_t *const data)
+{
+  return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+         ((uint32_t)data[2] << 8)  |  (uint32_t)data[3];
+}
+
+uint64_t mTox_mDelta_LOAD64(const uint8_t *const data)
+{
+  return ((uint64_t)mTox_mDelta_LOAD32(data) << 32) |
+         mTox_mDelta_LOAD32(&data[4]);
+}
+
+void mTox_mDelta_STORE32(uint8_t *const data, const uint32_t value)
+{
+  data[0] = value >> 24;
+  data[1] = value >> 16;
+  data[2] = value >> 8;
+  data[3] = value;
+}
+
+void mTox_mDelta_STORE64(uint8_t *const data, const uint64_t value)
+{
+  mTox_mDelta_STORE32(data, value >> 32);
+  mTox_mDelta_STORE32(&data[4], value);
+}
+
+// Buffers the data and writes it to the delta file when the buffer is full.
+// Data larger than the buffer is written directly after the buffer.
+bool mTox_mDelta_OUTPUT_WRITE(
+  mTox_mDelta_OUTPUT *const output,
+  const uint8_t *const data,
+  const size_t length
+)
+{
+  if (output->length + length > mTox_mDelta_BUFFER_SIZE) {
+    if (!mTox_mDelta_OUTPUT_FLUSH(output)) {
+      return false;
+    }
+
+    if (length > mTox_mDelta_BUFFER_SIZE) {
+      return mTox_FILE_IO_WRITE(output->fd, data, length);
+    }
+  }
+
+  memcpy(&output->data[output->length], data, length);
+  output->length += length;
+
+  return true;
+}
+
+bool mTox_mDelta_OUTPUT_FLUSH(mTox_mDelta_OUTPUT *const output)
+{
+  const size_t length = output->length;
+
+  output->length = 0;
+
+  return mTox_FILE_IO_WRITE(output->fd, output->data, length);
+}
+
+bool mTox_mDelta_OUTPUT_COPY(
+  mTox_mDelta_OUTPUT *const output,
+  const uint32_t index,
+  const uint32_t count
+)
+{
+  uint8_t op[9];
+
+  op[0] = mTox_mDelta_OP_COPY;
+  mTox_mDelta_STORE32(&op[1], index);
+  mTox_mDelta_STORE32(&op[5], count);
+
+  return mTox_mDelta_OUTPUT_WRITE(output, op, sizeof(op));
+}
+
+bool mTox_mDelta_OUTPUT_LITERAL(
+  mTox_mDelta_OUTPUT *const output,
+  const uint8_t *data,
+  size_t length
+)
+{
+  while (length > 0) {
+    const size_t chunk =
+      length < mTox_mDelta_MAX_LITERAL_SIZE
+      ? length
+      : mTox_mDelta_MAX_LITERAL_SIZE;
+
+    uint8_t op[5];
+
+    op[0] = mTox_mDelta_OP_LITERAL;
+    mTox_mDelta_STORE32(&op[1], chunk);
+
+    if (!mTox_mDelta_OUTPUT_WRITE(output, op, sizeof(op)) ||
+        !mTox_mDelta_OUTPUT_WRITE(output, data, chunk)) {
+      return false;
+    }
+
+    data   += chunk;
+    length -= chunk;
+  }
+
+  return true;
+}
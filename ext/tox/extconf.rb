@@ -52,16 +52,36 @@ cflags '-Wall'
 cflags '-Wextra'
 cflags '-Wno-declaration-after-statement'
 
+pkg_config! 'libsodium'
 pkg_config! 'libtoxcore'
 pkg_config! 'libtoxav'
+pkg_config! 'opusfile'
+pkg_config! 'opus'
 
+have_library! 'sodium'
+have_library! 'z'
 have_library! 'toxcore'
 have_library! 'toxav'
+have_library! 'opusfile'
+have_library! 'opus'
+have_library! 'pthread'
 
 have_header! 'ruby.h'
+have_header! 'ruby/thread.h'
 have_header! 'time.h'
+have_header! 'math.h'
+have_header! 'errno.h'
+have_header! 'fcntl.h'
+have_header! 'unistd.h'
+have_header! 'sys/stat.h'
+have_header! 'sys/mman.h'
+have_header! 'sodium.h'
+have_header! 'zlib.h'
 have_header! 'tox/tox.h'
 have_header! 'tox/toxav.h'
+have_header! 'opus/opusfile.h'
+have_header! 'opus/opus.h'
+have_header! 'pthread.h'
 
 have_struct_member! nil, 'struct timespec', 'tv_sec'
 have_struct_member! nil, 'struct timespec', 'tv_nsec'
@@ -69,7 +89,49 @@ have_struct_member! nil, 'struct timespec', 'tv_nsec'
 have_func! nil, 'free'
 have_func! nil, 'memset'
 have_func! nil, 'sprintf'
+have_func! nil, 'snprintf'
+have_func! nil, 'memchr'
 have_func! nil, 'nanosleep'
+have_func! 'fcntl.h', 'open'
+have_func! 'unistd.h', 'close'
+have_func! 'unistd.h', 'pread'
+have_func! 'unistd.h', 'pwrite'
+have_func! 'sys/stat.h', 'fstat'
+have_func! 'unistd.h', 'write'
+have_func! 'unistd.h', 'lseek'
+have_func! 'sys/mman.h', 'mmap'
+have_func! 'sys/mman.h', 'munmap'
+have_func! 'sys/mman.h', 'madvise'
+have_func! 'unistd.h', 'read'
+have_func! 'unistd.h', 'sysconf'
+have_func! 'ruby/thread.h', 'rb_thread_call_without_gvl'
+have_func! 'ruby/thread.h', 'rb_thread_call_without_gvl2'
+have_func! 'time.h', 'clock_gettime'
+have_func! 'pthread.h', 'pthread_create'
+have_func! 'pthread.h', 'pthread_join'
+have_func! 'pthread.h', 'pthread_once'
+have_func! 'math.h', 'lrintf'
+
+# Optional: frames expose their buffers through memory views since Ruby 3.0.
+have_header 'ruby/memory_view.h'
+
+# Optional: file transfers batch their I/O through io_uring when available.
+if have_header('liburing.h') && have_library('uring')
+  have_func 'io_uring_queue_init', 'liburing.h'
+end
+
+have_type! 'sodium.h', 'crypto_hash_sha256_state'
+
+have_func! 'sodium.h', 'crypto_hash_sha256_init'
+have_func! 'sodium.h', 'crypto_hash_sha256_update'
+have_func! 'sodium.h', 'crypto_hash_sha256_final'
+have_func! 'sodium.h', 'crypto_hash_sha256'
+have_func! 'sodium.h', 'crypto_generichash'
+have_func! 'sodium.h', 'randombytes_buf'
+
+have_func! 'zlib.h', 'compress2'
+have_func! 'zlib.h', 'compressBound'
+have_func! 'zlib.h', 'uncompress'
 
 have_macro! 'tox/tox.h', 'TOX_VERSION_IS_API_COMPATIBLE'
 have_macro! 'tox/tox.h', 'TOX_VERSION_IS_ABI_COMPATIBLE'
@@ -85,6 +147,8 @@ have_type! 'tox/tox.h', 'TOX_ERR_FRIEND_SEND_MESSAGE'
 have_type! 'tox/tox.h', 'TOX_ERR_FILE_SEND'
 have_type! 'tox/tox.h', 'TOX_ERR_FILE_SEND_CHUNK'
 have_type! 'tox/tox.h', 'TOX_ERR_FILE_CONTROL'
+have_type! 'tox/tox.h', 'TOX_ERR_FILE_GET'
+have_type! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET'
 
 have_type! 'tox/tox.h', 'TOX_SAVEDATA_TYPE'
 have_type! 'tox/tox.h', 'TOX_MESSAGE_TYPE'
@@ -101,11 +165,14 @@ have_type! 'tox/tox.h', 'tox_friend_status_cb'
 have_type! 'tox/tox.h', 'tox_file_chunk_request_cb'
 have_type! 'tox/tox.h', 'tox_file_recv_cb'
 have_type! 'tox/tox.h', 'tox_file_recv_chunk_cb'
+have_type! 'tox/tox.h', 'tox_friend_lossless_packet_cb'
 
 have_type! 'tox/toxav.h', 'TOXAV_ERR_NEW'
+have_type! 'tox/toxav.h', 'TOXAV_ERR_CALL'
 have_type! 'tox/toxav.h', 'TOXAV_ERR_ANSWER'
 have_type! 'tox/toxav.h', 'TOXAV_ERR_SEND_FRAME'
 have_type! 'tox/toxav.h', 'TOXAV_ERR_CALL_CONTROL'
+have_type! 'tox/toxav.h', 'TOXAV_ERR_BIT_RATE_SET'
 
 have_type! 'tox/toxav.h', 'TOXAV_CALL_CONTROL'
 have_type! 'tox/toxav.h', 'enum TOXAV_FRIEND_CALL_STATE'
@@ -114,6 +181,8 @@ have_const! 'tox/tox.h', 'TOX_VERSION_MAJOR'
 have_const! 'tox/tox.h', 'TOX_VERSION_MINOR'
 have_const! 'tox/tox.h', 'TOX_VERSION_PATCH'
 have_const! 'tox/tox.h', 'TOX_HASH_LENGTH'
+have_const! 'tox/tox.h', 'TOX_FILE_ID_LENGTH'
+have_const! 'tox/tox.h', 'TOX_MAX_CUSTOM_PACKET_SIZE'
 have_const! 'tox/tox.h', 'TOX_SAVEDATA_TYPE_NONE'
 have_const! 'tox/tox.h', 'TOX_SAVEDATA_TYPE_TOX_SAVE'
 have_const! 'tox/tox.h', 'TOX_SAVEDATA_TYPE_SECRET_KEY'
@@ -195,11 +264,30 @@ have_const! 'tox/tox.h', 'TOX_ERR_FILE_CONTROL_NOT_PAUSED'
 have_const! 'tox/tox.h', 'TOX_ERR_FILE_CONTROL_DENIED'
 have_const! 'tox/tox.h', 'TOX_ERR_FILE_CONTROL_ALREADY_PAUSED'
 have_const! 'tox/tox.h', 'TOX_ERR_FILE_CONTROL_SENDQ'
+have_const! 'tox/tox.h', 'TOX_ERR_FILE_GET_OK'
+have_const! 'tox/tox.h', 'TOX_ERR_FILE_GET_NULL'
+have_const! 'tox/tox.h', 'TOX_ERR_FILE_GET_FRIEND_NOT_FOUND'
+have_const! 'tox/tox.h', 'TOX_ERR_FILE_GET_NOT_FOUND'
+have_const! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET_OK'
+have_const! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET_NULL'
+have_const! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET_FRIEND_NOT_FOUND'
+have_const! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET_FRIEND_NOT_CONNECTED'
+have_const! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET_INVALID'
+have_const! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET_EMPTY'
+have_const! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET_TOO_LONG'
+have_const! 'tox/tox.h', 'TOX_ERR_FRIEND_CUSTOM_PACKET_SENDQ'
 
 have_const! 'tox/toxav.h', 'TOXAV_ERR_NEW_OK'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_NEW_NULL'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_NEW_MALLOC'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_NEW_MULTIPLE'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_OK'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_MALLOC'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_SYNC'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_FRIEND_NOT_FOUND'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_FRIEND_NOT_CONNECTED'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_FRIEND_ALREADY_IN_CALL'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_INVALID_BIT_RATE'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_ANSWER_OK'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_ANSWER_SYNC'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_ANSWER_CODEC_INITIALIZATION'
@@ -219,6 +307,11 @@ have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_CONTROL_SYNC'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_CONTROL_FRIEND_NOT_FOUND'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_CONTROL_FRIEND_NOT_IN_CALL'
 have_const! 'tox/toxav.h', 'TOXAV_ERR_CALL_CONTROL_INVALID_TRANSITION'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_BIT_RATE_SET_OK'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_BIT_RATE_SET_SYNC'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_BIT_RATE_SET_INVALID_BIT_RATE'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_FOUND'
+have_const! 'tox/toxav.h', 'TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_IN_CALL'
 
 have_const! 'tox/toxav.h', 'TOXAV_CALL_CONTROL_RESUME'
 have_const! 'tox/toxav.h', 'TOXAV_CALL_CONTROL_PAUSE'
@@ -309,12 +402,16 @@ have_func! 'tox/tox.h', 'tox_callback_file_chunk_request'
 have_func! 'tox/tox.h', 'tox_callback_file_recv'
 have_func! 'tox/tox.h', 'tox_callback_file_recv_chunk'
 have_func! 'tox/tox.h', 'tox_file_control'
+have_func! 'tox/tox.h', 'tox_file_get_file_id'
+have_func! 'tox/tox.h', 'tox_friend_send_lossless_packet'
+have_func! 'tox/tox.h', 'tox_callback_friend_lossless_packet'
 have_func! 'tox/tox.h', 'tox_callback_self_connection_status'
 
 have_func! 'tox/toxav.h', 'toxav_new'
 have_func! 'tox/toxav.h', 'toxav_kill'
 have_func! 'tox/toxav.h', 'toxav_iteration_interval'
 have_func! 'tox/toxav.h', 'toxav_iterate'
+have_func! 'tox/toxav.h', 'toxav_call'
 have_func! 'tox/toxav.h', 'toxav_answer'
 have_func! 'tox/toxav.h', 'toxav_audio_send_frame'
 have_func! 'tox/toxav.h', 'toxav_video_send_frame'
@@ -323,5 +420,20 @@ have_func! 'tox/toxav.h', 'toxav_callback_call_state'
 have_func! 'tox/toxav.h', 'toxav_callback_audio_receive_frame'
 have_func! 'tox/toxav.h', 'toxav_callback_video_receive_frame'
 have_func! 'tox/toxav.h', 'toxav_call_control'
+have_func! 'tox/toxav.h', 'toxav_audio_set_bit_rate'
+have_func! 'tox/toxav.h', 'toxav_video_set_bit_rate'
+have_func! 'tox/toxav.h', 'toxav_callback_audio_bit_rate'
+have_func! 'tox/toxav.h', 'toxav_callback_video_bit_rate'
+
+have_func! 'opus/opusfile.h', 'op_open_file'
+have_func! 'opus/opusfile.h', 'op_read_stereo'
+have_func! 'opus/opusfile.h', 'op_pcm_seek'
+have_func! 'opus/opusfile.h', 'op_free'
+
+have_func! 'opus/opus.h', 'opus_encoder_create'
+have_func! 'opus/opus.h', 'opus_encoder_ctl'
+have_func! 'opus/opus.h', 'opus_encode'
+have_func! 'opus/opus.h', 'opus_encoder_destroy'
+have_func! 'opus/opus.h', 'opus_get_version_string'
 
 create_makefile 'tox/tox' or exit 1
@@ -0,0 +1,717 @@
+#include "tox.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <ruby/thread.h>
+
+#ifdef HAVE_IO_URING_QUEUE_INIT
+#include <liburing.h>
+#endif
+
+typedef struct {
+  mTox_FILE_IO_WINDOW *window;
+
+  uint8_t  *data;
+  uint64_t  offset;
+  size_t    length;
+  size_t    requested;
+  bool      pending;
+} mTox_FILE_IO_BUFFER;
+
+struct mTox_FILE_IO {
+  mTox_FILE_IO_BACKEND backend;
+
+  size_t windows;
+  size_t queued;
+  size_t pending;
+
+#ifdef HAVE_IO_URING_QUEUE_INIT
+  struct io_uring ring;
+#endif
+};
+
+struct mTox_FILE_IO_WINDOW {
+  mTox_FILE_IO *io;
+
+  int      fd;
+  uint64_t size;
+  bool     write;
+  bool     failed;
+
+  size_t              current;
+  mTox_FILE_IO_BUFFER buffers[2];
+};
+
+// Private functions
+
+static ssize_t mTox_FILE_IO_PREAD(int fd, uint8_t *data, size_t length, uint64_t offset);
+static bool    mTox_FILE_IO_PWRITE(int fd, const uint8_t *data, size_t length, uint64_t offset);
+
+static void mTox_FILE_IO_REAP(mTox_FILE_IO *io);
+static void mTox_FILE_IO_WAIT(mTox_FILE_IO *io, mTox_FILE_IO_BUFFER *buffer);
+
+static void mTox_FILE_IO_BUFFER_COMPLETE(mTox_FILE_IO_BUFFER *buffer, int result);
+static bool mTox_FILE_IO_BUFFER_QUEUE(mTox_FILE_IO_BUFFER *buffer, uint64_t offset, size_t length);
+
+static mTox_FILE_IO_BUFFER *mTox_FILE_IO_WINDOW_FIND(mTox_FILE_IO_WINDOW *window, uint64_t position);
+
+static void mTox_FILE_IO_WINDOW_READ_AHEAD(mTox_FILE_IO_WINDOW *window, const mTox_FILE_IO_BUFFER *buffer);
+static void mTox_FILE_IO_WINDOW_FLUSH(mTox_FILE_IO_WINDOW *window);
+
+static void  mTox_FILE_IO_INTERRUPT(void *data);
+static VALUE mTox_FILE_IO_CHECK_INTS(VALUE arg);
+
+/*************************************************************
+ * Engine
+ *************************************************************/
+
+mTox_FILE_IO *mTox_FILE_IO_NEW(const mTox_FILE_IO_BACKEND backend)
+{
+  mTox_FILE_IO *const io = ALLOC(mTox_FILE_IO);
+
+  io->backend = mTox_FILE_IO_BACKEND_PREAD;
+  io->windows = 0;
+  io->queued  = 0;
+  io->pending = 0;
+
+#ifdef HAVE_IO_URING_QUEUE_INIT
+  if (backend == mTox_FILE_IO_BACKEND_IO_URING &&
+      io_uring_queue_init(mTox_FILE_IO_RING_ENTRIES, &io->ring, 0) == 0) {
+    io->backend = mTox_FILE_IO_BACKEND_IO_URING;
+  }
+#endif
+
+  return io;
+}
+
+void mTox_FILE_IO_FREE(mTox_FILE_IO *const io)
+{
+  if (!io) {
+    return;
+  }
+
+#ifdef HAVE_IO_URING_QUEUE_INIT
+  if (io->backend == mTox_FILE_IO_BACKEND_IO_URING) {
+    io_uring_queue_exit(&io->ring);
+  }
+#endif
+
+  free(io);
+}
+
+mTox_FILE_IO_BACKEND mTox_FILE_IO_GET_BACKEND(const mTox_FILE_IO *const io)
+{
+  return io->backend;
+}
+
+// The kernel or a seccomp profile can refuse io_uring even when liburing
+// was found at build time, so this is checked once with a real ring.
+bool mTox_FILE_IO_BACKEND_AVAILABLE(const mTox_FILE_IO_BACKEND backend)
+{
+  if (backend == mTox_FILE_IO_BACKEND_PREAD) {
+    return true;
+  }
+
+#ifdef HAVE_IO_URING_QUEUE_INIT
+  static int available = -1;
+
+  if (available == -1) {
+    struct io_uring ring;
+
+    available = io_uring_queue_init(1, &ring, 0) == 0;
+
+    if (available) {
+      io_uring_queue_exit(&ring);
+    }
+  }
+
+  return available;
+#else
+  return false;
+#endif
+}
+
+// Called once per client iteration, so the operations queued by all
+// transfers during the iteration take a single system call.
+void mTox_FILE_IO_SUBMIT(mTox_FILE_IO *const io)
+{
+  if (!io || io->queued == 0) {
+    return;
+  }
+
+#ifdef HAVE_IO_URING_QUEUE_INIT
+  if (io_uring_submit(&io->ring) >= 0) {
+    io->queued = 0;
+  }
+#endif
+
+  mTox_FILE_IO_REAP(io);
+}
+
+/*************************************************************
+ * Windows
+ *************************************************************/
+
+mTox_FILE_IO_WINDOW *mTox_FILE_IO_WINDOW_NEW(
+  mTox_FILE_IO *const io,
+  const int fd,
+  const uint64_t size,
+  const bool write
+)
+{
+  mTox_FILE_IO_WINDOW *const window = ALLOC(mTox_FILE_IO_WINDOW);
+
+  window->io      = io;
+  window->fd      = fd;
+  window->size    = size;
+  window->write   = write;
+  window->failed  = false;
+  window->current = 0;
+
+  for (size_t i = 0; i < 2; ++i) {
+    mTox_FILE_IO_BUFFER *const buffer = &window->buffers[i];
+
+    buffer->window    = window;
+    buffer->data      = ALLOC_N(uint8_t, mTox_FILE_IO_WINDOW_BUFFER_SIZE);
+    buffer->offset    = 0;
+    buffer->length    = 0;
+    buffer->requested = 0;
+    buffer->pending   = false;
+  }
+
+  ++io->windows;
+
+  return window;
+}
+
+// Flushes buffered writes, waits for operations in flight and closes the
+// file. Returns false if any read or write of the window has failed.
+bool mTox_FILE_IO_WINDOW_CLOSE(mTox_FILE_IO_WINDOW *const window)
+{
+  if (!window) {
+    return true;
+  }
+
+  mTox_FILE_IO *const io = window->io;
+
+  if (window->write) {
+    mTox_FILE_IO_WINDOW_FLUSH(window);
+  }
+
+  for (size_t i = 0; i < 2; ++i) {
+    mTox_FILE_IO_WAIT(io, &window->buffers[i]);
+    free(window->buffers[i].data);
+  }
+
+  if (close(window->fd) != 0 && window->write) {
+    window->failed = true;
+  }
+
+  const bool result = !window->failed;
+
+  --io->windows;
+
+  free(window);
+
+  return result;
+}
+
+bool mTox_FILE_IO_WINDOW_READ(
+  mTox_FILE_IO_WINDOW *const window,
+  const uint64_t position,
+  uint8_t *const data,
+  const size_t length
+)
+{
+  if (window->failed) {
+    return false;
+  }
+
+  mTox_FILE_IO *const io = window->io;
+
+  mTox_FILE_IO_REAP(io);
+
+  mTox_FILE_IO_BUFFER *buffer = NULL;
+
+  size_t copied = 0;
+
+  while (copied < length) {
+    const uint64_t offset = position + copied;
+
+    buffer = mTox_FILE_IO_WINDOW_FIND(window, offset);
+
+    if (buffer && buffer->pending) {
+      mTox_FILE_IO_WAIT(io, buffer);
+      continue;
+    }
+
+    // Not read ahead (the first chunk, a seek or a short read), so the
+    // chunk is loaded synchronously together with the rest of a buffer.
+    if (!buffer) {
+      buffer = &window->buffers[window->current];
+
+      mTox_FILE_IO_WAIT(io, buffer);
+
+      const ssize_t result = mTox_FILE_IO_PREAD(
+        window->fd,
+        buffer->data,
+        mTox_FILE_IO_WINDOW_BUFFER_SIZE,
+        offset
+      );
+
+      if (result <= 0) {
+        window->failed = true;
+        return false;
+      }
+
+      buffer->offset = offset;
+      buffer->length = result;
+    }
+
+    const size_t available = buffer->offset + buffer->length - offset;
+    const size_t count =
+      length - copied < available ? length - copied : available;
+
+    memcpy(&data[copied], &buffer->data[offset - buffer->offset], count);
+
+    copied += count;
+
+    window->current = buffer == &window->buffers[0] ? 0 : 1;
+  }
+
+  if (buffer) {
+    mTox_FILE_IO_WINDOW_READ_AHEAD(window, buffer);
+  }
+
+  return true;
+}
+
+bool mTox_FILE_IO_WINDOW_WRITE(
+  mTox_FILE_IO_WINDOW *const window,
+  const uint64_t position,
+  const uint8_t *const data,
+  const size_t length
+)
+{
+  if (window->failed) {
+    return false;
+  }
+
+  mTox_FILE_IO_REAP(window->io);
+
+  size_t copied = 0;
+
+  while (copied < length) {
+    mTox_FILE_IO_BUFFER *const buffer = &window->buffers[window->current];
+
+    const uint64_t offset = position + copied;
+
+    if (buffer->length > 0 && offset != buffer->offset + buffer->length) {
+      mTox_FILE_IO_WINDOW_FLUSH(window);
+      continue;
+    }
+
+    if (buffer->length == 0) {
+      buffer->offset = offset;
+    }
+
+    const size_t available = mTox_FILE_IO_WINDOW_BUFFER_SIZE - buffer->length;
+    const size_t count =
+      length - copied < available ? length - copied : available;
+
+    memcpy(&buffer->data[buffer->length], &data[copied], count);
+
+    buffer->length += count;
+    copied         += count;
+
+    if (buffer->length == mTox_FILE_IO_WINDOW_BUFFER_SIZE) {
+      mTox_FILE_IO_WINDOW_FLUSH(window);
+    }
+  }
+
+  return !window->failed;
+}
+
+/*************************************************************
+ * Whole files
+ *************************************************************/
+
+bool mTox_FILE_IO_MAP(
+  const int fd,
+  const uint8_t **const data,
+  size_t *const size
+)
+{
+  struct stat stat_data;
+
+  if (fstat(fd, &stat_data) != 0) {
+    return false;
+  }
+
+  if (!S_ISREG(stat_data.st_mode)) {
+    errno = EINVAL;
+    return false;
+  }
+
+  *size = stat_data.st_size;
+  *data = NULL;
+
+  if (*size == 0) {
+    return true;
+  }
+
+  void *const result = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  if (result == MAP_FAILED) {
+    return false;
+  }
+
+  madvise(result, *size, MADV_SEQUENTIAL);
+
+  *data = result;
+
+  return true;
+}
+
+bool mTox_FILE_IO_WRITE(
+  const int fd,
+  const uint8_t *data,
+  size_t length
+)
+{
+  while (length > 0) {
+    const ssize_t result = write(fd, data, length);
+
+    if (result == -1 && errno == EINTR) {
+      continue;
+    }
+
+    if (result <= 0) {
+      return false;
+    }
+
+    data   += result;
+    length -= result;
+  }
+
+  return true;
+}
+
+/*************************************************************
+ * Work without the GVL
+ *************************************************************/
+
+// The work has to return once "interrupted" is set and continue where it
+// stopped when it is called again. Interrupts of the thread are handled in
+// between: exceptions stop the work, anything else (like signal handlers
+// or spurious wakeups) resumes it.
+int mTox_FILE_IO_WITHOUT_GVL(
+  void *(*const func)(void *data),
+  void *const data,
+  volatile bool *const interrupted,
+  const bool *const finished
+)
+{
+  while (!*finished) {
+    *interrupted = false;
+
+    rb_thread_call_without_gvl2(
+      func,
+      data,
+      mTox_FILE_IO_INTERRUPT,
+      (void*)interrupted
+    );
+
+    if (*finished) {
+      break;
+    }
+
+    int state = 0;
+
+    rb_protect(mTox_FILE_IO_CHECK_INTS, Qnil, &state);
+
+    if (state) {
+      return state;
+    }
+  }
+
+  return 0;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+ssize_t mTox_FILE_IO_PREAD(
+  const int fd,
+  uint8_t *const data,
+  const size_t length,
+  const uint64_t offset
+)
+{
+  size_t done = 0;
+
+  while (done < length) {
+    const ssize_t result = pread(fd, &data[done], length - done, offset + done);
+
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (result < 0) {
+      return -1;
+    }
+
+    if (result == 0) {
+      break;
+    }
+
+    done += result;
+  }
+
+  return done;
+}
+
+bool mTox_FILE_IO_PWRITE(
+  const int fd,
+  const uint8_t *const data,
+  const size_t length,
+  const uint64_t offset
+)
+{
+  size_t done = 0;
+
+  while (done < length) {
+    const ssize_t result =
+      pwrite(fd, &data[done], length - done, offset + done);
+
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (result <= 0) {
+      return false;
+    }
+
+    done += result;
+  }
+
+  return true;
+}
+
+void mTox_FILE_IO_REAP(mTox_FILE_IO *const io)
+{
+#ifdef HAVE_IO_URING_QUEUE_INIT
+  if (io->backend != mTox_FILE_IO_BACKEND_IO_URING) {
+    return;
+  }
+
+  struct io_uring_cqe *cqe;
+
+  while (io->pending > 0 && io_uring_peek_cqe(&io->ring, &cqe) == 0) {
+    mTox_FILE_IO_BUFFER *const buffer = io_uring_cqe_get_data(cqe);
+    const int result = cqe->res;
+
+    io_uring_cqe_seen(&io->ring, cqe);
+
+    --io->pending;
+
+    mTox_FILE_IO_BUFFER_COMPLETE(buffer, result);
+  }
+#endif
+}
+
+// Buffers must not be reused or freed while the kernel still owns them.
+void mTox_FILE_IO_WAIT(
+  mTox_FILE_IO *const io,
+  mTox_FILE_IO_BUFFER *const buffer
+)
+{
+#ifdef HAVE_IO_URING_QUEUE_INIT
+  while (buffer->pending) {
+    const int result = io_uring_submit_and_wait(&io->ring, 1);
+
+    if (result >= 0) {
+      io->queued = 0;
+    }
+
+    mTox_FILE_IO_REAP(io);
+  }
+#endif
+}
+
+void mTox_FILE_IO_BUFFER_COMPLETE(
+  mTox_FILE_IO_BUFFER *const buffer,
+  const int result
+)
+{
+  mTox_FILE_IO_WINDOW *const window = buffer->window;
+
+  buffer->pending = false;
+
+  if (!window->write) {
+    // A failed read ahead is retried synchronously when the data is needed.
+    buffer->length = result > 0 ? (size_t)result : 0;
+    return;
+  }
+
+  if (result < 0) {
+    window->failed = true;
+  }
+  else if ((size_t)result < buffer->requested &&
+           !mTox_FILE_IO_PWRITE(
+             window->fd,
+             &buffer->data[result],
+             buffer->requested - result,
+             buffer->offset + result
+           )) {
+    window->failed = true;
+  }
+
+  buffer->length = 0;
+}
+
+// Returns false when the operation can not be queued, so the caller has to
+// do it synchronously.
+bool mTox_FILE_IO_BUFFER_QUEUE(
+  mTox_FILE_IO_BUFFER *const buffer,
+  const uint64_t offset,
+  const size_t length
+)
+{
+#ifdef HAVE_IO_URING_QUEUE_INIT
+  mTox_FILE_IO_WINDOW *const window = buffer->window;
+  mTox_FILE_IO *const io = window->io;
+
+  if (io->backend != mTox_FILE_IO_BACKEND_IO_URING ||
+      io->pending >= mTox_FILE_IO_RING_ENTRIES) {
+    return false;
+  }
+
+  struct io_uring_sqe *sqe = io_uring_get_sqe(&io->ring);
+
+  if (!sqe) {
+    if (io_uring_submit(&io->ring) >= 0) {
+      io->queued = 0;
+    }
+
+    sqe = io_uring_get_sqe(&io->ring);
+  }
+
+  if (!sqe) {
+    return false;
+  }
+
+  if (window->write) {
+    io_uring_prep_write(sqe, window->fd, buffer->data, length, offset);
+  }
+  else {
+    io_uring_prep_read(sqe, window->fd, buffer->data, length, offset);
+  }
+
+  io_uring_sqe_set_data(sqe, buffer);
+
+  buffer->offset    = offset;
+  buffer->requested = length;
+  buffer->pending   = true;
+
+  ++io->queued;
+  ++io->pending;
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+mTox_FILE_IO_BUFFER *mTox_FILE_IO_WINDOW_FIND(
+  mTox_FILE_IO_WINDOW *const window,
+  const uint64_t position
+)
+{
+  for (size_t i = 0; i < 2; ++i) {
+    mTox_FILE_IO_BUFFER *const buffer = &window->buffers[i];
+
+    const size_t length = buffer->pending ? buffer->requested : buffer->length;
+
+    if (position >= buffer->offset && position - buffer->offset < length) {
+      return buffer;
+    }
+  }
+
+  return NULL;
+}
+
+// Chunks are requested in order, so once reading moves into a buffer the
+// other one is free to receive the data which follows it.
+void mTox_FILE_IO_WINDOW_READ_AHEAD(
+  mTox_FILE_IO_WINDOW *const window,
+  const mTox_FILE_IO_BUFFER *const buffer
+)
+{
+  const uint64_t offset = buffer->offset + buffer->length;
+
+  if (buffer->length < mTox_FILE_IO_WINDOW_BUFFER_SIZE ||
+      offset >= window->size) {
+    return;
+  }
+
+  mTox_FILE_IO_BUFFER *const other =
+    &window->buffers[buffer == &window->buffers[0] ? 1 : 0];
+
+  if (other->pending || mTox_FILE_IO_WINDOW_FIND(window, offset) == other) {
+    return;
+  }
+
+  const uint64_t left = window->size - offset;
+
+  mTox_FILE_IO_BUFFER_QUEUE(
+    other,
+    offset,
+    left < mTox_FILE_IO_WINDOW_BUFFER_SIZE ?
+      left : mTox_FILE_IO_WINDOW_BUFFER_SIZE
+  );
+}
+
+// Writes the current buffer behind and switches to the other one.
+void mTox_FILE_IO_WINDOW_FLUSH(mTox_FILE_IO_WINDOW *const window)
+{
+  mTox_FILE_IO_BUFFER *const buffer = &window->buffers[window->current];
+
+  if (buffer->length == 0) {
+    return;
+  }
+
+  if (!mTox_FILE_IO_BUFFER_QUEUE(buffer, buffer->offset, buffer->length)) {
+    if (!mTox_FILE_IO_PWRITE(
+          window->fd,
+          buffer->data,
+          buffer->length,
+          buffer->offset
+        )) {
+      window->failed = true;
+    }
+
+    buffer->length = 0;
+  }
+
+  window->current = window->current == 0 ? 1 : 0;
+
+  mTox_FILE_IO_WAIT(window->io, &window->buffers[window->current]);
+}
+
+void mTox_FILE_IO_INTERRUPT(void *const data)
+{
+  volatile bool *const interrupted = data;
+
+  *interrupted = true;
+}
+
+VALUE mTox_FILE_IO_CHECK_INTS(const VALUE arg)
+{
+  rb_thread_check_ints();
+
+  return Qnil;
+}
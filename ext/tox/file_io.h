@@ -0,0 +1,67 @@
+// Native file I/O for transfers which read from or write to local files.
+//
+// Toxcore requests and delivers file data in chunks of about 1 KiB, so
+// every transfer has a window of two buffers: chunks are copied from the
+// buffers and whole buffers are read ahead or written behind. With
+// io_uring the buffer operations of all transfers are queued in one ring
+// and submitted once per iteration; without it they fall back to plain
+// "pread(2)" and "pwrite(2)" calls on the window buffers.
+
+#define mTox_FILE_IO_WINDOW_BUFFER_SIZE (128 * 1024)
+#define mTox_FILE_IO_RING_ENTRIES       256
+
+typedef enum {
+  mTox_FILE_IO_BACKEND_PREAD,
+  mTox_FILE_IO_BACKEND_IO_URING,
+} mTox_FILE_IO_BACKEND;
+
+typedef struct mTox_FILE_IO        mTox_FILE_IO;
+typedef struct mTox_FILE_IO_WINDOW mTox_FILE_IO_WINDOW;
+
+mTox_FILE_IO *mTox_FILE_IO_NEW(mTox_FILE_IO_BACKEND backend);
+void          mTox_FILE_IO_FREE(mTox_FILE_IO *io);
+
+mTox_FILE_IO_BACKEND mTox_FILE_IO_GET_BACKEND(const mTox_FILE_IO *io);
+bool                 mTox_FILE_IO_BACKEND_AVAILABLE(mTox_FILE_IO_BACKEND backend);
+
+void mTox_FILE_IO_SUBMIT(mTox_FILE_IO *io);
+
+mTox_FILE_IO_WINDOW *mTox_FILE_IO_WINDOW_NEW(
+  mTox_FILE_IO *io,
+  int fd,
+  uint64_t size,
+  bool write
+);
+
+bool mTox_FILE_IO_WINDOW_CLOSE(mTox_FILE_IO_WINDOW *window);
+
+bool mTox_FILE_IO_WINDOW_READ(
+  mTox_FILE_IO_WINDOW *window,
+  uint64_t position,
+  uint8_t *data,
+  size_t length
+);
+
+bool mTox_FILE_IO_WINDOW_WRITE(
+  mTox_FILE_IO_WINDOW *window,
+  uint64_t position,
+  const uint8_t *data,
+  size_t length
+);
+
+// Maps a whole regular file for reading; "data" is NULL for empty files.
+// Returns false and leaves errno set on failure.
+bool mTox_FILE_IO_MAP(int fd, const uint8_t **data, size_t *size);
+
+// Writes all of the data, retrying short writes.
+bool mTox_FILE_IO_WRITE(int fd, const uint8_t *data, size_t length);
+
+// Runs work on whole files without the GVL until it sets "finished".
+// Returns the tag of an exception to raise with "rb_jump_tag" once the
+// resources of the work have been released, or 0.
+int mTox_FILE_IO_WITHOUT_GVL(
+  void *(*func)(void *data),
+  void *data,
+  volatile bool *interrupted,
+  const bool *finished
+);
@@ -1,5 +1,10 @@
 #include "tox.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 // Public methods
 
 static VALUE mTox_cFriend_exist_QUESTION(VALUE self);
@@ -9,6 +14,13 @@ static VALUE mTox_cFriend_name(VALUE self);
 static VALUE mTox_cFriend_status(VALUE self);
 static VALUE mTox_cFriend_status_message(VALUE self);
 static VALUE mTox_cFriend_send_file(VALUE self, VALUE file_kind, VALUE file_size, VALUE filename);
+static VALUE mTox_cFriend_send_avatar(VALUE self);
+static VALUE mTox_cFriend_send_lossless_packet(VALUE self, VALUE data);
+
+// Private methods
+
+static VALUE mTox_cFriend_send_local_file_with(VALUE self, VALUE path, VALUE filename, VALUE file_id, VALUE compress);
+static VALUE mTox_cFriend_call_with(VALUE self, VALUE audio_video, VALUE audio_bit_rate, VALUE video_bit_rate);
 
 /*************************************************************
  * Initialization
@@ -26,6 +38,14 @@ void mTox_cFriend_INIT()
   rb_define_method(mTox_cFriend, "status",         mTox_cFriend_status,         0);
   rb_define_method(mTox_cFriend, "status_message", mTox_cFriend_status_message, 0);
   rb_define_method(mTox_cFriend, "send_file",      mTox_cFriend_send_file,      3);
+  rb_define_method(mTox_cFriend, "send_avatar",    mTox_cFriend_send_avatar,    0);
+
+  rb_define_method(mTox_cFriend, "send_lossless_packet", mTox_cFriend_send_lossless_packet, 1);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cFriend, "send_local_file_with", mTox_cFriend_send_local_file_with, 4);
+  rb_define_private_method(mTox_cFriend, "call_with",            mTox_cFriend_call_with,            3);
 }
 
 /*************************************************************
@@ -434,6 +454,350 @@ VALUE mTox_cFriend_send_file(const VALUE self, const VALUE file_kind, const VALU
     RAISE_FUNC_RESULT("tox_file_send");
   }
 
+  mTox_cOutFriendFile_TRANSFER_DELETE(
+    client_cdata,
+    friend_number_data,
+    file_number_data
+  );
+
+  const VALUE file_number = LONG2FIX(file_number_data);
+
+  const VALUE friend_out_file =
+    rb_funcall(mTox_cOutFriendFile, rb_intern("new"), 2,
+               self,
+               file_number);
+
+  return friend_out_file;
+}
+
+// Tox::Friend#send_avatar
+VALUE mTox_cFriend_send_avatar(const VALUE self)
+{
+  const VALUE client = rb_iv_get(self, "@client");
+
+  CDATA(client, mTox_cClient_CDATA, client_cdata);
+
+  const VALUE friend_number = rb_iv_get(self, "@number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  // Without an avatar a transfer of zero size tells the friend
+  // that there is none.
+  mTox_cClient_AVATAR *const avatar = client_cdata->avatar;
+
+  TOX_ERR_FILE_SEND file_send_error;
+
+  const uint32_t file_number_data = tox_file_send(
+    client_cdata->tox,
+    friend_number_data,
+    TOX_FILE_KIND_AVATAR,
+    avatar ? avatar->size : 0,
+    avatar ? avatar->hash : NULL,
+    NULL,
+    0,
+    &file_send_error
+  );
+
+  switch (file_send_error) {
+    case TOX_ERR_FILE_SEND_OK:
+      break;
+    case TOX_ERR_FILE_SEND_NULL:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_eNullError,
+        "TOX_ERR_FILE_SEND_NULL"
+      );
+    case TOX_ERR_FILE_SEND_FRIEND_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_cFriend_eNotFoundError,
+        "TOX_ERR_FILE_SEND_FRIEND_NOT_FOUND"
+      );
+    case TOX_ERR_FILE_SEND_FRIEND_NOT_CONNECTED:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_cFriend_eNotConnectedError,
+        "TOX_ERR_FILE_SEND_FRIEND_NOT_CONNECTED"
+      );
+    case TOX_ERR_FILE_SEND_NAME_TOO_LONG:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_cOutFriendFile_eNameTooLongError,
+        "TOX_ERR_FILE_SEND_NAME_TOO_LONG"
+      );
+    case TOX_ERR_FILE_SEND_TOO_MANY:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_cOutFriendFile_eTooManyError,
+        "TOX_ERR_FILE_SEND_TOO_MANY"
+      );
+    default:
+      RAISE_FUNC_ERROR_DEFAULT("tox_file_send");
+  }
+
+  if (file_number_data == UINT32_MAX) {
+    RAISE_FUNC_RESULT("tox_file_send");
+  }
+
+  if (avatar) {
+    mTox_cOutFriendFile_TRANSFER *const transfer =
+      mTox_cOutFriendFile_TRANSFER_GET(
+        client_cdata,
+        friend_number_data,
+        file_number_data,
+        true
+      );
+
+    mTox_cClient_AVATAR_RELEASE(transfer->avatar);
+
+    ++avatar->refs;
+    transfer->avatar = avatar;
+  }
+
+  const VALUE file_number = LONG2FIX(file_number_data);
+
+  const VALUE friend_out_file =
+    rb_funcall(mTox_cOutFriendFile, rb_intern("new"), 2,
+               self,
+               file_number);
+
+  return friend_out_file;
+}
+
+// Tox::Friend#send_lossless_packet
+VALUE mTox_cFriend_send_lossless_packet(const VALUE self, const VALUE data)
+{
+  Check_Type(data, T_STRING);
+
+  const VALUE client = rb_iv_get(self, "@client");
+  const VALUE number = rb_iv_get(self, "@number");
+
+  CDATA(client, mTox_cClient_CDATA, client_cdata);
+
+  TOX_ERR_FRIEND_CUSTOM_PACKET error;
+
+  const bool result = tox_friend_send_lossless_packet(
+    client_cdata->tox,
+    NUM2ULONG(number),
+    RSTRING_PTR(data),
+    RSTRING_LEN(data),
+    &error
+  );
+
+  switch (error) {
+    case TOX_ERR_FRIEND_CUSTOM_PACKET_OK:
+      break;
+    case TOX_ERR_FRIEND_CUSTOM_PACKET_NULL:
+      RAISE_FUNC_ERROR(
+        "tox_friend_send_lossless_packet",
+        mTox_eNullError,
+        "TOX_ERR_FRIEND_CUSTOM_PACKET_NULL"
+      );
+    case TOX_ERR_FRIEND_CUSTOM_PACKET_FRIEND_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "tox_friend_send_lossless_packet",
+        mTox_cFriend_eNotFoundError,
+        "TOX_ERR_FRIEND_CUSTOM_PACKET_FRIEND_NOT_FOUND"
+      );
+    case TOX_ERR_FRIEND_CUSTOM_PACKET_FRIEND_NOT_CONNECTED:
+      RAISE_FUNC_ERROR(
+        "tox_friend_send_lossless_packet",
+        mTox_cFriend_eNotConnectedError,
+        "TOX_ERR_FRIEND_CUSTOM_PACKET_FRIEND_NOT_CONNECTED"
+      );
+    case TOX_ERR_FRIEND_CUSTOM_PACKET_INVALID:
+      RAISE_FUNC_ERROR(
+        "tox_friend_send_lossless_packet",
+        rb_eArgError,
+        "TOX_ERR_FRIEND_CUSTOM_PACKET_INVALID"
+      );
+    case TOX_ERR_FRIEND_CUSTOM_PACKET_EMPTY:
+      RAISE_FUNC_ERROR(
+        "tox_friend_send_lossless_packet",
+        rb_eArgError,
+        "TOX_ERR_FRIEND_CUSTOM_PACKET_EMPTY"
+      );
+    case TOX_ERR_FRIEND_CUSTOM_PACKET_TOO_LONG:
+      RAISE_FUNC_ERROR(
+        "tox_friend_send_lossless_packet",
+        rb_eArgError,
+        "TOX_ERR_FRIEND_CUSTOM_PACKET_TOO_LONG"
+      );
+    case TOX_ERR_FRIEND_CUSTOM_PACKET_SENDQ:
+      RAISE_FUNC_ERROR(
+        "tox_friend_send_lossless_packet",
+        mTox_eSendQueueError,
+        "TOX_ERR_FRIEND_CUSTOM_PACKET_SENDQ"
+      );
+    default:
+      RAISE_FUNC_ERROR_DEFAULT("tox_friend_send_lossless_packet");
+  }
+
+  if (!result) {
+    RAISE_FUNC_RESULT("tox_friend_send_lossless_packet");
+  }
+
+  return Qnil;
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::Friend#send_local_file_with
+VALUE mTox_cFriend_send_local_file_with(
+  const VALUE self,
+  const VALUE path,
+  const VALUE filename,
+  const VALUE file_id,
+  const VALUE compress
+)
+{
+  Check_Type(path,     T_STRING);
+  Check_Type(filename, T_STRING);
+
+  if (Qnil != file_id) {
+    Check_Type(file_id, T_STRING);
+
+    if (RSTRING_LEN(file_id) != TOX_FILE_ID_LENGTH) {
+      rb_raise(
+        rb_eArgError,
+        "file id should be %d bytes long",
+        TOX_FILE_ID_LENGTH
+      );
+    }
+  }
+
+  const VALUE client = rb_iv_get(self, "@client");
+
+  CDATA(client, mTox_cClient_CDATA, client_cdata);
+
+  const VALUE friend_number = rb_iv_get(self, "@number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  const int fd = open(StringValueCStr(path), O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    rb_sys_fail_str(path);
+  }
+
+  struct stat file_stat;
+
+  if (fstat(fd, &file_stat) != 0) {
+    const int fstat_errno = errno;
+    close(fd);
+    errno = fstat_errno;
+    rb_sys_fail_str(path);
+  }
+
+  if (!S_ISREG(file_stat.st_mode)) {
+    close(fd);
+    rb_raise(rb_eArgError, "expected a regular file");
+  }
+
+  const uint64_t file_size_data = file_stat.st_size;
+
+  // Compressed files are streams of unknown size, compressed as chunks are
+  // requested. Their file ids carry the original size.
+  uint8_t compressed_file_id_data[TOX_FILE_ID_LENGTH];
+
+  if (RTEST(compress)) {
+    mTox_COMPRESSION_FILE_ID(compressed_file_id_data, file_size_data);
+  }
+
+  const uint8_t *const file_id_data =
+    RTEST(compress) ? compressed_file_id_data :
+    Qnil == file_id ? NULL                    :
+                      (const uint8_t*)RSTRING_PTR(file_id);
+
+  TOX_ERR_FILE_SEND file_send_error;
+
+  const uint32_t file_number_data = tox_file_send(
+    client_cdata->tox,
+    friend_number_data,
+    TOX_FILE_KIND_DATA,
+    RTEST(compress) ? UINT64_MAX : file_size_data,
+    file_id_data,
+    RSTRING_PTR(filename),
+    RSTRING_LEN(filename),
+    &file_send_error
+  );
+
+  if (file_send_error != TOX_ERR_FILE_SEND_OK ||
+      file_number_data == UINT32_MAX) {
+    close(fd);
+  }
+
+  switch (file_send_error) {
+    case TOX_ERR_FILE_SEND_OK:
+      break;
+    case TOX_ERR_FILE_SEND_NULL:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_eNullError,
+        "TOX_ERR_FILE_SEND_NULL"
+      );
+    case TOX_ERR_FILE_SEND_FRIEND_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_cFriend_eNotFoundError,
+        "TOX_ERR_FILE_SEND_FRIEND_NOT_FOUND"
+      );
+    case TOX_ERR_FILE_SEND_FRIEND_NOT_CONNECTED:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_cFriend_eNotConnectedError,
+        "TOX_ERR_FILE_SEND_FRIEND_NOT_CONNECTED"
+      );
+    case TOX_ERR_FILE_SEND_NAME_TOO_LONG:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_cOutFriendFile_eNameTooLongError,
+        "TOX_ERR_FILE_SEND_NAME_TOO_LONG"
+      );
+    case TOX_ERR_FILE_SEND_TOO_MANY:
+      RAISE_FUNC_ERROR(
+        "tox_file_send",
+        mTox_cOutFriendFile_eTooManyError,
+        "TOX_ERR_FILE_SEND_TOO_MANY"
+      );
+    default:
+      RAISE_FUNC_ERROR_DEFAULT("tox_file_send");
+  }
+
+  if (file_number_data == UINT32_MAX) {
+    RAISE_FUNC_RESULT("tox_file_send");
+  }
+
+  mTox_cOutFriendFile_TRANSFER_DELETE(
+    client_cdata,
+    friend_number_data,
+    file_number_data
+  );
+
+  mTox_cOutFriendFile_TRANSFER *const transfer =
+    mTox_cOutFriendFile_TRANSFER_GET(
+      client_cdata,
+      friend_number_data,
+      file_number_data,
+      true
+    );
+
+  mTox_FILE_IO_WINDOW *const window = mTox_FILE_IO_WINDOW_NEW(
+    mTox_cClient_FILE_IO(client_cdata),
+    fd,
+    file_size_data,
+    false
+  );
+
+  if (RTEST(compress)) {
+    transfer->encoder = mTox_COMPRESSION_ENCODER_NEW(window, file_size_data);
+  }
+  else {
+    transfer->window = window;
+  }
+
   const VALUE file_number = LONG2FIX(file_number_data);
 
   const VALUE friend_out_file =
@@ -443,3 +807,88 @@ VALUE mTox_cFriend_send_file(const VALUE self, const VALUE file_kind, const VALU
 
   return friend_out_file;
 }
+
+// Tox::Friend#call_with
+VALUE mTox_cFriend_call_with(
+  const VALUE self,
+  const VALUE audio_video,
+  const VALUE audio_bit_rate,
+  const VALUE video_bit_rate
+)
+{
+  const VALUE number = rb_iv_get(self, "@number");
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const uint32_t audio_bit_rate_data =
+    Qnil == audio_bit_rate ? 0 : NUM2ULONG(audio_bit_rate);
+
+  const uint32_t video_bit_rate_data =
+    Qnil == video_bit_rate ? 0 : NUM2ULONG(video_bit_rate);
+
+  TOXAV_ERR_CALL error;
+
+  const bool result = toxav_call(
+    audio_video_cdata->tox_av,
+    NUM2ULONG(number),
+    audio_bit_rate_data,
+    video_bit_rate_data,
+    &error
+  );
+
+  switch (error) {
+    case TOXAV_ERR_CALL_OK:
+      break;
+    case TOXAV_ERR_CALL_MALLOC:
+      RAISE_FUNC_ERROR(
+        "toxav_call",
+        rb_eNoMemError,
+        "TOXAV_ERR_CALL_MALLOC"
+      );
+    case TOXAV_ERR_CALL_SYNC:
+      RAISE_FUNC_ERROR(
+        "toxav_call",
+        rb_eRuntimeError,
+        "TOXAV_ERR_CALL_SYNC"
+      );
+    case TOXAV_ERR_CALL_FRIEND_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "toxav_call",
+        mTox_cFriend_eNotFoundError,
+        "TOXAV_ERR_CALL_FRIEND_NOT_FOUND"
+      );
+    case TOXAV_ERR_CALL_FRIEND_NOT_CONNECTED:
+      RAISE_FUNC_ERROR(
+        "toxav_call",
+        mTox_cFriend_eNotConnectedError,
+        "TOXAV_ERR_CALL_FRIEND_NOT_CONNECTED"
+      );
+    case TOXAV_ERR_CALL_FRIEND_ALREADY_IN_CALL:
+      RAISE_FUNC_ERROR(
+        "toxav_call",
+        rb_eRuntimeError,
+        "TOXAV_ERR_CALL_FRIEND_ALREADY_IN_CALL"
+      );
+    case TOXAV_ERR_CALL_INVALID_BIT_RATE:
+      RAISE_FUNC_ERROR(
+        "toxav_call",
+        rb_eArgError,
+        "TOXAV_ERR_CALL_INVALID_BIT_RATE"
+      );
+    default:
+      RAISE_FUNC_ERROR_DEFAULT("toxav_call");
+  }
+
+  if (!result) {
+    RAISE_FUNC_RESULT("toxav_call");
+  }
+
+  mTox_cAudioVideo_CALL_START(
+    audio_video_cdata,
+    NUM2ULONG(number),
+    audio_bit_rate_data,
+    video_bit_rate_data
+  );
+
+  return rb_funcall(mTox_cFriendCall, rb_intern("new"), 2, audio_video, number);
+}
@@ -1,10 +1,61 @@
 #include "tox.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <opus/opusfile.h>
+
 // Public methods
 
 static VALUE mTox_cFriendCall_send_audio_frame(VALUE self, VALUE audio_frame);
 static VALUE mTox_cFriendCall_send_video_frame(VALUE self, VALUE video_frame);
 
+static VALUE mTox_cFriendCall_control(VALUE self, VALUE call_control);
+static VALUE mTox_cFriendCall_paused_QUESTION(VALUE self);
+static VALUE mTox_cFriendCall_audio_muted_QUESTION(VALUE self);
+static VALUE mTox_cFriendCall_video_hidden_QUESTION(VALUE self);
+
+static VALUE mTox_cFriendCall_stop_stream(VALUE self);
+static VALUE mTox_cFriendCall_streaming_QUESTION(VALUE self);
+
+static VALUE mTox_cFriendCall_disable_jitter_buffer(VALUE self);
+static VALUE mTox_cFriendCall_jitter_buffer_stats(VALUE self);
+
+static VALUE mTox_cFriendCall_audio_bit_rate_ASSIGN(VALUE self, VALUE audio_bit_rate);
+static VALUE mTox_cFriendCall_video_bit_rate_ASSIGN(VALUE self, VALUE video_bit_rate);
+
+static VALUE mTox_cFriendCall_disable_bit_rate_control(VALUE self);
+static VALUE mTox_cFriendCall_bit_rate_control_stats(VALUE self);
+
+static VALUE mTox_cFriendCall_stop_recording(VALUE self);
+static VALUE mTox_cFriendCall_recording_stats(VALUE self);
+
+static VALUE mTox_cFriendCall_disable_voice_gate(VALUE self);
+static VALUE mTox_cFriendCall_voice_gate_stats(VALUE self);
+
+static VALUE mTox_cFriendCall_audio_level_stats(VALUE self);
+
+static VALUE mTox_cFriendCall_stop_relay(VALUE self);
+static VALUE mTox_cFriendCall_relay_stats(VALUE self);
+
+static VALUE mTox_cFriendCall_queue_video_frame(VALUE self, VALUE video_frame);
+static VALUE mTox_cFriendCall_disable_video_queue(VALUE self);
+static VALUE mTox_cFriendCall_video_queue_stats(VALUE self);
+
+static VALUE mTox_cFriendCall_stats(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cFriendCall_stream_file_with(VALUE self, VALUE path, VALUE loop);
+static VALUE mTox_cFriendCall_enable_jitter_buffer_with(VALUE self, VALUE latency);
+static VALUE mTox_cFriendCall_enable_bit_rate_control_with(VALUE self, VALUE audio_min, VALUE audio_max, VALUE video_min, VALUE video_max);
+static VALUE mTox_cFriendCall_record_to_with(VALUE self, VALUE path, VALUE bit_rate);
+static VALUE mTox_cFriendCall_enable_voice_gate_with(VALUE self, VALUE threshold, VALUE hangover);
+static VALUE mTox_cFriendCall_add_relay_sink_with(VALUE self, VALUE sink_number);
+static VALUE mTox_cFriendCall_remove_relay_sink_with(VALUE self, VALUE sink_number);
+static VALUE mTox_cFriendCall_relay_sink_numbers(VALUE self);
+static VALUE mTox_cFriendCall_enable_video_queue_with(VALUE self, VALUE frame_rate, VALUE depth);
+
 /*************************************************************
  * Initialization
  *************************************************************/
@@ -15,6 +66,52 @@ void mTox_cFriendCall_INIT()
 
   rb_define_method(mTox_cFriendCall, "send_audio_frame", mTox_cFriendCall_send_audio_frame, 1);
   rb_define_method(mTox_cFriendCall, "send_video_frame", mTox_cFriendCall_send_video_frame, 1);
+
+  rb_define_method(mTox_cFriendCall, "control",       mTox_cFriendCall_control,               1);
+  rb_define_method(mTox_cFriendCall, "paused?",       mTox_cFriendCall_paused_QUESTION,       0);
+  rb_define_method(mTox_cFriendCall, "audio_muted?",  mTox_cFriendCall_audio_muted_QUESTION,  0);
+  rb_define_method(mTox_cFriendCall, "video_hidden?", mTox_cFriendCall_video_hidden_QUESTION, 0);
+
+  rb_define_method(mTox_cFriendCall, "stop_stream", mTox_cFriendCall_stop_stream,         0);
+  rb_define_method(mTox_cFriendCall, "streaming?",  mTox_cFriendCall_streaming_QUESTION, 0);
+
+  rb_define_method(mTox_cFriendCall, "disable_jitter_buffer", mTox_cFriendCall_disable_jitter_buffer, 0);
+  rb_define_method(mTox_cFriendCall, "jitter_buffer_stats",   mTox_cFriendCall_jitter_buffer_stats,   0);
+
+  rb_define_method(mTox_cFriendCall, "audio_bit_rate=", mTox_cFriendCall_audio_bit_rate_ASSIGN, 1);
+  rb_define_method(mTox_cFriendCall, "video_bit_rate=", mTox_cFriendCall_video_bit_rate_ASSIGN, 1);
+
+  rb_define_method(mTox_cFriendCall, "disable_bit_rate_control", mTox_cFriendCall_disable_bit_rate_control, 0);
+  rb_define_method(mTox_cFriendCall, "bit_rate_control_stats",   mTox_cFriendCall_bit_rate_control_stats,   0);
+
+  rb_define_method(mTox_cFriendCall, "stop_recording",  mTox_cFriendCall_stop_recording,  0);
+  rb_define_method(mTox_cFriendCall, "recording_stats", mTox_cFriendCall_recording_stats, 0);
+
+  rb_define_method(mTox_cFriendCall, "disable_voice_gate", mTox_cFriendCall_disable_voice_gate, 0);
+  rb_define_method(mTox_cFriendCall, "voice_gate_stats",   mTox_cFriendCall_voice_gate_stats,   0);
+
+  rb_define_method(mTox_cFriendCall, "audio_level_stats", mTox_cFriendCall_audio_level_stats, 0);
+
+  rb_define_method(mTox_cFriendCall, "stop_relay",  mTox_cFriendCall_stop_relay,  0);
+  rb_define_method(mTox_cFriendCall, "relay_stats", mTox_cFriendCall_relay_stats, 0);
+
+  rb_define_method(mTox_cFriendCall, "queue_video_frame",   mTox_cFriendCall_queue_video_frame,   1);
+  rb_define_method(mTox_cFriendCall, "disable_video_queue", mTox_cFriendCall_disable_video_queue, 0);
+  rb_define_method(mTox_cFriendCall, "video_queue_stats",   mTox_cFriendCall_video_queue_stats,   0);
+
+  rb_define_method(mTox_cFriendCall, "stats", mTox_cFriendCall_stats, 0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cFriendCall, "stream_file_with",          mTox_cFriendCall_stream_file_with,          2);
+  rb_define_private_method(mTox_cFriendCall, "enable_jitter_buffer_with", mTox_cFriendCall_enable_jitter_buffer_with, 1);
+  rb_define_private_method(mTox_cFriendCall, "enable_bit_rate_control_with", mTox_cFriendCall_enable_bit_rate_control_with, 4);
+  rb_define_private_method(mTox_cFriendCall, "record_to_with",               mTox_cFriendCall_record_to_with,               2);
+  rb_define_private_method(mTox_cFriendCall, "enable_voice_gate_with",       mTox_cFriendCall_enable_voice_gate_with,       2);
+  rb_define_private_method(mTox_cFriendCall, "add_relay_sink_with",          mTox_cFriendCall_add_relay_sink_with,          1);
+  rb_define_private_method(mTox_cFriendCall, "remove_relay_sink_with",       mTox_cFriendCall_remove_relay_sink_with,       1);
+  rb_define_private_method(mTox_cFriendCall, "relay_sink_numbers",           mTox_cFriendCall_relay_sink_numbers,           0);
+  rb_define_private_method(mTox_cFriendCall, "enable_video_queue_with",      mTox_cFriendCall_enable_video_queue_with,      2);
 }
 
 /*************************************************************
@@ -22,12 +119,17 @@ void mTox_cFriendCall_INIT()
  *************************************************************/
 
 // Tox::FriendCall#send_audio_frame
+//
+// Returns true when the frame was sent, false when it was not encoded: the
+// voice gate suppressed it, or audio is paused, muted or not accepted by
+// the friend. It returned nil before the voice gate, so callers which
+// checked the result for nil have to check for false now.
 VALUE mTox_cFriendCall_send_audio_frame(
   const VALUE self,
   const VALUE audio_frame
 )
 {
-  if (!rb_funcall(audio_frame, rb_intern("is_a?"), 1, mTox_cAudioFrame)) {
+  if (!mTox_cAudioFrame_IS(audio_frame)) {
     RAISE_TYPECHECK(
       "Tox::FriendCall#send_audio_frame",
       "audio_frame",
@@ -35,7 +137,9 @@ VALUE mTox_cFriendCall_send_audio_frame(
     );
   }
 
-  if (!rb_funcall(audio_frame, rb_intern("valid?"), 0)) {
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  if (!mTox_cAudioFrame_VALID(audio_frame_cdata)) {
     rb_raise(rb_eRuntimeError, "audio frame is invalid");
   }
 
@@ -44,12 +148,34 @@ VALUE mTox_cFriendCall_send_audio_frame(
 
   const uint32_t friend_number_data = NUM2ULONG(friend_number);
 
-  const VALUE pcm = rb_iv_get(audio_frame, "@pcm");
-
-  const char *const pcm_data = RSTRING_PTR(pcm);
+  const char *const pcm_data = RSTRING_PTR(audio_frame_cdata->pcm);
 
   CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
-  CDATA(audio_frame, mTox_cAudioFrame_CDATA, audio_frame_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!mTox_cAudioVideo_SENDS_AUDIO(call)) {
+    return Qfalse;
+  }
+
+  mTox_VOICE_GATE *const voice_gate = call ? call->voice_gate : NULL;
+  mTox_CALL_STATS *const call_stats = call ? call->call_stats : NULL;
+
+  if (
+    voice_gate &&
+    !mTox_VOICE_GATE_PASS(
+      voice_gate,
+      (const int16_t*)pcm_data,
+      audio_frame_cdata->sample_count,
+      audio_frame_cdata->channels,
+      audio_frame_cdata->sampling_rate
+    )
+  ) {
+    return Qfalse;
+  }
+
+  const uint64_t started = call_stats ? mTox_AUDIO_STREAM_NOW() : 0;
 
   TOXAV_ERR_SEND_FRAME toxav_audio_send_frame_error;
 
@@ -63,6 +189,28 @@ VALUE mTox_cFriendCall_send_audio_frame(
     &toxav_audio_send_frame_error
   );
 
+  if (call_stats) {
+    mTox_CALL_STATS_SENT(
+      call_stats,
+      mTox_CALL_STATS_AUDIO,
+      toxav_audio_send_frame_error,
+      started,
+      mTox_AUDIO_STREAM_NOW(),
+      (uint64_t)audio_frame_cdata->sample_count * 1000000 /
+        audio_frame_cdata->sampling_rate
+    );
+  }
+
+  if (toxav_audio_send_frame_error == TOXAV_ERR_SEND_FRAME_SYNC ||
+      toxav_audio_send_frame_error == TOXAV_ERR_SEND_FRAME_RTP_FAILED) {
+    if (call && call->bit_rate_control) {
+      mTox_BIT_RATE_CONTROL_FAILED(
+        call->bit_rate_control,
+        mTox_BIT_RATE_CONTROL_AUDIO
+      );
+    }
+  }
+
   switch (toxav_audio_send_frame_error) {
     case TOXAV_ERR_SEND_FRAME_OK:
       break;
@@ -116,16 +264,19 @@ VALUE mTox_cFriendCall_send_audio_frame(
     RAISE_FUNC_RESULT("toxav_audio_send_frame");
   }
 
-  return Qnil;
+  return Qtrue;
 }
 
 // Tox::FriendCall#send_video_frame
+//
+// Returns false when the frame was not encoded: video is paused, hidden or
+// not accepted by the friend.
 VALUE mTox_cFriendCall_send_video_frame(
   const VALUE self,
   const VALUE video_frame
 )
 {
-  if (!rb_funcall(video_frame, rb_intern("is_a?"), 1, mTox_cVideoFrame)) {
+  if (!mTox_cVideoFrame_IS(video_frame)) {
     RAISE_TYPECHECK(
       "Tox::FriendCall#send_video_frame",
       "video_frame",
@@ -133,7 +284,9 @@ VALUE mTox_cFriendCall_send_video_frame(
     );
   }
 
-  if (!rb_funcall(video_frame, rb_intern("valid?"), 0)) {
+  VIDEO_FRAME_CDATA(video_frame, video_frame_cdata);
+
+  if (!mTox_cVideoFrame_VALID(video_frame_cdata)) {
     rb_raise(rb_eRuntimeError, "video frame is invalid");
   }
 
@@ -142,16 +295,26 @@ VALUE mTox_cFriendCall_send_video_frame(
 
   const uint32_t friend_number_data = NUM2ULONG(friend_number);
 
-  const VALUE y_plane = rb_iv_get(video_frame, "@y_plane");
-  const VALUE u_plane = rb_iv_get(video_frame, "@u_plane");
-  const VALUE v_plane = rb_iv_get(video_frame, "@v_plane");
-
-  const char *const y_plane_data = RSTRING_PTR(y_plane);
-  const char *const u_plane_data = RSTRING_PTR(u_plane);
-  const char *const v_plane_data = RSTRING_PTR(v_plane);
+  const char *const y_plane_data = RSTRING_PTR(video_frame_cdata->y_plane);
+  const char *const u_plane_data = RSTRING_PTR(video_frame_cdata->u_plane);
+  const char *const v_plane_data = RSTRING_PTR(video_frame_cdata->v_plane);
 
   CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
-  CDATA(video_frame, mTox_cVideoFrame_CDATA, video_frame_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!mTox_cAudioVideo_SENDS_VIDEO(call)) {
+    return Qfalse;
+  }
+
+  mTox_BIT_RATE_CONTROL *const bit_rate_control =
+    call ? call->bit_rate_control : NULL;
+
+  mTox_CALL_STATS *const call_stats = call ? call->call_stats : NULL;
+
+  const uint64_t started =
+    bit_rate_control || call_stats ? mTox_AUDIO_STREAM_NOW() : 0;
 
   TOXAV_ERR_SEND_FRAME toxav_video_send_frame_error;
 
@@ -166,6 +329,33 @@ VALUE mTox_cFriendCall_send_video_frame(
     &toxav_video_send_frame_error
   );
 
+  // Encoding is timed together with sending, toxav does both at once.
+  const uint64_t finished = started ? mTox_AUDIO_STREAM_NOW() : 0;
+
+  if (call_stats) {
+    mTox_CALL_STATS_SENT(
+      call_stats,
+      mTox_CALL_STATS_VIDEO,
+      toxav_video_send_frame_error,
+      started,
+      finished,
+      0
+    );
+  }
+
+  if (bit_rate_control) {
+    mTox_BIT_RATE_CONTROL_VIDEO_SENT(
+      bit_rate_control,
+      finished - started,
+      started
+    );
+
+    if (toxav_video_send_frame_error == TOXAV_ERR_SEND_FRAME_SYNC ||
+        toxav_video_send_frame_error == TOXAV_ERR_SEND_FRAME_RTP_FAILED) {
+      mTox_BIT_RATE_CONTROL_FAILED(bit_rate_control, mTox_BIT_RATE_CONTROL_VIDEO);
+    }
+  }
+
   switch (toxav_video_send_frame_error) {
     case TOXAV_ERR_SEND_FRAME_OK:
       break;
@@ -219,5 +409,1072 @@ VALUE mTox_cFriendCall_send_video_frame(
     RAISE_FUNC_RESULT("toxav_video_send_frame");
   }
 
+  return Qtrue;
+}
+
+// Tox::FriendCall#control
+VALUE mTox_cFriendCall_control(const VALUE self, const VALUE call_control)
+{
+  const TOXAV_CALL_CONTROL call_control_data =
+    mTox_mCallControl_TO_DATA(call_control);
+
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  TOXAV_ERR_CALL_CONTROL toxav_call_control_error;
+
+  const bool toxav_call_control_result = toxav_call_control(
+    audio_video_cdata->tox_av,
+    friend_number_data,
+    call_control_data,
+    &toxav_call_control_error
+  );
+
+  switch (toxav_call_control_error) {
+    case TOXAV_ERR_CALL_CONTROL_OK:
+      break;
+    case TOXAV_ERR_CALL_CONTROL_SYNC:
+      RAISE_FUNC_ERROR(
+        "toxav_call_control",
+        rb_eRuntimeError,
+        "TOXAV_ERR_CALL_CONTROL_SYNC"
+      );
+    case TOXAV_ERR_CALL_CONTROL_FRIEND_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "toxav_call_control",
+        rb_eRuntimeError,
+        "TOXAV_ERR_CALL_CONTROL_FRIEND_NOT_FOUND"
+      );
+    case TOXAV_ERR_CALL_CONTROL_FRIEND_NOT_IN_CALL:
+      RAISE_FUNC_ERROR(
+        "toxav_call_control",
+        rb_eRuntimeError,
+        "TOXAV_ERR_CALL_CONTROL_FRIEND_NOT_IN_CALL"
+      );
+    case TOXAV_ERR_CALL_CONTROL_INVALID_TRANSITION:
+      RAISE_FUNC_ERROR(
+        "toxav_call_control",
+        rb_eRuntimeError,
+        "TOXAV_ERR_CALL_CONTROL_INVALID_TRANSITION"
+      );
+    default:
+      RAISE_FUNC_ERROR_DEFAULT("toxav_call_control");
+  }
+
+  if (!toxav_call_control_result) {
+    RAISE_FUNC_RESULT("toxav_call_control");
+  }
+
+  // toxav does not report the end of calls which were cancelled here.
+  if (TOXAV_CALL_CONTROL_CANCEL == call_control_data) {
+    mTox_cAudioVideo_CALL_END(audio_video_cdata, friend_number_data);
+    return Qnil;
+  }
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  call->in_call = true;
+
+  switch (call_control_data) {
+    case TOXAV_CALL_CONTROL_RESUME:
+      call->paused = false;
+      break;
+    case TOXAV_CALL_CONTROL_PAUSE:
+      call->paused = true;
+      break;
+    case TOXAV_CALL_CONTROL_MUTE_AUDIO:
+      call->audio_muted = true;
+      break;
+    case TOXAV_CALL_CONTROL_UNMUTE_AUDIO:
+      call->audio_muted = false;
+      break;
+    case TOXAV_CALL_CONTROL_HIDE_VIDEO:
+      call->video_hidden = true;
+      break;
+    case TOXAV_CALL_CONTROL_SHOW_VIDEO:
+      call->video_hidden = false;
+      break;
+    default:
+      break;
+  }
+
+  return Qnil;
+}
+
+// Tox::FriendCall#paused?
+VALUE mTox_cFriendCall_paused_QUESTION(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, NUM2ULONG(friend_number));
+
+  if (call && call->paused) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::FriendCall#audio_muted?
+VALUE mTox_cFriendCall_audio_muted_QUESTION(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, NUM2ULONG(friend_number));
+
+  if (call && call->audio_muted) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::FriendCall#video_hidden?
+VALUE mTox_cFriendCall_video_hidden_QUESTION(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, NUM2ULONG(friend_number));
+
+  if (call && call->video_hidden) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::FriendCall#stop_stream
+VALUE mTox_cFriendCall_stop_stream(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!call || !call->stream) {
+    return Qfalse;
+  }
+
+  mTox_AUDIO_STREAM_CLOSE(call->stream);
+
+  call->stream = NULL;
+
+  return Qtrue;
+}
+
+// Tox::FriendCall#streaming?
+VALUE mTox_cFriendCall_streaming_QUESTION(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (call && call->stream) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::FriendCall#disable_jitter_buffer
+VALUE mTox_cFriendCall_disable_jitter_buffer(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!call || !call->jitter_buffer) {
+    return Qfalse;
+  }
+
+  mTox_JITTER_BUFFER_FREE(call->jitter_buffer);
+
+  call->jitter_buffer = NULL;
+
+  return Qtrue;
+}
+
+// Tox::FriendCall#jitter_buffer_stats
+VALUE mTox_cFriendCall_jitter_buffer_stats(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  const mTox_JITTER_BUFFER *const jitter_buffer =
+    call ? call->jitter_buffer : NULL;
+
+  if (!jitter_buffer) {
+    return Qnil;
+  }
+
+  return mTox_JITTER_BUFFER_STATS_HASH(jitter_buffer);
+}
+
+// Tox::FriendCall#audio_bit_rate=
+VALUE mTox_cFriendCall_audio_bit_rate_ASSIGN(
+  const VALUE self,
+  const VALUE audio_bit_rate
+)
+{
+  const uint32_t audio_bit_rate_data = NUM2ULONG(audio_bit_rate);
+
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  TOXAV_ERR_BIT_RATE_SET toxav_audio_set_bit_rate_error;
+
+  const bool toxav_audio_set_bit_rate_result = toxav_audio_set_bit_rate(
+    audio_video_cdata->tox_av,
+    friend_number_data,
+    audio_bit_rate_data,
+    &toxav_audio_set_bit_rate_error
+  );
+
+  switch (toxav_audio_set_bit_rate_error) {
+    case TOXAV_ERR_BIT_RATE_SET_OK:
+      break;
+    case TOXAV_ERR_BIT_RATE_SET_SYNC:
+      RAISE_FUNC_ERROR(
+        "toxav_audio_set_bit_rate",
+        rb_eRuntimeError,
+        "TOXAV_ERR_BIT_RATE_SET_SYNC"
+      );
+    case TOXAV_ERR_BIT_RATE_SET_INVALID_BIT_RATE:
+      RAISE_FUNC_ERROR(
+        "toxav_audio_set_bit_rate",
+        rb_eArgError,
+        "TOXAV_ERR_BIT_RATE_SET_INVALID_BIT_RATE"
+      );
+    case TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "toxav_audio_set_bit_rate",
+        rb_eRuntimeError,
+        "TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_FOUND"
+      );
+    case TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_IN_CALL:
+      RAISE_FUNC_ERROR(
+        "toxav_audio_set_bit_rate",
+        rb_eRuntimeError,
+        "TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_IN_CALL"
+      );
+    default:
+      RAISE_FUNC_ERROR_DEFAULT("toxav_audio_set_bit_rate");
+  }
+
+  if (!toxav_audio_set_bit_rate_result) {
+    RAISE_FUNC_RESULT("toxav_audio_set_bit_rate");
+  }
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (call && call->call_stats) {
+    mTox_CALL_STATS_BIT_RATE(call->call_stats, mTox_CALL_STATS_AUDIO, audio_bit_rate_data);
+  }
+
+  if (call && call->bit_rate_control) {
+    mTox_BIT_RATE_CONTROL_HOLD(call->bit_rate_control, mTox_BIT_RATE_CONTROL_AUDIO, audio_bit_rate_data);
+  }
+
+  return Qnil;
+}
+
+// Tox::FriendCall#video_bit_rate=
+VALUE mTox_cFriendCall_video_bit_rate_ASSIGN(
+  const VALUE self,
+  const VALUE video_bit_rate
+)
+{
+  const uint32_t video_bit_rate_data = NUM2ULONG(video_bit_rate);
+
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  TOXAV_ERR_BIT_RATE_SET toxav_video_set_bit_rate_error;
+
+  const bool toxav_video_set_bit_rate_result = toxav_video_set_bit_rate(
+    audio_video_cdata->tox_av,
+    friend_number_data,
+    video_bit_rate_data,
+    &toxav_video_set_bit_rate_error
+  );
+
+  switch (toxav_video_set_bit_rate_error) {
+    case TOXAV_ERR_BIT_RATE_SET_OK:
+      break;
+    case TOXAV_ERR_BIT_RATE_SET_SYNC:
+      RAISE_FUNC_ERROR(
+        "toxav_video_set_bit_rate",
+        rb_eRuntimeError,
+        "TOXAV_ERR_BIT_RATE_SET_SYNC"
+      );
+    case TOXAV_ERR_BIT_RATE_SET_INVALID_BIT_RATE:
+      RAISE_FUNC_ERROR(
+        "toxav_video_set_bit_rate",
+        rb_eArgError,
+        "TOXAV_ERR_BIT_RATE_SET_INVALID_BIT_RATE"
+      );
+    case TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "toxav_video_set_bit_rate",
+        rb_eRuntimeError,
+        "TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_FOUND"
+      );
+    case TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_IN_CALL:
+      RAISE_FUNC_ERROR(
+        "toxav_video_set_bit_rate",
+        rb_eRuntimeError,
+        "TOXAV_ERR_BIT_RATE_SET_FRIEND_NOT_IN_CALL"
+      );
+    default:
+      RAISE_FUNC_ERROR_DEFAULT("toxav_video_set_bit_rate");
+  }
+
+  if (!toxav_video_set_bit_rate_result) {
+    RAISE_FUNC_RESULT("toxav_video_set_bit_rate");
+  }
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (call && call->call_stats) {
+    mTox_CALL_STATS_BIT_RATE(call->call_stats, mTox_CALL_STATS_VIDEO, video_bit_rate_data);
+  }
+
+  if (call && call->bit_rate_control) {
+    mTox_BIT_RATE_CONTROL_HOLD(call->bit_rate_control, mTox_BIT_RATE_CONTROL_VIDEO, video_bit_rate_data);
+  }
+
+  return Qnil;
+}
+
+// Tox::FriendCall#disable_bit_rate_control
+VALUE mTox_cFriendCall_disable_bit_rate_control(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!call || !call->bit_rate_control) {
+    return Qfalse;
+  }
+
+  mTox_BIT_RATE_CONTROL_FREE(call->bit_rate_control);
+
+  call->bit_rate_control = NULL;
+
+  return Qtrue;
+}
+
+// Tox::FriendCall#bit_rate_control_stats
+VALUE mTox_cFriendCall_bit_rate_control_stats(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  const mTox_BIT_RATE_CONTROL *const bit_rate_control =
+    call ? call->bit_rate_control : NULL;
+
+  if (!bit_rate_control) {
+    return Qnil;
+  }
+
+  return mTox_BIT_RATE_CONTROL_STATS_HASH(bit_rate_control);
+}
+
+// Tox::FriendCall#stop_recording
+//
+// Waits for the recording to be encoded and written.
+VALUE mTox_cFriendCall_stop_recording(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!call || !call->recorder) {
+    return Qfalse;
+  }
+
+  mTox_CALL_RECORDER *const recorder = call->recorder;
+
+  call->recorder = NULL;
+
+  const int error = mTox_CALL_RECORDER_CLOSE(recorder);
+
+  if (error > 0) {
+    rb_syserr_fail(error, "Tox::FriendCall#stop_recording");
+  }
+
+  return Qtrue;
+}
+
+// Tox::FriendCall#recording_stats
+VALUE mTox_cFriendCall_recording_stats(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  mTox_CALL_RECORDER *const recorder = call ? call->recorder : NULL;
+
+  if (!recorder) {
+    return Qnil;
+  }
+
+  mTox_CALL_RECORDER_STATS stats;
+
+  mTox_CALL_RECORDER_GET_STATS(recorder, &stats);
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("sampling_rate")), ULONG2NUM(stats.sampling_rate));
+  rb_hash_aset(result, ID2SYM(rb_intern("channels")),      UINT2NUM(stats.channels));
+  rb_hash_aset(result, ID2SYM(rb_intern("received")),      ULL2NUM(stats.received));
+  rb_hash_aset(result, ID2SYM(rb_intern("dropped")),       ULL2NUM(stats.dropped));
+  rb_hash_aset(result, ID2SYM(rb_intern("packets")),       ULL2NUM(stats.packets));
+  rb_hash_aset(result, ID2SYM(rb_intern("bytes")),         ULL2NUM(stats.bytes));
+  rb_hash_aset(result, ID2SYM(rb_intern("error")),         stats.error ? INT2NUM(stats.error) : Qnil);
+
+  return result;
+}
+
+// Tox::FriendCall#disable_voice_gate
+VALUE mTox_cFriendCall_disable_voice_gate(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!call || !call->voice_gate) {
+    return Qfalse;
+  }
+
+  mTox_VOICE_GATE_FREE(call->voice_gate);
+
+  call->voice_gate = NULL;
+
+  return Qtrue;
+}
+
+// Tox::FriendCall#voice_gate_stats
+VALUE mTox_cFriendCall_voice_gate_stats(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  const mTox_VOICE_GATE *const voice_gate = call ? call->voice_gate : NULL;
+
+  if (!voice_gate) {
+    return Qnil;
+  }
+
+  mTox_VOICE_GATE_STATS stats;
+
+  mTox_VOICE_GATE_GET_STATS(voice_gate, &stats);
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("passed")),     ULL2NUM(stats.passed));
+  rb_hash_aset(result, ID2SYM(rb_intern("suppressed")), ULL2NUM(stats.suppressed));
+  rb_hash_aset(result, ID2SYM(rb_intern("open")),       stats.open ? Qtrue : Qfalse);
+
+  return result;
+}
+
+// Tox::FriendCall#audio_level_stats
+VALUE mTox_cFriendCall_audio_level_stats(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  const mTox_AUDIO_METER *const audio_meter = call ? call->audio_meter : NULL;
+
+  if (!audio_meter) {
+    return Qnil;
+  }
+
+  return mTox_AUDIO_METER_STATS_HASH(audio_meter);
+}
+
+// Tox::FriendCall#stop_relay
+VALUE mTox_cFriendCall_stop_relay(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!call || !call->media_relay) {
+    return Qfalse;
+  }
+
+  mTox_MEDIA_RELAY_FREE(call->media_relay);
+
+  call->media_relay = NULL;
+
+  return Qtrue;
+}
+
+// Tox::FriendCall#relay_stats
+VALUE mTox_cFriendCall_relay_stats(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  const mTox_MEDIA_RELAY *const media_relay = call ? call->media_relay : NULL;
+
+  if (!media_relay) {
+    return Qnil;
+  }
+
+  return mTox_MEDIA_RELAY_STATS_HASH(media_relay);
+}
+
+// Tox::FriendCall#queue_video_frame
+VALUE mTox_cFriendCall_queue_video_frame(
+  const VALUE self,
+  const VALUE video_frame
+)
+{
+  if (!mTox_cVideoFrame_IS(video_frame)) {
+    RAISE_TYPECHECK(
+      "Tox::FriendCall#queue_video_frame",
+      "video_frame",
+      "Tox::VideoFrame"
+    );
+  }
+
+  VIDEO_FRAME_CDATA(video_frame, video_frame_cdata);
+
+  if (!mTox_cVideoFrame_VALID(video_frame_cdata)) {
+    rb_raise(rb_eRuntimeError, "video frame is invalid");
+  }
+
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!call || !call->video_queue) {
+    rb_raise(rb_eRuntimeError, "video queue is not enabled");
+  }
+
+  if (!mTox_cAudioVideo_SENDS_VIDEO(call)) {
+    return Qfalse;
+  }
+
+  mTox_VIDEO_QUEUE_PUSH(
+    call->video_queue,
+    video_frame_cdata->width,
+    video_frame_cdata->height,
+    (const uint8_t*)RSTRING_PTR(video_frame_cdata->y_plane),
+    (const uint8_t*)RSTRING_PTR(video_frame_cdata->u_plane),
+    (const uint8_t*)RSTRING_PTR(video_frame_cdata->v_plane)
+  );
+
+  return Qtrue;
+}
+
+// Tox::FriendCall#disable_video_queue
+VALUE mTox_cFriendCall_disable_video_queue(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  if (!call || !call->video_queue) {
+    return Qfalse;
+  }
+
+  mTox_VIDEO_QUEUE_FREE(call->video_queue);
+
+  call->video_queue = NULL;
+
+  return Qtrue;
+}
+
+// Tox::FriendCall#video_queue_stats
+VALUE mTox_cFriendCall_video_queue_stats(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  const mTox_VIDEO_QUEUE *const video_queue = call ? call->video_queue : NULL;
+
+  if (!video_queue) {
+    return Qnil;
+  }
+
+  return mTox_VIDEO_QUEUE_STATS_HASH(video_queue);
+}
+
+// Tox::FriendCall#stats
+VALUE mTox_cFriendCall_stats(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  mTox_CALL_STATS *const call_stats = call ? call->call_stats : NULL;
+
+  if (!call_stats) {
+    return Qnil;
+  }
+
+  return mTox_CALL_STATS_STATS_HASH(call_stats, mTox_AUDIO_STREAM_NOW());
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::FriendCall#stream_file_with
+VALUE mTox_cFriendCall_stream_file_with(
+  const VALUE self,
+  const VALUE path,
+  const VALUE loop
+)
+{
+  const char *const path_data = StringValueCStr(path);
+
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  int error;
+
+  mTox_AUDIO_STREAM *const stream = mTox_AUDIO_STREAM_OPEN(
+    path_data,
+    friend_number_data,
+    RTEST(loop),
+    &error
+  );
+
+  if (!stream) {
+    // The file itself could not be opened.
+    if (error == OP_EFAULT) {
+      rb_sys_fail_str(path);
+    }
+
+    rb_raise(rb_eArgError, "Invalid Ogg Opus file (error %d)", error);
+  }
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  mTox_AUDIO_STREAM_CLOSE(call->stream);
+
+  call->stream = stream;
+
+  return Qnil;
+}
+
+// Tox::FriendCall#enable_jitter_buffer_with
+VALUE mTox_cFriendCall_enable_jitter_buffer_with(
+  const VALUE self,
+  const VALUE latency
+)
+{
+  const uint32_t latency_msec_data = NUM2DBL(latency) * 1000;
+
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  mTox_JITTER_BUFFER_FREE(call->jitter_buffer);
+
+  call->jitter_buffer =
+    mTox_JITTER_BUFFER_NEW(friend_number_data, latency_msec_data);
+
+  return Qnil;
+}
+
+// Tox::FriendCall#enable_bit_rate_control_with
+VALUE mTox_cFriendCall_enable_bit_rate_control_with(
+  const VALUE self,
+  const VALUE audio_min,
+  const VALUE audio_max,
+  const VALUE video_min,
+  const VALUE video_max
+)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_BIT_RATE_CONTROL *const bit_rate_control = mTox_BIT_RATE_CONTROL_NEW(
+    friend_number_data,
+    NUM2ULONG(audio_min),
+    NUM2ULONG(audio_max),
+    NUM2ULONG(video_min),
+    NUM2ULONG(video_max)
+  );
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  // Kinds disabled in the call stay disabled.
+  if (call->call_stats) {
+    mTox_CALL_STATS_STATS stats;
+
+    mTox_CALL_STATS_GET_STATS(call->call_stats, mTox_AUDIO_STREAM_NOW(), &stats);
+
+    if (stats.audio.bit_rate == 0) {
+      mTox_BIT_RATE_CONTROL_HOLD(bit_rate_control, mTox_BIT_RATE_CONTROL_AUDIO, 0);
+    }
+
+    if (stats.video.bit_rate == 0) {
+      mTox_BIT_RATE_CONTROL_HOLD(bit_rate_control, mTox_BIT_RATE_CONTROL_VIDEO, 0);
+    }
+  }
+
+  mTox_BIT_RATE_CONTROL_FREE(call->bit_rate_control);
+
+  call->bit_rate_control = bit_rate_control;
+
+  return Qnil;
+}
+
+// Tox::FriendCall#record_to_with
+VALUE mTox_cFriendCall_record_to_with(
+  const VALUE self,
+  const VALUE path,
+  const VALUE bit_rate
+)
+{
+  const uint32_t bit_rate_data = NUM2ULONG(bit_rate);
+
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const int fd = open(
+    StringValueCStr(path),
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0644
+  );
+
+  if (fd < 0) {
+    rb_sys_fail_str(path);
+  }
+
+  int error;
+
+  mTox_CALL_RECORDER *const recorder = mTox_CALL_RECORDER_NEW(
+    friend_number_data,
+    fd,
+    bit_rate_data,
+    &error
+  );
+
+  if (!recorder) {
+    close(fd);
+    rb_syserr_fail_str(error, path);
+  }
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  mTox_CALL_RECORDER_DETACH(call->recorder);
+
+  call->recorder = recorder;
+
+  return Qnil;
+}
+
+// Tox::FriendCall#enable_voice_gate_with
+VALUE mTox_cFriendCall_enable_voice_gate_with(
+  const VALUE self,
+  const VALUE threshold,
+  const VALUE hangover
+)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const double   threshold_data     = NUM2DBL(threshold);
+  const uint64_t hangover_usec_data = NUM2DBL(hangover) * 1000000;
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  mTox_VOICE_GATE_FREE(call->voice_gate);
+
+  call->voice_gate =
+    mTox_VOICE_GATE_NEW(friend_number_data, threshold_data, hangover_usec_data);
+
+  return Qnil;
+}
+
+// Tox::FriendCall#add_relay_sink_with
+VALUE mTox_cFriendCall_add_relay_sink_with(
+  const VALUE self,
+  const VALUE sink_number
+)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+  const uint32_t sink_number_data   = NUM2ULONG(sink_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  // Relays would never be dropped without calls to end.
+  if (!mTox_cAudioVideo_IN_CALL(audio_video_cdata, friend_number_data)) {
+    rb_raise(rb_eRuntimeError, "friend is not in call");
+  }
+
+  if (!mTox_cAudioVideo_IN_CALL(audio_video_cdata, sink_number_data)) {
+    rb_raise(rb_eRuntimeError, "sink is not in call");
+  }
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  if (!call->media_relay) {
+    mTox_cAudioVideo_SEND_POOL_START(audio_video_cdata);
+    call->media_relay = mTox_MEDIA_RELAY_NEW(friend_number_data);
+  }
+
+  if (mTox_MEDIA_RELAY_ADD_SINK(call->media_relay, sink_number_data)) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::FriendCall#remove_relay_sink_with
+VALUE mTox_cFriendCall_remove_relay_sink_with(
+  const VALUE self,
+  const VALUE sink_number
+)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+  const uint32_t sink_number_data   = NUM2ULONG(sink_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  mTox_MEDIA_RELAY *const media_relay = call ? call->media_relay : NULL;
+
+  if (media_relay && mTox_MEDIA_RELAY_REMOVE_SINK(media_relay, sink_number_data)) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::FriendCall#relay_sink_numbers
+VALUE mTox_cFriendCall_relay_sink_numbers(const VALUE self)
+{
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  const mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_GET(audio_video_cdata, friend_number_data);
+
+  const mTox_MEDIA_RELAY *const media_relay = call ? call->media_relay : NULL;
+
+  const VALUE result = rb_ary_new();
+
+  for (size_t i = 0; media_relay && i < mTox_MEDIA_RELAY_SINKS_SIZE(media_relay); ++i) {
+    rb_ary_push(result, ULONG2NUM(mTox_MEDIA_RELAY_SINK(media_relay, i)));
+  }
+
+  return result;
+}
+
+// Tox::FriendCall#enable_video_queue_with
+VALUE mTox_cFriendCall_enable_video_queue_with(
+  const VALUE self,
+  const VALUE frame_rate,
+  const VALUE depth
+)
+{
+  const uint16_t frame_rate_data = NUM2USHORT(frame_rate);
+  const size_t   depth_data      = NUM2SIZET(depth);
+
+  const VALUE audio_video   = rb_iv_get(self, "@audio_video");
+  const VALUE friend_number = rb_iv_get(self, "@friend_number");
+
+  const uint32_t friend_number_data = NUM2ULONG(friend_number);
+
+  CDATA(audio_video, mTox_cAudioVideo_CDATA, audio_video_cdata);
+
+  mTox_cAudioVideo_CALL *const call =
+    mTox_cAudioVideo_CALL_FETCH(audio_video_cdata, friend_number_data);
+
+  mTox_cAudioVideo_SEND_POOL_START(audio_video_cdata);
+
+  mTox_VIDEO_QUEUE_FREE(call->video_queue);
+
+  call->video_queue =
+    mTox_VIDEO_QUEUE_NEW(friend_number_data, frame_rate_data, depth_data);
+
   return Qnil;
 }
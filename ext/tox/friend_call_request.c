@@ -92,6 +92,13 @@ VALUE mTox_cFriendCallRequest_answer(
     RAISE_FUNC_RESULT("toxav_answer");
   }
 
+  mTox_cAudioVideo_CALL_START(
+    audio_video_cdata,
+    friend_number_data,
+    audio_bit_rate_data,
+    video_bit_rate_data
+  );
+
   return Qnil;
 }
 
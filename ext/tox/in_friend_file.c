@@ -1,8 +1,22 @@
 #include "tox.h"
 
+#include <fcntl.h>
+
 // Public methods
 
 static VALUE mTox_cInFriendFile_control(VALUE self, VALUE file_control);
+static VALUE mTox_cInFriendFile_enable_digest(VALUE self);
+static VALUE mTox_cInFriendFile_digest(VALUE self);
+static VALUE mTox_cInFriendFile_receive_to(VALUE self, VALUE path);
+static VALUE mTox_cInFriendFile_file_id(VALUE self);
+
+// Private functions
+
+static mTox_cClient_CDATA *mTox_cInFriendFile_CLIENT_CDATA(
+  VALUE self,
+  uint32_t *friend_number_data,
+  uint32_t *file_number_data
+);
 
 /*************************************************************
  * Initialization
@@ -12,7 +26,185 @@ void mTox_cInFriendFile_INIT()
 {
   // Public methods
 
-  rb_define_method(mTox_cInFriendFile, "control", mTox_cInFriendFile_control, 1);
+  rb_define_method(mTox_cInFriendFile, "control",       mTox_cInFriendFile_control,       1);
+  rb_define_method(mTox_cInFriendFile, "enable_digest", mTox_cInFriendFile_enable_digest, 0);
+  rb_define_method(mTox_cInFriendFile, "digest",        mTox_cInFriendFile_digest,        0);
+  rb_define_method(mTox_cInFriendFile, "receive_to",    mTox_cInFriendFile_receive_to,    1);
+  rb_define_method(mTox_cInFriendFile, "file_id",       mTox_cInFriendFile_file_id,       0);
+}
+
+/*************************************************************
+ * Transfer state
+ *************************************************************/
+
+mTox_cInFriendFile_TRANSFER *mTox_cInFriendFile_TRANSFER_GET(
+  mTox_cClient_CDATA *const client_cdata,
+  const uint32_t friend_number_data,
+  const uint32_t file_number_data,
+  const bool create
+)
+{
+  for (size_t i = 0; i < client_cdata->in_transfers_size; ++i) {
+    mTox_cInFriendFile_TRANSFER *const transfer = client_cdata->in_transfers[i];
+
+    if (transfer->friend_number == friend_number_data &&
+        transfer->file_number   == file_number_data) {
+      return transfer;
+    }
+  }
+
+  if (!create) {
+    return NULL;
+  }
+
+  mTox_cInFriendFile_TRANSFER *const transfer =
+    ALLOC(mTox_cInFriendFile_TRANSFER);
+
+  memset(transfer, 0, sizeof(mTox_cInFriendFile_TRANSFER));
+
+  transfer->friend_number = friend_number_data;
+  transfer->file_number   = file_number_data;
+
+  REALLOC_N(
+    client_cdata->in_transfers,
+    mTox_cInFriendFile_TRANSFER*,
+    client_cdata->in_transfers_size + 1
+  );
+
+  client_cdata->in_transfers[client_cdata->in_transfers_size++] = transfer;
+
+  return transfer;
+}
+
+void mTox_cInFriendFile_TRANSFER_DELETE(
+  mTox_cClient_CDATA *const client_cdata,
+  const uint32_t friend_number_data,
+  const uint32_t file_number_data
+)
+{
+  for (size_t i = 0; i < client_cdata->in_transfers_size; ++i) {
+    mTox_cInFriendFile_TRANSFER *const transfer = client_cdata->in_transfers[i];
+
+    if (transfer->friend_number == friend_number_data &&
+        transfer->file_number   == file_number_data) {
+      mTox_cInFriendFile_TRANSFER_FREE(transfer);
+
+      client_cdata->in_transfers[i] =
+        client_cdata->in_transfers[--client_cdata->in_transfers_size];
+
+      return;
+    }
+  }
+}
+
+void mTox_cInFriendFile_TRANSFER_FREE(
+  mTox_cInFriendFile_TRANSFER *const transfer
+)
+{
+  free(transfer->avatar_data);
+  mTox_FILE_IO_WINDOW_CLOSE(transfer->window);
+  mTox_COMPRESSION_DECODER_FREE(transfer->decoder);
+  free(transfer);
+}
+
+// Called from the receive callback before the data reaches Ruby. Chunks
+// arrive in order, so the digest is fed directly; anything else (a resumed
+// or seeked transfer) invalidates it instead of buffering. Returns true when
+// the chunk was written to a local file, so Ruby does not have to see it.
+// Sets "failed" when the local file could not be written or closed, or a
+// compressed stream was malformed or incomplete; the transfer is cancelled
+// then and has to be reported as such.
+bool mTox_cInFriendFile_TRANSFER_RECV_CHUNK(
+  mTox_cClient_CDATA *const client_cdata,
+  mTox_cInFriendFile_TRANSFER *const transfer,
+  const uint64_t position_data,
+  const uint8_t *const ptr_data,
+  const size_t length_data,
+  bool *const failed
+)
+{
+  *failed = false;
+
+  if (transfer->avatar_data &&
+      position_data <= transfer->avatar_size &&
+      length_data   <= transfer->avatar_size - position_data) {
+    memcpy(&transfer->avatar_data[position_data], ptr_data, length_data);
+  }
+
+  if (transfer->digest_enabled && !transfer->digest_finished) {
+    if (length_data == 0) {
+      crypto_hash_sha256_final(&transfer->digest_state, transfer->digest);
+      transfer->digest_finished = true;
+    }
+    else {
+      if (position_data != transfer->digest_position) {
+        transfer->digest_valid = false;
+      }
+
+      if (transfer->digest_valid) {
+        crypto_hash_sha256_update(
+          &transfer->digest_state,
+          ptr_data,
+          length_data
+        );
+
+        transfer->digest_position += length_data;
+      }
+    }
+  }
+
+  if (!transfer->window) {
+    return false;
+  }
+
+  // The file is complete before Ruby receives the final empty chunk.
+  // Compressed streams also have to be whole.
+  if (length_data == 0) {
+    const bool closed = mTox_FILE_IO_WINDOW_CLOSE(transfer->window);
+
+    transfer->window = NULL;
+
+    if (!closed ||
+        (transfer->decoder &&
+         !mTox_COMPRESSION_DECODER_FINISHED(transfer->decoder))) {
+      *failed = true;
+      return true;
+    }
+
+    return false;
+  }
+
+  const bool written = transfer->decoder
+    ? mTox_COMPRESSION_DECODER_FEED(
+        transfer->decoder,
+        transfer->window,
+        position_data,
+        ptr_data,
+        length_data
+      )
+    : mTox_FILE_IO_WINDOW_WRITE(
+        transfer->window,
+        position_data,
+        ptr_data,
+        length_data
+      );
+
+  if (!written) {
+    mTox_FILE_IO_WINDOW_CLOSE(transfer->window);
+    transfer->window = NULL;
+
+    tox_file_control(
+      client_cdata->tox,
+      transfer->friend_number,
+      transfer->file_number,
+      TOX_FILE_CONTROL_CANCEL,
+      NULL
+    );
+
+    *failed = true;
+  }
+
+  return true;
 }
 
 /*************************************************************
@@ -100,5 +292,220 @@ VALUE mTox_cInFriendFile_control(
     RAISE_FUNC_RESULT("tox_file_control");
   }
 
+  if (file_control_data == TOX_FILE_CONTROL_CANCEL) {
+    mTox_cInFriendFile_TRANSFER_DELETE(
+      client_cdata,
+      friend_number_data,
+      file_number_data
+    );
+  }
+
   return Qnil;
 }
+
+// Tox::InFriendFile#enable_digest
+VALUE mTox_cInFriendFile_enable_digest(const VALUE self)
+{
+  uint32_t friend_number_data;
+  uint32_t file_number_data;
+
+  mTox_cClient_CDATA *const client_cdata = mTox_cInFriendFile_CLIENT_CDATA(
+    self,
+    &friend_number_data,
+    &file_number_data
+  );
+
+  mTox_cInFriendFile_TRANSFER *const transfer = mTox_cInFriendFile_TRANSFER_GET(
+    client_cdata,
+    friend_number_data,
+    file_number_data,
+    true
+  );
+
+  if (transfer->digest_enabled) {
+    return self;
+  }
+
+  transfer->digest_enabled  = true;
+  transfer->digest_valid    = true;
+  transfer->digest_finished = false;
+  transfer->digest_position = 0;
+
+  crypto_hash_sha256_init(&transfer->digest_state);
+
+  return self;
+}
+
+// Tox::InFriendFile#digest
+VALUE mTox_cInFriendFile_digest(const VALUE self)
+{
+  uint32_t friend_number_data;
+  uint32_t file_number_data;
+
+  mTox_cClient_CDATA *const client_cdata = mTox_cInFriendFile_CLIENT_CDATA(
+    self,
+    &friend_number_data,
+    &file_number_data
+  );
+
+  const mTox_cInFriendFile_TRANSFER *const transfer =
+    mTox_cInFriendFile_TRANSFER_GET(
+      client_cdata,
+      friend_number_data,
+      file_number_data,
+      false
+    );
+
+  if (!transfer || !transfer->digest_finished || !transfer->digest_valid) {
+    return Qnil;
+  }
+
+  return rb_str_new(transfer->digest, TOX_HASH_LENGTH);
+}
+
+// Tox::InFriendFile#receive_to
+VALUE mTox_cInFriendFile_receive_to(const VALUE self, const VALUE path)
+{
+  Check_Type(path, T_STRING);
+
+  uint32_t friend_number_data;
+  uint32_t file_number_data;
+
+  mTox_cClient_CDATA *const client_cdata = mTox_cInFriendFile_CLIENT_CDATA(
+    self,
+    &friend_number_data,
+    &file_number_data
+  );
+
+  const int fd = open(
+    StringValueCStr(path),
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0644
+  );
+
+  if (fd < 0) {
+    rb_sys_fail_str(path);
+  }
+
+  mTox_cInFriendFile_TRANSFER *const transfer = mTox_cInFriendFile_TRANSFER_GET(
+    client_cdata,
+    friend_number_data,
+    file_number_data,
+    true
+  );
+
+  mTox_FILE_IO_WINDOW_CLOSE(transfer->window);
+
+  transfer->window = mTox_FILE_IO_WINDOW_NEW(
+    mTox_cClient_FILE_IO(client_cdata),
+    fd,
+    0,
+    true
+  );
+
+  mTox_COMPRESSION_DECODER_FREE(transfer->decoder);
+  transfer->decoder = NULL;
+
+  // Compressed streams are recognized by their file ids and decompressed
+  // as they arrive.
+  uint8_t file_id_data[TOX_FILE_ID_LENGTH];
+
+  if (tox_file_get_file_id(
+        client_cdata->tox,
+        friend_number_data,
+        file_number_data,
+        file_id_data,
+        NULL
+      ) &&
+      memcmp(
+        file_id_data,
+        mTox_COMPRESSION_MAGIC,
+        mTox_COMPRESSION_MAGIC_SIZE
+      ) == 0) {
+    transfer->decoder = mTox_COMPRESSION_DECODER_NEW(
+      mTox_COMPRESSION_ORIGINAL_SIZE(file_id_data)
+    );
+  }
+
+  return self;
+}
+
+// Tox::InFriendFile#file_id
+VALUE mTox_cInFriendFile_file_id(const VALUE self)
+{
+  uint32_t friend_number_data;
+  uint32_t file_number_data;
+
+  mTox_cClient_CDATA *const client_cdata = mTox_cInFriendFile_CLIENT_CDATA(
+    self,
+    &friend_number_data,
+    &file_number_data
+  );
+
+  uint8_t file_id_data[TOX_FILE_ID_LENGTH];
+
+  TOX_ERR_FILE_GET tox_file_get_file_id_error;
+
+  const bool tox_file_get_file_id_result = tox_file_get_file_id(
+    client_cdata->tox,
+    friend_number_data,
+    file_number_data,
+    file_id_data,
+    &tox_file_get_file_id_error
+  );
+
+  switch (tox_file_get_file_id_error) {
+    case TOX_ERR_FILE_GET_OK:
+      break;
+    case TOX_ERR_FILE_GET_NULL:
+      RAISE_FUNC_ERROR(
+        "tox_file_get_file_id",
+        mTox_eNullError,
+        "TOX_ERR_FILE_GET_NULL"
+      );
+    case TOX_ERR_FILE_GET_FRIEND_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "tox_file_get_file_id",
+        mTox_cFriend_eNotFoundError,
+        "TOX_ERR_FILE_GET_FRIEND_NOT_FOUND"
+      );
+    case TOX_ERR_FILE_GET_NOT_FOUND:
+      RAISE_FUNC_ERROR(
+        "tox_file_get_file_id",
+        rb_eRuntimeError,
+        "TOX_ERR_FILE_GET_NOT_FOUND"
+      );
+    default:
+      RAISE_FUNC_ERROR_DEFAULT("tox_file_get_file_id");
+  }
+
+  if (!tox_file_get_file_id_result) {
+    RAISE_FUNC_RESULT("tox_file_get_file_id");
+  }
+
+  return rb_str_new(file_id_data, TOX_FILE_ID_LENGTH);
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+mTox_cClient_CDATA *mTox_cInFriendFile_CLIENT_CDATA(
+  const VALUE self,
+  uint32_t *const friend_number_data,
+  uint32_t *const file_number_data
+)
+{
+  const VALUE friend      = rb_iv_get(self, "@friend");
+  const VALUE file_number = rb_iv_get(self, "@number");
+
+  const VALUE client        = rb_iv_get(friend, "@client");
+  const VALUE friend_number = rb_iv_get(friend, "@number");
+
+  CDATA(client, mTox_cClient_CDATA, client_cdata);
+
+  *friend_number_data = NUM2ULONG(friend_number);
+  *file_number_data   = NUM2ULONG(file_number);
+
+  return client_cdata;
+}
@@ -0,0 +1,621 @@
+#include "tox.h"
+
+#include <math.h>
+
+typedef struct {
+  uint64_t sequence;
+  size_t   length;
+  size_t   capacity;
+  int16_t *samples;
+} mTox_JITTER_BUFFER_PENDING;
+
+struct mTox_JITTER_BUFFER {
+  uint32_t friend_number;
+  uint32_t latency_msec;
+
+  uint8_t  channels;
+  uint32_t sampling_rate;
+
+  bool     playing;
+  uint64_t deadline;
+  size_t   concealed_in_row;
+
+  uint64_t last_arrival;
+  uint64_t last_duration;
+
+  bool     sequenced;
+  uint64_t next_sequence;
+
+  size_t                     pending_size;
+  mTox_JITTER_BUFFER_PENDING pending[mTox_JITTER_BUFFER_MAX_PENDING];
+
+  size_t   size;
+  size_t   capacity;
+  int16_t *samples;
+
+  size_t   frame_capacity;
+  int16_t *frame;
+
+  mTox_JITTER_BUFFER_STATS stats;
+};
+
+// Memory management
+static VALUE mTox_cJitterBuffer_alloc(VALUE klass);
+static void  mTox_cJitterBuffer_free(mTox_cJitterBuffer_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cJitterBuffer_pop(VALUE self, VALUE time);
+static VALUE mTox_cJitterBuffer_stats(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cJitterBuffer_initialize_with(VALUE self, VALUE latency);
+static VALUE mTox_cJitterBuffer_push_with(VALUE self, VALUE audio_frame, VALUE time, VALUE sequence);
+
+// Private functions
+
+static size_t mTox_JITTER_BUFFER_FRAME_SIZE(const mTox_JITTER_BUFFER *jitter_buffer);
+static size_t mTox_JITTER_BUFFER_MSEC_SIZE(const mTox_JITTER_BUFFER *jitter_buffer, uint32_t msec);
+static size_t mTox_JITTER_BUFFER_PENDING_LENGTH(const mTox_JITTER_BUFFER *jitter_buffer);
+static void   mTox_JITTER_BUFFER_APPEND(mTox_JITTER_BUFFER *jitter_buffer, const int16_t *pcm, size_t length);
+static void   mTox_JITTER_BUFFER_HOLD(mTox_JITTER_BUFFER *jitter_buffer, uint64_t sequence, const int16_t *pcm, size_t length);
+static void   mTox_JITTER_BUFFER_RELEASE(mTox_JITTER_BUFFER *jitter_buffer);
+static void   mTox_JITTER_BUFFER_CONCEAL(mTox_JITTER_BUFFER *jitter_buffer, size_t from, size_t length);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cJitterBuffer_INIT()
+{
+  // Private, specs reach it through spec/support/jitter_buffer.rb.
+  mTox_cJitterBuffer = rb_define_class_under(mTox, "JitterBuffer", rb_cObject);
+  rb_funcall(mTox, rb_intern("private_constant"), 1, ID2SYM(rb_intern("JitterBuffer")));
+
+  // Memory management
+  rb_define_alloc_func(mTox_cJitterBuffer, mTox_cJitterBuffer_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cJitterBuffer, "pop",   mTox_cJitterBuffer_pop,   1);
+  rb_define_method(mTox_cJitterBuffer, "stats", mTox_cJitterBuffer_stats, 0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cJitterBuffer, "initialize_with", mTox_cJitterBuffer_initialize_with, 1);
+  rb_define_private_method(mTox_cJitterBuffer, "push_with",       mTox_cJitterBuffer_push_with,       3);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cJitterBuffer_alloc(const VALUE klass)
+{
+  mTox_cJitterBuffer_CDATA *alloc_cdata = ALLOC(mTox_cJitterBuffer_CDATA);
+
+  alloc_cdata->jitter_buffer = NULL;
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cJitterBuffer_free, alloc_cdata);
+}
+
+void mTox_cJitterBuffer_free(mTox_cJitterBuffer_CDATA *const free_cdata)
+{
+  mTox_JITTER_BUFFER_FREE(free_cdata->jitter_buffer);
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::JitterBuffer#pop
+VALUE mTox_cJitterBuffer_pop(const VALUE self, const VALUE time)
+{
+  const uint64_t now = llround(NUM2DBL(time) * 1000000);
+
+  CDATA(self, mTox_cJitterBuffer_CDATA, self_cdata);
+
+  const int16_t *pcm_data;
+  size_t         sample_count_data;
+  uint8_t        channels_data;
+  uint32_t       sampling_rate_data;
+
+  if (!mTox_JITTER_BUFFER_POP(
+        self_cdata->jitter_buffer,
+        now,
+        &pcm_data,
+        &sample_count_data,
+        &channels_data,
+        &sampling_rate_data
+      )) {
+    return Qnil;
+  }
+
+  const VALUE audio_frame = rb_funcall(mTox_cAudioFrame, rb_intern("new"), 0);
+
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  mTox_cAudioFrame_SET_FORMAT(
+    audio_frame_cdata,
+    sample_count_data,
+    channels_data,
+    sampling_rate_data
+  );
+
+  mTox_cAudioFrame_SET_PCM(
+    audio_frame,
+    audio_frame_cdata,
+    rb_str_new(
+      (const char*)pcm_data,
+      sample_count_data * channels_data * sizeof(int16_t)
+    )
+  );
+
+  return audio_frame;
+}
+
+// Tox::JitterBuffer#stats
+VALUE mTox_cJitterBuffer_stats(const VALUE self)
+{
+  CDATA(self, mTox_cJitterBuffer_CDATA, self_cdata);
+
+  return mTox_JITTER_BUFFER_STATS_HASH(self_cdata->jitter_buffer);
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::JitterBuffer#initialize_with
+VALUE mTox_cJitterBuffer_initialize_with(const VALUE self, const VALUE latency)
+{
+  const uint32_t latency_msec_data = NUM2DBL(latency) * 1000;
+
+  CDATA(self, mTox_cJitterBuffer_CDATA, self_cdata);
+
+  mTox_JITTER_BUFFER_FREE(self_cdata->jitter_buffer);
+
+  self_cdata->jitter_buffer = mTox_JITTER_BUFFER_NEW(0, latency_msec_data);
+
+  return self;
+}
+
+// Tox::JitterBuffer#push_with
+VALUE mTox_cJitterBuffer_push_with(
+  const VALUE self,
+  const VALUE audio_frame,
+  const VALUE time,
+  const VALUE sequence
+)
+{
+  if (!mTox_cAudioFrame_IS(audio_frame)) {
+    RAISE_TYPECHECK(
+      "Tox::JitterBuffer#push",
+      "audio_frame",
+      "Tox::AudioFrame"
+    );
+  }
+
+  const uint64_t now = llround(NUM2DBL(time) * 1000000);
+
+  const uint64_t sequence_data =
+    Qnil == sequence ? mTox_JITTER_BUFFER_IN_ORDER : NUM2ULL(sequence);
+
+  CDATA(self, mTox_cJitterBuffer_CDATA, self_cdata);
+
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  if (!mTox_cAudioFrame_VALID(audio_frame_cdata)) {
+    rb_raise(rb_eArgError, "audio frame is invalid");
+  }
+
+  mTox_JITTER_BUFFER_PUSH(
+    self_cdata->jitter_buffer,
+    sequence_data,
+    (const int16_t*)RSTRING_PTR(audio_frame_cdata->pcm),
+    audio_frame_cdata->sample_count,
+    audio_frame_cdata->channels,
+    audio_frame_cdata->sampling_rate,
+    now
+  );
+
+  return self;
+}
+
+/*************************************************************
+ * Jitter buffers
+ *************************************************************/
+
+mTox_JITTER_BUFFER *mTox_JITTER_BUFFER_NEW(
+  const uint32_t friend_number,
+  const uint32_t latency_msec
+)
+{
+  mTox_JITTER_BUFFER *const jitter_buffer = ALLOC(mTox_JITTER_BUFFER);
+
+  memset(jitter_buffer, 0, sizeof(mTox_JITTER_BUFFER));
+
+  jitter_buffer->friend_number      = friend_number;
+  jitter_buffer->latency_msec       = latency_msec;
+  jitter_buffer->stats.latency_msec = latency_msec;
+
+  return jitter_buffer;
+}
+
+void mTox_JITTER_BUFFER_FREE(mTox_JITTER_BUFFER *const jitter_buffer)
+{
+  if (!jitter_buffer) {
+    return;
+  }
+
+  for (size_t i = 0; i < mTox_JITTER_BUFFER_MAX_PENDING; ++i) {
+    free(jitter_buffer->pending[i].samples);
+  }
+
+  free(jitter_buffer->samples);
+  free(jitter_buffer->frame);
+  free(jitter_buffer);
+}
+
+uint32_t mTox_JITTER_BUFFER_FRIEND_NUMBER(
+  const mTox_JITTER_BUFFER *const jitter_buffer
+)
+{
+  return jitter_buffer->friend_number;
+}
+
+uint64_t mTox_JITTER_BUFFER_DEADLINE(
+  const mTox_JITTER_BUFFER *const jitter_buffer
+)
+{
+  return jitter_buffer->playing ? jitter_buffer->deadline : UINT64_MAX;
+}
+
+// Jitter is estimated like in RFC 3550, from the difference between the
+// arrival interval and the duration of the previous frame.
+void mTox_JITTER_BUFFER_PUSH(
+  mTox_JITTER_BUFFER *const jitter_buffer,
+  const uint64_t sequence,
+  const int16_t *const pcm,
+  const size_t sample_count,
+  const uint8_t channels,
+  const uint32_t sampling_rate,
+  const uint64_t now
+)
+{
+  if (channels == 0 || sampling_rate == 0) {
+    return;
+  }
+
+  // The sender has switched the format, the buffered audio is useless.
+  if (channels != jitter_buffer->channels ||
+      sampling_rate != jitter_buffer->sampling_rate) {
+    jitter_buffer->channels      = channels;
+    jitter_buffer->sampling_rate = sampling_rate;
+    jitter_buffer->size          = 0;
+    jitter_buffer->playing       = false;
+    jitter_buffer->sequenced     = false;
+    jitter_buffer->pending_size  = 0;
+  }
+
+  if (jitter_buffer->stats.received > 0) {
+    const int64_t difference =
+      (int64_t)(now - jitter_buffer->last_arrival) -
+      (int64_t)jitter_buffer->last_duration;
+
+    const uint64_t deviation = difference < 0 ? -difference : difference;
+
+    jitter_buffer->stats.jitter_usec +=
+      ((int64_t)deviation - (int64_t)jitter_buffer->stats.jitter_usec) / 16;
+  }
+
+  jitter_buffer->last_arrival  = now;
+  jitter_buffer->last_duration =
+    (uint64_t)sample_count * 1000000 / sampling_rate;
+
+  ++jitter_buffer->stats.received;
+
+  const size_t length = sample_count * channels;
+
+  if (sequence == mTox_JITTER_BUFFER_IN_ORDER) {
+    mTox_JITTER_BUFFER_APPEND(jitter_buffer, pcm, length);
+  }
+  else if (!jitter_buffer->sequenced ||
+           sequence == jitter_buffer->next_sequence) {
+    jitter_buffer->sequenced     = true;
+    jitter_buffer->next_sequence = sequence + 1;
+
+    mTox_JITTER_BUFFER_APPEND(jitter_buffer, pcm, length);
+    mTox_JITTER_BUFFER_RELEASE(jitter_buffer);
+  }
+  // A duplicate, or too late: its place has been concealed.
+  else if (sequence < jitter_buffer->next_sequence) {
+    ++jitter_buffer->stats.dropped;
+  }
+  else {
+    mTox_JITTER_BUFFER_HOLD(jitter_buffer, sequence, pcm, length);
+  }
+
+  // Frames behind a gap count, as the gap is concealed when it is reached.
+  const size_t target =
+    mTox_JITTER_BUFFER_MSEC_SIZE(jitter_buffer, jitter_buffer->latency_msec);
+
+  if (!jitter_buffer->playing &&
+      jitter_buffer->size +
+        mTox_JITTER_BUFFER_PENDING_LENGTH(jitter_buffer) >= target) {
+    jitter_buffer->playing          = true;
+    jitter_buffer->deadline         = now;
+    jitter_buffer->concealed_in_row = 0;
+  }
+}
+
+bool mTox_JITTER_BUFFER_POP(
+  mTox_JITTER_BUFFER *const jitter_buffer,
+  const uint64_t now,
+  const int16_t **const pcm,
+  size_t *const sample_count,
+  uint8_t *const channels,
+  uint32_t *const sampling_rate
+)
+{
+  if (!jitter_buffer->playing || jitter_buffer->deadline > now) {
+    return false;
+  }
+
+  if (now > jitter_buffer->deadline + mTox_JITTER_BUFFER_MAX_LAG_USEC) {
+    jitter_buffer->deadline = now;
+  }
+
+  const size_t length = mTox_JITTER_BUFFER_FRAME_SIZE(jitter_buffer);
+
+  if (jitter_buffer->frame_capacity < length) {
+    REALLOC_N(jitter_buffer->frame, int16_t, length);
+    jitter_buffer->frame_capacity = length;
+  }
+
+  if (jitter_buffer->size >= length) {
+    memcpy(jitter_buffer->frame, jitter_buffer->samples, length * sizeof(int16_t));
+
+    jitter_buffer->concealed_in_row = 0;
+  }
+  else {
+    if (jitter_buffer->concealed_in_row == 0) {
+      ++jitter_buffer->stats.underruns;
+    }
+
+    if (jitter_buffer->concealed_in_row == mTox_JITTER_BUFFER_MAX_CONCEALED) {
+      jitter_buffer->playing = false;
+      return false;
+    }
+
+    ++jitter_buffer->concealed_in_row;
+    ++jitter_buffer->stats.concealed;
+
+    memcpy(
+      jitter_buffer->frame,
+      jitter_buffer->samples,
+      jitter_buffer->size * sizeof(int16_t)
+    );
+
+    mTox_JITTER_BUFFER_CONCEAL(jitter_buffer, jitter_buffer->size, length);
+  }
+
+  const size_t taken = jitter_buffer->size < length ? jitter_buffer->size : length;
+
+  memmove(
+    jitter_buffer->samples,
+    &jitter_buffer->samples[taken],
+    (jitter_buffer->size - taken) * sizeof(int16_t)
+  );
+
+  jitter_buffer->size -= taken;
+
+  // The concealed frame takes the place of the missing one, so the frames
+  // waiting behind it follow.
+  if (taken < length && jitter_buffer->pending_size > 0) {
+    ++jitter_buffer->next_sequence;
+    mTox_JITTER_BUFFER_RELEASE(jitter_buffer);
+  }
+
+  jitter_buffer->deadline += mTox_JITTER_BUFFER_FRAME_USEC;
+
+  ++jitter_buffer->stats.played;
+
+  *pcm           = jitter_buffer->frame;
+  *sample_count  = length / jitter_buffer->channels;
+  *channels      = jitter_buffer->channels;
+  *sampling_rate = jitter_buffer->sampling_rate;
+
+  return true;
+}
+
+void mTox_JITTER_BUFFER_GET_STATS(
+  const mTox_JITTER_BUFFER *const jitter_buffer,
+  mTox_JITTER_BUFFER_STATS *const stats
+)
+{
+  *stats = jitter_buffer->stats;
+
+  stats->buffered_msec = jitter_buffer->sampling_rate == 0 ? 0 :
+    (uint64_t)jitter_buffer->size * 1000 /
+    jitter_buffer->channels / jitter_buffer->sampling_rate;
+}
+
+VALUE mTox_JITTER_BUFFER_STATS_HASH(
+  const mTox_JITTER_BUFFER *const jitter_buffer
+)
+{
+  mTox_JITTER_BUFFER_STATS stats;
+
+  mTox_JITTER_BUFFER_GET_STATS(jitter_buffer, &stats);
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("latency")),   DBL2NUM(stats.latency_msec  * 0.001));
+  rb_hash_aset(result, ID2SYM(rb_intern("buffered")),  DBL2NUM(stats.buffered_msec * 0.001));
+  rb_hash_aset(result, ID2SYM(rb_intern("jitter")),    DBL2NUM(stats.jitter_usec   * 0.000001));
+  rb_hash_aset(result, ID2SYM(rb_intern("received")),  ULL2NUM(stats.received));
+  rb_hash_aset(result, ID2SYM(rb_intern("played")),    ULL2NUM(stats.played));
+  rb_hash_aset(result, ID2SYM(rb_intern("concealed")), ULL2NUM(stats.concealed));
+  rb_hash_aset(result, ID2SYM(rb_intern("underruns")), ULL2NUM(stats.underruns));
+  rb_hash_aset(result, ID2SYM(rb_intern("dropped")),   ULL2NUM(stats.dropped));
+
+  return result;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+size_t mTox_JITTER_BUFFER_FRAME_SIZE(
+  const mTox_JITTER_BUFFER *const jitter_buffer
+)
+{
+  return mTox_JITTER_BUFFER_MSEC_SIZE(
+    jitter_buffer,
+    mTox_JITTER_BUFFER_FRAME_USEC / 1000
+  );
+}
+
+size_t mTox_JITTER_BUFFER_MSEC_SIZE(
+  const mTox_JITTER_BUFFER *const jitter_buffer,
+  const uint32_t msec
+)
+{
+  return (size_t)jitter_buffer->sampling_rate * msec / 1000 *
+    jitter_buffer->channels;
+}
+
+size_t mTox_JITTER_BUFFER_PENDING_LENGTH(
+  const mTox_JITTER_BUFFER *const jitter_buffer
+)
+{
+  size_t length = 0;
+
+  for (size_t i = 0; i < jitter_buffer->pending_size; ++i) {
+    length += jitter_buffer->pending[i].length;
+  }
+
+  return length;
+}
+
+void mTox_JITTER_BUFFER_APPEND(
+  mTox_JITTER_BUFFER *const jitter_buffer,
+  const int16_t *const pcm,
+  const size_t length
+)
+{
+  const size_t capacity = mTox_JITTER_BUFFER_MSEC_SIZE(
+    jitter_buffer,
+    jitter_buffer->latency_msec + mTox_JITTER_BUFFER_MAX_EXCESS_MSEC
+  ) + length;
+
+  if (jitter_buffer->capacity < capacity) {
+    REALLOC_N(jitter_buffer->samples, int16_t, capacity);
+    jitter_buffer->capacity = capacity;
+  }
+
+  memcpy(
+    &jitter_buffer->samples[jitter_buffer->size],
+    pcm,
+    length * sizeof(int16_t)
+  );
+
+  jitter_buffer->size += length;
+
+  // Too far behind the sender, back to the target latency.
+  const size_t target =
+    mTox_JITTER_BUFFER_MSEC_SIZE(jitter_buffer, jitter_buffer->latency_msec);
+
+  if (jitter_buffer->size > capacity - length) {
+    const size_t dropped = jitter_buffer->size - target;
+
+    memmove(
+      jitter_buffer->samples,
+      &jitter_buffer->samples[dropped],
+      target * sizeof(int16_t)
+    );
+
+    jitter_buffer->size = target;
+
+    jitter_buffer->stats.dropped +=
+      dropped / mTox_JITTER_BUFFER_FRAME_SIZE(jitter_buffer);
+  }
+}
+
+// Keeps a frame that arrived before the ones in front of it. Duplicates
+// and frames beyond the pending limit are dropped.
+void mTox_JITTER_BUFFER_HOLD(
+  mTox_JITTER_BUFFER *const jitter_buffer,
+  const uint64_t sequence,
+  const int16_t *const pcm,
+  const size_t length
+)
+{
+  for (size_t i = 0; i < jitter_buffer->pending_size; ++i) {
+    if (jitter_buffer->pending[i].sequence == sequence) {
+      ++jitter_buffer->stats.dropped;
+      return;
+    }
+  }
+
+  if (jitter_buffer->pending_size == mTox_JITTER_BUFFER_MAX_PENDING) {
+    ++jitter_buffer->stats.dropped;
+    return;
+  }
+
+  mTox_JITTER_BUFFER_PENDING *const pending =
+    &jitter_buffer->pending[jitter_buffer->pending_size++];
+
+  if (pending->capacity < length) {
+    REALLOC_N(pending->samples, int16_t, length);
+    pending->capacity = length;
+  }
+
+  memcpy(pending->samples, pcm, length * sizeof(int16_t));
+
+  pending->sequence = sequence;
+  pending->length   = length;
+}
+
+// Appends the pending frames that follow the buffered ones.
+void mTox_JITTER_BUFFER_RELEASE(mTox_JITTER_BUFFER *const jitter_buffer)
+{
+  size_t i = 0;
+
+  while (i < jitter_buffer->pending_size) {
+    mTox_JITTER_BUFFER_PENDING *const pending = &jitter_buffer->pending[i];
+
+    if (pending->sequence != jitter_buffer->next_sequence) {
+      ++i;
+      continue;
+    }
+
+    mTox_JITTER_BUFFER_APPEND(jitter_buffer, pending->samples, pending->length);
+
+    ++jitter_buffer->next_sequence;
+
+    // Slots keep their samples for reuse, so they are swapped, not copied.
+    const mTox_JITTER_BUFFER_PENDING released = *pending;
+
+    *pending = jitter_buffer->pending[--jitter_buffer->pending_size];
+    jitter_buffer->pending[jitter_buffer->pending_size] = released;
+
+    i = 0;
+  }
+}
+
+// The frame before the gap still holds the previous output, so the gap is
+// filled with it, halved for every concealed frame in a row.
+void mTox_JITTER_BUFFER_CONCEAL(
+  mTox_JITTER_BUFFER *const jitter_buffer,
+  const size_t from,
+  const size_t length
+)
+{
+  for (size_t i = from; i < length; ++i) {
+    jitter_buffer->frame[i] >>= 1;
+  }
+}
@@ -0,0 +1,80 @@
+// Jitter buffers of received audio. Decoded frames of a friend are queued
+// until the target latency is buffered, then the audio/video instance
+// takes 20 ms frames from the queue on its own schedule, so consumers see
+// a steady cadence whatever the arrival times were. Gaps are concealed by
+// fading out the last frame; when they last longer, the buffer refills to
+// the target latency before playing again.
+//
+// Frames can carry sequence numbers, one per 20 ms frame. Those arriving
+// early wait until the frames before them arrive or are given up on and
+// concealed; duplicates and frames arriving after that are dropped.
+
+#define mTox_JITTER_BUFFER_FRAME_USEC   20000
+#define mTox_JITTER_BUFFER_MAX_LAG_USEC 200000
+
+// Frames concealed before the buffer stops and refills.
+#define mTox_JITTER_BUFFER_MAX_CONCEALED 5
+
+// Audio buffered above the target latency before the oldest is dropped.
+#define mTox_JITTER_BUFFER_MAX_EXCESS_MSEC 120
+
+// Frames waiting for earlier sequence numbers.
+#define mTox_JITTER_BUFFER_MAX_PENDING 16
+
+// Sequence number of frames that arrive in order, like the ones decoded by
+// toxav.
+#define mTox_JITTER_BUFFER_IN_ORDER UINT64_MAX
+
+typedef struct mTox_JITTER_BUFFER mTox_JITTER_BUFFER;
+
+typedef struct {
+  uint32_t latency_msec;
+  uint32_t buffered_msec;
+  uint64_t jitter_usec;
+  uint64_t received;
+  uint64_t played;
+  uint64_t concealed;
+  uint64_t underruns;
+  uint64_t dropped;
+} mTox_JITTER_BUFFER_STATS;
+
+mTox_JITTER_BUFFER *mTox_JITTER_BUFFER_NEW(
+  uint32_t friend_number,
+  uint32_t latency_msec
+);
+
+void mTox_JITTER_BUFFER_FREE(mTox_JITTER_BUFFER *jitter_buffer);
+
+uint32_t mTox_JITTER_BUFFER_FRIEND_NUMBER(const mTox_JITTER_BUFFER *jitter_buffer);
+
+// UINT64_MAX while the buffer is filling.
+uint64_t mTox_JITTER_BUFFER_DEADLINE(const mTox_JITTER_BUFFER *jitter_buffer);
+
+void mTox_JITTER_BUFFER_PUSH(
+  mTox_JITTER_BUFFER *jitter_buffer,
+  uint64_t sequence,
+  const int16_t *pcm,
+  size_t sample_count,
+  uint8_t channels,
+  uint32_t sampling_rate,
+  uint64_t now
+);
+
+// Takes the next frame if it is due. The samples stay valid until the
+// buffer is changed or freed.
+bool mTox_JITTER_BUFFER_POP(
+  mTox_JITTER_BUFFER *jitter_buffer,
+  uint64_t now,
+  const int16_t **pcm,
+  size_t *sample_count,
+  uint8_t *channels,
+  uint32_t *sampling_rate
+);
+
+void mTox_JITTER_BUFFER_GET_STATS(
+  const mTox_JITTER_BUFFER *jitter_buffer,
+  mTox_JITTER_BUFFER_STATS *stats
+);
+
+// Stats for Ruby, in seconds.
+VALUE mTox_JITTER_BUFFER_STATS_HASH(const mTox_JITTER_BUFFER *jitter_buffer);
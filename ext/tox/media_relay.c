@@ -0,0 +1,699 @@
+#include "tox.h"
+
+typedef struct {
+  uint32_t friend_number;
+  uint32_t video_backoff;
+  uint32_t video_skip;
+} mTox_MEDIA_RELAY_SINK_DATA;
+
+typedef struct {
+  int16_t *pcm;
+  size_t   sample_count;
+  uint8_t  channels;
+  uint32_t sampling_rate;
+} mTox_MEDIA_RELAY_AUDIO_FRAME;
+
+struct mTox_MEDIA_RELAY {
+  uint32_t friend_number;
+
+  size_t                      sinks_size;
+  mTox_MEDIA_RELAY_SINK_DATA *sinks;
+
+  size_t video_first;
+  bool   video_left;
+
+  // Pending audio frames, oldest first from "audio_first".
+  mTox_MEDIA_RELAY_AUDIO_FRAME audio[mTox_MEDIA_RELAY_MAX_PENDING_AUDIO];
+  size_t                       audio_first;
+  size_t                       audio_size;
+
+  // Pending video frame and the buffer kept for the next one.
+  uint8_t *video;
+  uint16_t video_width;
+  uint16_t video_height;
+  uint8_t *planes;
+  size_t   planes_size;
+
+  mTox_MEDIA_RELAY_STATS stats;
+};
+
+// Memory management
+static VALUE mTox_cMediaRelay_alloc(VALUE klass);
+static void  mTox_cMediaRelay_free(mTox_cMediaRelay_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cMediaRelay_initialize(VALUE self);
+static VALUE mTox_cMediaRelay_sinks(VALUE self);
+static VALUE mTox_cMediaRelay_video_order(VALUE self);
+static VALUE mTox_cMediaRelay_audio_received(VALUE self);
+static VALUE mTox_cMediaRelay_video_received(VALUE self);
+static VALUE mTox_cMediaRelay_stats(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cMediaRelay_add_sink_with(VALUE self, VALUE sink);
+static VALUE mTox_cMediaRelay_remove_sink_with(VALUE self, VALUE sink);
+static VALUE mTox_cMediaRelay_audio_sent_with(VALUE self, VALUE sink, VALUE congested);
+static VALUE mTox_cMediaRelay_video_sent_with(VALUE self, VALUE sink, VALUE congested);
+static VALUE mTox_cMediaRelay_video_due_with(VALUE self, VALUE index);
+static VALUE mTox_cMediaRelay_video_left_with(VALUE self, VALUE sink);
+
+// Private functions
+
+static mTox_MEDIA_RELAY_SINK_DATA *mTox_MEDIA_RELAY_FIND(mTox_MEDIA_RELAY *media_relay, uint32_t sink);
+static void mTox_MEDIA_RELAY_CONGESTED(mTox_MEDIA_RELAY_SINK_DATA *sink);
+static size_t mTox_MEDIA_RELAY_PLANES_SIZE(uint16_t width, uint16_t height);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cMediaRelay_INIT()
+{
+  // Private, spec/support/media_relay.rb reaches the bookkeeping.
+  mTox_cMediaRelay = rb_define_class_under(mTox, "MediaRelay", rb_cObject);
+  rb_funcall(mTox, rb_intern("private_constant"), 1, ID2SYM(rb_intern("MediaRelay")));
+
+  // Memory management
+  rb_define_alloc_func(mTox_cMediaRelay, mTox_cMediaRelay_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cMediaRelay, "initialize",     mTox_cMediaRelay_initialize,     0);
+  rb_define_method(mTox_cMediaRelay, "sinks",          mTox_cMediaRelay_sinks,          0);
+  rb_define_method(mTox_cMediaRelay, "video_order",    mTox_cMediaRelay_video_order,    0);
+  rb_define_method(mTox_cMediaRelay, "audio_received", mTox_cMediaRelay_audio_received, 0);
+  rb_define_method(mTox_cMediaRelay, "video_received", mTox_cMediaRelay_video_received, 0);
+  rb_define_method(mTox_cMediaRelay, "stats",          mTox_cMediaRelay_stats,          0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cMediaRelay, "add_sink_with",    mTox_cMediaRelay_add_sink_with,    1);
+  rb_define_private_method(mTox_cMediaRelay, "remove_sink_with", mTox_cMediaRelay_remove_sink_with, 1);
+  rb_define_private_method(mTox_cMediaRelay, "audio_sent_with",  mTox_cMediaRelay_audio_sent_with,  2);
+  rb_define_private_method(mTox_cMediaRelay, "video_sent_with",  mTox_cMediaRelay_video_sent_with,  2);
+  rb_define_private_method(mTox_cMediaRelay, "video_due_with",   mTox_cMediaRelay_video_due_with,   1);
+  rb_define_private_method(mTox_cMediaRelay, "video_left_with",  mTox_cMediaRelay_video_left_with,  1);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cMediaRelay_alloc(const VALUE klass)
+{
+  mTox_cMediaRelay_CDATA *alloc_cdata = ALLOC(mTox_cMediaRelay_CDATA);
+
+  alloc_cdata->media_relay = NULL;
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cMediaRelay_free, alloc_cdata);
+}
+
+void mTox_cMediaRelay_free(mTox_cMediaRelay_CDATA *const free_cdata)
+{
+  if (free_cdata->media_relay) {
+    mTox_MEDIA_RELAY_FREE(free_cdata->media_relay);
+  }
+
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::MediaRelay#initialize
+VALUE mTox_cMediaRelay_initialize(const VALUE self)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  if (self_cdata->media_relay) {
+    mTox_MEDIA_RELAY_FREE(self_cdata->media_relay);
+  }
+
+  self_cdata->media_relay = mTox_MEDIA_RELAY_NEW(0);
+
+  return self;
+}
+
+// Tox::MediaRelay#sinks
+VALUE mTox_cMediaRelay_sinks(const VALUE self)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  const mTox_MEDIA_RELAY *const media_relay = self_cdata->media_relay;
+
+  const VALUE result = rb_ary_new();
+
+  for (size_t i = 0; i < media_relay->sinks_size; ++i) {
+    rb_ary_push(result, ULONG2NUM(media_relay->sinks[i].friend_number));
+  }
+
+  return result;
+}
+
+// Tox::MediaRelay#video_order
+VALUE mTox_cMediaRelay_video_order(const VALUE self)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  const mTox_MEDIA_RELAY *const media_relay = self_cdata->media_relay;
+
+  const VALUE result = rb_ary_new();
+
+  for (size_t k = 0; k < media_relay->sinks_size; ++k) {
+    const size_t i = (media_relay->video_first + k) % media_relay->sinks_size;
+
+    rb_ary_push(result, ULONG2NUM(media_relay->sinks[i].friend_number));
+  }
+
+  return result;
+}
+
+// Tox::MediaRelay#audio_received
+VALUE mTox_cMediaRelay_audio_received(const VALUE self)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  mTox_MEDIA_RELAY_AUDIO_RECEIVED(self_cdata->media_relay);
+
+  return self;
+}
+
+// Tox::MediaRelay#video_received
+VALUE mTox_cMediaRelay_video_received(const VALUE self)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  mTox_MEDIA_RELAY_VIDEO_RECEIVED(self_cdata->media_relay);
+
+  return self;
+}
+
+// Tox::MediaRelay#stats
+VALUE mTox_cMediaRelay_stats(const VALUE self)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  return mTox_MEDIA_RELAY_STATS_HASH(self_cdata->media_relay);
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::MediaRelay#add_sink_with
+VALUE mTox_cMediaRelay_add_sink_with(const VALUE self, const VALUE sink)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  if (mTox_MEDIA_RELAY_ADD_SINK(self_cdata->media_relay, NUM2ULONG(sink))) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::MediaRelay#remove_sink_with
+VALUE mTox_cMediaRelay_remove_sink_with(const VALUE self, const VALUE sink)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  if (mTox_MEDIA_RELAY_REMOVE_SINK(self_cdata->media_relay, NUM2ULONG(sink))) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::MediaRelay#audio_sent_with
+VALUE mTox_cMediaRelay_audio_sent_with(
+  const VALUE self,
+  const VALUE sink,
+  const VALUE congested
+)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  mTox_MEDIA_RELAY_AUDIO_SENT(
+    self_cdata->media_relay,
+    NUM2ULONG(sink),
+    RTEST(congested)
+  );
+
+  return self;
+}
+
+// Tox::MediaRelay#video_sent_with
+VALUE mTox_cMediaRelay_video_sent_with(
+  const VALUE self,
+  const VALUE sink,
+  const VALUE congested
+)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  mTox_MEDIA_RELAY_VIDEO_SENT(
+    self_cdata->media_relay,
+    NUM2ULONG(sink),
+    RTEST(congested)
+  );
+
+  return self;
+}
+
+// Tox::MediaRelay#video_due_with
+VALUE mTox_cMediaRelay_video_due_with(const VALUE self, const VALUE index)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  if (mTox_MEDIA_RELAY_VIDEO_DUE(self_cdata->media_relay, NUM2SIZET(index))) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+// Tox::MediaRelay#video_left_with
+VALUE mTox_cMediaRelay_video_left_with(const VALUE self, const VALUE sink)
+{
+  CDATA(self, mTox_cMediaRelay_CDATA, self_cdata);
+
+  mTox_MEDIA_RELAY_VIDEO_LEFT(self_cdata->media_relay, NUM2ULONG(sink));
+
+  return self;
+}
+
+/*************************************************************
+ * Media relay
+ *************************************************************/
+
+mTox_MEDIA_RELAY *mTox_MEDIA_RELAY_NEW(const uint32_t friend_number)
+{
+  mTox_MEDIA_RELAY *const media_relay = ALLOC(mTox_MEDIA_RELAY);
+
+  memset(media_relay, 0, sizeof(mTox_MEDIA_RELAY));
+
+  media_relay->friend_number = friend_number;
+
+  return media_relay;
+}
+
+void mTox_MEDIA_RELAY_FREE(mTox_MEDIA_RELAY *const media_relay)
+{
+  if (!media_relay) {
+    return;
+  }
+
+  for (size_t i = 0; i < media_relay->audio_size; ++i) {
+    const size_t index =
+      (media_relay->audio_first + i) % mTox_MEDIA_RELAY_MAX_PENDING_AUDIO;
+
+    free(media_relay->audio[index].pcm);
+  }
+
+  free(media_relay->sinks);
+  free(media_relay->video);
+  free(media_relay->planes);
+  free(media_relay);
+}
+
+uint32_t mTox_MEDIA_RELAY_FRIEND_NUMBER(
+  const mTox_MEDIA_RELAY *const media_relay
+)
+{
+  return media_relay->friend_number;
+}
+
+bool mTox_MEDIA_RELAY_ADD_SINK(
+  mTox_MEDIA_RELAY *const media_relay,
+  const uint32_t sink
+)
+{
+  if (mTox_MEDIA_RELAY_FIND(media_relay, sink)) {
+    return false;
+  }
+
+  REALLOC_N(
+    media_relay->sinks,
+    mTox_MEDIA_RELAY_SINK_DATA,
+    media_relay->sinks_size + 1
+  );
+
+  mTox_MEDIA_RELAY_SINK_DATA *const sink_data =
+    &media_relay->sinks[media_relay->sinks_size++];
+
+  memset(sink_data, 0, sizeof(mTox_MEDIA_RELAY_SINK_DATA));
+
+  sink_data->friend_number = sink;
+
+  return true;
+}
+
+bool mTox_MEDIA_RELAY_REMOVE_SINK(
+  mTox_MEDIA_RELAY *const media_relay,
+  const uint32_t sink
+)
+{
+  mTox_MEDIA_RELAY_SINK_DATA *const sink_data =
+    mTox_MEDIA_RELAY_FIND(media_relay, sink);
+
+  if (!sink_data) {
+    return false;
+  }
+
+  *sink_data = media_relay->sinks[--media_relay->sinks_size];
+
+  if (media_relay->video_first >= media_relay->sinks_size) {
+    media_relay->video_first = 0;
+  }
+
+  return true;
+}
+
+size_t mTox_MEDIA_RELAY_SINKS_SIZE(const mTox_MEDIA_RELAY *const media_relay)
+{
+  return media_relay->sinks_size;
+}
+
+uint32_t mTox_MEDIA_RELAY_SINK(
+  const mTox_MEDIA_RELAY *const media_relay,
+  const size_t index
+)
+{
+  return media_relay->sinks[index].friend_number;
+}
+
+void mTox_MEDIA_RELAY_AUDIO_RECEIVED(mTox_MEDIA_RELAY *const media_relay)
+{
+  ++media_relay->stats.audio_frames;
+}
+
+void mTox_MEDIA_RELAY_VIDEO_RECEIVED(mTox_MEDIA_RELAY *const media_relay)
+{
+  ++media_relay->stats.video_frames;
+
+  media_relay->video_left = false;
+}
+
+void mTox_MEDIA_RELAY_AUDIO_SENT(
+  mTox_MEDIA_RELAY *const media_relay,
+  const uint32_t sink,
+  const bool congested
+)
+{
+  mTox_MEDIA_RELAY_SINK_DATA *const sink_data =
+    mTox_MEDIA_RELAY_FIND(media_relay, sink);
+
+  if (!sink_data) {
+    return;
+  }
+
+  if (congested) {
+    ++media_relay->stats.audio_failed;
+    mTox_MEDIA_RELAY_CONGESTED(sink_data);
+  }
+  else {
+    ++media_relay->stats.audio_sent;
+  }
+}
+
+void mTox_MEDIA_RELAY_VIDEO_SENT(
+  mTox_MEDIA_RELAY *const media_relay,
+  const uint32_t sink,
+  const bool congested
+)
+{
+  mTox_MEDIA_RELAY_SINK_DATA *const sink_data =
+    mTox_MEDIA_RELAY_FIND(media_relay, sink);
+
+  if (!sink_data) {
+    return;
+  }
+
+  if (congested) {
+    ++media_relay->stats.video_failed;
+    mTox_MEDIA_RELAY_CONGESTED(sink_data);
+  }
+  else {
+    ++media_relay->stats.video_sent;
+    sink_data->video_backoff /= 2;
+  }
+}
+
+size_t mTox_MEDIA_RELAY_VIDEO_FIRST(const mTox_MEDIA_RELAY *const media_relay)
+{
+  return media_relay->video_first;
+}
+
+bool mTox_MEDIA_RELAY_VIDEO_DUE(
+  mTox_MEDIA_RELAY *const media_relay,
+  const size_t index
+)
+{
+  mTox_MEDIA_RELAY_SINK_DATA *const sink_data = &media_relay->sinks[index];
+
+  if (sink_data->video_skip > 0) {
+    --sink_data->video_skip;
+    ++media_relay->stats.video_dropped;
+    return false;
+  }
+
+  return true;
+}
+
+void mTox_MEDIA_RELAY_VIDEO_LEFT(
+  mTox_MEDIA_RELAY *const media_relay,
+  const uint32_t sink
+)
+{
+  mTox_MEDIA_RELAY_SINK_DATA *const sink_data =
+    mTox_MEDIA_RELAY_FIND(media_relay, sink);
+
+  if (!sink_data) {
+    return;
+  }
+
+  ++media_relay->stats.video_dropped;
+
+  if (!media_relay->video_left) {
+    media_relay->video_left  = true;
+    media_relay->video_first = sink_data - media_relay->sinks;
+  }
+}
+
+void mTox_MEDIA_RELAY_PUSH_AUDIO(
+  mTox_MEDIA_RELAY *const media_relay,
+  const int16_t *const pcm,
+  const size_t sample_count,
+  const uint8_t channels,
+  const uint32_t sampling_rate
+)
+{
+  if (media_relay->audio_size == mTox_MEDIA_RELAY_MAX_PENDING_AUDIO) {
+    free(media_relay->audio[media_relay->audio_first].pcm);
+
+    media_relay->audio_first =
+      (media_relay->audio_first + 1) % mTox_MEDIA_RELAY_MAX_PENDING_AUDIO;
+
+    --media_relay->audio_size;
+  }
+
+  const size_t index =
+    (media_relay->audio_first + media_relay->audio_size++) %
+    mTox_MEDIA_RELAY_MAX_PENDING_AUDIO;
+
+  mTox_MEDIA_RELAY_AUDIO_FRAME *const frame = &media_relay->audio[index];
+
+  frame->pcm           = ALLOC_N(int16_t, sample_count * channels);
+  frame->sample_count  = sample_count;
+  frame->channels      = channels;
+  frame->sampling_rate = sampling_rate;
+
+  memcpy(frame->pcm, pcm, sample_count * channels * sizeof(int16_t));
+}
+
+void mTox_MEDIA_RELAY_PUSH_VIDEO(
+  mTox_MEDIA_RELAY *const media_relay,
+  const uint16_t width,
+  const uint16_t height,
+  const uint8_t *const y,
+  const uint8_t *const u,
+  const uint8_t *const v,
+  const int32_t ystride,
+  const int32_t ustride,
+  const int32_t vstride
+)
+{
+  const size_t y_size  = (size_t)width * height;
+  const size_t uv_size = (size_t)(width / 2) * (height / 2);
+  const size_t size    = mTox_MEDIA_RELAY_PLANES_SIZE(width, height);
+
+  uint8_t *planes;
+  size_t   planes_size;
+
+  if (media_relay->video) {
+    media_relay->stats.video_dropped += media_relay->sinks_size;
+
+    planes      = media_relay->video;
+    planes_size = mTox_MEDIA_RELAY_PLANES_SIZE(
+      media_relay->video_width,
+      media_relay->video_height
+    );
+  }
+  else {
+    planes      = media_relay->planes;
+    planes_size = media_relay->planes_size;
+
+    media_relay->planes      = NULL;
+    media_relay->planes_size = 0;
+  }
+
+  if (!planes || planes_size != size) {
+    REALLOC_N(planes, uint8_t, size);
+  }
+
+  uint8_t *const y_plane = planes;
+  uint8_t *const u_plane = &y_plane[y_size];
+  uint8_t *const v_plane = &u_plane[uv_size];
+
+  for (size_t h = 0; h < height; ++h) {
+    memcpy(&y_plane[h * width], &y[h * ystride], width);
+  }
+
+  for (size_t h = 0; h < height / 2; ++h) {
+    memcpy(&u_plane[h * (width / 2)], &u[h * ustride], width / 2);
+    memcpy(&v_plane[h * (width / 2)], &v[h * vstride], width / 2);
+  }
+
+  media_relay->video        = planes;
+  media_relay->video_width  = width;
+  media_relay->video_height = height;
+}
+
+int16_t *mTox_MEDIA_RELAY_TAKE_AUDIO(
+  mTox_MEDIA_RELAY *const media_relay,
+  size_t *const sample_count,
+  uint8_t *const channels,
+  uint32_t *const sampling_rate
+)
+{
+  if (media_relay->audio_size == 0) {
+    return NULL;
+  }
+
+  const mTox_MEDIA_RELAY_AUDIO_FRAME *const frame =
+    &media_relay->audio[media_relay->audio_first];
+
+  *sample_count  = frame->sample_count;
+  *channels      = frame->channels;
+  *sampling_rate = frame->sampling_rate;
+
+  media_relay->audio_first =
+    (media_relay->audio_first + 1) % mTox_MEDIA_RELAY_MAX_PENDING_AUDIO;
+
+  --media_relay->audio_size;
+
+  return frame->pcm;
+}
+
+uint8_t *mTox_MEDIA_RELAY_TAKE_VIDEO(
+  mTox_MEDIA_RELAY *const media_relay,
+  uint16_t *const width,
+  uint16_t *const height
+)
+{
+  uint8_t *const planes = media_relay->video;
+
+  *width  = media_relay->video_width;
+  *height = media_relay->video_height;
+
+  media_relay->video = NULL;
+
+  return planes;
+}
+
+void mTox_MEDIA_RELAY_VIDEO_DONE(
+  mTox_MEDIA_RELAY *const media_relay,
+  uint8_t *const planes,
+  const uint16_t width,
+  const uint16_t height
+)
+{
+  if (!media_relay || media_relay->planes) {
+    free(planes);
+    return;
+  }
+
+  media_relay->planes      = planes;
+  media_relay->planes_size = mTox_MEDIA_RELAY_PLANES_SIZE(width, height);
+}
+
+void mTox_MEDIA_RELAY_GET_STATS(
+  const mTox_MEDIA_RELAY *const media_relay,
+  mTox_MEDIA_RELAY_STATS *const stats
+)
+{
+  *stats = media_relay->stats;
+
+  stats->sinks = media_relay->sinks_size;
+}
+
+VALUE mTox_MEDIA_RELAY_STATS_HASH(const mTox_MEDIA_RELAY *const media_relay)
+{
+  mTox_MEDIA_RELAY_STATS stats;
+
+  mTox_MEDIA_RELAY_GET_STATS(media_relay, &stats);
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("sinks")),         SIZET2NUM(stats.sinks));
+  rb_hash_aset(result, ID2SYM(rb_intern("audio_frames")),  ULL2NUM(stats.audio_frames));
+  rb_hash_aset(result, ID2SYM(rb_intern("video_frames")),  ULL2NUM(stats.video_frames));
+  rb_hash_aset(result, ID2SYM(rb_intern("audio_sent")),    ULL2NUM(stats.audio_sent));
+  rb_hash_aset(result, ID2SYM(rb_intern("video_sent")),    ULL2NUM(stats.video_sent));
+  rb_hash_aset(result, ID2SYM(rb_intern("audio_failed")),  ULL2NUM(stats.audio_failed));
+  rb_hash_aset(result, ID2SYM(rb_intern("video_failed")),  ULL2NUM(stats.video_failed));
+  rb_hash_aset(result, ID2SYM(rb_intern("video_dropped")), ULL2NUM(stats.video_dropped));
+
+  return result;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+mTox_MEDIA_RELAY_SINK_DATA *mTox_MEDIA_RELAY_FIND(
+  mTox_MEDIA_RELAY *const media_relay,
+  const uint32_t sink
+)
+{
+  for (size_t i = 0; i < media_relay->sinks_size; ++i) {
+    if (media_relay->sinks[i].friend_number == sink) {
+      return &media_relay->sinks[i];
+    }
+  }
+
+  return NULL;
+}
+
+void mTox_MEDIA_RELAY_CONGESTED(mTox_MEDIA_RELAY_SINK_DATA *const sink)
+{
+  if (sink->video_backoff == 0) {
+    sink->video_backoff = 1;
+  }
+  else if (sink->video_backoff < mTox_MEDIA_RELAY_MAX_VIDEO_BACKOFF) {
+    sink->video_backoff *= 2;
+  }
+
+  sink->video_skip = sink->video_backoff;
+}
+
+size_t mTox_MEDIA_RELAY_PLANES_SIZE(const uint16_t width, const uint16_t height)
+{
+  return (size_t)width * height + 2 * (size_t)(width / 2) * (height / 2);
+}
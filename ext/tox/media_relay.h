@@ -0,0 +1,131 @@
+// Relays of calls. Frames received from a source friend are forwarded to
+// sink friends by the next iteration, so they are decoded once and encoded
+// by toxav for every sink without going through Ruby. Video is dropped before
+// audio: a sink whose send fails because of congestion skips video frames,
+// twice as many after every further failure, and sinks which are left when
+// forwarding a video frame takes longer than its budget skip that frame
+// and get the next one first.
+
+#define mTox_MEDIA_RELAY_VIDEO_BUDGET_USEC 20000
+
+// Video frames which a congested sink skips at most in a row.
+#define mTox_MEDIA_RELAY_MAX_VIDEO_BACKOFF 64
+
+// Audio frames kept until the next iteration at most, the oldest ones are
+// dropped. Only the newest video frame is kept.
+#define mTox_MEDIA_RELAY_MAX_PENDING_AUDIO 8
+
+typedef struct mTox_MEDIA_RELAY mTox_MEDIA_RELAY;
+
+typedef struct {
+  size_t   sinks;
+  uint64_t audio_frames;
+  uint64_t video_frames;
+  uint64_t audio_sent;
+  uint64_t video_sent;
+  uint64_t audio_failed;
+  uint64_t video_failed;
+  uint64_t video_dropped;
+} mTox_MEDIA_RELAY_STATS;
+
+mTox_MEDIA_RELAY *mTox_MEDIA_RELAY_NEW(uint32_t friend_number);
+
+void mTox_MEDIA_RELAY_FREE(mTox_MEDIA_RELAY *media_relay);
+
+// Of the source.
+uint32_t mTox_MEDIA_RELAY_FRIEND_NUMBER(const mTox_MEDIA_RELAY *media_relay);
+
+// Return false when the sink was already there or was not.
+bool mTox_MEDIA_RELAY_ADD_SINK(mTox_MEDIA_RELAY *media_relay, uint32_t sink);
+bool mTox_MEDIA_RELAY_REMOVE_SINK(mTox_MEDIA_RELAY *media_relay, uint32_t sink);
+
+size_t   mTox_MEDIA_RELAY_SINKS_SIZE(const mTox_MEDIA_RELAY *media_relay);
+uint32_t mTox_MEDIA_RELAY_SINK(const mTox_MEDIA_RELAY *media_relay, size_t index);
+
+// Frames received from the source.
+void mTox_MEDIA_RELAY_AUDIO_RECEIVED(mTox_MEDIA_RELAY *media_relay);
+void mTox_MEDIA_RELAY_VIDEO_RECEIVED(mTox_MEDIA_RELAY *media_relay);
+
+// Results of sends, by friend number because sinks may have changed while
+// the frame was sent. Sinks which are gone are ignored. Congestion of
+// either kind makes the sink skip video.
+void mTox_MEDIA_RELAY_AUDIO_SENT(
+  mTox_MEDIA_RELAY *media_relay,
+  uint32_t sink,
+  bool congested
+);
+
+void mTox_MEDIA_RELAY_VIDEO_SENT(
+  mTox_MEDIA_RELAY *media_relay,
+  uint32_t sink,
+  bool congested
+);
+
+// Index of the sink which gets the next video frame first.
+size_t mTox_MEDIA_RELAY_VIDEO_FIRST(const mTox_MEDIA_RELAY *media_relay);
+
+// Returns false when the sink skips the video frame because of congestion,
+// which is counted as dropped.
+bool mTox_MEDIA_RELAY_VIDEO_DUE(mTox_MEDIA_RELAY *media_relay, size_t index);
+
+// The sink was due but the video frame ran out of its budget before it was
+// sent to it. The first sink left of a frame gets the next one first.
+void mTox_MEDIA_RELAY_VIDEO_LEFT(mTox_MEDIA_RELAY *media_relay, uint32_t sink);
+
+// Copy frames received from the source, in toxav callbacks, until the next
+// iteration takes them. A video frame which was not taken yet is replaced
+// and counted as dropped for every sink.
+void mTox_MEDIA_RELAY_PUSH_AUDIO(
+  mTox_MEDIA_RELAY *media_relay,
+  const int16_t *pcm,
+  size_t sample_count,
+  uint8_t channels,
+  uint32_t sampling_rate
+);
+
+void mTox_MEDIA_RELAY_PUSH_VIDEO(
+  mTox_MEDIA_RELAY *media_relay,
+  uint16_t width,
+  uint16_t height,
+  const uint8_t *y,
+  const uint8_t *u,
+  const uint8_t *v,
+  int32_t ystride,
+  int32_t ustride,
+  int32_t vstride
+);
+
+// Takes the oldest pending audio frame, which the caller frees. Returns
+// NULL when there is none.
+int16_t *mTox_MEDIA_RELAY_TAKE_AUDIO(
+  mTox_MEDIA_RELAY *media_relay,
+  size_t *sample_count,
+  uint8_t *channels,
+  uint32_t *sampling_rate
+);
+
+// Takes the pending video frame as planes without row padding in one
+// buffer, so it can be sent from while the relay changes or goes away, and
+// given back with mTox_MEDIA_RELAY_VIDEO_DONE. Returns NULL when there is
+// none.
+uint8_t *mTox_MEDIA_RELAY_TAKE_VIDEO(
+  mTox_MEDIA_RELAY *media_relay,
+  uint16_t *width,
+  uint16_t *height
+);
+
+// Keeps the buffer for the next frame, frees it when "media_relay" is NULL.
+void mTox_MEDIA_RELAY_VIDEO_DONE(
+  mTox_MEDIA_RELAY *media_relay,
+  uint8_t *planes,
+  uint16_t width,
+  uint16_t height
+);
+
+void mTox_MEDIA_RELAY_GET_STATS(
+  const mTox_MEDIA_RELAY *media_relay,
+  mTox_MEDIA_RELAY_STATS *stats
+);
+
+// Stats for Ruby, frames are counted since the relay was created.
+VALUE mTox_MEDIA_RELAY_STATS_HASH(const mTox_MEDIA_RELAY *media_relay);
@@ -0,0 +1,46 @@
+#include "tox.h"
+
+void mTox_MEMORY_VIEW_EXPORT(
+  const VALUE owner,
+  VALUE *const exports,
+  const VALUE string
+)
+{
+  if (Qnil == *exports) {
+    RB_OBJ_WRITE(owner, exports, rb_ary_new());
+  }
+
+  // Ruby refuses to lock a string twice. Frozen strings can not be
+  // resized anyway.
+  if (!OBJ_FROZEN(string) && !mTox_MEMORY_VIEW_EXPORTED(*exports, string)) {
+    rb_str_locktmp(string);
+  }
+
+  rb_ary_push(*exports, string);
+}
+
+void mTox_MEMORY_VIEW_UNEXPORT(const VALUE exports, const VALUE string)
+{
+  const long length = RARRAY_LEN(exports);
+
+  for (long i = length - 1; i >= 0; --i) {
+    if (RARRAY_AREF(exports, i) == string) {
+      rb_ary_store(exports, i, RARRAY_AREF(exports, length - 1));
+      rb_ary_pop(exports);
+      break;
+    }
+  }
+
+  if (!OBJ_FROZEN(string) && !mTox_MEMORY_VIEW_EXPORTED(exports, string)) {
+    rb_str_unlocktmp(string);
+  }
+}
+
+bool mTox_MEMORY_VIEW_EXPORTED(const VALUE exports, const VALUE string)
+{
+  if (Qnil == exports) {
+    return false;
+  }
+
+  return Qtrue == rb_ary_includes(exports, string);
+}
@@ -0,0 +1,7 @@
+// Strings of frames exported through memory views. They are locked, so
+// Ruby can not resize them, and kept by their frames until the views are
+// released, even if the frames get other strings meanwhile.
+
+void mTox_MEMORY_VIEW_EXPORT(VALUE owner, VALUE *exports, VALUE string);
+void mTox_MEMORY_VIEW_UNEXPORT(VALUE exports, VALUE string);
+bool mTox_MEMORY_VIEW_EXPORTED(VALUE exports, VALUE string);
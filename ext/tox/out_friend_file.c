@@ -15,6 +15,172 @@ void mTox_cOutFriendFile_INIT()
   rb_define_method(mTox_cOutFriendFile, "send_chunk", mTox_cOutFriendFile_send_chunk, 2);
 }
 
+/*************************************************************
+ * Transfer state
+ *************************************************************/
+
+mTox_cOutFriendFile_TRANSFER *mTox_cOutFriendFile_TRANSFER_GET(
+  mTox_cClient_CDATA *const client_cdata,
+  const uint32_t friend_number_data,
+  const uint32_t file_number_data,
+  const bool create
+)
+{
+  for (size_t i = 0; i < client_cdata->out_transfers_size; ++i) {
+    mTox_cOutFriendFile_TRANSFER *const transfer =
+      client_cdata->out_transfers[i];
+
+    if (transfer->friend_number == friend_number_data &&
+        transfer->file_number   == file_number_data) {
+      return transfer;
+    }
+  }
+
+  if (!create) {
+    return NULL;
+  }
+
+  mTox_cOutFriendFile_TRANSFER *const transfer =
+    ALLOC(mTox_cOutFriendFile_TRANSFER);
+
+  memset(transfer, 0, sizeof(mTox_cOutFriendFile_TRANSFER));
+
+  transfer->friend_number = friend_number_data;
+  transfer->file_number   = file_number_data;
+
+  REALLOC_N(
+    client_cdata->out_transfers,
+    mTox_cOutFriendFile_TRANSFER*,
+    client_cdata->out_transfers_size + 1
+  );
+
+  client_cdata->out_transfers[client_cdata->out_transfers_size++] = transfer;
+
+  return transfer;
+}
+
+void mTox_cOutFriendFile_TRANSFER_DELETE(
+  mTox_cClient_CDATA *const client_cdata,
+  const uint32_t friend_number_data,
+  const uint32_t file_number_data
+)
+{
+  for (size_t i = 0; i < client_cdata->out_transfers_size; ++i) {
+    mTox_cOutFriendFile_TRANSFER *const transfer =
+      client_cdata->out_transfers[i];
+
+    if (transfer->friend_number == friend_number_data &&
+        transfer->file_number   == file_number_data) {
+      mTox_cOutFriendFile_TRANSFER_FREE(transfer);
+
+      client_cdata->out_transfers[i] =
+        client_cdata->out_transfers[--client_cdata->out_transfers_size];
+
+      return;
+    }
+  }
+}
+
+void mTox_cOutFriendFile_TRANSFER_FREE(
+  mTox_cOutFriendFile_TRANSFER *const transfer
+)
+{
+  mTox_cClient_AVATAR_RELEASE(transfer->avatar);
+  mTox_FILE_IO_WINDOW_CLOSE(transfer->window);
+  mTox_COMPRESSION_ENCODER_FREE(transfer->encoder);
+  free(transfer);
+}
+
+// Serves a chunk request without calling Ruby. Returns false when the
+// transfer has no native data source, so Ruby has to handle it. Sets
+// "failed" when the local file could not be read; the transfer is
+// cancelled then and has to be reported as such.
+bool mTox_cOutFriendFile_TRANSFER_CHUNK_REQUEST(
+  mTox_cClient_CDATA *const client_cdata,
+  mTox_cOutFriendFile_TRANSFER *const transfer,
+  const uint64_t position_data,
+  const size_t length_data,
+  bool *const failed
+)
+{
+  *failed = false;
+
+  if (!transfer->avatar && !transfer->window && !transfer->encoder) {
+    return false;
+  }
+
+  if (length_data == 0) {
+    return true;
+  }
+
+  const uint8_t *ptr_data;
+  uint8_t file_data[length_data];
+
+  // Compressed streams have an unknown size and end with a shorter chunk.
+  size_t chunk_length = length_data;
+
+  if (transfer->avatar) {
+    if (position_data > transfer->avatar->size ||
+        length_data   > transfer->avatar->size - position_data) {
+      return true;
+    }
+
+    ptr_data = &transfer->avatar->data[position_data];
+  }
+  else {
+    const bool read = transfer->encoder
+      ? mTox_COMPRESSION_ENCODER_READ(
+          transfer->encoder,
+          position_data,
+          file_data,
+          length_data,
+          &chunk_length
+        )
+      : mTox_FILE_IO_WINDOW_READ(
+          transfer->window,
+          position_data,
+          file_data,
+          length_data
+        );
+
+    if (!read) {
+      mTox_FILE_IO_WINDOW_CLOSE(transfer->window);
+      transfer->window = NULL;
+
+      mTox_COMPRESSION_ENCODER_FREE(transfer->encoder);
+      transfer->encoder = NULL;
+
+      tox_file_control(
+        client_cdata->tox,
+        transfer->friend_number,
+        transfer->file_number,
+        TOX_FILE_CONTROL_CANCEL,
+        NULL
+      );
+
+      *failed = true;
+
+      return true;
+    }
+
+    ptr_data = file_data;
+  }
+
+  // Errors are not reported here: toxcore only requests chunks when there is
+  // room in the send queue and cancels the transfer itself on disconnect.
+  tox_file_send_chunk(
+    client_cdata->tox,
+    transfer->friend_number,
+    transfer->file_number,
+    position_data,
+    ptr_data,
+    chunk_length,
+    NULL
+  );
+
+  return true;
+}
+
 /*************************************************************
  * Public methods
  *************************************************************/
@@ -0,0 +1,427 @@
+#include "tox.h"
+
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Memory management
+static VALUE mTox_cResampler_alloc(VALUE klass);
+static void  mTox_cResampler_free(mTox_cResampler_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cResampler_process(VALUE self, VALUE audio_frame);
+static VALUE mTox_cResampler_reset(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cResampler_initialize_with(
+  VALUE self,
+  VALUE input_sampling_rate,
+  VALUE input_channels,
+  VALUE output_sampling_rate,
+  VALUE output_channels
+);
+
+// Private functions
+
+static uint32_t mTox_cResampler_GCD(uint32_t a, uint32_t b);
+static double   mTox_cResampler_BESSEL_I0(double x);
+static void     mTox_cResampler_DESIGN(mTox_cResampler_CDATA *self_cdata);
+static float    mTox_cResampler_DOT(const float *coefficients, const float *samples, size_t length);
+static void     mTox_cResampler_STORE(int16_t *pcm, const float *samples, size_t length);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cResampler_INIT()
+{
+  // Memory management
+  rb_define_alloc_func(mTox_cResampler, mTox_cResampler_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cResampler, "process", mTox_cResampler_process, 1);
+  rb_define_method(mTox_cResampler, "reset",   mTox_cResampler_reset,   0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cResampler, "initialize_with", mTox_cResampler_initialize_with, 4);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cResampler_alloc(const VALUE klass)
+{
+  mTox_cResampler_CDATA *alloc_cdata = ALLOC(mTox_cResampler_CDATA);
+
+  memset(alloc_cdata, 0, sizeof(mTox_cResampler_CDATA));
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cResampler_free, alloc_cdata);
+}
+
+void mTox_cResampler_free(mTox_cResampler_CDATA *const free_cdata)
+{
+  free(free_cdata->coefficients);
+  free(free_cdata->history);
+  free(free_cdata->work);
+  free(free_cdata->output);
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::Resampler#process
+//
+// Channels are reduced before filtering and added after it, so only the
+// smaller number of channels is filtered.
+VALUE mTox_cResampler_process(const VALUE self, const VALUE audio_frame)
+{
+  if (!mTox_cAudioFrame_IS(audio_frame)) {
+    RAISE_TYPECHECK(
+      "Tox::Resampler#process",
+      "audio_frame",
+      "Tox::AudioFrame"
+    );
+  }
+
+  CDATA(self, mTox_cResampler_CDATA, self_cdata);
+
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  if (audio_frame_cdata->sampling_rate != self_cdata->input_sampling_rate ||
+      audio_frame_cdata->channels      != self_cdata->input_channels) {
+    rb_raise(rb_eArgError, "audio frame format does not match the resampler");
+  }
+
+  const VALUE pcm = audio_frame_cdata->pcm;
+
+  const size_t input_size = audio_frame_cdata->sample_count;
+
+  if ((size_t)RSTRING_LEN(pcm) <
+      input_size * self_cdata->input_channels * sizeof(int16_t)) {
+    rb_raise(rb_eArgError, "audio frame is invalid");
+  }
+
+  const int16_t *const input = (const int16_t*)RSTRING_PTR(pcm);
+
+  const size_t taps     = self_cdata->taps;
+  const size_t channels = self_cdata->channels;
+  const size_t up       = self_cdata->up;
+  const size_t down     = self_cdata->down;
+  const size_t stride   = taps - 1 + input_size;
+
+  // Samples of all channels after the history of the previous frame.
+  if (self_cdata->work_capacity < channels * stride) {
+    REALLOC_N(self_cdata->work, float, channels * stride);
+    self_cdata->work_capacity = channels * stride;
+  }
+
+  for (size_t c = 0; c < channels; ++c) {
+    float *const work = &self_cdata->work[c * stride];
+
+    memcpy(work, &self_cdata->history[c * (taps - 1)], (taps - 1) * sizeof(float));
+
+    if (self_cdata->input_channels == channels) {
+      for (size_t i = 0; i < input_size; ++i) {
+        work[taps - 1 + i] = input[i * channels + c];
+      }
+    }
+    else {
+      for (size_t i = 0; i < input_size; ++i) {
+        work[taps - 1 + i] = 0.5f * ((float)input[i * 2] + input[i * 2 + 1]);
+      }
+    }
+  }
+
+  const uint64_t end = (uint64_t)input_size * up;
+
+  const size_t output_size =
+    self_cdata->position < end
+      ? (end - self_cdata->position + down - 1) / down
+      : 0;
+
+  if (self_cdata->output_capacity < channels * output_size) {
+    REALLOC_N(self_cdata->output, float, channels * output_size);
+    self_cdata->output_capacity = channels * output_size;
+  }
+
+  for (size_t c = 0; c < channels; ++c) {
+    const float *const work   = &self_cdata->work[c * stride];
+    float       *const output = &self_cdata->output[c * output_size];
+
+    uint64_t position = self_cdata->position;
+
+    for (size_t j = 0; j < output_size; ++j, position += down) {
+      output[j] = mTox_cResampler_DOT(
+        &self_cdata->coefficients[(position % up) * taps],
+        &work[position / up],
+        taps
+      );
+    }
+
+    memcpy(
+      &self_cdata->history[c * (taps - 1)],
+      &work[input_size],
+      (taps - 1) * sizeof(float)
+    );
+  }
+
+  self_cdata->position += (uint64_t)output_size * down;
+  self_cdata->position -= end;
+
+  const size_t output_channels = self_cdata->output_channels;
+
+  const VALUE output_frame = rb_funcall(mTox_cAudioFrame, rb_intern("new"), 0);
+
+  AUDIO_FRAME_CDATA(output_frame, output_frame_cdata);
+
+  mTox_cAudioFrame_SET_FORMAT(
+    output_frame_cdata,
+    output_size,
+    output_channels,
+    self_cdata->output_sampling_rate
+  );
+
+  const VALUE output_pcm =
+    rb_str_new(NULL, output_size * output_channels * sizeof(int16_t));
+
+  int16_t *const output_pcm_data = (int16_t*)RSTRING_PTR(output_pcm);
+
+  if (channels == 1) {
+    mTox_cResampler_STORE(output_pcm_data, self_cdata->output, output_size);
+
+    // Mono to stereo, in place from the end.
+    if (output_channels == 2) {
+      for (size_t j = output_size; j-- > 0;) {
+        output_pcm_data[j * 2]     = output_pcm_data[j];
+        output_pcm_data[j * 2 + 1] = output_pcm_data[j];
+      }
+    }
+  }
+  else {
+    for (size_t j = 0; j < output_size; ++j) {
+      for (size_t c = 0; c < channels; ++c) {
+        const float value = self_cdata->output[c * output_size + j];
+
+        output_pcm_data[j * channels + c] =
+          value >= INT16_MAX ? INT16_MAX :
+          value <= INT16_MIN ? INT16_MIN :
+          (int16_t)lrintf(value);
+      }
+    }
+  }
+
+  mTox_cAudioFrame_SET_PCM(output_frame, output_frame_cdata, output_pcm);
+
+  return output_frame;
+}
+
+// Tox::Resampler#reset
+VALUE mTox_cResampler_reset(const VALUE self)
+{
+  CDATA(self, mTox_cResampler_CDATA, self_cdata);
+
+  memset(
+    self_cdata->history,
+    0,
+    self_cdata->channels * (self_cdata->taps - 1) * sizeof(float)
+  );
+
+  self_cdata->position = 0;
+
+  return Qnil;
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::Resampler#initialize_with
+VALUE mTox_cResampler_initialize_with(
+  const VALUE self,
+  const VALUE input_sampling_rate,
+  const VALUE input_channels,
+  const VALUE output_sampling_rate,
+  const VALUE output_channels
+)
+{
+  CDATA(self, mTox_cResampler_CDATA, self_cdata);
+
+  self_cdata->input_sampling_rate  = NUM2ULONG(input_sampling_rate);
+  self_cdata->input_channels       = NUM2UINT(input_channels);
+  self_cdata->output_sampling_rate = NUM2ULONG(output_sampling_rate);
+  self_cdata->output_channels      = NUM2UINT(output_channels);
+
+  self_cdata->channels =
+    self_cdata->input_channels < self_cdata->output_channels
+      ? self_cdata->input_channels
+      : self_cdata->output_channels;
+
+  const uint32_t gcd = mTox_cResampler_GCD(
+    self_cdata->input_sampling_rate,
+    self_cdata->output_sampling_rate
+  );
+
+  self_cdata->up   = self_cdata->output_sampling_rate / gcd;
+  self_cdata->down = self_cdata->input_sampling_rate  / gcd;
+
+  mTox_cResampler_DESIGN(self_cdata);
+
+  self_cdata->history = ALLOC_N(float, self_cdata->channels * (self_cdata->taps - 1) + 1);
+
+  mTox_cResampler_reset(self);
+
+  return self;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+uint32_t mTox_cResampler_GCD(uint32_t a, uint32_t b)
+{
+  while (b != 0) {
+    const uint32_t c = a % b;
+    a = b;
+    b = c;
+  }
+
+  return a;
+}
+
+double mTox_cResampler_BESSEL_I0(const double x)
+{
+  double sum  = 1.0;
+  double term = 1.0;
+
+  for (int k = 1; k < 32; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum  += term;
+  }
+
+  return sum;
+}
+
+// Kaiser windowed sinc, split into one filter per phase. Taps of every
+// phase are stored in reverse, so they line up with the input samples in
+// memory, and normalized to unity gain.
+void mTox_cResampler_DESIGN(mTox_cResampler_CDATA *const self_cdata)
+{
+  const size_t up   = self_cdata->up;
+  const size_t down = self_cdata->down;
+
+  if (up == 1 && down == 1) {
+    self_cdata->taps         = 1;
+    self_cdata->coefficients = ALLOC_N(float, 1);
+    self_cdata->coefficients[0] = 1.0f;
+    return;
+  }
+
+  // Decimating filters are longer, so the transition band stays as narrow.
+  const size_t taps   = mTox_cResampler_TAPS * ((down + up - 1) / up);
+  const size_t length = taps * up;
+
+  const double cutoff =
+    mTox_cResampler_CUTOFF * 0.5 / (up > down ? up : down);
+
+  const double center = (length - 1) / 2.0;
+  const double beta   = mTox_cResampler_KAISER_BETA;
+  const double norm   = mTox_cResampler_BESSEL_I0(beta);
+
+  self_cdata->taps         = taps;
+  self_cdata->coefficients = ALLOC_N(float, length);
+
+  for (size_t phase = 0; phase < up; ++phase) {
+    float *const coefficients = &self_cdata->coefficients[phase * taps];
+
+    double sum = 0.0;
+
+    for (size_t k = 0; k < taps; ++k) {
+      const size_t index = phase + (taps - 1 - k) * up;
+      const double x     = index - center;
+      const double ratio = x / (center + 1.0);
+
+      const double sinc =
+        x == 0.0 ? 1.0 : sin(2.0 * M_PI * cutoff * x) / (2.0 * M_PI * cutoff * x);
+
+      const double window =
+        mTox_cResampler_BESSEL_I0(beta * sqrt(1.0 - ratio * ratio)) / norm;
+
+      coefficients[k] = sinc * window;
+      sum += coefficients[k];
+    }
+
+    for (size_t k = 0; k < taps; ++k) {
+      coefficients[k] /= sum;
+    }
+  }
+}
+
+float mTox_cResampler_DOT(
+  const float *const coefficients,
+  const float *const samples,
+  const size_t length
+)
+{
+  size_t i   = 0;
+  float  sum = 0.0f;
+
+#ifdef __SSE2__
+  __m128 vector_sum = _mm_setzero_ps();
+
+  for (; i + 4 <= length; i += 4) {
+    vector_sum = _mm_add_ps(
+      vector_sum,
+      _mm_mul_ps(_mm_loadu_ps(&coefficients[i]), _mm_loadu_ps(&samples[i]))
+    );
+  }
+
+  float parts[4];
+
+  _mm_storeu_ps(parts, vector_sum);
+
+  sum = (parts[0] + parts[1]) + (parts[2] + parts[3]);
+#endif
+
+  for (; i < length; ++i) {
+    sum += coefficients[i] * samples[i];
+  }
+
+  return sum;
+}
+
+// Rounded and saturated to 16 bits.
+void mTox_cResampler_STORE(
+  int16_t *const pcm,
+  const float *const samples,
+  const size_t length
+)
+{
+  size_t i = 0;
+
+#ifdef __SSE2__
+  for (; i + 8 <= length; i += 8) {
+    const __m128i low  = _mm_cvtps_epi32(_mm_loadu_ps(&samples[i]));
+    const __m128i high = _mm_cvtps_epi32(_mm_loadu_ps(&samples[i + 4]));
+
+    _mm_storeu_si128((__m128i*)&pcm[i], _mm_packs_epi32(low, high));
+  }
+#endif
+
+  for (; i < length; ++i) {
+    const float value = samples[i];
+
+    pcm[i] =
+      value >= INT16_MAX ? INT16_MAX :
+      value <= INT16_MIN ? INT16_MIN :
+      (int16_t)lrintf(value);
+  }
+}
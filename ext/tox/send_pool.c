@@ -0,0 +1,171 @@
+#include "tox.h"
+
+#include <unistd.h>
+#include <pthread.h>
+
+struct mTox_SEND_POOL {
+  size_t    threads_size;
+  pthread_t threads[mTox_SEND_POOL_MAX_THREADS];
+
+  // Held while a batch runs.
+  pthread_mutex_t batch_mutex;
+
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  pthread_cond_t  done_cond;
+
+  // Shared with the threads, guarded by the mutex.
+
+  bool stopped;
+
+  void  (*func)(void *data, size_t index);
+  void   *data;
+  size_t  size;
+  size_t  next;
+  size_t  running;
+};
+
+static void *mTox_SEND_POOL_THREAD(void *data);
+static void  mTox_SEND_POOL_WORK(mTox_SEND_POOL *send_pool);
+
+/*************************************************************
+ * Send pool
+ *************************************************************/
+
+mTox_SEND_POOL *mTox_SEND_POOL_NEW()
+{
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+  size_t threads_size = cpus > 1 ? cpus - 1 : 0;
+
+  if (threads_size > mTox_SEND_POOL_MAX_THREADS) {
+    threads_size = mTox_SEND_POOL_MAX_THREADS;
+  }
+
+  mTox_SEND_POOL *const send_pool = ALLOC(mTox_SEND_POOL);
+
+  memset(send_pool, 0, sizeof(mTox_SEND_POOL));
+
+  pthread_mutex_init(&send_pool->batch_mutex, NULL);
+  pthread_mutex_init(&send_pool->mutex, NULL);
+  pthread_cond_init(&send_pool->cond, NULL);
+  pthread_cond_init(&send_pool->done_cond, NULL);
+
+  // Batches run with the threads which could be started.
+  while (send_pool->threads_size < threads_size) {
+    if (pthread_create(
+          &send_pool->threads[send_pool->threads_size],
+          NULL,
+          mTox_SEND_POOL_THREAD,
+          send_pool
+        )) {
+      break;
+    }
+
+    ++send_pool->threads_size;
+  }
+
+  return send_pool;
+}
+
+void mTox_SEND_POOL_FREE(mTox_SEND_POOL *const send_pool)
+{
+  if (!send_pool) {
+    return;
+  }
+
+  pthread_mutex_lock(&send_pool->mutex);
+  send_pool->stopped = true;
+  pthread_cond_broadcast(&send_pool->cond);
+  pthread_mutex_unlock(&send_pool->mutex);
+
+  for (size_t i = 0; i < send_pool->threads_size; ++i) {
+    pthread_join(send_pool->threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&send_pool->done_cond);
+  pthread_cond_destroy(&send_pool->cond);
+  pthread_mutex_destroy(&send_pool->mutex);
+  pthread_mutex_destroy(&send_pool->batch_mutex);
+
+  free(send_pool);
+}
+
+void mTox_SEND_POOL_RUN(
+  mTox_SEND_POOL *const send_pool,
+  void (*const func)(void *data, size_t index),
+  void *const data,
+  const size_t size
+)
+{
+  pthread_mutex_lock(&send_pool->batch_mutex);
+  pthread_mutex_lock(&send_pool->mutex);
+
+  send_pool->func = func;
+  send_pool->data = data;
+  send_pool->size = size;
+  send_pool->next = 0;
+
+  if (size > 1) {
+    pthread_cond_broadcast(&send_pool->cond);
+  }
+
+  mTox_SEND_POOL_WORK(send_pool);
+
+  while (send_pool->running > 0) {
+    pthread_cond_wait(&send_pool->done_cond, &send_pool->mutex);
+  }
+
+  send_pool->size = 0;
+
+  pthread_mutex_unlock(&send_pool->mutex);
+  pthread_mutex_unlock(&send_pool->batch_mutex);
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+void *mTox_SEND_POOL_THREAD(void *const data)
+{
+  mTox_SEND_POOL *const send_pool = data;
+
+  pthread_mutex_lock(&send_pool->mutex);
+
+  while (!send_pool->stopped) {
+    if (send_pool->next >= send_pool->size) {
+      pthread_cond_wait(&send_pool->cond, &send_pool->mutex);
+      continue;
+    }
+
+    mTox_SEND_POOL_WORK(send_pool);
+
+    if (send_pool->running == 0) {
+      pthread_cond_signal(&send_pool->done_cond);
+    }
+  }
+
+  pthread_mutex_unlock(&send_pool->mutex);
+
+  return NULL;
+}
+
+// Takes indices of the batch until there are none left. Called and returns
+// with the mutex locked.
+void mTox_SEND_POOL_WORK(mTox_SEND_POOL *const send_pool)
+{
+  while (send_pool->next < send_pool->size) {
+    void (*const func)(void *data, size_t index) = send_pool->func;
+    void *const data = send_pool->data;
+
+    const size_t index = send_pool->next++;
+
+    ++send_pool->running;
+    pthread_mutex_unlock(&send_pool->mutex);
+
+    func(data, index);
+
+    pthread_mutex_lock(&send_pool->mutex);
+    --send_pool->running;
+  }
+}
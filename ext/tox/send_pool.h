@@ -0,0 +1,25 @@
+// Threads which share the sends of one frame to many friends. toxav
+// encodes inside its send functions and locks only the call it sends to,
+// so sends to different friends run in parallel. Batches are run without
+// the GVL and must not touch Ruby.
+
+// Threads at most, besides the one which runs a batch.
+#define mTox_SEND_POOL_MAX_THREADS 7
+
+typedef struct mTox_SEND_POOL mTox_SEND_POOL;
+
+// Starts a thread per online CPU but one. Batches of a pool without
+// threads run on the calling thread alone.
+mTox_SEND_POOL *mTox_SEND_POOL_NEW();
+
+void mTox_SEND_POOL_FREE(mTox_SEND_POOL *send_pool);
+
+// Calls "func" once for every index below "size" on the threads and the
+// calling thread, and returns when all of the calls did. Indices are
+// handed out in order. Batches run one at a time.
+void mTox_SEND_POOL_RUN(
+  mTox_SEND_POOL *send_pool,
+  void (*func)(void *data, size_t index),
+  void *data,
+  size_t size
+);
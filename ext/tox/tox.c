@@ -29,11 +29,27 @@ VALUE mTox_mFileKind;
 VALUE mTox_cOutFriendFile;
 VALUE mTox_cInFriendFile;
 VALUE mTox_mFileControl;
+VALUE mTox_mFileIOBackend;
+VALUE mTox_mCallControl;
 VALUE mTox_cFriendCallRequest;
 VALUE mTox_cFriendCall;
 VALUE mTox_cAudioFrame;
 VALUE mTox_cVideoFrame;
+VALUE mTox_cVideoPlane;
 VALUE mTox_cFriendCallState;
+VALUE mTox_mDelta;
+VALUE mTox_mCompression;
+VALUE mTox_cAudioMixer;
+VALUE mTox_cVideoMosaic;
+VALUE mTox_cResampler;
+VALUE mTox_cJitterBuffer;
+VALUE mTox_cAudioMeter;
+VALUE mTox_cBitRateControl;
+VALUE mTox_cMediaRelay;
+VALUE mTox_cCallStats;
+VALUE mTox_cVideoQueue;
+VALUE mTox_cY4MFile;
+VALUE mTox_cWavFile;
 
 VALUE mTox_mUserStatus_NONE;
 VALUE mTox_mUserStatus_AWAY;
@@ -54,6 +70,17 @@ VALUE mTox_mFileControl_RESUME;
 VALUE mTox_mFileControl_PAUSE;
 VALUE mTox_mFileControl_CANCEL;
 
+VALUE mTox_mFileIOBackend_PREAD;
+VALUE mTox_mFileIOBackend_IO_URING;
+
+VALUE mTox_mCallControl_RESUME;
+VALUE mTox_mCallControl_PAUSE;
+VALUE mTox_mCallControl_CANCEL;
+VALUE mTox_mCallControl_MUTE_AUDIO;
+VALUE mTox_mCallControl_UNMUTE_AUDIO;
+VALUE mTox_mCallControl_HIDE_VIDEO;
+VALUE mTox_mCallControl_SHOW_VIDEO;
+
 VALUE mTox_cClient_eBadSavedataError;
 
 VALUE mTox_cFriend_eNotFoundError;
@@ -65,6 +92,11 @@ VALUE mTox_mOutMessage_eEmptyError;
 VALUE mTox_cOutFriendFile_eNameTooLongError;
 VALUE mTox_cOutFriendFile_eTooManyError;
 
+VALUE mTox_mDelta_eCorruptError;
+
+VALUE mTox_cY4MFile_eFormatError;
+VALUE mTox_cWavFile_eFormatError;
+
 // Singleton methods
 
 static VALUE mTox_hash(VALUE self, VALUE data);
@@ -104,11 +136,21 @@ void Init_tox()
   mTox_cOutFriendFile     = rb_const_get(mTox, rb_intern("OutFriendFile"));
   mTox_cInFriendFile      = rb_const_get(mTox, rb_intern("InFriendFile"));
   mTox_mFileControl       = rb_const_get(mTox, rb_intern("FileControl"));
+  mTox_mFileIOBackend     = rb_const_get(mTox, rb_intern("FileIOBackend"));
+  mTox_mCallControl       = rb_const_get(mTox, rb_intern("CallControl"));
   mTox_cFriendCallRequest = rb_const_get(mTox, rb_intern("FriendCallRequest"));
   mTox_cFriendCall        = rb_const_get(mTox, rb_intern("FriendCall"));
   mTox_cAudioFrame        = rb_const_get(mTox, rb_intern("AudioFrame"));
   mTox_cVideoFrame        = rb_const_get(mTox, rb_intern("VideoFrame"));
+  mTox_cVideoPlane        = rb_const_get(mTox, rb_intern("VideoPlane"));
   mTox_cFriendCallState   = rb_const_get(mTox, rb_intern("FriendCallState"));
+  mTox_mDelta             = rb_const_get(mTox, rb_intern("Delta"));
+  mTox_mCompression       = rb_const_get(mTox, rb_intern("Compression"));
+  mTox_cAudioMixer        = rb_const_get(mTox, rb_intern("AudioMixer"));
+  mTox_cVideoMosaic       = rb_const_get(mTox, rb_intern("VideoMosaic"));
+  mTox_cResampler         = rb_const_get(mTox, rb_intern("Resampler"));
+  mTox_cY4MFile           = rb_const_get(mTox, rb_intern("Y4MFile"));
+  mTox_cWavFile           = rb_const_get(mTox, rb_intern("WavFile"));
 
   mTox_mUserStatus_NONE = rb_const_get(mTox_mUserStatus, rb_intern("NONE"));
   mTox_mUserStatus_AWAY = rb_const_get(mTox_mUserStatus, rb_intern("AWAY"));
@@ -129,6 +171,17 @@ void Init_tox()
   mTox_mFileControl_PAUSE  = rb_const_get(mTox_mFileControl, rb_intern("PAUSE"));
   mTox_mFileControl_CANCEL = rb_const_get(mTox_mFileControl, rb_intern("CANCEL"));
 
+  mTox_mFileIOBackend_PREAD    = rb_const_get(mTox_mFileIOBackend, rb_intern("PREAD"));
+  mTox_mFileIOBackend_IO_URING = rb_const_get(mTox_mFileIOBackend, rb_intern("IO_URING"));
+
+  mTox_mCallControl_RESUME       = rb_const_get(mTox_mCallControl, rb_intern("RESUME"));
+  mTox_mCallControl_PAUSE        = rb_const_get(mTox_mCallControl, rb_intern("PAUSE"));
+  mTox_mCallControl_CANCEL       = rb_const_get(mTox_mCallControl, rb_intern("CANCEL"));
+  mTox_mCallControl_MUTE_AUDIO   = rb_const_get(mTox_mCallControl, rb_intern("MUTE_AUDIO"));
+  mTox_mCallControl_UNMUTE_AUDIO = rb_const_get(mTox_mCallControl, rb_intern("UNMUTE_AUDIO"));
+  mTox_mCallControl_HIDE_VIDEO   = rb_const_get(mTox_mCallControl, rb_intern("HIDE_VIDEO"));
+  mTox_mCallControl_SHOW_VIDEO   = rb_const_get(mTox_mCallControl, rb_intern("SHOW_VIDEO"));
+
   mTox_cClient_eBadSavedataError = rb_const_get(mTox_cClient, rb_intern("BadSavedataError"));
 
   mTox_cFriend_eNotFoundError     = rb_const_get(mTox_cFriend, rb_intern("NotFoundError"));
@@ -140,6 +193,11 @@ void Init_tox()
   mTox_cOutFriendFile_eNameTooLongError = rb_const_get(mTox_cOutFriendFile, rb_intern("NameTooLongError"));
   mTox_cOutFriendFile_eTooManyError     = rb_const_get(mTox_cOutFriendFile, rb_intern("TooManyError"));
 
+  mTox_mDelta_eCorruptError = rb_const_get(mTox_mDelta, rb_intern("CorruptError"));
+
+  mTox_cY4MFile_eFormatError = rb_const_get(mTox_cY4MFile, rb_intern("FormatError"));
+  mTox_cWavFile_eFormatError = rb_const_get(mTox_cWavFile, rb_intern("FormatError"));
+
   // Singleton methods
 
   rb_define_singleton_method(mTox, "hash", mTox_hash, 1);
@@ -155,6 +213,20 @@ void Init_tox()
   mTox_cFriendCall_INIT();
   mTox_cAudioFrame_INIT();
   mTox_cVideoFrame_INIT();
+  mTox_cVideoPlane_INIT();
+  mTox_mDelta_INIT();
+  mTox_mCompression_INIT();
+  mTox_cAudioMixer_INIT();
+  mTox_cVideoMosaic_INIT();
+  mTox_cResampler_INIT();
+  mTox_cJitterBuffer_INIT();
+  mTox_cAudioMeter_INIT();
+  mTox_cBitRateControl_INIT();
+  mTox_cMediaRelay_INIT();
+  mTox_cCallStats_INIT();
+  mTox_cVideoQueue_INIT();
+  mTox_cY4MFile_INIT();
+  mTox_cWavFile_INIT();
 }
 
 /*************************************************************
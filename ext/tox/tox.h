@@ -1,8 +1,28 @@
 #include <ruby.h>
 
+#ifdef HAVE_RUBY_MEMORY_VIEW_H
+#include <ruby/memory_view.h>
+#endif
+
+#include <sodium.h>
+
 #include <tox/tox.h>
 #include <tox/toxav.h>
 
+#include "file_io.h"
+#include "memory_view.h"
+#include "compression.h"
+#include "audio_level.h"
+#include "voice_gate.h"
+#include "call_stats.h"
+#include "audio_stream.h"
+#include "jitter_buffer.h"
+#include "bit_rate_control.h"
+#include "call_recorder.h"
+#include "media_relay.h"
+#include "send_pool.h"
+#include "video_queue.h"
+#include "video_convert.h"
 #include "client_callbacks.h"
 #include "audio_video_callbacks.h"
 
@@ -20,6 +40,20 @@ void mTox_cFriendCallRequest_INIT();
 void mTox_cFriendCall_INIT();
 void mTox_cAudioFrame_INIT();
 void mTox_cVideoFrame_INIT();
+void mTox_cVideoPlane_INIT();
+void mTox_mDelta_INIT();
+void mTox_mCompression_INIT();
+void mTox_cAudioMixer_INIT();
+void mTox_cVideoMosaic_INIT();
+void mTox_cResampler_INIT();
+void mTox_cJitterBuffer_INIT();
+void mTox_cAudioMeter_INIT();
+void mTox_cBitRateControl_INIT();
+void mTox_cMediaRelay_INIT();
+void mTox_cCallStats_INIT();
+void mTox_cVideoQueue_INIT();
+void mTox_cY4MFile_INIT();
+void mTox_cWavFile_INIT();
 
 // C data
 
@@ -30,25 +64,264 @@ typedef struct {
   char proxy_host[mTox_cOptions_CDATA_PROXY_HOST_BUFFER_SIZE];
 } mTox_cOptions_CDATA;
 
+// Tox clients refuse avatars larger than this, so it is also the limit
+// for avatars buffered in memory.
+#define mTox_cClient_AVATAR_MAX_SIZE 65536
+
+typedef struct {
+  size_t  refs;
+  size_t  size;
+  uint8_t hash[TOX_HASH_LENGTH];
+  uint8_t data[];
+} mTox_cClient_AVATAR;
+
+typedef struct {
+  uint32_t friend_number;
+  uint32_t file_number;
+
+  mTox_cClient_AVATAR      *avatar;
+  mTox_FILE_IO_WINDOW      *window;
+  mTox_COMPRESSION_ENCODER *encoder;
+} mTox_cOutFriendFile_TRANSFER;
+
+typedef struct {
+  uint32_t friend_number;
+  uint32_t file_number;
+
+  uint8_t *avatar_data;
+  uint64_t avatar_size;
+  uint8_t  avatar_file_id[TOX_FILE_ID_LENGTH];
+
+  mTox_FILE_IO_WINDOW      *window;
+  mTox_COMPRESSION_DECODER *decoder;
+
+  bool     digest_enabled;
+  bool     digest_valid;
+  bool     digest_finished;
+  uint64_t digest_position;
+  uint8_t  digest[TOX_HASH_LENGTH];
+
+  crypto_hash_sha256_state digest_state;
+} mTox_cInFriendFile_TRANSFER;
+
 typedef struct {
   Tox *tox;
+
+  mTox_cClient_AVATAR *avatar;
+
+  mTox_FILE_IO_BACKEND file_io_backend;
+  mTox_FILE_IO        *file_io;
+
+  size_t                        in_transfers_size;
+  mTox_cInFriendFile_TRANSFER **in_transfers;
+
+  size_t                         out_transfers_size;
+  mTox_cOutFriendFile_TRANSFER **out_transfers;
 } mTox_cClient_CDATA;
 
+// Native state kept for a friend, looked up once per frame. Parts are NULL
+// until they are enabled. Kinds paused, muted or hidden by call controls
+// which were sent, and kinds which the friend does not accept, are held
+// back from its answer or start until the call ends.
+typedef struct {
+  uint32_t friend_number;
+  bool     in_call;
+  bool     paused;
+  bool     audio_muted;
+  bool     video_hidden;
+  bool     audio_refused;
+  bool     video_refused;
+
+  mTox_AUDIO_STREAM     *stream;
+  mTox_JITTER_BUFFER    *jitter_buffer;
+  mTox_BIT_RATE_CONTROL *bit_rate_control;
+  mTox_CALL_RECORDER    *recorder;
+  mTox_VOICE_GATE       *voice_gate;
+  mTox_AUDIO_METER      *audio_meter;
+  mTox_MEDIA_RELAY      *media_relay;
+  mTox_VIDEO_QUEUE      *video_queue;
+  mTox_CALL_STATS       *call_stats;
+} mTox_cAudioVideo_CALL;
+
 typedef struct {
   ToxAV *tox_av;
+
+  size_t                  calls_size;
+  mTox_cAudioVideo_CALL **calls;
+
+  // Started with the first relay or video queue.
+  mTox_SEND_POOL *send_pool;
 } mTox_cAudioVideo_CDATA;
 
+// Sizes which frames must have are computed on assignment, so sending
+// a frame does not call back into Ruby.
 typedef struct {
+  VALUE pcm;
   size_t sample_count;
   uint8_t channels;
   uint32_t sampling_rate;
+  size_t pcm_size;
+  bool format_valid;
+  VALUE exports;
 } mTox_cAudioFrame_CDATA;
 
 typedef struct {
+  VALUE y_plane;
+  VALUE u_plane;
+  VALUE v_plane;
   uint16_t width;
   uint16_t height;
+  size_t y_size;
+  size_t uv_size;
+  VALUE exports;
 } mTox_cVideoFrame_CDATA;
 
+// Sources buffer at most this much audio ahead of the mix.
+#define mTox_cAudioMixer_MAX_DELAY_MSEC 200
+
+typedef struct {
+  uint32_t id;
+  size_t   size;
+  size_t   capacity;
+  int16_t *samples;
+} mTox_cAudioMixer_SOURCE;
+
+typedef struct {
+  uint32_t sampling_rate;
+  uint8_t  channels;
+
+  size_t                   sources_size;
+  mTox_cAudioMixer_SOURCE *sources;
+
+  size_t   total_capacity;
+  int32_t *total;
+} mTox_cAudioMixer_CDATA;
+
+// The latest frame of a source is kept packed and scaled to its tile once,
+// when the tile is first composed after the frame was pushed.
+typedef struct {
+  uint32_t id;
+
+  uint16_t width;
+  uint16_t height;
+  size_t   frame_capacity;
+  uint8_t *frame;
+
+  bool     scaled;
+  uint16_t tile_width;
+  uint16_t tile_height;
+  size_t   tile_capacity;
+  uint8_t *tile;
+} mTox_cVideoMosaic_SOURCE;
+
+typedef struct {
+  uint16_t width;
+  uint16_t height;
+  uint16_t columns;
+  uint16_t rows;
+
+  uint64_t frame_interval;
+  uint64_t next_frame;
+
+  size_t                    sources_size;
+  mTox_cVideoMosaic_SOURCE *sources;
+
+  size_t   row_capacity;
+  uint8_t *row;
+} mTox_cVideoMosaic_CDATA;
+
+// Taps of every phase of the resampling filter when it does not decimate,
+// its cutoff relative to the lower Nyquist frequency and the shape of its
+// window.
+#define mTox_cResampler_TAPS        24
+#define mTox_cResampler_CUTOFF      0.92
+#define mTox_cResampler_KAISER_BETA 8.0
+
+typedef struct {
+  uint32_t input_sampling_rate;
+  uint32_t output_sampling_rate;
+  uint8_t  input_channels;
+  uint8_t  output_channels;
+  uint8_t  channels;
+
+  uint32_t up;
+  uint32_t down;
+  size_t   taps;
+  float   *coefficients;
+
+  uint64_t position;
+  float   *history;
+
+  size_t work_capacity;
+  float *work;
+
+  size_t output_capacity;
+  float *output;
+} mTox_cResampler_CDATA;
+
+typedef struct {
+  mTox_JITTER_BUFFER *jitter_buffer;
+} mTox_cJitterBuffer_CDATA;
+
+typedef struct {
+  mTox_BIT_RATE_CONTROL *bit_rate_control;
+} mTox_cBitRateControl_CDATA;
+
+typedef struct {
+  mTox_AUDIO_METER *audio_meter;
+} mTox_cAudioMeter_CDATA;
+
+typedef struct {
+  mTox_MEDIA_RELAY *media_relay;
+} mTox_cMediaRelay_CDATA;
+
+typedef struct {
+  mTox_CALL_STATS *call_stats;
+} mTox_cCallStats_CDATA;
+
+// The frame taken by Tox::VideoQueue#take until it is given back.
+typedef struct {
+  mTox_VIDEO_QUEUE *video_queue;
+  uint8_t          *planes;
+  uint16_t          width;
+  uint16_t          height;
+  const uint8_t    *y;
+  const uint8_t    *u;
+  const uint8_t    *v;
+} mTox_cVideoQueue_CDATA;
+
+// Readers map the whole file and copy frames from the mapping, writers
+// append to it. A closed file has no descriptor.
+typedef struct {
+  int  fd;
+  bool writing;
+
+  const uint8_t *data;
+  size_t         size;
+  size_t         start;
+  size_t         position;
+
+  uint16_t width;
+  uint16_t height;
+  uint32_t frame_rate_numerator;
+  uint32_t frame_rate_denominator;
+} mTox_cY4MFile_CDATA;
+
+typedef struct {
+  int  fd;
+  bool writing;
+
+  const uint8_t *data;
+  size_t         size;
+  size_t         start;
+  size_t         end;
+  size_t         position;
+
+  uint32_t sampling_rate;
+  uint8_t  channels;
+  uint64_t sample_count;
+} mTox_cWavFile_CDATA;
+
 // Instances
 
 extern VALUE mTox;
@@ -83,6 +356,8 @@ extern VALUE mTox_mProxyType;
 extern VALUE mTox_mConnectionStatus;
 extern VALUE mTox_mFileKind;
 extern VALUE mTox_mFileControl;
+extern VALUE mTox_mFileIOBackend;
+extern VALUE mTox_mCallControl;
 
 // Binary string primitives
 extern VALUE mTox_cPublicKey;
@@ -92,6 +367,29 @@ extern VALUE mTox_cAddress;
 // Media data primitives
 extern VALUE mTox_cAudioFrame;
 extern VALUE mTox_cVideoFrame;
+extern VALUE mTox_cVideoPlane;
+
+extern const rb_data_type_t mTox_cAudioFrame_TYPE;
+extern const rb_data_type_t mTox_cVideoFrame_TYPE;
+
+// Media processing
+extern VALUE mTox_cAudioMixer;
+extern VALUE mTox_cVideoMosaic;
+extern VALUE mTox_cResampler;
+extern VALUE mTox_cJitterBuffer;
+extern VALUE mTox_cAudioMeter;
+extern VALUE mTox_cBitRateControl;
+extern VALUE mTox_cMediaRelay;
+extern VALUE mTox_cCallStats;
+extern VALUE mTox_cVideoQueue;
+
+// Media files
+extern VALUE mTox_cY4MFile;
+extern VALUE mTox_cWavFile;
+
+// File synchronization
+extern VALUE mTox_mDelta;
+extern VALUE mTox_mCompression;
 
 // Enumeration constants
 
@@ -114,6 +412,17 @@ extern VALUE mTox_mFileControl_RESUME;
 extern VALUE mTox_mFileControl_PAUSE;
 extern VALUE mTox_mFileControl_CANCEL;
 
+extern VALUE mTox_mFileIOBackend_PREAD;
+extern VALUE mTox_mFileIOBackend_IO_URING;
+
+extern VALUE mTox_mCallControl_RESUME;
+extern VALUE mTox_mCallControl_PAUSE;
+extern VALUE mTox_mCallControl_CANCEL;
+extern VALUE mTox_mCallControl_MUTE_AUDIO;
+extern VALUE mTox_mCallControl_UNMUTE_AUDIO;
+extern VALUE mTox_mCallControl_HIDE_VIDEO;
+extern VALUE mTox_mCallControl_SHOW_VIDEO;
+
 // Exception classes
 
 extern VALUE mTox_cClient_eBadSavedataError;
@@ -127,6 +436,171 @@ extern VALUE mTox_mOutMessage_eEmptyError;
 extern VALUE mTox_cOutFriendFile_eNameTooLongError;
 extern VALUE mTox_cOutFriendFile_eTooManyError;
 
+extern VALUE mTox_mDelta_eCorruptError;
+
+extern VALUE mTox_cY4MFile_eFormatError;
+extern VALUE mTox_cWavFile_eFormatError;
+
+// Transfer state
+
+void mTox_cClient_AVATAR_RELEASE(mTox_cClient_AVATAR *avatar);
+
+mTox_FILE_IO *mTox_cClient_FILE_IO(mTox_cClient_CDATA *client_cdata);
+
+mTox_cOutFriendFile_TRANSFER *mTox_cOutFriendFile_TRANSFER_GET(
+  mTox_cClient_CDATA *client_cdata,
+  uint32_t friend_number_data,
+  uint32_t file_number_data,
+  bool create
+);
+
+void mTox_cOutFriendFile_TRANSFER_DELETE(
+  mTox_cClient_CDATA *client_cdata,
+  uint32_t friend_number_data,
+  uint32_t file_number_data
+);
+
+void mTox_cOutFriendFile_TRANSFER_FREE(mTox_cOutFriendFile_TRANSFER *transfer);
+
+bool mTox_cOutFriendFile_TRANSFER_CHUNK_REQUEST(
+  mTox_cClient_CDATA *client_cdata,
+  mTox_cOutFriendFile_TRANSFER *transfer,
+  uint64_t position_data,
+  size_t length_data,
+  bool *failed
+);
+
+mTox_cInFriendFile_TRANSFER *mTox_cInFriendFile_TRANSFER_GET(
+  mTox_cClient_CDATA *client_cdata,
+  uint32_t friend_number_data,
+  uint32_t file_number_data,
+  bool create
+);
+
+void mTox_cInFriendFile_TRANSFER_DELETE(
+  mTox_cClient_CDATA *client_cdata,
+  uint32_t friend_number_data,
+  uint32_t file_number_data
+);
+
+void mTox_cInFriendFile_TRANSFER_FREE(mTox_cInFriendFile_TRANSFER *transfer);
+
+bool mTox_cInFriendFile_TRANSFER_RECV_CHUNK(
+  mTox_cClient_CDATA *client_cdata,
+  mTox_cInFriendFile_TRANSFER *transfer,
+  uint64_t position_data,
+  const uint8_t *ptr_data,
+  size_t length_data,
+  bool *failed
+);
+
+// Call state
+
+mTox_cAudioVideo_CALL *mTox_cAudioVideo_CALL_GET(
+  const mTox_cAudioVideo_CDATA *audio_video_cdata,
+  uint32_t friend_number_data
+);
+
+// Adds the state of a friend with no parts and nothing held back if there
+// is none.
+mTox_cAudioVideo_CALL *mTox_cAudioVideo_CALL_FETCH(
+  mTox_cAudioVideo_CDATA *audio_video_cdata,
+  uint32_t friend_number_data
+);
+
+// Marks the friend as in a call with stats at the bit rates, replacing the
+// stats of the previous call.
+mTox_cAudioVideo_CALL *mTox_cAudioVideo_CALL_START(
+  mTox_cAudioVideo_CDATA *audio_video_cdata,
+  uint32_t friend_number_data,
+  uint32_t audio_bit_rate,
+  uint32_t video_bit_rate
+);
+
+bool mTox_cAudioVideo_IN_CALL(
+  const mTox_cAudioVideo_CDATA *audio_video_cdata,
+  uint32_t friend_number_data
+);
+
+// Whether frames of the kind should be encoded and sent. NULL is a friend
+// with nothing held back.
+bool mTox_cAudioVideo_SENDS_AUDIO(const mTox_cAudioVideo_CALL *call);
+
+bool mTox_cAudioVideo_SENDS_VIDEO(const mTox_cAudioVideo_CALL *call);
+
+// Starts the send pool for the first relay or video queue.
+void mTox_cAudioVideo_SEND_POOL_START(mTox_cAudioVideo_CDATA *audio_video_cdata);
+
+// Copy frames received from the friend into its relay, if it has sinks.
+// They are forwarded by the next iteration of the audio/video instance.
+void mTox_cAudioVideo_RELAY_AUDIO(
+  mTox_cAudioVideo_CALL *call,
+  const int16_t *pcm,
+  size_t sample_count,
+  uint8_t channels,
+  uint32_t sampling_rate
+);
+
+void mTox_cAudioVideo_RELAY_VIDEO(
+  mTox_cAudioVideo_CALL *call,
+  uint16_t width,
+  uint16_t height,
+  const uint8_t *y,
+  const uint8_t *u,
+  const uint8_t *v,
+  int32_t ystride,
+  int32_t ustride,
+  int32_t vstride
+);
+
+// Frees all parts kept for the friend and removes it from relays.
+void mTox_cAudioVideo_CALL_END(
+  mTox_cAudioVideo_CDATA *audio_video_cdata,
+  uint32_t friend_number_data
+);
+
+// Frames
+
+bool mTox_cAudioFrame_IS(VALUE value);
+
+void mTox_cAudioFrame_SET_PCM(
+  VALUE self,
+  mTox_cAudioFrame_CDATA *self_cdata,
+  VALUE pcm
+);
+
+// Nil while a memory view holds the PCM, so it is not reused in place.
+VALUE mTox_cAudioFrame_REUSABLE_PCM(const mTox_cAudioFrame_CDATA *self_cdata);
+
+void mTox_cAudioFrame_SET_FORMAT(
+  mTox_cAudioFrame_CDATA *self_cdata,
+  size_t sample_count,
+  uint8_t channels,
+  uint32_t sampling_rate
+);
+
+bool mTox_cVideoFrame_IS(VALUE value);
+
+void mTox_cVideoFrame_SET_PLANES(
+  VALUE self,
+  mTox_cVideoFrame_CDATA *self_cdata,
+  VALUE y_plane,
+  VALUE u_plane,
+  VALUE v_plane
+);
+
+// Nil while a memory view holds the plane, so it is not reused in place.
+VALUE mTox_cVideoFrame_REUSABLE_PLANE(
+  const mTox_cVideoFrame_CDATA *self_cdata,
+  VALUE plane
+);
+
+void mTox_cVideoFrame_SET_SIZE(
+  mTox_cVideoFrame_CDATA *self_cdata,
+  uint16_t width,
+  uint16_t height
+);
+
 // Inline functions
 
 static inline VALUE           mTox_mUserStatus_FROM_DATA(TOX_USER_STATUS data);
@@ -149,12 +623,32 @@ static inline VALUE                 mTox_mFileControl_FROM_DATA(enum TOX_FILE_KI
 static inline VALUE                 mTox_mFileControl_TRY_DATA(enum TOX_FILE_KIND data);
 static inline enum TOX_FILE_CONTROL mTox_mFileControl_TO_DATA(VALUE value);
 
+static inline VALUE                mTox_mFileIOBackend_FROM_DATA(mTox_FILE_IO_BACKEND data);
+static inline mTox_FILE_IO_BACKEND mTox_mFileIOBackend_TO_DATA(VALUE value);
+
+static inline TOXAV_CALL_CONTROL mTox_mCallControl_TO_DATA(VALUE value);
+
+static inline bool mTox_cAudioFrame_VALID(const mTox_cAudioFrame_CDATA *cdata);
+static inline bool mTox_cVideoFrame_VALID(const mTox_cVideoFrame_CDATA *cdata);
+
 // Macros
 
 #define CDATA(value, cdata_type, cdata)          \
   cdata_type *(cdata);                           \
   Data_Get_Struct((value), cdata_type, (cdata));
 
+#define AUDIO_FRAME_CDATA(value, cdata)                               \
+  mTox_cAudioFrame_CDATA *(cdata);                                    \
+  TypedData_Get_Struct(                                               \
+    (value), mTox_cAudioFrame_CDATA, &mTox_cAudioFrame_TYPE, (cdata)  \
+  );
+
+#define VIDEO_FRAME_CDATA(value, cdata)                               \
+  mTox_cVideoFrame_CDATA *(cdata);                                    \
+  TypedData_Get_Struct(                                               \
+    (value), mTox_cVideoFrame_CDATA, &mTox_cVideoFrame_TYPE, (cdata)  \
+  );
+
 #define RAISE_TYPECHECK(method_name, arg_name, expected_type) \
   rb_raise(                                                   \
     rb_eTypeError,                                            \
@@ -394,3 +888,69 @@ enum TOX_FILE_CONTROL mTox_mFileControl_TO_DATA(const VALUE value)
     RAISE_OPTION("Tox::FileControl");
   }
 }
+
+VALUE mTox_mFileIOBackend_FROM_DATA(const mTox_FILE_IO_BACKEND data)
+{
+  switch (data) {
+    case mTox_FILE_IO_BACKEND_PREAD:
+      return mTox_mFileIOBackend_PREAD;
+    case mTox_FILE_IO_BACKEND_IO_URING:
+      return mTox_mFileIOBackend_IO_URING;
+    default:
+      RAISE_ENUM("mTox_FILE_IO_BACKEND");
+  }
+}
+
+mTox_FILE_IO_BACKEND mTox_mFileIOBackend_TO_DATA(const VALUE value)
+{
+  if (value == mTox_mFileIOBackend_PREAD) {
+    return mTox_FILE_IO_BACKEND_PREAD;
+  }
+  else if (value == mTox_mFileIOBackend_IO_URING) {
+    return mTox_FILE_IO_BACKEND_IO_URING;
+  }
+  else {
+    RAISE_OPTION("Tox::FileIOBackend");
+  }
+}
+
+TOXAV_CALL_CONTROL mTox_mCallControl_TO_DATA(const VALUE value)
+{
+  if (value == mTox_mCallControl_RESUME) {
+    return TOXAV_CALL_CONTROL_RESUME;
+  }
+  else if (value == mTox_mCallControl_PAUSE) {
+    return TOXAV_CALL_CONTROL_PAUSE;
+  }
+  else if (value == mTox_mCallControl_CANCEL) {
+    return TOXAV_CALL_CONTROL_CANCEL;
+  }
+  else if (value == mTox_mCallControl_MUTE_AUDIO) {
+    return TOXAV_CALL_CONTROL_MUTE_AUDIO;
+  }
+  else if (value == mTox_mCallControl_UNMUTE_AUDIO) {
+    return TOXAV_CALL_CONTROL_UNMUTE_AUDIO;
+  }
+  else if (value == mTox_mCallControl_HIDE_VIDEO) {
+    return TOXAV_CALL_CONTROL_HIDE_VIDEO;
+  }
+  else if (value == mTox_mCallControl_SHOW_VIDEO) {
+    return TOXAV_CALL_CONTROL_SHOW_VIDEO;
+  }
+  else {
+    RAISE_OPTION("Tox::CallControl");
+  }
+}
+
+bool mTox_cAudioFrame_VALID(const mTox_cAudioFrame_CDATA *const cdata)
+{
+  return cdata->format_valid &&
+         (size_t)RSTRING_LEN(cdata->pcm) == cdata->pcm_size;
+}
+
+bool mTox_cVideoFrame_VALID(const mTox_cVideoFrame_CDATA *const cdata)
+{
+  return (size_t)RSTRING_LEN(cdata->y_plane) == cdata->y_size  &&
+         (size_t)RSTRING_LEN(cdata->u_plane) == cdata->uv_size &&
+         (size_t)RSTRING_LEN(cdata->v_plane) == cdata->uv_size;
+}
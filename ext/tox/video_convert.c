@@ -0,0 +1,378 @@
+#include "tox.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Private functions
+
+static void mTox_VIDEO_CONVERT_Y_ROW(const uint8_t *data, size_t pixel_size, size_t width, uint8_t *y_row);
+static void mTox_VIDEO_CONVERT_UV_ROW(const uint8_t *data, size_t stride, size_t pixel_size, size_t width, uint8_t *u_row, uint8_t *v_row);
+static void mTox_VIDEO_CONVERT_SPLIT_UV_ROW(const uint8_t *uv_row, size_t width, uint8_t *u_row, uint8_t *v_row);
+static void mTox_VIDEO_CONVERT_BLEND_ROWS(const uint8_t *row0, const uint8_t *row1, size_t width, uint32_t fraction, uint8_t *output);
+
+/*************************************************************
+ * Conversion
+ *************************************************************/
+
+// RGB or RGBA, alpha is ignored. Width and height must be even.
+void mTox_VIDEO_CONVERT_PACKED_TO_I420(
+  const uint8_t *const data,
+  const size_t pixel_size,
+  const size_t width,
+  const size_t height,
+  uint8_t *const y_plane,
+  uint8_t *const u_plane,
+  uint8_t *const v_plane
+)
+{
+  const size_t stride = width * pixel_size;
+
+  for (size_t row = 0; row < height; ++row) {
+    mTox_VIDEO_CONVERT_Y_ROW(
+      &data[row * stride],
+      pixel_size,
+      width,
+      &y_plane[row * width]
+    );
+  }
+
+  for (size_t row = 0; row < height / 2; ++row) {
+    mTox_VIDEO_CONVERT_UV_ROW(
+      &data[row * 2 * stride],
+      stride,
+      pixel_size,
+      width,
+      &u_plane[row * width / 2],
+      &v_plane[row * width / 2]
+    );
+  }
+}
+
+// Luma plane followed by interleaved chroma.
+void mTox_VIDEO_CONVERT_NV12_TO_I420(
+  const uint8_t *const data,
+  const size_t width,
+  const size_t height,
+  uint8_t *const y_plane,
+  uint8_t *const u_plane,
+  uint8_t *const v_plane
+)
+{
+  memcpy(y_plane, data, width * height);
+
+  const uint8_t *const uv_plane = &data[width * height];
+
+  for (size_t row = 0; row < height / 2; ++row) {
+    mTox_VIDEO_CONVERT_SPLIT_UV_ROW(
+      &uv_plane[row * width],
+      width / 2,
+      &u_plane[row * width / 2],
+      &v_plane[row * width / 2]
+    );
+  }
+}
+
+// Bilinear scaling with 8-bit weights between planes with strides, like
+// the row filters of libyuv. Two source rows are blended with SSE2 into
+// the row buffer, which holds source_width bytes, and then sampled
+// horizontally, so every source row is read once per output row. The
+// horizontal pass stays scalar: SSE2 has no gather for the varying source
+// columns, and libyuv needs SSSE3 shuffles for it too.
+void mTox_VIDEO_CONVERT_SCALE_PLANE(
+  const uint8_t *const source,
+  const size_t source_width,
+  const size_t source_height,
+  const size_t source_stride,
+  uint8_t *const destination,
+  const size_t width,
+  const size_t height,
+  const size_t stride,
+  uint8_t *const row
+)
+{
+  const uint64_t step_x =
+    width > 1 ? ((uint64_t)(source_width - 1) << 16) / (width - 1) : 0;
+  const uint64_t step_y =
+    height > 1 ? ((uint64_t)(source_height - 1) << 16) / (height - 1) : 0;
+
+  for (size_t output_row = 0; output_row < height; ++output_row) {
+    const uint64_t y = output_row * step_y;
+
+    const size_t   y0 = y >> 16;
+    const size_t   y1 = y0 + 1 < source_height ? y0 + 1 : y0;
+    const uint32_t fy = (y >> 8) & 0xff;
+
+    const uint8_t *blended = &source[y0 * source_stride];
+
+    if (fy != 0) {
+      mTox_VIDEO_CONVERT_BLEND_ROWS(
+        blended,
+        &source[y1 * source_stride],
+        source_width,
+        fy,
+        row
+      );
+
+      blended = row;
+    }
+
+    uint8_t *const output = &destination[output_row * stride];
+
+    if (width == source_width) {
+      memcpy(output, blended, width);
+      continue;
+    }
+
+    for (size_t column = 0; column < width; ++column) {
+      const uint64_t x = column * step_x;
+
+      const size_t   x0 = x >> 16;
+      const size_t   x1 = x0 + 1 < source_width ? x0 + 1 : x0;
+      const uint32_t fx = (x >> 8) & 0xff;
+
+      output[column] =
+        (blended[x0] * (256 - fx) + blended[x1] * fx + 128) >> 8;
+    }
+  }
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+void mTox_VIDEO_CONVERT_Y_ROW(
+  const uint8_t *const data,
+  const size_t pixel_size,
+  const size_t width,
+  uint8_t *const y_row
+)
+{
+  size_t x = 0;
+
+#ifdef __SSE2__
+  // Four RGBA pixels per register: products of red and green, then of
+  // blue and alpha, are summed in pairs and the pairs are added.
+  if (pixel_size == 4) {
+    const __m128i coefficients = _mm_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0);
+    const __m128i zero         = _mm_setzero_si128();
+    const __m128i rounding     = _mm_set1_epi32(128);
+    const __m128i offset       = _mm_set1_epi16(16);
+
+    for (; x + 8 <= width; x += 8) {
+      const __m128i first  = _mm_loadu_si128((const __m128i*)&data[x * 4]);
+      const __m128i second = _mm_loadu_si128((const __m128i*)&data[x * 4 + 16]);
+
+      const __m128i pairs[4] = {
+        _mm_madd_epi16(_mm_unpacklo_epi8(first,  zero), coefficients),
+        _mm_madd_epi16(_mm_unpackhi_epi8(first,  zero), coefficients),
+        _mm_madd_epi16(_mm_unpacklo_epi8(second, zero), coefficients),
+        _mm_madd_epi16(_mm_unpackhi_epi8(second, zero), coefficients),
+      };
+
+      __m128i sums[2];
+
+      for (int i = 0; i < 2; ++i) {
+        const __m128 a = _mm_castsi128_ps(pairs[i * 2]);
+        const __m128 b = _mm_castsi128_ps(pairs[i * 2 + 1]);
+
+        const __m128i even = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        const __m128i odd  = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        sums[i] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), rounding), 8);
+      }
+
+      const __m128i luma = _mm_add_epi16(_mm_packs_epi32(sums[0], sums[1]), offset);
+
+      _mm_storel_epi64((__m128i*)&y_row[x], _mm_packus_epi16(luma, zero));
+    }
+  }
+#endif
+
+  for (; x < width; ++x) {
+    const uint8_t *const pixel = &data[x * pixel_size];
+
+    y_row[x] = ((66 * pixel[0] + 129 * pixel[1] + 25 * pixel[2] + 128) >> 8) + 16;
+  }
+}
+
+void mTox_VIDEO_CONVERT_UV_ROW(
+  const uint8_t *const data,
+  const size_t stride,
+  const size_t pixel_size,
+  const size_t width,
+  uint8_t *const u_row,
+  uint8_t *const v_row
+)
+{
+  size_t x = 0;
+
+#ifdef __SSE2__
+  // Sixteen RGBA pixels of both rows per iteration. Pixels are widened,
+  // the rows are added and neighbours are added in pairs, which leaves
+  // eight 2x2 sums. Both chroma values are then computed like luma in
+  // mTox_VIDEO_CONVERT_Y_ROW.
+  if (pixel_size == 4) {
+    const __m128i u_coefficients = _mm_setr_epi16(-38, -74, 112, 0, -38, -74, 112, 0);
+    const __m128i v_coefficients = _mm_setr_epi16(112, -94, -18, 0, 112, -94, -18, 0);
+    const __m128i zero           = _mm_setzero_si128();
+    const __m128i two            = _mm_set1_epi16(2);
+    const __m128i rounding       = _mm_set1_epi32(128);
+    const __m128i offset         = _mm_set1_epi16(128);
+
+    for (; x + 8 <= width / 2; x += 8) {
+      const uint8_t *const top    = &data[x * 8];
+      const uint8_t *const bottom = &top[stride];
+
+      __m128i averages[4];
+
+      for (int i = 0; i < 4; ++i) {
+        const __m128i top_pixels =
+          _mm_loadu_si128((const __m128i*)&top[i * 16]);
+        const __m128i bottom_pixels =
+          _mm_loadu_si128((const __m128i*)&bottom[i * 16]);
+
+        const __m128i low = _mm_add_epi16(
+          _mm_unpacklo_epi8(top_pixels,    zero),
+          _mm_unpacklo_epi8(bottom_pixels, zero)
+        );
+
+        const __m128i high = _mm_add_epi16(
+          _mm_unpackhi_epi8(top_pixels,    zero),
+          _mm_unpackhi_epi8(bottom_pixels, zero)
+        );
+
+        const __m128i sums = _mm_unpacklo_epi64(
+          _mm_add_epi16(low,  _mm_srli_si128(low,  8)),
+          _mm_add_epi16(high, _mm_srli_si128(high, 8))
+        );
+
+        averages[i] = _mm_srli_epi16(_mm_add_epi16(sums, two), 2);
+      }
+
+      const __m128i *const coefficients[2] = { &u_coefficients, &v_coefficients };
+      uint8_t *const rows[2] = { u_row, v_row };
+
+      for (int c = 0; c < 2; ++c) {
+        __m128i values[2];
+
+        for (int i = 0; i < 2; ++i) {
+          const __m128 a = _mm_castsi128_ps(_mm_madd_epi16(averages[i * 2],     *coefficients[c]));
+          const __m128 b = _mm_castsi128_ps(_mm_madd_epi16(averages[i * 2 + 1], *coefficients[c]));
+
+          const __m128i even = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+          const __m128i odd  = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+
+          values[i] = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), rounding), 8);
+        }
+
+        const __m128i chroma =
+          _mm_add_epi16(_mm_packs_epi32(values[0], values[1]), offset);
+
+        _mm_storel_epi64((__m128i*)&rows[c][x], _mm_packus_epi16(chroma, zero));
+      }
+    }
+  }
+#endif
+
+  for (; x < width / 2; ++x) {
+    const uint8_t *const top    = &data[x * 2 * pixel_size];
+    const uint8_t *const bottom = &top[stride];
+
+    const int r = (top[0] + top[pixel_size]     + bottom[0] + bottom[pixel_size]     + 2) >> 2;
+    const int g = (top[1] + top[pixel_size + 1] + bottom[1] + bottom[pixel_size + 1] + 2) >> 2;
+    const int b = (top[2] + top[pixel_size + 2] + bottom[2] + bottom[pixel_size + 2] + 2) >> 2;
+
+    u_row[x] = ((-38 * r -  74 * g + 112 * b + 128) >> 8) + 128;
+    v_row[x] = ((112 * r -  94 * g -  18 * b + 128) >> 8) + 128;
+  }
+}
+
+void mTox_VIDEO_CONVERT_SPLIT_UV_ROW(
+  const uint8_t *const uv_row,
+  const size_t width,
+  uint8_t *const u_row,
+  uint8_t *const v_row
+)
+{
+  size_t x = 0;
+
+#ifdef __SSE2__
+  const __m128i mask = _mm_set1_epi16(0x00ff);
+
+  for (; x + 16 <= width; x += 16) {
+    const __m128i first  = _mm_loadu_si128((const __m128i*)&uv_row[x * 2]);
+    const __m128i second = _mm_loadu_si128((const __m128i*)&uv_row[x * 2 + 16]);
+
+    const __m128i u = _mm_packus_epi16(
+      _mm_and_si128(first, mask),
+      _mm_and_si128(second, mask)
+    );
+
+    const __m128i v = _mm_packus_epi16(
+      _mm_srli_epi16(first, 8),
+      _mm_srli_epi16(second, 8)
+    );
+
+    _mm_storeu_si128((__m128i*)&u_row[x], u);
+    _mm_storeu_si128((__m128i*)&v_row[x], v);
+  }
+#endif
+
+  for (; x < width; ++x) {
+    u_row[x] = uv_row[x * 2];
+    v_row[x] = uv_row[x * 2 + 1];
+  }
+}
+
+// Weights are out of 256, so sums fit unsigned 16-bit lanes.
+void mTox_VIDEO_CONVERT_BLEND_ROWS(
+  const uint8_t *const row0,
+  const uint8_t *const row1,
+  const size_t width,
+  const uint32_t fraction,
+  uint8_t *const output
+)
+{
+  size_t x = 0;
+
+#ifdef __SSE2__
+  const __m128i zero    = _mm_setzero_si128();
+  const __m128i round   = _mm_set1_epi16(128);
+  const __m128i weight0 = _mm_set1_epi16(256 - fraction);
+  const __m128i weight1 = _mm_set1_epi16(fraction);
+
+  for (; x + 16 <= width; x += 16) {
+    const __m128i top    = _mm_loadu_si128((const __m128i*)&row0[x]);
+    const __m128i bottom = _mm_loadu_si128((const __m128i*)&row1[x]);
+
+    const __m128i low = _mm_srli_epi16(
+      _mm_add_epi16(
+        _mm_add_epi16(
+          _mm_mullo_epi16(_mm_unpacklo_epi8(top,    zero), weight0),
+          _mm_mullo_epi16(_mm_unpacklo_epi8(bottom, zero), weight1)
+        ),
+        round
+      ),
+      8
+    );
+
+    const __m128i high = _mm_srli_epi16(
+      _mm_add_epi16(
+        _mm_add_epi16(
+          _mm_mullo_epi16(_mm_unpackhi_epi8(top,    zero), weight0),
+          _mm_mullo_epi16(_mm_unpackhi_epi8(bottom, zero), weight1)
+        ),
+        round
+      ),
+      8
+    );
+
+    _mm_storeu_si128((__m128i*)&output[x], _mm_packus_epi16(low, high));
+  }
+#endif
+
+  for (; x < width; ++x) {
+    output[x] = (row0[x] * (256 - fraction) + row1[x] * fraction + 128) >> 8;
+  }
+}
@@ -0,0 +1,36 @@
+// Conversion of video to the I420 layout of toxav, like in libyuv. Colors
+// use the BT.601 limited range, chroma is averaged over 2x2 blocks and
+// planes are scaled bilinearly with 16.16 fixed point steps and 8-bit
+// weights.
+
+void mTox_VIDEO_CONVERT_PACKED_TO_I420(
+  const uint8_t *data,
+  size_t pixel_size,
+  size_t width,
+  size_t height,
+  uint8_t *y_plane,
+  uint8_t *u_plane,
+  uint8_t *v_plane
+);
+
+void mTox_VIDEO_CONVERT_NV12_TO_I420(
+  const uint8_t *data,
+  size_t width,
+  size_t height,
+  uint8_t *y_plane,
+  uint8_t *u_plane,
+  uint8_t *v_plane
+);
+
+// The row buffer holds source_width bytes.
+void mTox_VIDEO_CONVERT_SCALE_PLANE(
+  const uint8_t *source,
+  size_t source_width,
+  size_t source_height,
+  size_t source_stride,
+  uint8_t *destination,
+  size_t width,
+  size_t height,
+  size_t stride,
+  uint8_t *row
+);
@@ -2,16 +2,48 @@
 
 // Memory management
 static VALUE mTox_cVideoFrame_alloc(VALUE klass);
-static void  mTox_cVideoFrame_free(mTox_cVideoFrame_CDATA *free_cdata);
+static void  mTox_cVideoFrame_mark(void *mark_cdata);
+static void  mTox_cVideoFrame_free(void *free_cdata);
 
 // Public methods
 
+static VALUE mTox_cVideoFrame_y_plane(VALUE self);
+static VALUE mTox_cVideoFrame_y_plane_ASSIGN(VALUE self, VALUE y_plane);
+
+static VALUE mTox_cVideoFrame_u_plane(VALUE self);
+static VALUE mTox_cVideoFrame_u_plane_ASSIGN(VALUE self, VALUE u_plane);
+
+static VALUE mTox_cVideoFrame_v_plane(VALUE self);
+static VALUE mTox_cVideoFrame_v_plane_ASSIGN(VALUE self, VALUE v_plane);
+
 static VALUE mTox_cVideoFrame_width(VALUE self);
 static VALUE mTox_cVideoFrame_width_ASSIGN(VALUE self, VALUE width);
 
 static VALUE mTox_cVideoFrame_height(VALUE self);
 static VALUE mTox_cVideoFrame_height_ASSIGN(VALUE self, VALUE height);
 
+static VALUE mTox_cVideoFrame_valid_QUESTION(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cVideoFrame_from_packed_with(VALUE klass, VALUE data, VALUE pixel_size, VALUE width, VALUE height);
+static VALUE mTox_cVideoFrame_from_nv12_with(VALUE klass, VALUE data, VALUE width, VALUE height);
+static VALUE mTox_cVideoFrame_scale_with(VALUE self, VALUE width, VALUE height);
+
+// Private functions
+
+static VALUE mTox_cVideoFrame_NEW(VALUE klass, uint16_t width, uint16_t height, uint8_t **y_plane, uint8_t **u_plane, uint8_t **v_plane);
+static VALUE mTox_cVideoFrame_PLANE(size_t length, uint8_t **plane);
+
+const rb_data_type_t mTox_cVideoFrame_TYPE = {
+  .wrap_struct_name = "Tox::VideoFrame",
+  .function = {
+    .dmark = mTox_cVideoFrame_mark,
+    .dfree = mTox_cVideoFrame_free,
+  },
+  .flags = RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
 /*************************************************************
  * Initialization
  *************************************************************/
@@ -23,27 +55,71 @@ void mTox_cVideoFrame_INIT()
 
   // Public methods
 
+  rb_define_method(mTox_cVideoFrame, "y_plane",  mTox_cVideoFrame_y_plane,        0);
+  rb_define_method(mTox_cVideoFrame, "y_plane=", mTox_cVideoFrame_y_plane_ASSIGN, 1);
+
+  rb_define_method(mTox_cVideoFrame, "u_plane",  mTox_cVideoFrame_u_plane,        0);
+  rb_define_method(mTox_cVideoFrame, "u_plane=", mTox_cVideoFrame_u_plane_ASSIGN, 1);
+
+  rb_define_method(mTox_cVideoFrame, "v_plane",  mTox_cVideoFrame_v_plane,        0);
+  rb_define_method(mTox_cVideoFrame, "v_plane=", mTox_cVideoFrame_v_plane_ASSIGN, 1);
+
   rb_define_method(mTox_cVideoFrame, "width",  mTox_cVideoFrame_width,        0);
   rb_define_method(mTox_cVideoFrame, "width=", mTox_cVideoFrame_width_ASSIGN, 1);
 
   rb_define_method(mTox_cVideoFrame, "height",  mTox_cVideoFrame_height,        0);
   rb_define_method(mTox_cVideoFrame, "height=", mTox_cVideoFrame_height_ASSIGN, 1);
+
+  rb_define_method(mTox_cVideoFrame, "valid?", mTox_cVideoFrame_valid_QUESTION, 0);
+
+  // Private methods
+
+  const VALUE singleton = rb_singleton_class(mTox_cVideoFrame);
+
+  rb_define_private_method(singleton, "from_packed_with", mTox_cVideoFrame_from_packed_with, 4);
+  rb_define_private_method(singleton, "from_nv12_with",   mTox_cVideoFrame_from_nv12_with,   3);
+
+  rb_define_private_method(mTox_cVideoFrame, "scale_with", mTox_cVideoFrame_scale_with, 2);
 }
 
 /*************************************************************
  * Memory management
  *************************************************************/
 
+// Fresh frames hold frozen empty planes, so received frames get new
+// buffers.
 VALUE mTox_cVideoFrame_alloc(const VALUE klass)
 {
   mTox_cVideoFrame_CDATA *alloc_cdata = ALLOC(mTox_cVideoFrame_CDATA);
 
   memset(alloc_cdata, 0, sizeof(mTox_cVideoFrame_CDATA));
 
-  return Data_Wrap_Struct(klass, NULL, mTox_cVideoFrame_free, alloc_cdata);
+  alloc_cdata->y_plane = Qnil;
+  alloc_cdata->u_plane = Qnil;
+  alloc_cdata->v_plane = Qnil;
+  alloc_cdata->exports = Qnil;
+
+  const VALUE self =
+    TypedData_Wrap_Struct(klass, &mTox_cVideoFrame_TYPE, alloc_cdata);
+
+  const VALUE empty = rb_obj_freeze(rb_str_new(NULL, 0));
+
+  mTox_cVideoFrame_SET_PLANES(self, alloc_cdata, empty, empty, empty);
+
+  return self;
 }
 
-void mTox_cVideoFrame_free(mTox_cVideoFrame_CDATA *const free_cdata)
+void mTox_cVideoFrame_mark(void *const mark_cdata)
+{
+  const mTox_cVideoFrame_CDATA *const cdata = mark_cdata;
+
+  rb_gc_mark(cdata->y_plane);
+  rb_gc_mark(cdata->u_plane);
+  rb_gc_mark(cdata->v_plane);
+  rb_gc_mark(cdata->exports);
+}
+
+void mTox_cVideoFrame_free(void *const free_cdata)
 {
   free(free_cdata);
 }
@@ -52,10 +128,88 @@ void mTox_cVideoFrame_free(mTox_cVideoFrame_CDATA *const free_cdata)
  * Public methods
  *************************************************************/
 
+// Tox::VideoFrame#y_plane
+VALUE mTox_cVideoFrame_y_plane(const VALUE self)
+{
+  VIDEO_FRAME_CDATA(self, self_cdata);
+
+  return self_cdata->y_plane;
+}
+
+// Tox::VideoFrame#y_plane=
+VALUE mTox_cVideoFrame_y_plane_ASSIGN(const VALUE self, const VALUE y_plane)
+{
+  Check_Type(y_plane, T_STRING);
+
+  VIDEO_FRAME_CDATA(self, self_cdata);
+
+  mTox_cVideoFrame_SET_PLANES(
+    self,
+    self_cdata,
+    y_plane,
+    self_cdata->u_plane,
+    self_cdata->v_plane
+  );
+
+  return Qnil;
+}
+
+// Tox::VideoFrame#u_plane
+VALUE mTox_cVideoFrame_u_plane(const VALUE self)
+{
+  VIDEO_FRAME_CDATA(self, self_cdata);
+
+  return self_cdata->u_plane;
+}
+
+// Tox::VideoFrame#u_plane=
+VALUE mTox_cVideoFrame_u_plane_ASSIGN(const VALUE self, const VALUE u_plane)
+{
+  Check_Type(u_plane, T_STRING);
+
+  VIDEO_FRAME_CDATA(self, self_cdata);
+
+  mTox_cVideoFrame_SET_PLANES(
+    self,
+    self_cdata,
+    self_cdata->y_plane,
+    u_plane,
+    self_cdata->v_plane
+  );
+
+  return Qnil;
+}
+
+// Tox::VideoFrame#v_plane
+VALUE mTox_cVideoFrame_v_plane(const VALUE self)
+{
+  VIDEO_FRAME_CDATA(self, self_cdata);
+
+  return self_cdata->v_plane;
+}
+
+// Tox::VideoFrame#v_plane=
+VALUE mTox_cVideoFrame_v_plane_ASSIGN(const VALUE self, const VALUE v_plane)
+{
+  Check_Type(v_plane, T_STRING);
+
+  VIDEO_FRAME_CDATA(self, self_cdata);
+
+  mTox_cVideoFrame_SET_PLANES(
+    self,
+    self_cdata,
+    self_cdata->y_plane,
+    self_cdata->u_plane,
+    v_plane
+  );
+
+  return Qnil;
+}
+
 // Tox::VideoFrame#width
 VALUE mTox_cVideoFrame_width(const VALUE self)
 {
-  CDATA(self, mTox_cVideoFrame_CDATA, self_cdata);
+  VIDEO_FRAME_CDATA(self, self_cdata);
 
   return UINT2NUM(self_cdata->width);
 }
@@ -63,9 +217,9 @@ VALUE mTox_cVideoFrame_width(const VALUE self)
 // Tox::VideoFrame#width=
 VALUE mTox_cVideoFrame_width_ASSIGN(const VALUE self, const VALUE width)
 {
-  CDATA(self, mTox_cVideoFrame_CDATA, self_cdata);
+  VIDEO_FRAME_CDATA(self, self_cdata);
 
-  self_cdata->width = NUM2UINT(width);
+  mTox_cVideoFrame_SET_SIZE(self_cdata, NUM2UINT(width), self_cdata->height);
 
   return Qnil;
 }
@@ -73,7 +227,7 @@ VALUE mTox_cVideoFrame_width_ASSIGN(const VALUE self, const VALUE width)
 // Tox::VideoFrame#height
 VALUE mTox_cVideoFrame_height(const VALUE self)
 {
-  CDATA(self, mTox_cVideoFrame_CDATA, self_cdata);
+  VIDEO_FRAME_CDATA(self, self_cdata);
 
   return UINT2NUM(self_cdata->height);
 }
@@ -81,9 +235,233 @@ VALUE mTox_cVideoFrame_height(const VALUE self)
 // Tox::VideoFrame#height=
 VALUE mTox_cVideoFrame_height_ASSIGN(const VALUE self, const VALUE height)
 {
-  CDATA(self, mTox_cVideoFrame_CDATA, self_cdata);
+  VIDEO_FRAME_CDATA(self, self_cdata);
 
-  self_cdata->height = NUM2UINT(height);
+  mTox_cVideoFrame_SET_SIZE(self_cdata, self_cdata->width, NUM2UINT(height));
 
   return Qnil;
 }
+
+// Tox::VideoFrame#valid?
+VALUE mTox_cVideoFrame_valid_QUESTION(const VALUE self)
+{
+  VIDEO_FRAME_CDATA(self, self_cdata);
+
+  if (mTox_cVideoFrame_VALID(self_cdata)) {
+    return Qtrue;
+  }
+  else {
+    return Qfalse;
+  }
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::VideoFrame.from_packed_with
+VALUE mTox_cVideoFrame_from_packed_with(
+  const VALUE klass,
+  const VALUE data,
+  const VALUE pixel_size,
+  const VALUE width,
+  const VALUE height
+)
+{
+  uint8_t *y_plane, *u_plane, *v_plane;
+
+  const VALUE frame = mTox_cVideoFrame_NEW(
+    klass,
+    NUM2UINT(width),
+    NUM2UINT(height),
+    &y_plane,
+    &u_plane,
+    &v_plane
+  );
+
+  mTox_VIDEO_CONVERT_PACKED_TO_I420(
+    (const uint8_t*)RSTRING_PTR(data),
+    NUM2UINT(pixel_size),
+    NUM2UINT(width),
+    NUM2UINT(height),
+    y_plane,
+    u_plane,
+    v_plane
+  );
+
+  RB_GC_GUARD(data);
+
+  return frame;
+}
+
+// Tox::VideoFrame.from_nv12_with
+VALUE mTox_cVideoFrame_from_nv12_with(
+  const VALUE klass,
+  const VALUE data,
+  const VALUE width,
+  const VALUE height
+)
+{
+  uint8_t *y_plane, *u_plane, *v_plane;
+
+  const VALUE frame = mTox_cVideoFrame_NEW(
+    klass,
+    NUM2UINT(width),
+    NUM2UINT(height),
+    &y_plane,
+    &u_plane,
+    &v_plane
+  );
+
+  mTox_VIDEO_CONVERT_NV12_TO_I420(
+    (const uint8_t*)RSTRING_PTR(data),
+    NUM2UINT(width),
+    NUM2UINT(height),
+    y_plane,
+    u_plane,
+    v_plane
+  );
+
+  RB_GC_GUARD(data);
+
+  return frame;
+}
+
+// Tox::VideoFrame#scale_with
+VALUE mTox_cVideoFrame_scale_with(
+  const VALUE self,
+  const VALUE width,
+  const VALUE height
+)
+{
+  VIDEO_FRAME_CDATA(self, self_cdata);
+
+  const VALUE source_planes[3] = {
+    self_cdata->y_plane,
+    self_cdata->u_plane,
+    self_cdata->v_plane,
+  };
+
+  uint8_t *planes[3];
+
+  const VALUE frame = mTox_cVideoFrame_NEW(
+    rb_obj_class(self),
+    NUM2UINT(width),
+    NUM2UINT(height),
+    &planes[0],
+    &planes[1],
+    &planes[2]
+  );
+
+  // Rows of the luma plane are the widest.
+  VALUE row_buffer;
+
+  uint8_t *const row = ALLOCV_N(uint8_t, row_buffer, self_cdata->width);
+
+  for (int i = 0; i < 3; ++i) {
+    const size_t shift = i == 0 ? 0 : 1;
+
+    mTox_VIDEO_CONVERT_SCALE_PLANE(
+      (const uint8_t*)RSTRING_PTR(source_planes[i]),
+      self_cdata->width  >> shift,
+      self_cdata->height >> shift,
+      self_cdata->width  >> shift,
+      planes[i],
+      NUM2UINT(width)  >> shift,
+      NUM2UINT(height) >> shift,
+      NUM2UINT(width)  >> shift,
+      row
+    );
+  }
+
+  ALLOCV_END(row_buffer);
+
+  RB_GC_GUARD(source_planes[0]);
+  RB_GC_GUARD(source_planes[1]);
+  RB_GC_GUARD(source_planes[2]);
+
+  return frame;
+}
+
+/*************************************************************
+ * Frames
+ *************************************************************/
+
+bool mTox_cVideoFrame_IS(const VALUE value)
+{
+  return rb_typeddata_is_kind_of(value, &mTox_cVideoFrame_TYPE);
+}
+
+void mTox_cVideoFrame_SET_PLANES(
+  const VALUE self,
+  mTox_cVideoFrame_CDATA *const self_cdata,
+  const VALUE y_plane,
+  const VALUE u_plane,
+  const VALUE v_plane
+)
+{
+  RB_OBJ_WRITE(self, &self_cdata->y_plane, y_plane);
+  RB_OBJ_WRITE(self, &self_cdata->u_plane, u_plane);
+  RB_OBJ_WRITE(self, &self_cdata->v_plane, v_plane);
+}
+
+VALUE mTox_cVideoFrame_REUSABLE_PLANE(
+  const mTox_cVideoFrame_CDATA *const self_cdata,
+  const VALUE plane
+)
+{
+  if (mTox_MEMORY_VIEW_EXPORTED(self_cdata->exports, plane)) {
+    return Qnil;
+  }
+
+  return plane;
+}
+
+void mTox_cVideoFrame_SET_SIZE(
+  mTox_cVideoFrame_CDATA *const self_cdata,
+  const uint16_t width,
+  const uint16_t height
+)
+{
+  self_cdata->width   = width;
+  self_cdata->height  = height;
+  self_cdata->y_size  = (size_t)width * height;
+  self_cdata->uv_size = (size_t)(width / 2) * (height / 2);
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+VALUE mTox_cVideoFrame_NEW(
+  const VALUE klass,
+  const uint16_t width,
+  const uint16_t height,
+  uint8_t **const y_plane,
+  uint8_t **const u_plane,
+  uint8_t **const v_plane
+)
+{
+  const VALUE frame = rb_funcall(klass, rb_intern("new"), 0);
+
+  VIDEO_FRAME_CDATA(frame, frame_cdata);
+
+  mTox_cVideoFrame_SET_SIZE(frame_cdata, width, height);
+
+  const VALUE y_string = mTox_cVideoFrame_PLANE(frame_cdata->y_size,  y_plane);
+  const VALUE u_string = mTox_cVideoFrame_PLANE(frame_cdata->uv_size, u_plane);
+  const VALUE v_string = mTox_cVideoFrame_PLANE(frame_cdata->uv_size, v_plane);
+
+  mTox_cVideoFrame_SET_PLANES(frame, frame_cdata, y_string, u_string, v_string);
+
+  return frame;
+}
+
+VALUE mTox_cVideoFrame_PLANE(const size_t length, uint8_t **const plane)
+{
+  const VALUE string = rb_str_new(NULL, length);
+
+  *plane = (uint8_t*)RSTRING_PTR(string);
+
+  return string;
+}
@@ -0,0 +1,562 @@
+#include "tox.h"
+
+// Memory management
+static VALUE mTox_cVideoMosaic_alloc(VALUE klass);
+static void  mTox_cVideoMosaic_free(mTox_cVideoMosaic_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cVideoMosaic_width(VALUE self);
+static VALUE mTox_cVideoMosaic_height(VALUE self);
+static VALUE mTox_cVideoMosaic_columns(VALUE self);
+static VALUE mTox_cVideoMosaic_rows(VALUE self);
+
+static VALUE mTox_cVideoMosaic_push(VALUE self, VALUE source, VALUE video_frame);
+static VALUE mTox_cVideoMosaic_delete(VALUE self, VALUE source);
+static VALUE mTox_cVideoMosaic_sources(VALUE self);
+static VALUE mTox_cVideoMosaic_tick(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cVideoMosaic_initialize_with(VALUE self, VALUE width, VALUE height, VALUE columns, VALUE rows, VALUE frame_interval);
+static VALUE mTox_cVideoMosaic_compose_with(VALUE self, VALUE video_frame, VALUE except);
+
+// Private functions
+
+static mTox_cVideoMosaic_SOURCE *mTox_cVideoMosaic_SOURCE_GET(
+  mTox_cVideoMosaic_CDATA *self_cdata,
+  uint32_t source_data,
+  bool create
+);
+
+static void mTox_cVideoMosaic_GRID(const mTox_cVideoMosaic_CDATA *self_cdata, size_t count, size_t *columns, size_t *rows);
+static void mTox_cVideoMosaic_TILE(mTox_cVideoMosaic_CDATA *self_cdata, mTox_cVideoMosaic_SOURCE *source_cdata, size_t cell_width, size_t cell_height);
+static VALUE mTox_cVideoMosaic_BUFFER(VALUE buffer, size_t length);
+
+// Colors of cells without a tile and of borders around tiles.
+#define mTox_cVideoMosaic_BLACK_Y  16
+#define mTox_cVideoMosaic_BLACK_UV 128
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cVideoMosaic_INIT()
+{
+  // Memory management
+  rb_define_alloc_func(mTox_cVideoMosaic, mTox_cVideoMosaic_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cVideoMosaic, "width",   mTox_cVideoMosaic_width,   0);
+  rb_define_method(mTox_cVideoMosaic, "height",  mTox_cVideoMosaic_height,  0);
+  rb_define_method(mTox_cVideoMosaic, "columns", mTox_cVideoMosaic_columns, 0);
+  rb_define_method(mTox_cVideoMosaic, "rows",    mTox_cVideoMosaic_rows,    0);
+
+  rb_define_method(mTox_cVideoMosaic, "push",    mTox_cVideoMosaic_push,    2);
+  rb_define_method(mTox_cVideoMosaic, "delete",  mTox_cVideoMosaic_delete,  1);
+  rb_define_method(mTox_cVideoMosaic, "sources", mTox_cVideoMosaic_sources, 0);
+  rb_define_method(mTox_cVideoMosaic, "tick",    mTox_cVideoMosaic_tick,    0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cVideoMosaic, "initialize_with", mTox_cVideoMosaic_initialize_with, 5);
+  rb_define_private_method(mTox_cVideoMosaic, "compose_with",    mTox_cVideoMosaic_compose_with,    2);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cVideoMosaic_alloc(const VALUE klass)
+{
+  mTox_cVideoMosaic_CDATA *alloc_cdata = ALLOC(mTox_cVideoMosaic_CDATA);
+
+  memset(alloc_cdata, 0, sizeof(mTox_cVideoMosaic_CDATA));
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cVideoMosaic_free, alloc_cdata);
+}
+
+void mTox_cVideoMosaic_free(mTox_cVideoMosaic_CDATA *const free_cdata)
+{
+  for (size_t i = 0; i < free_cdata->sources_size; ++i) {
+    free(free_cdata->sources[i].frame);
+    free(free_cdata->sources[i].tile);
+  }
+
+  free(free_cdata->sources);
+  free(free_cdata->row);
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::VideoMosaic#width
+VALUE mTox_cVideoMosaic_width(const VALUE self)
+{
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  return UINT2NUM(self_cdata->width);
+}
+
+// Tox::VideoMosaic#height
+VALUE mTox_cVideoMosaic_height(const VALUE self)
+{
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  return UINT2NUM(self_cdata->height);
+}
+
+// Tox::VideoMosaic#columns
+VALUE mTox_cVideoMosaic_columns(const VALUE self)
+{
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  if (self_cdata->columns == 0) {
+    return Qnil;
+  }
+
+  return UINT2NUM(self_cdata->columns);
+}
+
+// Tox::VideoMosaic#rows
+VALUE mTox_cVideoMosaic_rows(const VALUE self)
+{
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  if (self_cdata->rows == 0) {
+    return Qnil;
+  }
+
+  return UINT2NUM(self_cdata->rows);
+}
+
+// Tox::VideoMosaic#push
+VALUE mTox_cVideoMosaic_push(
+  const VALUE self,
+  const VALUE source,
+  const VALUE video_frame
+)
+{
+  if (!mTox_cVideoFrame_IS(video_frame)) {
+    RAISE_TYPECHECK(
+      "Tox::VideoMosaic#push",
+      "video_frame",
+      "Tox::VideoFrame"
+    );
+  }
+
+  const uint32_t source_data = NUM2ULONG(source);
+
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  VIDEO_FRAME_CDATA(video_frame, video_frame_cdata);
+
+  if (
+    !mTox_cVideoFrame_VALID(video_frame_cdata) ||
+    video_frame_cdata->width < 2 ||
+    video_frame_cdata->height < 2
+  ) {
+    rb_raise(rb_eArgError, "video frame is invalid");
+  }
+
+  const size_t y_size  = video_frame_cdata->y_size;
+  const size_t uv_size = video_frame_cdata->uv_size;
+
+  mTox_cVideoMosaic_SOURCE *const source_cdata =
+    mTox_cVideoMosaic_SOURCE_GET(self_cdata, source_data, true);
+
+  if (source_cdata->frame_capacity < y_size + 2 * uv_size) {
+    REALLOC_N(source_cdata->frame, uint8_t, y_size + 2 * uv_size);
+    source_cdata->frame_capacity = y_size + 2 * uv_size;
+  }
+
+  memcpy(source_cdata->frame, RSTRING_PTR(video_frame_cdata->y_plane), y_size);
+
+  memcpy(
+    &source_cdata->frame[y_size],
+    RSTRING_PTR(video_frame_cdata->u_plane),
+    uv_size
+  );
+
+  memcpy(
+    &source_cdata->frame[y_size + uv_size],
+    RSTRING_PTR(video_frame_cdata->v_plane),
+    uv_size
+  );
+
+  source_cdata->width  = video_frame_cdata->width;
+  source_cdata->height = video_frame_cdata->height;
+  source_cdata->scaled = false;
+
+  return Qnil;
+}
+
+// Tox::VideoMosaic#delete
+//
+// Sources keep their order, so the remaining tiles do not jump around.
+VALUE mTox_cVideoMosaic_delete(const VALUE self, const VALUE source)
+{
+  const uint32_t source_data = NUM2ULONG(source);
+
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  for (size_t i = 0; i < self_cdata->sources_size; ++i) {
+    if (self_cdata->sources[i].id == source_data) {
+      free(self_cdata->sources[i].frame);
+      free(self_cdata->sources[i].tile);
+
+      memmove(
+        &self_cdata->sources[i],
+        &self_cdata->sources[i + 1],
+        (self_cdata->sources_size - i - 1) * sizeof(mTox_cVideoMosaic_SOURCE)
+      );
+
+      --self_cdata->sources_size;
+
+      return Qtrue;
+    }
+  }
+
+  return Qfalse;
+}
+
+// Tox::VideoMosaic#sources
+VALUE mTox_cVideoMosaic_sources(const VALUE self)
+{
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  const VALUE sources = rb_ary_new_capa(self_cdata->sources_size);
+
+  for (size_t i = 0; i < self_cdata->sources_size; ++i) {
+    rb_ary_push(sources, ULONG2NUM(self_cdata->sources[i].id));
+  }
+
+  return sources;
+}
+
+// Tox::VideoMosaic#tick
+//
+// A mosaic which fell behind skips the missed frames instead of
+// composing them in a burst.
+VALUE mTox_cVideoMosaic_tick(const VALUE self)
+{
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  const uint64_t now = mTox_AUDIO_STREAM_NOW();
+
+  if (now < self_cdata->next_frame) {
+    return Qfalse;
+  }
+
+  self_cdata->next_frame += self_cdata->frame_interval;
+
+  if (self_cdata->next_frame <= now) {
+    self_cdata->next_frame = now + self_cdata->frame_interval;
+  }
+
+  return Qtrue;
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::VideoMosaic#initialize_with
+VALUE mTox_cVideoMosaic_initialize_with(
+  const VALUE self,
+  const VALUE width,
+  const VALUE height,
+  const VALUE columns,
+  const VALUE rows,
+  const VALUE frame_interval
+)
+{
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+
+  self_cdata->width          = NUM2UINT(width);
+  self_cdata->height         = NUM2UINT(height);
+  self_cdata->columns        = Qnil == columns ? 0 : NUM2UINT(columns);
+  self_cdata->rows           = Qnil == rows    ? 0 : NUM2UINT(rows);
+  self_cdata->frame_interval = NUM2ULL(frame_interval);
+
+  return self;
+}
+
+// Tox::VideoMosaic#compose_with
+//
+// The grid is laid out for all the sources even when one is left out, so
+// tiles keep their sizes and are not scaled again for every listener.
+VALUE mTox_cVideoMosaic_compose_with(
+  const VALUE self,
+  const VALUE video_frame,
+  const VALUE except
+)
+{
+  CDATA(self, mTox_cVideoMosaic_CDATA, self_cdata);
+  VIDEO_FRAME_CDATA(video_frame, video_frame_cdata);
+
+  const bool     has_except  = Qnil != except;
+  const uint32_t except_data = has_except ? NUM2ULONG(except) : 0;
+
+  const size_t width  = self_cdata->width;
+  const size_t height = self_cdata->height;
+
+  mTox_cVideoFrame_SET_SIZE(video_frame_cdata, width, height);
+
+  const size_t y_size  = video_frame_cdata->y_size;
+  const size_t uv_size = video_frame_cdata->uv_size;
+
+  const VALUE old_y_plane =
+    mTox_cVideoFrame_REUSABLE_PLANE(video_frame_cdata, video_frame_cdata->y_plane);
+  const VALUE old_u_plane =
+    mTox_cVideoFrame_REUSABLE_PLANE(video_frame_cdata, video_frame_cdata->u_plane);
+  const VALUE old_v_plane =
+    mTox_cVideoFrame_REUSABLE_PLANE(video_frame_cdata, video_frame_cdata->v_plane);
+
+  const VALUE y_plane = mTox_cVideoMosaic_BUFFER(old_y_plane, y_size);
+
+  // Planes can be the same string when they were assigned by hand.
+  const VALUE u_plane =
+    old_u_plane == y_plane ?
+      rb_str_new(NULL, uv_size) :
+      mTox_cVideoMosaic_BUFFER(old_u_plane, uv_size);
+
+  const VALUE v_plane =
+    old_v_plane == y_plane || old_v_plane == u_plane ?
+      rb_str_new(NULL, uv_size) :
+      mTox_cVideoMosaic_BUFFER(old_v_plane, uv_size);
+
+  mTox_cVideoFrame_SET_PLANES(
+    video_frame,
+    video_frame_cdata,
+    y_plane,
+    u_plane,
+    v_plane
+  );
+
+  uint8_t *const y_data = (uint8_t*)RSTRING_PTR(y_plane);
+  uint8_t *const u_data = (uint8_t*)RSTRING_PTR(u_plane);
+  uint8_t *const v_data = (uint8_t*)RSTRING_PTR(v_plane);
+
+  memset(y_data, mTox_cVideoMosaic_BLACK_Y,  y_size);
+  memset(u_data, mTox_cVideoMosaic_BLACK_UV, uv_size);
+  memset(v_data, mTox_cVideoMosaic_BLACK_UV, uv_size);
+
+  size_t columns, rows;
+
+  mTox_cVideoMosaic_GRID(self_cdata, self_cdata->sources_size, &columns, &rows);
+
+  const size_t cell_width  = (width  / columns) & ~(size_t)1;
+  const size_t cell_height = (height / rows)    & ~(size_t)1;
+
+  if (cell_width < 2 || cell_height < 2) {
+    return video_frame;
+  }
+
+  size_t cell = 0;
+
+  for (size_t i = 0; i < self_cdata->sources_size && cell < columns * rows; ++i) {
+    mTox_cVideoMosaic_SOURCE *const source_cdata = &self_cdata->sources[i];
+
+    if (has_except && source_cdata->id == except_data) {
+      continue;
+    }
+
+    mTox_cVideoMosaic_TILE(self_cdata, source_cdata, cell_width, cell_height);
+
+    const size_t tile_width  = source_cdata->tile_width;
+    const size_t tile_height = source_cdata->tile_height;
+
+    // Tiles are centered on even offsets, so chroma stays aligned.
+    const size_t x =
+      cell % columns * cell_width + ((cell_width - tile_width) / 2 & ~(size_t)1);
+    const size_t y =
+      cell / columns * cell_height + ((cell_height - tile_height) / 2 & ~(size_t)1);
+
+    const uint8_t *const tile_y = source_cdata->tile;
+    const uint8_t *const tile_u = &tile_y[tile_width * tile_height];
+    const uint8_t *const tile_v = &tile_u[tile_width / 2 * (tile_height / 2)];
+
+    for (size_t row = 0; row < tile_height; ++row) {
+      memcpy(
+        &y_data[(y + row) * width + x],
+        &tile_y[row * tile_width],
+        tile_width
+      );
+    }
+
+    for (size_t row = 0; row < tile_height / 2; ++row) {
+      const size_t offset = (y / 2 + row) * (width / 2) + x / 2;
+
+      memcpy(&u_data[offset], &tile_u[row * (tile_width / 2)], tile_width / 2);
+      memcpy(&v_data[offset], &tile_v[row * (tile_width / 2)], tile_width / 2);
+    }
+
+    ++cell;
+  }
+
+  return video_frame;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+mTox_cVideoMosaic_SOURCE *mTox_cVideoMosaic_SOURCE_GET(
+  mTox_cVideoMosaic_CDATA *const self_cdata,
+  const uint32_t source_data,
+  const bool create
+)
+{
+  for (size_t i = 0; i < self_cdata->sources_size; ++i) {
+    if (self_cdata->sources[i].id == source_data) {
+      return &self_cdata->sources[i];
+    }
+  }
+
+  if (!create) {
+    return NULL;
+  }
+
+  REALLOC_N(
+    self_cdata->sources,
+    mTox_cVideoMosaic_SOURCE,
+    self_cdata->sources_size + 1
+  );
+
+  mTox_cVideoMosaic_SOURCE *const source_cdata =
+    &self_cdata->sources[self_cdata->sources_size++];
+
+  memset(source_cdata, 0, sizeof(mTox_cVideoMosaic_SOURCE));
+
+  source_cdata->id = source_data;
+
+  return source_cdata;
+}
+
+// The missing dimension is chosen so every source gets a cell, the
+// grid is square when both are missing.
+void mTox_cVideoMosaic_GRID(
+  const mTox_cVideoMosaic_CDATA *const self_cdata,
+  const size_t count,
+  size_t *const columns,
+  size_t *const rows
+)
+{
+  const size_t cells = count > 0 ? count : 1;
+
+  *columns = self_cdata->columns;
+  *rows    = self_cdata->rows;
+
+  if (*columns == 0 && *rows == 0) {
+    *columns = 1;
+
+    while (*columns * *columns < cells) {
+      ++*columns;
+    }
+  }
+
+  if (*columns == 0) {
+    *columns = (cells + *rows - 1) / *rows;
+  }
+
+  if (*rows == 0) {
+    *rows = (cells + *columns - 1) / *columns;
+  }
+}
+
+// Fits the latest frame into the cell, keeping its aspect ratio.
+void mTox_cVideoMosaic_TILE(
+  mTox_cVideoMosaic_CDATA *const self_cdata,
+  mTox_cVideoMosaic_SOURCE *const source_cdata,
+  const size_t cell_width,
+  const size_t cell_height
+)
+{
+  const size_t source_width  = source_cdata->width;
+  const size_t source_height = source_cdata->height;
+
+  size_t tile_width  = cell_width;
+  size_t tile_height = cell_height;
+
+  if ((uint64_t)source_width * cell_height <= (uint64_t)source_height * cell_width) {
+    tile_width = ((uint64_t)source_width * cell_height / source_height) & ~(size_t)1;
+  }
+  else {
+    tile_height = ((uint64_t)source_height * cell_width / source_width) & ~(size_t)1;
+  }
+
+  if (tile_width  < 2) tile_width  = 2;
+  if (tile_height < 2) tile_height = 2;
+
+  if (
+    source_cdata->scaled &&
+    source_cdata->tile_width  == tile_width &&
+    source_cdata->tile_height == tile_height
+  ) {
+    return;
+  }
+
+  const size_t tile_size =
+    tile_width * tile_height + 2 * (tile_width / 2) * (tile_height / 2);
+
+  if (source_cdata->tile_capacity < tile_size) {
+    REALLOC_N(source_cdata->tile, uint8_t, tile_size);
+    source_cdata->tile_capacity = tile_size;
+  }
+
+  if (self_cdata->row_capacity < source_width) {
+    REALLOC_N(self_cdata->row, uint8_t, source_width);
+    self_cdata->row_capacity = source_width;
+  }
+
+  const size_t source_y_size  = source_width * source_height;
+  const size_t source_uv_size = (source_width / 2) * (source_height / 2);
+  const size_t tile_y_size    = tile_width * tile_height;
+  const size_t tile_uv_size   = (tile_width / 2) * (tile_height / 2);
+
+  mTox_VIDEO_CONVERT_SCALE_PLANE(
+    source_cdata->frame,
+    source_width,
+    source_height,
+    source_width,
+    source_cdata->tile,
+    tile_width,
+    tile_height,
+    tile_width,
+    self_cdata->row
+  );
+
+  for (size_t plane = 0; plane < 2; ++plane) {
+    mTox_VIDEO_CONVERT_SCALE_PLANE(
+      &source_cdata->frame[source_y_size + plane * source_uv_size],
+      source_width / 2,
+      source_height / 2,
+      source_width / 2,
+      &source_cdata->tile[tile_y_size + plane * tile_uv_size],
+      tile_width / 2,
+      tile_height / 2,
+      tile_width / 2,
+      self_cdata->row
+    );
+  }
+
+  source_cdata->scaled      = true;
+  source_cdata->tile_width  = tile_width;
+  source_cdata->tile_height = tile_height;
+}
+
+VALUE mTox_cVideoMosaic_BUFFER(const VALUE buffer, const size_t length)
+{
+  if (OBJ_FROZEN(buffer)) {
+    return rb_str_new(NULL, length);
+  }
+
+  rb_str_resize(buffer, length);
+  rb_str_modify(buffer);
+
+  return buffer;
+}
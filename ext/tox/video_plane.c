@@ -0,0 +1,150 @@
+#include "tox.h"
+
+#ifdef HAVE_RUBY_MEMORY_VIEW_H
+// Memory view
+static bool mTox_cVideoPlane_memory_view_get(VALUE self, rb_memory_view_t *view, int flags);
+static bool mTox_cVideoPlane_memory_view_release(VALUE self, rb_memory_view_t *view);
+static bool mTox_cVideoPlane_memory_view_available_p(VALUE self);
+
+// Private functions
+
+static VALUE mTox_cVideoPlane_PLANE(VALUE self, size_t *width, size_t *height);
+
+// Rows of bytes.
+static const rb_memory_view_entry_t mTox_cVideoPlane_MEMORY_VIEW = {
+  .get_func         = mTox_cVideoPlane_memory_view_get,
+  .release_func     = mTox_cVideoPlane_memory_view_release,
+  .available_p_func = mTox_cVideoPlane_memory_view_available_p,
+};
+#endif
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cVideoPlane_INIT()
+{
+#ifdef HAVE_RUBY_MEMORY_VIEW_H
+  // Memory view
+  rb_memory_view_register(mTox_cVideoPlane, &mTox_cVideoPlane_MEMORY_VIEW);
+#endif
+}
+
+/*************************************************************
+ * Memory view
+ *************************************************************/
+
+#ifdef HAVE_RUBY_MEMORY_VIEW_H
+bool mTox_cVideoPlane_memory_view_get(
+  const VALUE self,
+  rb_memory_view_t *const view,
+  const int flags
+)
+{
+  const VALUE frame = rb_iv_get(self, "@frame");
+
+  VIDEO_FRAME_CDATA(frame, frame_cdata);
+
+  size_t width, height;
+
+  const VALUE plane = mTox_cVideoPlane_PLANE(self, &width, &height);
+
+  const bool readonly = OBJ_FROZEN(plane);
+
+  if (readonly && (flags & RUBY_MEMORY_VIEW_WRITABLE)) {
+    return false;
+  }
+
+  // Writes must not reach strings which share the buffer.
+  if (!readonly && !mTox_MEMORY_VIEW_EXPORTED(frame_cdata->exports, plane)) {
+    rb_str_modify(plane);
+  }
+
+  // Shape followed by strides.
+  ssize_t *const layout = ALLOC_N(ssize_t, 4);
+
+  layout[0] = height;
+  layout[1] = width;
+  layout[2] = width;
+  layout[3] = 1;
+
+  mTox_MEMORY_VIEW_EXPORT(frame, &frame_cdata->exports, plane);
+
+  view->obj                  = self;
+  view->data                 = RSTRING_PTR(plane);
+  view->byte_size            = width * height;
+  view->readonly             = readonly;
+  view->format               = "C";
+  view->item_size            = 1;
+  view->item_desc.components = NULL;
+  view->item_desc.length     = 0;
+  view->ndim                 = 2;
+  view->shape                = &layout[0];
+  view->strides              = &layout[2];
+  view->sub_offsets          = NULL;
+  view->private_data         = (void*)plane;
+
+  return true;
+}
+
+bool mTox_cVideoPlane_memory_view_release(
+  const VALUE self,
+  rb_memory_view_t *const view
+)
+{
+  const VALUE frame = rb_iv_get(self, "@frame");
+
+  VIDEO_FRAME_CDATA(frame, frame_cdata);
+
+  mTox_MEMORY_VIEW_UNEXPORT(frame_cdata->exports, (VALUE)view->private_data);
+
+  xfree((void*)view->shape);
+
+  return true;
+}
+
+// Views cover whole planes, so strings must have all of their bytes.
+bool mTox_cVideoPlane_memory_view_available_p(const VALUE self)
+{
+  size_t width, height;
+
+  const VALUE plane = mTox_cVideoPlane_PLANE(self, &width, &height);
+
+  return width > 0 && height > 0 &&
+    (size_t)RSTRING_LEN(plane) >= width * height;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+// Chroma planes have half of the luma size in both directions.
+VALUE mTox_cVideoPlane_PLANE(
+  const VALUE self,
+  size_t *const width,
+  size_t *const height
+)
+{
+  const VALUE frame = rb_iv_get(self, "@frame");
+  const ID    name  = SYM2ID(rb_iv_get(self, "@name"));
+
+  VIDEO_FRAME_CDATA(frame, frame_cdata);
+
+  if (rb_intern("y") == name) {
+    *width  = frame_cdata->width;
+    *height = frame_cdata->height;
+
+    return frame_cdata->y_plane;
+  }
+
+  *width  = frame_cdata->width / 2;
+  *height = frame_cdata->height / 2;
+
+  if (rb_intern("u") == name) {
+    return frame_cdata->u_plane;
+  }
+  else {
+    return frame_cdata->v_plane;
+  }
+}
+#endif
@@ -0,0 +1,470 @@
+#include "tox.h"
+
+typedef struct {
+  uint16_t width;
+  uint16_t height;
+  size_t   capacity;
+  uint8_t *planes;
+} mTox_VIDEO_QUEUE_SLOT;
+
+// The ring holds one more slot than the depth, the one of the frame which
+// was taken last, so pushes while it is sent keep their buffers.
+struct mTox_VIDEO_QUEUE {
+  uint32_t friend_number;
+  uint64_t frame_interval;
+  uint64_t deadline;
+
+  size_t                 depth;
+  size_t                 head;
+  size_t                 size;
+  mTox_VIDEO_QUEUE_SLOT *slots;
+
+  // Buffer of the frame taken last until it is given back.
+  uint8_t *taken;
+  size_t   taken_slot;
+  size_t   taken_capacity;
+
+  mTox_VIDEO_QUEUE_STATS stats;
+};
+
+// Memory management
+static VALUE mTox_cVideoQueue_alloc(VALUE klass);
+static void  mTox_cVideoQueue_free(mTox_cVideoQueue_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cVideoQueue_push(VALUE self, VALUE video_frame);
+static VALUE mTox_cVideoQueue_clear(VALUE self);
+static VALUE mTox_cVideoQueue_stats(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cVideoQueue_initialize_with(VALUE self, VALUE frame_rate, VALUE depth);
+static VALUE mTox_cVideoQueue_take_with(VALUE self, VALUE time);
+static VALUE mTox_cVideoQueue_taken_planes(VALUE self);
+static VALUE mTox_cVideoQueue_done_with(VALUE self, VALUE failed);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cVideoQueue_INIT()
+{
+  // Private, the wrapper for specs is spec/support/video_queue.rb.
+  mTox_cVideoQueue = rb_define_class_under(mTox, "VideoQueue", rb_cObject);
+  rb_funcall(mTox, rb_intern("private_constant"), 1, ID2SYM(rb_intern("VideoQueue")));
+
+  // Memory management
+  rb_define_alloc_func(mTox_cVideoQueue, mTox_cVideoQueue_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cVideoQueue, "push",  mTox_cVideoQueue_push,  1);
+  rb_define_method(mTox_cVideoQueue, "clear", mTox_cVideoQueue_clear, 0);
+  rb_define_method(mTox_cVideoQueue, "stats", mTox_cVideoQueue_stats, 0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cVideoQueue, "initialize_with", mTox_cVideoQueue_initialize_with, 2);
+  rb_define_private_method(mTox_cVideoQueue, "take_with",       mTox_cVideoQueue_take_with,       1);
+  rb_define_private_method(mTox_cVideoQueue, "taken_planes",    mTox_cVideoQueue_taken_planes,    0);
+  rb_define_private_method(mTox_cVideoQueue, "done_with",       mTox_cVideoQueue_done_with,       1);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cVideoQueue_alloc(const VALUE klass)
+{
+  mTox_cVideoQueue_CDATA *alloc_cdata = ALLOC(mTox_cVideoQueue_CDATA);
+
+  alloc_cdata->video_queue = NULL;
+  alloc_cdata->planes      = NULL;
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cVideoQueue_free, alloc_cdata);
+}
+
+void mTox_cVideoQueue_free(mTox_cVideoQueue_CDATA *const free_cdata)
+{
+  free(free_cdata->planes);
+
+  if (free_cdata->video_queue) {
+    mTox_VIDEO_QUEUE_FREE(free_cdata->video_queue);
+  }
+
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::VideoQueue#push
+VALUE mTox_cVideoQueue_push(const VALUE self, const VALUE video_frame)
+{
+  if (!mTox_cVideoFrame_IS(video_frame)) {
+    RAISE_TYPECHECK("Tox::VideoQueue#push", "video_frame", "Tox::VideoFrame");
+  }
+
+  VIDEO_FRAME_CDATA(video_frame, video_frame_cdata);
+
+  if (!mTox_cVideoFrame_VALID(video_frame_cdata)) {
+    rb_raise(rb_eRuntimeError, "video frame is invalid");
+  }
+
+  CDATA(self, mTox_cVideoQueue_CDATA, self_cdata);
+
+  mTox_VIDEO_QUEUE_PUSH(
+    self_cdata->video_queue,
+    video_frame_cdata->width,
+    video_frame_cdata->height,
+    (const uint8_t*)RSTRING_PTR(video_frame_cdata->y_plane),
+    (const uint8_t*)RSTRING_PTR(video_frame_cdata->u_plane),
+    (const uint8_t*)RSTRING_PTR(video_frame_cdata->v_plane)
+  );
+
+  return self;
+}
+
+// Tox::VideoQueue#clear
+VALUE mTox_cVideoQueue_clear(const VALUE self)
+{
+  CDATA(self, mTox_cVideoQueue_CDATA, self_cdata);
+
+  mTox_VIDEO_QUEUE_CLEAR(self_cdata->video_queue);
+
+  return self;
+}
+
+// Tox::VideoQueue#stats
+VALUE mTox_cVideoQueue_stats(const VALUE self)
+{
+  CDATA(self, mTox_cVideoQueue_CDATA, self_cdata);
+
+  return mTox_VIDEO_QUEUE_STATS_HASH(self_cdata->video_queue);
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::VideoQueue#initialize_with
+VALUE mTox_cVideoQueue_initialize_with(
+  const VALUE self,
+  const VALUE frame_rate,
+  const VALUE depth
+)
+{
+  const uint16_t frame_rate_data = NUM2USHORT(frame_rate);
+  const size_t   depth_data      = NUM2SIZET(depth);
+
+  CDATA(self, mTox_cVideoQueue_CDATA, self_cdata);
+
+  free(self_cdata->planes);
+  self_cdata->planes = NULL;
+
+  if (self_cdata->video_queue) {
+    mTox_VIDEO_QUEUE_FREE(self_cdata->video_queue);
+    self_cdata->video_queue = NULL;
+  }
+
+  self_cdata->video_queue = mTox_VIDEO_QUEUE_NEW(0, frame_rate_data, depth_data);
+
+  return self;
+}
+
+// Tox::VideoQueue#take_with
+VALUE mTox_cVideoQueue_take_with(const VALUE self, const VALUE time)
+{
+  const uint64_t now = llround(NUM2DBL(time) * 1000000);
+
+  CDATA(self, mTox_cVideoQueue_CDATA, self_cdata);
+
+  uint8_t *const planes = mTox_VIDEO_QUEUE_NEXT(
+    self_cdata->video_queue,
+    now,
+    &self_cdata->width,
+    &self_cdata->height,
+    &self_cdata->y,
+    &self_cdata->u,
+    &self_cdata->v
+  );
+
+  if (!planes) {
+    return Qfalse;
+  }
+
+  self_cdata->planes = planes;
+
+  return Qtrue;
+}
+
+// Tox::VideoQueue#taken_planes
+VALUE mTox_cVideoQueue_taken_planes(const VALUE self)
+{
+  CDATA(self, mTox_cVideoQueue_CDATA, self_cdata);
+
+  if (!self_cdata->planes) {
+    return Qnil;
+  }
+
+  const size_t y_size  = (size_t)self_cdata->width * self_cdata->height;
+  const size_t uv_size =
+    (size_t)(self_cdata->width / 2) * (self_cdata->height / 2);
+
+  return rb_ary_new_from_args(
+    5,
+    UINT2NUM(self_cdata->width),
+    UINT2NUM(self_cdata->height),
+    rb_str_new((const char*)self_cdata->y, y_size),
+    rb_str_new((const char*)self_cdata->u, uv_size),
+    rb_str_new((const char*)self_cdata->v, uv_size)
+  );
+}
+
+// Tox::VideoQueue#done_with
+VALUE mTox_cVideoQueue_done_with(const VALUE self, const VALUE failed)
+{
+  CDATA(self, mTox_cVideoQueue_CDATA, self_cdata);
+
+  if (!self_cdata->planes) {
+    return Qfalse;
+  }
+
+  mTox_VIDEO_QUEUE_DONE(self_cdata->video_queue, self_cdata->planes);
+  mTox_VIDEO_QUEUE_SENT(self_cdata->video_queue, RTEST(failed));
+
+  self_cdata->planes = NULL;
+
+  return Qtrue;
+}
+
+/*************************************************************
+ * Video queue
+ *************************************************************/
+
+mTox_VIDEO_QUEUE *mTox_VIDEO_QUEUE_NEW(
+  const uint32_t friend_number,
+  const uint16_t frame_rate,
+  const size_t depth
+)
+{
+  // The slots first, so nothing leaks when allocating them raises.
+  mTox_VIDEO_QUEUE_SLOT *const slots = ALLOC_N(mTox_VIDEO_QUEUE_SLOT, depth + 1);
+
+  memset(slots, 0, (depth + 1) * sizeof(mTox_VIDEO_QUEUE_SLOT));
+
+  mTox_VIDEO_QUEUE *const video_queue = ALLOC(mTox_VIDEO_QUEUE);
+
+  memset(video_queue, 0, sizeof(mTox_VIDEO_QUEUE));
+
+  video_queue->friend_number  = friend_number;
+  video_queue->frame_interval = 1000000 / frame_rate;
+  video_queue->depth          = depth;
+  video_queue->slots          = slots;
+
+  video_queue->stats.frame_rate = frame_rate;
+  video_queue->stats.max_depth  = depth;
+
+  return video_queue;
+}
+
+void mTox_VIDEO_QUEUE_FREE(mTox_VIDEO_QUEUE *const video_queue)
+{
+  if (!video_queue) {
+    return;
+  }
+
+  for (size_t i = 0; i <= video_queue->depth; ++i) {
+    free(video_queue->slots[i].planes);
+  }
+
+  free(video_queue->slots);
+  free(video_queue);
+}
+
+uint32_t mTox_VIDEO_QUEUE_FRIEND_NUMBER(
+  const mTox_VIDEO_QUEUE *const video_queue
+)
+{
+  return video_queue->friend_number;
+}
+
+uint64_t mTox_VIDEO_QUEUE_DEADLINE(const mTox_VIDEO_QUEUE *const video_queue)
+{
+  if (video_queue->size == 0) {
+    return UINT64_MAX;
+  }
+
+  return video_queue->deadline;
+}
+
+void mTox_VIDEO_QUEUE_PUSH(
+  mTox_VIDEO_QUEUE *const video_queue,
+  const uint16_t width,
+  const uint16_t height,
+  const uint8_t *const y,
+  const uint8_t *const u,
+  const uint8_t *const v
+)
+{
+  const size_t slots_size = video_queue->depth + 1;
+
+  if (video_queue->size == video_queue->depth) {
+    video_queue->head = (video_queue->head + 1) % slots_size;
+    --video_queue->size;
+    ++video_queue->stats.dropped;
+  }
+
+  mTox_VIDEO_QUEUE_SLOT *const slot =
+    &video_queue->slots[(video_queue->head + video_queue->size) % slots_size];
+
+  const size_t y_size  = (size_t)width * height;
+  const size_t uv_size = (size_t)(width / 2) * (height / 2);
+
+  if (slot->capacity < y_size + 2 * uv_size) {
+    REALLOC_N(slot->planes, uint8_t, y_size + 2 * uv_size);
+    slot->capacity = y_size + 2 * uv_size;
+  }
+
+  memcpy(slot->planes,                      y, y_size);
+  memcpy(&slot->planes[y_size],             u, uv_size);
+  memcpy(&slot->planes[y_size + uv_size],   v, uv_size);
+
+  slot->width  = width;
+  slot->height = height;
+
+  ++video_queue->size;
+  ++video_queue->stats.queued;
+}
+
+// A queue which fell behind starts its schedule again from now instead of
+// sending the missed frames in a burst.
+uint8_t *mTox_VIDEO_QUEUE_NEXT(
+  mTox_VIDEO_QUEUE *const video_queue,
+  const uint64_t now,
+  uint16_t *const width,
+  uint16_t *const height,
+  const uint8_t **const y,
+  const uint8_t **const u,
+  const uint8_t **const v
+)
+{
+  if (
+    video_queue->taken ||
+    video_queue->size == 0 ||
+    now < video_queue->deadline
+  ) {
+    return NULL;
+  }
+
+  const size_t slots_size = video_queue->depth + 1;
+
+  video_queue->stats.dropped += video_queue->size - 1;
+
+  const size_t slot_index =
+    (video_queue->head + video_queue->size - 1) % slots_size;
+
+  mTox_VIDEO_QUEUE_SLOT *const slot = &video_queue->slots[slot_index];
+
+  video_queue->head = (video_queue->head + video_queue->size) % slots_size;
+  video_queue->size = 0;
+
+  video_queue->deadline += video_queue->frame_interval;
+
+  if (video_queue->deadline <= now) {
+    video_queue->deadline = now + video_queue->frame_interval;
+  }
+
+  const size_t y_size  = (size_t)slot->width * slot->height;
+  const size_t uv_size = (size_t)(slot->width / 2) * (slot->height / 2);
+
+  *width  = slot->width;
+  *height = slot->height;
+  *y      = slot->planes;
+  *u      = &slot->planes[y_size];
+  *v      = &slot->planes[y_size + uv_size];
+
+  video_queue->taken          = slot->planes;
+  video_queue->taken_slot     = slot_index;
+  video_queue->taken_capacity = slot->capacity;
+
+  slot->planes   = NULL;
+  slot->capacity = 0;
+
+  return video_queue->taken;
+}
+
+// A push after a clear may have used the slot meanwhile.
+void mTox_VIDEO_QUEUE_DONE(
+  mTox_VIDEO_QUEUE *const video_queue,
+  uint8_t *const planes
+)
+{
+  if (!video_queue || video_queue->taken != planes) {
+    free(planes);
+    return;
+  }
+
+  mTox_VIDEO_QUEUE_SLOT *const slot =
+    &video_queue->slots[video_queue->taken_slot];
+
+  if (slot->planes) {
+    free(planes);
+  }
+  else {
+    slot->planes   = planes;
+    slot->capacity = video_queue->taken_capacity;
+  }
+
+  video_queue->taken = NULL;
+}
+
+void mTox_VIDEO_QUEUE_SENT(
+  mTox_VIDEO_QUEUE *const video_queue,
+  const bool failed
+)
+{
+  if (failed) {
+    ++video_queue->stats.failed;
+  }
+  else {
+    ++video_queue->stats.sent;
+  }
+}
+
+void mTox_VIDEO_QUEUE_CLEAR(mTox_VIDEO_QUEUE *const video_queue)
+{
+  video_queue->head = (video_queue->head + video_queue->size) % (video_queue->depth + 1);
+  video_queue->size = 0;
+}
+
+void mTox_VIDEO_QUEUE_GET_STATS(
+  const mTox_VIDEO_QUEUE *const video_queue,
+  mTox_VIDEO_QUEUE_STATS *const stats
+)
+{
+  *stats = video_queue->stats;
+
+  stats->depth = video_queue->size;
+}
+
+VALUE mTox_VIDEO_QUEUE_STATS_HASH(const mTox_VIDEO_QUEUE *const video_queue)
+{
+  mTox_VIDEO_QUEUE_STATS stats;
+
+  mTox_VIDEO_QUEUE_GET_STATS(video_queue, &stats);
+
+  const VALUE result = rb_hash_new();
+
+  rb_hash_aset(result, ID2SYM(rb_intern("frame_rate")), UINT2NUM(stats.frame_rate));
+  rb_hash_aset(result, ID2SYM(rb_intern("max_depth")),  SIZET2NUM(stats.max_depth));
+  rb_hash_aset(result, ID2SYM(rb_intern("depth")),      SIZET2NUM(stats.depth));
+  rb_hash_aset(result, ID2SYM(rb_intern("queued")),     ULL2NUM(stats.queued));
+  rb_hash_aset(result, ID2SYM(rb_intern("sent")),       ULL2NUM(stats.sent));
+  rb_hash_aset(result, ID2SYM(rb_intern("failed")),     ULL2NUM(stats.failed));
+  rb_hash_aset(result, ID2SYM(rb_intern("dropped")),    ULL2NUM(stats.dropped));
+
+  return result;
+}
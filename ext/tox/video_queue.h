@@ -0,0 +1,74 @@
+// Send queues of video. Queuing a frame only copies it, so producers never
+// wait for the encoder; the audio/video instance sends the newest queued
+// frame when it is due at the target frame rate and drops the older ones
+// as late. A full queue drops its oldest frame, so latency stays bounded
+// by the depth when the encoder can not keep up. The frame being sent is
+// taken out of the queue, so it is encoded without the GVL while frames
+// are pushed.
+
+typedef struct mTox_VIDEO_QUEUE mTox_VIDEO_QUEUE;
+
+typedef struct {
+  uint16_t frame_rate;
+  size_t   max_depth;
+  size_t   depth;
+  uint64_t queued;
+  uint64_t sent;
+  uint64_t failed;
+  uint64_t dropped;
+} mTox_VIDEO_QUEUE_STATS;
+
+mTox_VIDEO_QUEUE *mTox_VIDEO_QUEUE_NEW(
+  uint32_t friend_number,
+  uint16_t frame_rate,
+  size_t depth
+);
+
+void mTox_VIDEO_QUEUE_FREE(mTox_VIDEO_QUEUE *video_queue);
+
+uint32_t mTox_VIDEO_QUEUE_FRIEND_NUMBER(const mTox_VIDEO_QUEUE *video_queue);
+
+// UINT64_MAX while the queue is empty.
+uint64_t mTox_VIDEO_QUEUE_DEADLINE(const mTox_VIDEO_QUEUE *video_queue);
+
+void mTox_VIDEO_QUEUE_PUSH(
+  mTox_VIDEO_QUEUE *video_queue,
+  uint16_t width,
+  uint16_t height,
+  const uint8_t *y,
+  const uint8_t *u,
+  const uint8_t *v
+);
+
+// Returns NULL when no frame is due or the one taken last was not given
+// back yet. Otherwise takes the newest frame, dropping the older ones, sets
+// its planes and returns the buffer which holds them. It is taken from the
+// queue, so pushes do not reuse it and it stays valid when the queue goes
+// away, until it is given back with mTox_VIDEO_QUEUE_DONE.
+uint8_t *mTox_VIDEO_QUEUE_NEXT(
+  mTox_VIDEO_QUEUE *video_queue,
+  uint64_t now,
+  uint16_t *width,
+  uint16_t *height,
+  const uint8_t **y,
+  const uint8_t **u,
+  const uint8_t **v
+);
+
+// Keeps the buffer of the taken frame for reuse, frees it when
+// "video_queue" is NULL or not the queue it was taken from.
+void mTox_VIDEO_QUEUE_DONE(mTox_VIDEO_QUEUE *video_queue, uint8_t *planes);
+
+void mTox_VIDEO_QUEUE_SENT(mTox_VIDEO_QUEUE *video_queue, bool failed);
+
+// Throws the queued frames away without counting them as dropped, for
+// when video is held.
+void mTox_VIDEO_QUEUE_CLEAR(mTox_VIDEO_QUEUE *video_queue);
+
+void mTox_VIDEO_QUEUE_GET_STATS(
+  const mTox_VIDEO_QUEUE *video_queue,
+  mTox_VIDEO_QUEUE_STATS *stats
+);
+
+// Stats for Ruby.
+VALUE mTox_VIDEO_QUEUE_STATS_HASH(const mTox_VIDEO_QUEUE *video_queue);
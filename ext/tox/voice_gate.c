@@ -0,0 +1,97 @@
+#include "tox.h"
+
+#include <math.h>
+
+struct mTox_VOICE_GATE {
+  uint32_t friend_number;
+
+  // Mean square of samples at the threshold, full scale being 1.
+  double threshold;
+
+  uint64_t hangover_usec;
+  uint64_t hangover_left;
+
+  mTox_VOICE_GATE_STATS stats;
+};
+
+/*************************************************************
+ * Voice gate
+ *************************************************************/
+
+mTox_VOICE_GATE *mTox_VOICE_GATE_NEW(
+  const uint32_t friend_number,
+  const double threshold,
+  const uint64_t hangover_usec
+)
+{
+  mTox_VOICE_GATE *const voice_gate = ALLOC(mTox_VOICE_GATE);
+
+  memset(voice_gate, 0, sizeof(mTox_VOICE_GATE));
+
+  voice_gate->friend_number = friend_number;
+  voice_gate->threshold     = pow(10, threshold / 10);
+  voice_gate->hangover_usec = hangover_usec;
+
+  return voice_gate;
+}
+
+void mTox_VOICE_GATE_FREE(mTox_VOICE_GATE *const voice_gate)
+{
+  free(voice_gate);
+}
+
+uint32_t mTox_VOICE_GATE_FRIEND_NUMBER(
+  const mTox_VOICE_GATE *const voice_gate
+)
+{
+  return voice_gate->friend_number;
+}
+
+bool mTox_VOICE_GATE_PASS(
+  mTox_VOICE_GATE *const voice_gate,
+  const int16_t *const pcm,
+  const size_t sample_count,
+  const uint8_t channels,
+  const uint32_t sampling_rate
+)
+{
+  const size_t length = sample_count * channels;
+
+  mTox_AUDIO_LEVEL level;
+
+  mTox_AUDIO_LEVEL_MEASURE(pcm, length, &level);
+
+  const double energy = (double)level.energy /
+    (mTox_AUDIO_LEVEL_FULL_SCALE * mTox_AUDIO_LEVEL_FULL_SCALE);
+
+  const uint64_t duration = (uint64_t)sample_count * 1000000 / sampling_rate;
+
+  if (length > 0 && energy >= voice_gate->threshold * length) {
+    voice_gate->hangover_left = voice_gate->hangover_usec;
+  }
+  else if (voice_gate->hangover_left > duration) {
+    voice_gate->hangover_left -= duration;
+  }
+  else if (voice_gate->hangover_left > 0) {
+    // The last frame of the hangover is still sent.
+    voice_gate->hangover_left = 0;
+  }
+  else {
+    voice_gate->stats.open = false;
+    ++voice_gate->stats.suppressed;
+    return false;
+  }
+
+  voice_gate->stats.open = true;
+  ++voice_gate->stats.passed;
+
+  return true;
+}
+
+void mTox_VOICE_GATE_GET_STATS(
+  const mTox_VOICE_GATE *const voice_gate,
+  mTox_VOICE_GATE_STATS *const stats
+)
+{
+  *stats = voice_gate->stats;
+}
@@ -0,0 +1,38 @@
+// Voice activity gates of sent audio. The mean energy of every frame is
+// compared with a threshold in dBFS; quiet frames are not sent once the
+// hangover after the last loud frame has passed, so the ends of words and
+// short pauses are kept. Frames which are not sent cost neither encoding
+// nor bandwidth, receivers conceal the gaps.
+
+typedef struct mTox_VOICE_GATE mTox_VOICE_GATE;
+
+typedef struct {
+  uint64_t passed;
+  uint64_t suppressed;
+  bool     open;
+} mTox_VOICE_GATE_STATS;
+
+mTox_VOICE_GATE *mTox_VOICE_GATE_NEW(
+  uint32_t friend_number,
+  double threshold,
+  uint64_t hangover_usec
+);
+
+void mTox_VOICE_GATE_FREE(mTox_VOICE_GATE *voice_gate);
+
+uint32_t mTox_VOICE_GATE_FRIEND_NUMBER(const mTox_VOICE_GATE *voice_gate);
+
+// Returns false when the frame should not be sent.
+bool mTox_VOICE_GATE_PASS(
+  mTox_VOICE_GATE *voice_gate,
+  const int16_t *pcm,
+  size_t sample_count,
+  uint8_t channels,
+  uint32_t sampling_rate
+);
+
+void mTox_VOICE_GATE_GET_STATS(
+  const mTox_VOICE_GATE *voice_gate,
+  mTox_VOICE_GATE_STATS *stats
+);
+
@@ -0,0 +1,548 @@
+#include "tox.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// RIFF header, format chunk of 16-bit PCM and header of the data chunk.
+#define mTox_cWavFile_HEADER_SIZE 44
+
+#define mTox_cWavFile_FORMAT_PCM        1
+#define mTox_cWavFile_FORMAT_EXTENSIBLE 0xFFFE
+
+// Memory management
+static VALUE mTox_cWavFile_alloc(VALUE klass);
+static void  mTox_cWavFile_free(mTox_cWavFile_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cWavFile_sampling_rate(VALUE self);
+static VALUE mTox_cWavFile_channels(VALUE self);
+static VALUE mTox_cWavFile_sample_count(VALUE self);
+static VALUE mTox_cWavFile_rewind(VALUE self);
+static VALUE mTox_cWavFile_close(VALUE self);
+static VALUE mTox_cWavFile_closed_QUESTION(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cWavFile_open_with(VALUE self, VALUE path);
+static VALUE mTox_cWavFile_create_with(VALUE self, VALUE path, VALUE sampling_rate, VALUE channels);
+static VALUE mTox_cWavFile_read_frame_with(VALUE self, VALUE audio_frame, VALUE sample_count);
+static VALUE mTox_cWavFile_write_frame_with(VALUE self, VALUE audio_frame);
+
+// Private functions
+
+static void     mTox_cWavFile_OPENED(const mTox_cWavFile_CDATA *self_cdata, bool writing);
+static void     mTox_cWavFile_HEADER(mTox_cWavFile_CDATA *self_cdata);
+static void     mTox_cWavFile_BUILD_HEADER(const mTox_cWavFile_CDATA *self_cdata, uint8_t *header);
+static bool     mTox_cWavFile_FINISH(const mTox_cWavFile_CDATA *self_cdata);
+static VALUE    mTox_cWavFile_BUFFER(VALUE buffer, size_t length);
+static uint16_t mTox_cWavFile_LOAD16(const uint8_t *data);
+static uint32_t mTox_cWavFile_LOAD32(const uint8_t *data);
+static void     mTox_cWavFile_STORE16(uint8_t *data, uint16_t value);
+static void     mTox_cWavFile_STORE32(uint8_t *data, uint32_t value);
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cWavFile_INIT()
+{
+  // Memory management
+  rb_define_alloc_func(mTox_cWavFile, mTox_cWavFile_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cWavFile, "sampling_rate", mTox_cWavFile_sampling_rate,   0);
+  rb_define_method(mTox_cWavFile, "channels",      mTox_cWavFile_channels,        0);
+  rb_define_method(mTox_cWavFile, "sample_count",  mTox_cWavFile_sample_count,    0);
+  rb_define_method(mTox_cWavFile, "rewind",        mTox_cWavFile_rewind,          0);
+  rb_define_method(mTox_cWavFile, "close",         mTox_cWavFile_close,           0);
+  rb_define_method(mTox_cWavFile, "closed?",       mTox_cWavFile_closed_QUESTION, 0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cWavFile, "open_with",        mTox_cWavFile_open_with,        1);
+  rb_define_private_method(mTox_cWavFile, "create_with",      mTox_cWavFile_create_with,      3);
+  rb_define_private_method(mTox_cWavFile, "read_frame_with",  mTox_cWavFile_read_frame_with,  2);
+  rb_define_private_method(mTox_cWavFile, "write_frame_with", mTox_cWavFile_write_frame_with, 1);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cWavFile_alloc(const VALUE klass)
+{
+  mTox_cWavFile_CDATA *alloc_cdata = ALLOC(mTox_cWavFile_CDATA);
+
+  memset(alloc_cdata, 0, sizeof(mTox_cWavFile_CDATA));
+
+  alloc_cdata->fd = -1;
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cWavFile_free, alloc_cdata);
+}
+
+// Files which were not closed still get the sizes in their header.
+void mTox_cWavFile_free(mTox_cWavFile_CDATA *const free_cdata)
+{
+  if (free_cdata->data) {
+    munmap((void*)free_cdata->data, free_cdata->size);
+  }
+
+  if (free_cdata->fd != -1) {
+    if (free_cdata->writing) {
+      mTox_cWavFile_FINISH(free_cdata);
+    }
+
+    close(free_cdata->fd);
+  }
+
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::WavFile#sampling_rate
+VALUE mTox_cWavFile_sampling_rate(const VALUE self)
+{
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+
+  return ULONG2NUM(self_cdata->sampling_rate);
+}
+
+// Tox::WavFile#channels
+VALUE mTox_cWavFile_channels(const VALUE self)
+{
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+
+  return UINT2NUM(self_cdata->channels);
+}
+
+// Tox::WavFile#sample_count
+VALUE mTox_cWavFile_sample_count(const VALUE self)
+{
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+
+  return ULL2NUM(self_cdata->sample_count);
+}
+
+// Tox::WavFile#rewind
+VALUE mTox_cWavFile_rewind(const VALUE self)
+{
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+
+  mTox_cWavFile_OPENED(self_cdata, false);
+
+  self_cdata->position = self_cdata->start;
+
+  return self;
+}
+
+// Tox::WavFile#close
+VALUE mTox_cWavFile_close(const VALUE self)
+{
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+
+  if (self_cdata->fd == -1) {
+    return Qnil;
+  }
+
+  if (self_cdata->data) {
+    munmap((void*)self_cdata->data, self_cdata->size);
+    self_cdata->data = NULL;
+  }
+
+  bool success = true;
+  int error = 0;
+
+  if (self_cdata->writing && !mTox_cWavFile_FINISH(self_cdata)) {
+    success = false;
+    error = errno;
+  }
+
+  if (close(self_cdata->fd) != 0 && success) {
+    success = false;
+    error = errno;
+  }
+
+  self_cdata->fd = -1;
+
+  if (!success && self_cdata->writing) {
+    errno = error;
+    rb_sys_fail_str(rb_iv_get(self, "@path"));
+  }
+
+  return Qnil;
+}
+
+// Tox::WavFile#closed?
+VALUE mTox_cWavFile_closed_QUESTION(const VALUE self)
+{
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+
+  return self_cdata->fd == -1 ? Qtrue : Qfalse;
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::WavFile#open_with
+VALUE mTox_cWavFile_open_with(const VALUE self, const VALUE path)
+{
+  Check_Type(path, T_STRING);
+
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+
+  const int fd = open(StringValueCStr(path), O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1) {
+    rb_sys_fail_str(path);
+  }
+
+  const uint8_t *data;
+  size_t size;
+
+  if (!mTox_FILE_IO_MAP(fd, &data, &size)) {
+    const int error = errno;
+    close(fd);
+    errno = error;
+    rb_sys_fail_str(path);
+  }
+
+  self_cdata->fd      = fd;
+  self_cdata->writing = false;
+  self_cdata->data    = data;
+  self_cdata->size    = size;
+
+  mTox_cWavFile_HEADER(self_cdata);
+
+  self_cdata->position = self_cdata->start;
+
+  return self;
+}
+
+// Tox::WavFile#create_with
+VALUE mTox_cWavFile_create_with(
+  const VALUE self,
+  const VALUE path,
+  const VALUE sampling_rate,
+  const VALUE channels
+)
+{
+  Check_Type(path, T_STRING);
+
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+
+  self_cdata->sampling_rate = NUM2ULONG(sampling_rate);
+  self_cdata->channels      = NUM2UINT(channels);
+  self_cdata->sample_count  = 0;
+
+  uint8_t header[mTox_cWavFile_HEADER_SIZE];
+
+  mTox_cWavFile_BUILD_HEADER(self_cdata, header);
+
+  const int fd = open(
+    StringValueCStr(path),
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0644
+  );
+
+  if (fd == -1) {
+    rb_sys_fail_str(path);
+  }
+
+  if (!mTox_FILE_IO_WRITE(fd, header, sizeof(header))) {
+    const int error = errno;
+    close(fd);
+    errno = error;
+    rb_sys_fail_str(path);
+  }
+
+  self_cdata->fd      = fd;
+  self_cdata->writing = true;
+
+  return self;
+}
+
+// Tox::WavFile#read_frame_with
+VALUE mTox_cWavFile_read_frame_with(
+  const VALUE self,
+  const VALUE audio_frame,
+  const VALUE sample_count
+)
+{
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  mTox_cWavFile_OPENED(self_cdata, false);
+
+  const size_t block_size = self_cdata->channels * sizeof(int16_t);
+  const size_t left = (self_cdata->end - self_cdata->position) / block_size;
+
+  size_t sample_count_data = NUM2SIZET(sample_count);
+
+  if (sample_count_data > left) {
+    sample_count_data = left;
+  }
+
+  if (sample_count_data == 0) {
+    return Qnil;
+  }
+
+  mTox_cAudioFrame_SET_FORMAT(
+    audio_frame_cdata,
+    sample_count_data,
+    self_cdata->channels,
+    self_cdata->sampling_rate
+  );
+
+  const VALUE pcm =
+    mTox_cWavFile_BUFFER(
+      mTox_cAudioFrame_REUSABLE_PCM(audio_frame_cdata),
+      audio_frame_cdata->pcm_size
+    );
+
+  mTox_cAudioFrame_SET_PCM(audio_frame, audio_frame_cdata, pcm);
+
+  // Samples of toxav are in host byte order, which is little-endian on
+  // every supported platform, so they are copied as they are.
+  memcpy(
+    RSTRING_PTR(pcm),
+    &self_cdata->data[self_cdata->position],
+    audio_frame_cdata->pcm_size
+  );
+
+  self_cdata->position += audio_frame_cdata->pcm_size;
+
+  return audio_frame;
+}
+
+// Tox::WavFile#write_frame_with
+VALUE mTox_cWavFile_write_frame_with(const VALUE self, const VALUE audio_frame)
+{
+  CDATA(self, mTox_cWavFile_CDATA, self_cdata);
+  AUDIO_FRAME_CDATA(audio_frame, audio_frame_cdata);
+
+  mTox_cWavFile_OPENED(self_cdata, true);
+
+  // Frames of any length can be written, like the last one of a file.
+  if (
+    audio_frame_cdata->pcm_size == 0 ||
+    (size_t)RSTRING_LEN(audio_frame_cdata->pcm) != audio_frame_cdata->pcm_size
+  ) {
+    rb_raise(rb_eRuntimeError, "audio frame is invalid");
+  }
+
+  if (
+    audio_frame_cdata->channels      != self_cdata->channels ||
+    audio_frame_cdata->sampling_rate != self_cdata->sampling_rate
+  ) {
+    rb_raise(rb_eArgError, "Frame format does not match");
+  }
+
+  if (
+    !mTox_FILE_IO_WRITE(
+      self_cdata->fd,
+      (const uint8_t*)RSTRING_PTR(audio_frame_cdata->pcm),
+      audio_frame_cdata->pcm_size
+    )
+  ) {
+    rb_sys_fail_str(rb_iv_get(self, "@path"));
+  }
+
+  self_cdata->sample_count += audio_frame_cdata->sample_count;
+
+  return self;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+void mTox_cWavFile_OPENED(
+  const mTox_cWavFile_CDATA *const self_cdata,
+  const bool writing
+)
+{
+  if (self_cdata->fd == -1) {
+    rb_raise(rb_eIOError, "closed file");
+  }
+
+  if (self_cdata->writing != writing) {
+    rb_raise(
+      rb_eIOError,
+      writing ? "not opened for writing" : "not opened for reading"
+    );
+  }
+}
+
+// Finds the format and data chunks. Recorders which stream the file leave
+// the size of the data chunk unknown, so it ends at most at the end of the
+// file.
+void mTox_cWavFile_HEADER(mTox_cWavFile_CDATA *const self_cdata)
+{
+  const uint8_t *const data = self_cdata->data;
+  const size_t size = self_cdata->size;
+
+  if (
+    size < 12 ||
+    memcmp(data, "RIFF", 4) != 0 ||
+    memcmp(&data[8], "WAVE", 4) != 0
+  ) {
+    rb_raise(mTox_cWavFile_eFormatError, "Invalid header");
+  }
+
+  bool format_found = false;
+  size_t offset = 12;
+
+  while (size - offset >= 8) {
+    const uint8_t *const chunk = &data[offset];
+    const size_t chunk_size = mTox_cWavFile_LOAD32(&chunk[4]);
+    const size_t body = offset + 8;
+
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+      if (chunk_size < 16 || chunk_size > size - body) {
+        rb_raise(mTox_cWavFile_eFormatError, "Invalid header");
+      }
+
+      const uint8_t *const format = &data[body];
+
+      uint16_t format_tag = mTox_cWavFile_LOAD16(format);
+
+      const uint16_t channels        = mTox_cWavFile_LOAD16(&format[2]);
+      const uint32_t sampling_rate   = mTox_cWavFile_LOAD32(&format[4]);
+      const uint16_t block_align     = mTox_cWavFile_LOAD16(&format[12]);
+      const uint16_t bits_per_sample = mTox_cWavFile_LOAD16(&format[14]);
+
+      // The sub format starts with the format tag it extends.
+      if (format_tag == mTox_cWavFile_FORMAT_EXTENSIBLE && chunk_size >= 40) {
+        format_tag = mTox_cWavFile_LOAD16(&format[24]);
+      }
+
+      if (
+        format_tag != mTox_cWavFile_FORMAT_PCM ||
+        bits_per_sample != 16 ||
+        (channels != 1 && channels != 2) ||
+        block_align != channels * sizeof(int16_t)
+      ) {
+        rb_raise(mTox_cWavFile_eFormatError, "Unsupported format");
+      }
+
+      self_cdata->sampling_rate = sampling_rate;
+      self_cdata->channels      = channels;
+
+      format_found = true;
+    }
+    else if (memcmp(chunk, "data", 4) == 0) {
+      if (!format_found) {
+        rb_raise(mTox_cWavFile_eFormatError, "Invalid header");
+      }
+
+      const size_t block_size = self_cdata->channels * sizeof(int16_t);
+      const size_t length = chunk_size < size - body ? chunk_size : size - body;
+
+      self_cdata->start        = body;
+      self_cdata->end          = body + length - length % block_size;
+      self_cdata->sample_count = length / block_size;
+
+      return;
+    }
+
+    if (chunk_size > size - body) {
+      break;
+    }
+
+    offset = body + chunk_size + (chunk_size & 1);
+
+    if (offset > size) {
+      break;
+    }
+  }
+
+  rb_raise(mTox_cWavFile_eFormatError, "Invalid header");
+}
+
+void mTox_cWavFile_BUILD_HEADER(
+  const mTox_cWavFile_CDATA *const self_cdata,
+  uint8_t *const header
+)
+{
+  const uint16_t block_align = self_cdata->channels * sizeof(int16_t);
+
+  // Sizes which do not fit are left at the maximum, readers take the rest
+  // of the file then.
+  const uint64_t data_size = self_cdata->sample_count * block_align;
+  const uint32_t data_size_data =
+    data_size > UINT32_MAX - 36 ? UINT32_MAX - 36 : data_size;
+
+  memcpy(header, "RIFF", 4);
+  mTox_cWavFile_STORE32(&header[4], 36 + data_size_data);
+  memcpy(&header[8], "WAVE", 4);
+
+  memcpy(&header[12], "fmt ", 4);
+  mTox_cWavFile_STORE32(&header[16], 16);
+  mTox_cWavFile_STORE16(&header[20], mTox_cWavFile_FORMAT_PCM);
+  mTox_cWavFile_STORE16(&header[22], self_cdata->channels);
+  mTox_cWavFile_STORE32(&header[24], self_cdata->sampling_rate);
+  mTox_cWavFile_STORE32(&header[28], self_cdata->sampling_rate * block_align);
+  mTox_cWavFile_STORE16(&header[32], block_align);
+  mTox_cWavFile_STORE16(&header[34], 16);
+
+  memcpy(&header[36], "data", 4);
+  mTox_cWavFile_STORE32(&header[40], data_size_data);
+}
+
+bool mTox_cWavFile_FINISH(const mTox_cWavFile_CDATA *const self_cdata)
+{
+  uint8_t header[mTox_cWavFile_HEADER_SIZE];
+
+  mTox_cWavFile_BUILD_HEADER(self_cdata, header);
+
+  return pwrite(self_cdata->fd, header, sizeof(header), 0) ==
+    (ssize_t)sizeof(header);
+}
+
+// Reuses the samples of a frame which has been read before.
+VALUE mTox_cWavFile_BUFFER(const VALUE buffer, const size_t length)
+{
+  if (OBJ_FROZEN(buffer)) {
+    return rb_str_new(NULL, length);
+  }
+
+  rb_str_resize(buffer, length);
+  rb_str_modify(buffer);
+
+  return buffer;
+}
+
+uint16_t mTox_cWavFile_LOAD16(const uint8_t *const data)
+{
+  return (uint16_t)data[0] | (uint16_t)data[1] << 8;
+}
+
+uint32_t mTox_cWavFile_LOAD32(const uint8_t *const data)
+{
+  return (uint32_t)data[0]       |
+         (uint32_t)data[1] << 8  |
+         (uint32_t)data[2] << 16 |
+         (uint32_t)data[3] << 24;
+}
+
+void mTox_cWavFile_STORE16(uint8_t *const data, const uint16_t value)
+{
+  data[0] = value;
+  data[1] = value >> 8;
+}
+
+void mTox_cWavFile_STORE32(uint8_t *const data, const uint32_t value)
+{
+  data[0] = value;
+  data[1] = value >> 8;
+  data[2] = value >> 16;
+  data[3] = value >> 24;
+}
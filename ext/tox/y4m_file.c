@@ -0,0 +1,558 @@
+#include "tox.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Memory management
+static VALUE mTox_cY4MFile_alloc(VALUE klass);
+static void  mTox_cY4MFile_free(mTox_cY4MFile_CDATA *free_cdata);
+
+// Public methods
+
+static VALUE mTox_cY4MFile_width(VALUE self);
+static VALUE mTox_cY4MFile_height(VALUE self);
+static VALUE mTox_cY4MFile_frame_rate(VALUE self);
+static VALUE mTox_cY4MFile_rewind(VALUE self);
+static VALUE mTox_cY4MFile_close(VALUE self);
+static VALUE mTox_cY4MFile_closed_QUESTION(VALUE self);
+
+// Private methods
+
+static VALUE mTox_cY4MFile_open_with(VALUE self, VALUE path);
+static VALUE mTox_cY4MFile_create_with(VALUE self, VALUE path, VALUE width, VALUE height, VALUE frame_rate_numerator, VALUE frame_rate_denominator);
+static VALUE mTox_cY4MFile_read_frame_with(VALUE self, VALUE video_frame);
+static VALUE mTox_cY4MFile_write_frame_with(VALUE self, VALUE video_frame);
+
+// Private functions
+
+static void  mTox_cY4MFile_OPENED(const mTox_cY4MFile_CDATA *self_cdata, bool writing);
+static void  mTox_cY4MFile_HEADER(mTox_cY4MFile_CDATA *self_cdata);
+static bool  mTox_cY4MFile_NUMBER(const uint8_t **data, const uint8_t *end, uint32_t *value);
+static VALUE mTox_cY4MFile_BUFFER(VALUE buffer, size_t length);
+
+// Colorspaces of 8-bit 4:2:0 frames, which only differ in chroma siting.
+static const char *const mTox_cY4MFile_COLORSPACES[] = {
+  "420", "420jpeg", "420paldv", "420mpeg2",
+};
+
+/*************************************************************
+ * Initialization
+ *************************************************************/
+
+void mTox_cY4MFile_INIT()
+{
+  // Memory management
+  rb_define_alloc_func(mTox_cY4MFile, mTox_cY4MFile_alloc);
+
+  // Public methods
+
+  rb_define_method(mTox_cY4MFile, "width",      mTox_cY4MFile_width,           0);
+  rb_define_method(mTox_cY4MFile, "height",     mTox_cY4MFile_height,          0);
+  rb_define_method(mTox_cY4MFile, "frame_rate", mTox_cY4MFile_frame_rate,      0);
+  rb_define_method(mTox_cY4MFile, "rewind",     mTox_cY4MFile_rewind,          0);
+  rb_define_method(mTox_cY4MFile, "close",      mTox_cY4MFile_close,           0);
+  rb_define_method(mTox_cY4MFile, "closed?",    mTox_cY4MFile_closed_QUESTION, 0);
+
+  // Private methods
+
+  rb_define_private_method(mTox_cY4MFile, "open_with",        mTox_cY4MFile_open_with,        1);
+  rb_define_private_method(mTox_cY4MFile, "create_with",      mTox_cY4MFile_create_with,      5);
+  rb_define_private_method(mTox_cY4MFile, "read_frame_with",  mTox_cY4MFile_read_frame_with,  1);
+  rb_define_private_method(mTox_cY4MFile, "write_frame_with", mTox_cY4MFile_write_frame_with, 1);
+}
+
+/*************************************************************
+ * Memory management
+ *************************************************************/
+
+VALUE mTox_cY4MFile_alloc(const VALUE klass)
+{
+  mTox_cY4MFile_CDATA *alloc_cdata = ALLOC(mTox_cY4MFile_CDATA);
+
+  memset(alloc_cdata, 0, sizeof(mTox_cY4MFile_CDATA));
+
+  alloc_cdata->fd = -1;
+
+  return Data_Wrap_Struct(klass, NULL, mTox_cY4MFile_free, alloc_cdata);
+}
+
+void mTox_cY4MFile_free(mTox_cY4MFile_CDATA *const free_cdata)
+{
+  if (free_cdata->data) {
+    munmap((void*)free_cdata->data, free_cdata->size);
+  }
+
+  if (free_cdata->fd != -1) {
+    close(free_cdata->fd);
+  }
+
+  free(free_cdata);
+}
+
+/*************************************************************
+ * Public methods
+ *************************************************************/
+
+// Tox::Y4MFile#width
+VALUE mTox_cY4MFile_width(const VALUE self)
+{
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+
+  return UINT2NUM(self_cdata->width);
+}
+
+// Tox::Y4MFile#height
+VALUE mTox_cY4MFile_height(const VALUE self)
+{
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+
+  return UINT2NUM(self_cdata->height);
+}
+
+// Tox::Y4MFile#frame_rate
+VALUE mTox_cY4MFile_frame_rate(const VALUE self)
+{
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+
+  return rb_rational_new(
+    UINT2NUM(self_cdata->frame_rate_numerator),
+    UINT2NUM(self_cdata->frame_rate_denominator)
+  );
+}
+
+// Tox::Y4MFile#rewind
+VALUE mTox_cY4MFile_rewind(const VALUE self)
+{
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+
+  mTox_cY4MFile_OPENED(self_cdata, false);
+
+  self_cdata->position = self_cdata->start;
+
+  return self;
+}
+
+// Tox::Y4MFile#close
+VALUE mTox_cY4MFile_close(const VALUE self)
+{
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+
+  if (self_cdata->fd == -1) {
+    return Qnil;
+  }
+
+  if (self_cdata->data) {
+    munmap((void*)self_cdata->data, self_cdata->size);
+    self_cdata->data = NULL;
+  }
+
+  const int result = close(self_cdata->fd);
+
+  self_cdata->fd = -1;
+
+  if (result != 0 && self_cdata->writing) {
+    rb_sys_fail_str(rb_iv_get(self, "@path"));
+  }
+
+  return Qnil;
+}
+
+// Tox::Y4MFile#closed?
+VALUE mTox_cY4MFile_closed_QUESTION(const VALUE self)
+{
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+
+  return self_cdata->fd == -1 ? Qtrue : Qfalse;
+}
+
+/*************************************************************
+ * Private methods
+ *************************************************************/
+
+// Tox::Y4MFile#open_with
+VALUE mTox_cY4MFile_open_with(const VALUE self, const VALUE path)
+{
+  Check_Type(path, T_STRING);
+
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+
+  const int fd = open(StringValueCStr(path), O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1) {
+    rb_sys_fail_str(path);
+  }
+
+  const uint8_t *data;
+  size_t size;
+
+  if (!mTox_FILE_IO_MAP(fd, &data, &size)) {
+    const int error = errno;
+    close(fd);
+    errno = error;
+    rb_sys_fail_str(path);
+  }
+
+  self_cdata->fd      = fd;
+  self_cdata->writing = false;
+  self_cdata->data    = data;
+  self_cdata->size    = size;
+
+  mTox_cY4MFile_HEADER(self_cdata);
+
+  self_cdata->position = self_cdata->start;
+
+  return self;
+}
+
+// Tox::Y4MFile#create_with
+VALUE mTox_cY4MFile_create_with(
+  const VALUE self,
+  const VALUE path,
+  const VALUE width,
+  const VALUE height,
+  const VALUE frame_rate_numerator,
+  const VALUE frame_rate_denominator
+)
+{
+  Check_Type(path, T_STRING);
+
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+
+  const uint16_t width_data  = NUM2USHORT(width);
+  const uint16_t height_data = NUM2USHORT(height);
+
+  const uint32_t frame_rate_numerator_data   = NUM2UINT(frame_rate_numerator);
+  const uint32_t frame_rate_denominator_data = NUM2UINT(frame_rate_denominator);
+
+  char header[128];
+
+  const int length = snprintf(
+    header,
+    sizeof(header),
+    "YUV4MPEG2 W%u H%u F%u:%u Ip A1:1 C420jpeg\n",
+    width_data,
+    height_data,
+    frame_rate_numerator_data,
+    frame_rate_denominator_data
+  );
+
+  const int fd = open(
+    StringValueCStr(path),
+    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+    0644
+  );
+
+  if (fd == -1) {
+    rb_sys_fail_str(path);
+  }
+
+  if (!mTox_FILE_IO_WRITE(fd, (const uint8_t*)header, length)) {
+    const int error = errno;
+    close(fd);
+    errno = error;
+    rb_sys_fail_str(path);
+  }
+
+  self_cdata->fd      = fd;
+  self_cdata->writing = true;
+  self_cdata->width   = width_data;
+  self_cdata->height  = height_data;
+
+  self_cdata->frame_rate_numerator   = frame_rate_numerator_data;
+  self_cdata->frame_rate_denominator = frame_rate_denominator_data;
+
+  return self;
+}
+
+// Tox::Y4MFile#read_frame_with
+VALUE mTox_cY4MFile_read_frame_with(const VALUE self, const VALUE video_frame)
+{
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+  VIDEO_FRAME_CDATA(video_frame, video_frame_cdata);
+
+  mTox_cY4MFile_OPENED(self_cdata, false);
+
+  if (self_cdata->position >= self_cdata->size) {
+    return Qnil;
+  }
+
+  const uint8_t *const header = &self_cdata->data[self_cdata->position];
+  const size_t left = self_cdata->size - self_cdata->position;
+
+  const uint8_t *const header_end = memchr(header, '\n', left);
+
+  if (
+    !header_end ||
+    header_end - header < 5 ||
+    memcmp(header, "FRAME", 5) != 0 ||
+    (header_end - header > 5 && header[5] != ' ')
+  ) {
+    rb_raise(mTox_cY4MFile_eFormatError, "Invalid frame header");
+  }
+
+  const size_t offset  = header_end - self_cdata->data + 1;
+  const size_t y_size  = (size_t)self_cdata->width * self_cdata->height;
+  const size_t uv_size = y_size / 4;
+
+  if (self_cdata->size - offset < y_size + 2 * uv_size) {
+    rb_raise(mTox_cY4MFile_eFormatError, "Truncated frame");
+  }
+
+  mTox_cVideoFrame_SET_SIZE(
+    video_frame_cdata,
+    self_cdata->width,
+    self_cdata->height
+  );
+
+  const VALUE old_y_plane =
+    mTox_cVideoFrame_REUSABLE_PLANE(video_frame_cdata, video_frame_cdata->y_plane);
+  const VALUE old_u_plane =
+    mTox_cVideoFrame_REUSABLE_PLANE(video_frame_cdata, video_frame_cdata->u_plane);
+  const VALUE old_v_plane =
+    mTox_cVideoFrame_REUSABLE_PLANE(video_frame_cdata, video_frame_cdata->v_plane);
+
+  const VALUE y_plane = mTox_cY4MFile_BUFFER(old_y_plane, y_size);
+
+  // Planes can be the same string when they were assigned by hand.
+  const VALUE u_plane =
+    old_u_plane == y_plane ?
+      rb_str_new(NULL, uv_size) :
+      mTox_cY4MFile_BUFFER(old_u_plane, uv_size);
+
+  const VALUE v_plane =
+    old_v_plane == y_plane || old_v_plane == u_plane ?
+      rb_str_new(NULL, uv_size) :
+      mTox_cY4MFile_BUFFER(old_v_plane, uv_size);
+
+  mTox_cVideoFrame_SET_PLANES(
+    video_frame,
+    video_frame_cdata,
+    y_plane,
+    u_plane,
+    v_plane
+  );
+
+  const uint8_t *const planes = &self_cdata->data[offset];
+
+  memcpy(RSTRING_PTR(y_plane), planes,                     y_size);
+  memcpy(RSTRING_PTR(u_plane), &planes[y_size],            uv_size);
+  memcpy(RSTRING_PTR(v_plane), &planes[y_size + uv_size], uv_size);
+
+  self_cdata->position = offset + y_size + 2 * uv_size;
+
+  return video_frame;
+}
+
+// Tox::Y4MFile#write_frame_with
+VALUE mTox_cY4MFile_write_frame_with(const VALUE self, const VALUE video_frame)
+{
+  CDATA(self, mTox_cY4MFile_CDATA, self_cdata);
+  VIDEO_FRAME_CDATA(video_frame, video_frame_cdata);
+
+  mTox_cY4MFile_OPENED(self_cdata, true);
+
+  if (!mTox_cVideoFrame_VALID(video_frame_cdata)) {
+    rb_raise(rb_eRuntimeError, "video frame is invalid");
+  }
+
+  if (
+    video_frame_cdata->width  != self_cdata->width ||
+    video_frame_cdata->height != self_cdata->height
+  ) {
+    rb_raise(rb_eArgError, "Frame size does not match");
+  }
+
+  static const uint8_t header[] = "FRAME\n";
+
+  if (
+    !mTox_FILE_IO_WRITE(self_cdata->fd, header, sizeof(header) - 1) ||
+    !mTox_FILE_IO_WRITE(
+      self_cdata->fd,
+      (const uint8_t*)RSTRING_PTR(video_frame_cdata->y_plane),
+      video_frame_cdata->y_size
+    ) ||
+    !mTox_FILE_IO_WRITE(
+      self_cdata->fd,
+      (const uint8_t*)RSTRING_PTR(video_frame_cdata->u_plane),
+      video_frame_cdata->uv_size
+    ) ||
+    !mTox_FILE_IO_WRITE(
+      self_cdata->fd,
+      (const uint8_t*)RSTRING_PTR(video_frame_cdata->v_plane),
+      video_frame_cdata->uv_size
+    )
+  ) {
+    rb_sys_fail_str(rb_iv_get(self, "@path"));
+  }
+
+  return self;
+}
+
+/*************************************************************
+ * Private functions
+ *************************************************************/
+
+void mTox_cY4MFile_OPENED(
+  const mTox_cY4MFile_CDATA *const self_cdata,
+  const bool writing
+)
+{
+  if (self_cdata->fd == -1) {
+    rb_raise(rb_eIOError, "closed file");
+  }
+
+  if (self_cdata->writing != writing) {
+    rb_raise(
+      rb_eIOError,
+      writing ? "not opened for writing" : "not opened for reading"
+    );
+  }
+}
+
+// YUV4MPEG2 W<width> H<height> F<numerator>:<denominator> [I, A, C, X...]
+void mTox_cY4MFile_HEADER(mTox_cY4MFile_CDATA *const self_cdata)
+{
+  const uint8_t *const data = self_cdata->data;
+  const size_t size = self_cdata->size;
+
+  static const char magic[] = "YUV4MPEG2 ";
+
+  if (size < sizeof(magic) - 1 || memcmp(data, magic, sizeof(magic) - 1) != 0) {
+    rb_raise(mTox_cY4MFile_eFormatError, "Invalid header");
+  }
+
+  const uint8_t *const end = memchr(data, '\n', size);
+
+  if (!end) {
+    rb_raise(mTox_cY4MFile_eFormatError, "Invalid header");
+  }
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // Players assume 30 fps when the frame rate is missing.
+  uint32_t frame_rate_numerator = 30;
+  uint32_t frame_rate_denominator = 1;
+
+  const uint8_t *token = &data[sizeof(magic) - 1];
+
+  while (token < end) {
+    if (*token == ' ') {
+      ++token;
+      continue;
+    }
+
+    const uint8_t *token_end = token;
+
+    while (token_end < end && *token_end != ' ') {
+      ++token_end;
+    }
+
+    const uint8_t *value = token + 1;
+    bool valid = true;
+
+    switch (*token) {
+      case 'W':
+        valid = mTox_cY4MFile_NUMBER(&value, token_end, &width) &&
+                value == token_end;
+        break;
+      case 'H':
+        valid = mTox_cY4MFile_NUMBER(&value, token_end, &height) &&
+                value == token_end;
+        break;
+      case 'F':
+        valid = mTox_cY4MFile_NUMBER(&value, token_end, &frame_rate_numerator) &&
+                value < token_end && *value++ == ':' &&
+                mTox_cY4MFile_NUMBER(&value, token_end, &frame_rate_denominator) &&
+                value == token_end &&
+                frame_rate_numerator != 0 && frame_rate_denominator != 0;
+        break;
+      case 'C':
+        valid = false;
+
+        for (size_t i = 0; i < sizeof(mTox_cY4MFile_COLORSPACES) / sizeof(char*); ++i) {
+          const size_t length = strlen(mTox_cY4MFile_COLORSPACES[i]);
+
+          if (
+            (size_t)(token_end - value) == length &&
+            memcmp(value, mTox_cY4MFile_COLORSPACES[i], length) == 0
+          ) {
+            valid = true;
+            break;
+          }
+        }
+
+        if (!valid) {
+          rb_raise(mTox_cY4MFile_eFormatError, "Unsupported colorspace");
+        }
+        break;
+      default:
+        // Interlacing, aspect ratio and extensions do not change the layout.
+        break;
+    }
+
+    if (!valid) {
+      rb_raise(mTox_cY4MFile_eFormatError, "Invalid header");
+    }
+
+    token = token_end;
+  }
+
+  if (
+    width  == 0 || width  % 2 != 0 || width  > UINT16_MAX ||
+    height == 0 || height % 2 != 0 || height > UINT16_MAX
+  ) {
+    rb_raise(mTox_cY4MFile_eFormatError, "Unsupported frame size");
+  }
+
+  self_cdata->width  = width;
+  self_cdata->height = height;
+  self_cdata->start  = end - data + 1;
+
+  self_cdata->frame_rate_numerator   = frame_rate_numerator;
+  self_cdata->frame_rate_denominator = frame_rate_denominator;
+}
+
+bool mTox_cY4MFile_NUMBER(
+  const uint8_t **const data,
+  const uint8_t *const end,
+  uint32_t *const value
+)
+{
+  const uint8_t *current = *data;
+  uint64_t result = 0;
+
+  while (current < end && *current >= '0' && *current <= '9') {
+    result = result * 10 + (*current - '0');
+
+    if (result > UINT32_MAX) {
+      return false;
+    }
+
+    ++current;
+  }
+
+  if (current == *data) {
+    return false;
+  }
+
+  *data  = current;
+  *value = result;
+
+  return true;
+}
+
+// Reuses the plane of a frame which has been read before.
+VALUE mTox_cY4MFile_BUFFER(const VALUE buffer, const size_t length)
+{
+  if (OBJ_FROZEN(buffer)) {
+    return rb_str_new(NULL, length);
+  }
+
+  rb_str_resize(buffer, length);
+  rb_str_modify(buffer);
+
+  return buffer;
+}
@@ -4,6 +4,10 @@ require 'uri'
 require 'net/http'
 require 'json'
 require 'resolv'
+require 'fileutils'
+require 'find'
+require 'securerandom'
+require 'tmpdir'
 
 require 'tox/version'
 require 'tox/core_ext'
@@ -22,6 +26,37 @@ require 'tox/in_friend_file'
 require 'tox/friend_call_request'
 require 'tox/friend_call'
 
+# Pools
+require 'tox/frame_pool'
+require 'tox/pooled_frame'
+
+# Media processing
+require 'tox/audio_mixer'
+require 'tox/video_mosaic'
+require 'tox/resampler'
+
+# Media files
+require 'tox/y4m_file'
+require 'tox/wav_file'
+
+# Caches
+require 'tox/avatar_cache'
+
+# Directory transfers
+require 'tox/file_trees'
+require 'tox/out_friend_tree'
+require 'tox/in_friend_tree'
+
+# Delta transfers
+require 'tox/delta'
+require 'tox/file_syncs'
+require 'tox/out_friend_sync'
+require 'tox/in_friend_sync'
+
+# Compressed transfers
+require 'tox/compression'
+require 'tox/file_compression'
+
 # Configuration classes
 require 'tox/options'
 require 'tox/status'
@@ -39,6 +74,8 @@ require 'tox/proxy_type'
 require 'tox/connection_status'
 require 'tox/file_kind'
 require 'tox/file_control'
+require 'tox/file_io_backend'
+require 'tox/call_control'
 
 # Binary string primitives
 require 'tox/binary'
@@ -50,6 +87,7 @@ require 'tox/address'
 # Media data primitives
 require 'tox/audio_frame'
 require 'tox/video_frame'
+require 'tox/video_plane'
 
 ##
 # Ruby interface for libtoxcore. It can be used to create Tox chat client or
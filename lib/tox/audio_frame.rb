@@ -2,41 +2,25 @@
 
 module Tox
   ##
-  # Audio frame.
+  # Audio frame. Its validity is computed natively on assignment, so
+  # sending it costs a few integer comparisons. Its levels ({#rms} and
+  # {#peak}, relative to full scale) are measured natively on each call.
+  # Since Ruby 3.0 its samples are exposed in place through the memory view
+  # protocol as a matrix of 16-bit integers, one row per sample and one
+  # column per channel.
   #
   class AudioFrame
     using CoreExt
 
+    include PooledFrame
+
     VALID_SAMPLING_RATES = [8_000, 12_000, 16_000, 24_000, 48_000].freeze
     VALID_AUDIO_LENGTHS  = [2.5, 5, 10, 20, 40, 60].freeze
 
-    attr_reader :pcm
-
-    def initialize
-      @pcm = ''
-    end
-
-    def pcm=(value)
-      String.ancestor_of! value
-      @pcm = value
-    end
-
-    def valid?
-      VALID_SAMPLING_RATES.include?(sampling_rate) &&
-        sample_count_valid? &&
-        pcm_size_valid?
-    end
-
-  private
-
-    def sample_count_valid?
-      VALID_AUDIO_LENGTHS.any? do |audio_length|
-        sample_count == sampling_rate * audio_length / 1000
-      end
-    end
-
-    def pcm_size_valid?
-      pcm.bytesize == sample_count * channels * 2
+    # A frame on its own. Consecutive frames of a stream should go through
+    # one {Resampler} instead.
+    def convert(rate: sampling_rate, channels: self.channels)
+      Resampler.new(sampling_rate, self.channels, rate, channels).process self
     end
   end
 end
@@ -0,0 +1,37 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Audio mixer for conferences. Frames of every source (usually a friend
+  # number) are buffered natively, so sources with different frame lengths
+  # line up by samples. {#mix} gives every source the mix of all the other
+  # sources.
+  #
+  # All frames must have the sampling rate and channels of the mixer.
+  #
+  class AudioMixer
+    using CoreExt
+
+    VALID_CHANNELS = [1, 2].freeze
+
+    def initialize(sampling_rate = 48_000, channels = 2)
+      Integer.ancestor_of! sampling_rate
+      Integer.ancestor_of! channels
+
+      unless AudioFrame::VALID_SAMPLING_RATES.include? sampling_rate
+        raise ArgumentError, 'Invalid sampling rate'
+      end
+
+      unless VALID_CHANNELS.include? channels
+        raise ArgumentError, 'Invalid channels'
+      end
+
+      initialize_with sampling_rate, channels
+    end
+
+    # Sample count of frames of the given length in milliseconds.
+    def sample_count(audio_length)
+      (sampling_rate * audio_length / 1000).to_i
+    end
+  end
+end
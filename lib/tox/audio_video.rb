@@ -5,15 +5,25 @@ module Tox
   # Tox audio/video instance.
   #
   class AudioVideo
+    attr_reader :frame_pool
+
     def initialize(client)
+      @frame_pool = nil
       @on_call = nil
       @on_call_state_change = nil
       @on_audio_frame = nil
       @on_video_frame = nil
+      @on_audio_bit_rate = nil
+      @on_video_bit_rate = nil
 
       initialize_with client
     end
 
+    # Received frames are recycled through a {FramePool} when it is enabled.
+    def frame_pool=(value)
+      @frame_pool = value ? FramePool.new(self) : nil
+    end
+
     def on_call(&block)
       @on_call = block
     end
@@ -29,5 +39,16 @@ module Tox
     def on_video_frame(&block)
       @on_video_frame = block
     end
+
+    # Toxav suggests bit rates in kbit/sec when packets are lost. They are
+    # applied with {FriendCall#audio_bit_rate=} and
+    # {FriendCall#video_bit_rate=}, or by {FriendCall#enable_bit_rate_control}.
+    def on_audio_bit_rate(&block)
+      @on_audio_bit_rate = block
+    end
+
+    def on_video_bit_rate(&block)
+      @on_video_bit_rate = block
+    end
   end
 end
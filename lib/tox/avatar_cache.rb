@@ -0,0 +1,86 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Content-addressed avatar storage. Avatars are kept in a local directory
+  # under their hash ({Tox.hash}), which toxcore also sends as the file id of
+  # avatar transfers. When assigned to {Tox::Client#avatar_cache} incoming
+  # avatar transfers with already cached hash are cancelled natively, and
+  # newly received avatars are stored automatically. Only the most recently
+  # used avatars are also kept in memory.
+  #
+  class AvatarCache
+    using CoreExt
+
+    HASH_SIZE = 32
+
+    # Avatars kept in memory, at most 64 KiB each.
+    MEMORY_SIZE = 64
+
+    attr_reader :dir
+
+    def initialize(dir)
+      String.ancestor_of! dir
+      @dir = File.expand_path(dir).freeze
+      @memory = {}
+      FileUtils.mkdir_p @dir
+    end
+
+    def include?(hash)
+      @memory.key?(valid_hash!(hash)) || File.file?(path(hash))
+    end
+
+    def [](hash)
+      data = @memory.delete(valid_hash!(hash)) || begin
+        File.binread(path(hash)).freeze if File.file? path hash
+      end
+      remember hash, data unless data.nil?
+      data
+    end
+
+    def store(data)
+      String.ancestor_of! data
+      hash = Tox.hash(data).freeze
+      unless include? hash
+        write path(hash), data
+        remember hash, data.dup_and_freeze
+      end
+      hash
+    end
+
+    def path(hash)
+      File.join dir, valid_hash!(hash).unpack('H*').first.upcase
+    end
+
+  private
+
+    # Hashes keep the order of insertion, so the least recently used avatar
+    # is the first one.
+    def remember(hash, data)
+      @memory.delete hash
+      @memory.shift while @memory.size >= MEMORY_SIZE
+      @memory[hash] = data
+    end
+
+    # The file appears under its final name only once it is complete, so a
+    # crash never leaves a truncated avatar behind.
+    def write(path, data)
+      temp_path = "#{path}.#{Process.pid}.#{Thread.current.object_id}.tmp"
+      File.open temp_path, 'wb' do |file|
+        file.write data
+        file.fsync
+      end
+      File.rename temp_path, path
+    ensure
+      File.unlink temp_path if temp_path && File.exist?(temp_path)
+    end
+
+    def valid_hash!(value)
+      String.ancestor_of! value
+      unless value.bytesize == HASH_SIZE
+        raise ArgumentError, "Expected hash to be #{HASH_SIZE} bytes long"
+      end
+      value
+    end
+  end
+end
@@ -0,0 +1,32 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Represents call control commands.
+  #
+  module CallControl
+    # Resumes a previously paused call. Only valid if the pause was caused by
+    # this client, if not, this control is ignored. Not valid before the call
+    # is accepted.
+    RESUME = :resume
+
+    # Puts a call on hold. Not valid before the call is accepted.
+    PAUSE = :pause
+
+    # Rejects a call if it was not answered, yet. Cancels a call after it was
+    # answered.
+    CANCEL = :cancel
+
+    # Mutes outgoing audio for this call.
+    MUTE_AUDIO = :mute_audio
+
+    # Unmutes outgoing audio for this call.
+    UNMUTE_AUDIO = :unmute_audio
+
+    # Hides outgoing video for this call.
+    HIDE_VIDEO = :hide_video
+
+    # Shows outgoing video for this call.
+    SHOW_VIDEO = :show_video
+  end
+end
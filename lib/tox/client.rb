@@ -5,6 +5,8 @@ module Tox
   # Tox client.
   #
   class Client
+    using CoreExt
+
     def initialize( # rubocop:disable Metrics/MethodLength
       options = Tox::Options.new
     )
@@ -15,14 +17,40 @@ module Tox
       @on_friend_status_message_change = nil
       @on_friend_status_change = nil
       @on_friend_connection_status_change = nil
+      @on_friend_lossless_packet = nil
       @on_file_chunk_request = nil
       @on_file_recv_request = nil
       @on_file_recv_chunk = nil
       @on_file_recv_control = nil
+      @on_friend_avatar = nil
+
+      @avatar_cache = nil
+      @file_trees = FileTrees.new self
+      @file_syncs = FileSyncs.new self
+      @file_compression = FileCompression.new self
 
       initialize_with options
     end
 
+    attr_reader :avatar_cache, :file_trees, :file_syncs, :file_compression
+
+    def avatar_cache=(value)
+      AvatarCache.ancestor_of! value unless value.nil?
+      @avatar_cache = value
+    end
+
+    # Friends only send compressed files ({Friend#send_local_file} with
+    # `compress: true`) once this is set. They are decompressed when received
+    # with {InFriendFile#receive_to}; chunks passed to {#on_file_recv_chunk}
+    # are never decompressed.
+    def accept_compressed_files
+      file_compression.enabled?
+    end
+
+    def accept_compressed_files=(value)
+      file_compression.enabled = value
+    end
+
     def audio_video
       @audio_video ||= Tox::AudioVideo.new self
     end
@@ -75,6 +103,10 @@ module Tox
       @on_friend_connection_status_change = block
     end
 
+    def on_friend_lossless_packet(&block)
+      @on_friend_lossless_packet = block
+    end
+
     def on_file_chunk_request(&block)
       @on_file_chunk_request = block
     end
@@ -91,6 +123,22 @@ module Tox
       @on_file_recv_control = block
     end
 
+    # Called with the friend and the hash of its avatar when
+    # {#avatar_cache} has it, either because the transfer was cancelled as
+    # the hash was already cached or because the received avatar was just
+    # stored.
+    def on_friend_avatar(&block)
+      @on_friend_avatar = block
+    end
+
+    def on_tree_recv_request(&block)
+      file_trees.on_recv_request(&block)
+    end
+
+    def on_sync_recv_request(&block)
+      file_syncs.on_recv_request(&block)
+    end
+
     class Error < RuntimeError; end
     class BadSavedataError < Error; end
   end
@@ -0,0 +1,27 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Compressed file transfers ({Friend#send_local_file} with `compress:
+  # true`). They are streams of unknown size: the sender compresses frames
+  # of the file as chunks are requested, and {InFriendFile#receive_to}
+  # decompresses them as they arrive and checks the original size at the
+  # end. Transfers are marked with {MAGIC} and the original size in their
+  # file ids. Only friends who have announced support receive them
+  # ({FileCompression}).
+  #
+  module Compression
+    using CoreExt
+
+    ORIGINAL_SIZE_FORMAT = 'Q>'
+    ORIGINAL_SIZE_SIZE   = 8
+
+    # Returns nil when the file id does not belong to a compressed transfer.
+    def self.original_size(file_id)
+      String.ancestor_of! file_id
+      return unless file_id.start_with? MAGIC
+      file_id.byteslice(MAGIC.bytesize, ORIGINAL_SIZE_SIZE)
+             .unpack(ORIGINAL_SIZE_FORMAT).first
+    end
+  end
+end
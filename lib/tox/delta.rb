@@ -0,0 +1,32 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Delta encoding of files with the rsync algorithm. A signature has weak
+  # rolling and strong checksums of every block of an old copy, so the delta
+  # of a new copy only carries instructions to copy matching blocks and the
+  # data which has changed. {Delta.patch} takes the block size of the
+  # signature, rejects instructions past the old or new copy and checks the
+  # result against the size and SHA-256 of the new copy.
+  #
+  module Delta
+    using CoreExt
+
+    MIN_BLOCK_SIZE = 1024
+    MAX_BLOCK_SIZE = 65_536
+
+    # Square root of the file size like in rsync, so both signature and
+    # delta of small changes grow slowly with large files.
+    def self.block_size(file_size)
+      Integer.ancestor_of! file_size
+      size = (Math.sqrt(file_size) / MIN_BLOCK_SIZE).ceil * MIN_BLOCK_SIZE
+      [[size, MIN_BLOCK_SIZE].max, MAX_BLOCK_SIZE].min
+    end
+
+    def self.empty_signature(block_size)
+      [block_size].pack('N')
+    end
+
+    class CorruptError < RuntimeError; end
+  end
+end
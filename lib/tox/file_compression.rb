@@ -0,0 +1,117 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Compression support of friends ({Friend#send_local_file} with `compress:
+  # true`). Once the application accepts compressed files
+  # ({Client#accept_compressed_files=}), the client announces support in a
+  # lossless packet whenever a friend comes online. It only compresses files
+  # for friends who have announced it too, so others never receive
+  # compressed streams.
+  #
+  # The client calls it from callbacks and iterations.
+  #
+  class FileCompression
+    using CoreExt
+
+    # Lossless packets with this first byte announce support.
+    # See {FileTrees::PACKET_ID} for the other first bytes in use.
+    PACKET_ID = 162
+
+    # Version of the compressed stream format. Announcements of other
+    # versions withdraw support.
+    VERSION = 1
+    NONE    = 0
+
+    attr_reader :client
+
+    def initialize(client)
+      Client.ancestor_of! client
+      @client = client
+      @enabled = false
+      @online = []
+      @announcements = []
+      @supported = []
+    end
+
+    def enabled?
+      @enabled
+    end
+
+    # Compressed streams are only decompressed by {InFriendFile#receive_to},
+    # so support is only announced when the application enables it. Friends
+    # online now are told of the change at once.
+    def enabled=(value)
+      @enabled = value ? true : false
+      @announcements |= @online
+    end
+
+    def supported?(friend_number)
+      @supported.include? friend_number
+    end
+
+    def iterate
+      @announcements.reject! do |friend_number|
+        begin
+          client.friend(friend_number).send_lossless_packet(
+            self.class.announcement_packet(enabled? ? VERSION : NONE),
+          )
+          true
+        rescue SendQueueError
+          false
+        rescue Friend::NotConnectedError, Friend::NotFoundError
+          true
+        end
+      end
+    end
+
+    def packet(friend_number, data)
+      return false unless data.getbyte(0) == PACKET_ID
+
+      if data.getbyte(1) != VERSION
+        @supported.delete friend_number
+      elsif !supported?(friend_number)
+        @supported << friend_number
+      end
+
+      true
+    end
+
+    # Support is announced again on every connection, as the friend may have
+    # changed clients meanwhile.
+    def friend_connection_status_change(friend_number, connection_status)
+      if connection_status == ConnectionStatus::NONE
+        @online.delete friend_number
+        @supported.delete friend_number
+        @announcements.delete friend_number
+      else
+        @online |= [friend_number]
+        @announcements |= [friend_number] if enabled?
+      end
+
+      false
+    end
+
+    # Compressed transfers are ordinary transfers for the file registries.
+
+    def file_recv_request(_friend_number, _file_number)
+      false
+    end
+
+    def file_received(_friend_number, _file_number)
+      false
+    end
+
+    def file_sent(_friend_number, _file_number)
+      false
+    end
+
+    def file_cancelled(_friend_number, _file_number)
+      false
+    end
+
+    def self.announcement_packet(version = VERSION)
+      [PACKET_ID, version].pack 'CC'
+    end
+  end
+end
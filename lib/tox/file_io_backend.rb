@@ -0,0 +1,16 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Represents the ways local files of native file transfers are read and
+  # written.
+  #
+  module FileIOBackend
+    # Synchronous "pread(2)" and "pwrite(2)" calls. Always available.
+    PREAD = :pread
+
+    # Operations of all transfers are batched through io_uring. Available
+    # when the extension is built with liburing and the kernel allows it.
+    IO_URING = :io_uring
+  end
+end
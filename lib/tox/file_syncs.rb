@@ -0,0 +1,190 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Delta transfers of a client ({Friend#sync_file}). The sender offers a
+  # file in a lossless packet, the receiver answers with the signature of its
+  # old copy ({Delta.signature}) and the sender sends back only the delta.
+  # The receiver acknowledges the applied delta, or rejects the sync when it
+  # can not be applied, so the sender only succeeds with the file in place.
+  # Signatures and deltas are native transfers ({Friend#send_local_file})
+  # which carry the sync id and their role in file ids.
+  #
+  # The client calls it from callbacks and iterations, so these transfers
+  # never reach the user callbacks of files. Signatures, deltas and patches
+  # are made in iterations, after tox_iterate has returned.
+  #
+  class FileSyncs
+    using CoreExt
+
+    # Lossless packets with this first byte carry offers, rejections and
+    # acknowledgements. See {FileTrees::PACKET_ID} for the other first bytes
+    # in use.
+    PACKET_ID = 161
+
+    OFFER  = 0
+    REJECT = 1
+    ACK    = 2
+
+    SIGNATURE = 1
+    DELTA     = 2
+
+    ID_SIZE = 8
+
+    # Packet id, packet kind, sync id; offers add file size and name.
+    HEADER_FORMAT = "CCa#{ID_SIZE}"
+    HEADER_SIZE   = 1 + 1 + ID_SIZE
+
+    OFFER_FORMAT = "#{HEADER_FORMAT}Q>"
+    OFFER_SIZE   = HEADER_SIZE + 8
+
+    attr_reader :client
+
+    def initialize(client)
+      Client.ancestor_of! client
+      @client = client
+      @on_recv_request = nil
+      @out_syncs = {}
+      @in_syncs = {}
+      @out_files = {}
+      @in_files = {}
+    end
+
+    def on_recv_request(&block)
+      @on_recv_request = block
+    end
+
+    def send_file(friend, path, filename, &block)
+      sync = OutFriendSync.new friend, path, filename, &block
+      @out_syncs[[friend.number, sync.id]] = sync
+      sync
+    end
+
+    def iterate
+      [@out_syncs, @in_syncs].each do |syncs|
+        next if syncs.empty?
+
+        syncs.values.each do |sync|
+          sync.pump do |out_friend_file|
+            @out_files[[sync.friend.number, out_friend_file.number]] = sync
+          end
+        end
+
+        syncs.reject! { |_, sync| sync.done? }
+      end
+    end
+
+    def packet(friend_number, data)
+      return false unless data.getbyte(0) == PACKET_ID &&
+                          data.bytesize >= HEADER_SIZE
+
+      _, kind, id = data.unpack HEADER_FORMAT
+
+      case kind
+      when OFFER  then offer_received friend_number, id, data
+      when REJECT then @out_syncs[[friend_number, id]]&.rejected
+      when ACK    then @out_syncs[[friend_number, id]]&.acknowledged
+      end
+
+      true
+    end
+
+    def file_recv_request(friend_number, file_number)
+      @in_files.delete [friend_number, file_number]
+
+      in_friend_file =
+        InFriendFile.new client.friend(friend_number), file_number
+
+      id, role = in_friend_file.file_id.unpack "a#{ID_SIZE}C"
+
+      sync = case role
+             when SIGNATURE then @out_syncs[[friend_number, id]]
+             when DELTA     then @in_syncs[[friend_number, id]]
+             end
+
+      return false if sync.nil?
+
+      @in_files[[friend_number, file_number]] = sync
+      sync.file_requested in_friend_file
+
+      true
+    end
+
+    def file_received(friend_number, file_number)
+      sync = @in_files.delete [friend_number, file_number]
+      return false if sync.nil?
+      sync.file_received true
+      true
+    end
+
+    def file_sent(friend_number, file_number)
+      sync = @out_files.delete [friend_number, file_number]
+      return false if sync.nil?
+      sync.file_sent true
+      true
+    end
+
+    def file_cancelled(friend_number, file_number)
+      if (sync = @in_files.delete([friend_number, file_number]))
+        sync.file_received false
+      elsif (sync = @out_files.delete([friend_number, file_number]))
+        sync.file_sent false
+      else
+        return false
+      end
+      true
+    end
+
+    # Toxcore drops the transfers of a friend who goes offline without
+    # calling back, so the syncs of the friend fail at once.
+    def friend_connection_status_change(friend_number, connection_status)
+      return false unless connection_status == ConnectionStatus::NONE
+
+      [@out_syncs, @in_syncs].each do |syncs|
+        syncs.reject! do |(number, _), sync|
+          number == friend_number && sync.fail!
+        end
+      end
+
+      @out_files.delete_if { |(number, _), _| number == friend_number }
+      @in_files.delete_if  { |(number, _), _| number == friend_number }
+
+      false
+    end
+
+    def self.file_id(id, role)
+      [id, role].pack("a#{ID_SIZE}C").ljust FileTrees::FILE_ID_SIZE, "\0"
+    end
+
+    def self.offer_packet(id, size, filename)
+      [PACKET_ID, OFFER, id, size].pack(OFFER_FORMAT) + filename.b
+    end
+
+    def self.reject_packet(id)
+      [PACKET_ID, REJECT, id].pack HEADER_FORMAT
+    end
+
+    def self.ack_packet(id)
+      [PACKET_ID, ACK, id].pack HEADER_FORMAT
+    end
+
+  private
+
+    def offer_received(friend_number, id, data)
+      return if data.bytesize < OFFER_SIZE ||
+                @in_syncs.key?([friend_number, id])
+
+      size = data.unpack(OFFER_FORMAT).last
+      filename = data.byteslice(OFFER_SIZE..-1)
+
+      sync = InFriendSync.new client.friend(friend_number), id, size, filename
+      @in_syncs[[friend_number, id]] = sync
+
+      if @on_recv_request.nil?
+        sync.reject
+      else
+        @on_recv_request.call sync
+      end
+    end
+  end
+end
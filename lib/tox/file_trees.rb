@@ -0,0 +1,264 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Directory transfers of a client. A manifest with relative paths and
+  # sizes is sent in lossless packets first, then the files follow as native
+  # transfers ({Friend#send_local_file}) which carry the tree id and the
+  # index of the entry in their file ids. Files are sent without waiting for
+  # each other, up to the toxcore limit of concurrent transfers per friend.
+  #
+  # The client calls it from callbacks and iterations, so transfers of trees
+  # never reach the user callbacks of files.
+  #
+  class FileTrees
+    using CoreExt
+
+    # Lossless packets with this first byte carry manifests. Toxcore leaves
+    # first bytes 160..191 of lossless packets to clients; 160 is taken
+    # here, 161 by {FileSyncs::PACKET_ID} and 162 by
+    # {FileCompression::PACKET_ID}, so {Client#on_friend_lossless_packet}
+    # never sees packets starting with them.
+    PACKET_ID = 160
+
+    MAX_PACKET_SIZE = 1373
+
+    ID_SIZE = 8
+
+    FILE_ID_SIZE = 32
+
+    # Packet id, tree id, sequence number, flag of the last packet.
+    HEADER_FORMAT = "Ca#{ID_SIZE}nC"
+    HEADER_SIZE   = 1 + ID_SIZE + 2 + 1
+
+    PAYLOAD_SIZE = MAX_PACKET_SIZE - HEADER_SIZE
+
+    # File size, path size.
+    ENTRY_FORMAT = 'Q>n'
+    ENTRY_SIZE   = 8 + 2
+
+    # Limits of received trees, which keep their manifests in memory:
+    # entries and bytes of a manifest, and trees of a friend waiting for
+    # their manifests, their acceptance or their files. Manifests over the
+    # limits are rejected, trees over the limit are ignored.
+    MAX_ENTRIES = 10_000
+    MAX_MANIFEST_SIZE = 1024 * 1024
+    MAX_IN_TREES = 16
+
+    # Tree ids and entry indices are followed by zeros in file ids.
+    FILE_ID_PADDING = ("\0" * (FILE_ID_SIZE - ID_SIZE - 4)).freeze
+
+    attr_reader :client
+
+    def initialize(client)
+      Client.ancestor_of! client
+      @client = client
+      @on_recv_request = nil
+      @out_trees = []
+      @in_trees = {}
+      @out_files = {}
+      @in_files = {}
+    end
+
+    def on_recv_request(&block)
+      @on_recv_request = block
+    end
+
+    def send_tree(friend, path, &block)
+      tree = OutFriendTree.new friend, path, &block
+      @out_trees << tree
+      tree
+    end
+
+    def iterate
+      return if @out_trees.empty?
+
+      @out_trees.each do |tree|
+        tree.pump do |out_friend_file, index|
+          @out_files[[tree.friend.number, out_friend_file.number]] =
+            [tree, index]
+        end
+      end
+
+      @out_trees.reject!(&:done?)
+    end
+
+    def packet(friend_number, data)
+      return false unless data.getbyte(0) == PACKET_ID &&
+                          data.bytesize >= HEADER_SIZE
+
+      _, id, seq, last = data.unpack HEADER_FORMAT
+
+      tree = @in_trees[[friend_number, id]]
+
+      if tree.nil?
+        return true if in_trees_count(friend_number) >= MAX_IN_TREES
+        tree = @in_trees[[friend_number, id]] =
+          InFriendTree.new client.friend(friend_number), id
+      end
+
+      tree.receive_manifest seq, data.byteslice(HEADER_SIZE..-1)
+
+      manifest_received tree unless last.zero?
+
+      true
+    end
+
+    def file_recv_request(friend_number, file_number)
+      @in_files.delete [friend_number, file_number]
+
+      in_friend_file =
+        InFriendFile.new client.friend(friend_number), file_number
+
+      id, index, padding = in_friend_file.file_id.unpack "a#{ID_SIZE}Na*"
+
+      tree = @in_trees[[friend_number, id]]
+
+      # Files of rejected or ignored trees are cancelled.
+      if tree.nil?
+        return false unless padding == FILE_ID_PADDING
+        cancel in_friend_file
+        return true
+      end
+
+      @in_files[[friend_number, file_number]] = [tree, index]
+      tree.file_requested index, in_friend_file
+      @in_trees.delete [friend_number, id] if tree.done?
+
+      true
+    end
+
+    # Rejected trees are forgotten at once, their files are cancelled as
+    # they arrive.
+    def tree_rejected(tree)
+      @in_trees.delete [tree.friend.number, tree.id]
+    end
+
+    def file_received(friend_number, file_number)
+      finish_in_file friend_number, file_number, true
+    end
+
+    def file_sent(friend_number, file_number)
+      finish_out_file friend_number, file_number, true
+    end
+
+    def file_cancelled(friend_number, file_number)
+      finish_in_file(friend_number, file_number, false) ||
+        finish_out_file(friend_number, file_number, false)
+    end
+
+    # Toxcore drops the transfers of a friend who goes offline without
+    # calling back, so the trees of the friend fail at once.
+    def friend_connection_status_change(friend_number, connection_status)
+      return false unless connection_status == ConnectionStatus::NONE
+
+      @out_trees.reject! do |tree|
+        tree.friend.number == friend_number && tree.fail!
+      end
+
+      @in_trees.reject! do |(number, _), tree|
+        number == friend_number && tree.fail!
+      end
+
+      @out_files.delete_if { |(number, _), _| number == friend_number }
+      @in_files.delete_if  { |(number, _), _| number == friend_number }
+
+      false
+    end
+
+    def self.file_id(id, index)
+      [id, index].pack("a#{ID_SIZE}N").ljust FILE_ID_SIZE, "\0"
+    end
+
+    def self.manifest_packets(id, entries)
+      data = entries.map do |relative_path, size|
+        [size, relative_path.bytesize].pack(ENTRY_FORMAT) + relative_path.b
+      end.join
+
+      chunks = (0...[data.bytesize, 1].max).step(PAYLOAD_SIZE).map do |offset|
+        data.byteslice offset, PAYLOAD_SIZE
+      end
+
+      if entries.size > MAX_ENTRIES || data.bytesize > MAX_MANIFEST_SIZE
+        raise ArgumentError, 'Manifest is too large'
+      end
+
+      chunks.each_with_index.map do |chunk, seq|
+        last = seq == chunks.size - 1 ? 1 : 0
+        [PACKET_ID, id, seq, last].pack(HEADER_FORMAT) + chunk
+      end
+    end
+
+    # Returns nil when the manifest is malformed, over the limits or a path
+    # could escape the destination directory.
+    def self.parse_manifest(data)
+      return if data.bytesize > MAX_MANIFEST_SIZE
+
+      entries = []
+      offset = 0
+
+      while offset < data.bytesize
+        return if data.bytesize - offset < ENTRY_SIZE ||
+                  entries.size == MAX_ENTRIES
+
+        size, length = data.byteslice(offset, ENTRY_SIZE).unpack ENTRY_FORMAT
+        relative_path = data.byteslice offset + ENTRY_SIZE, length
+
+        return unless relative_path.bytesize == length &&
+                      valid_path?(relative_path)
+
+        entries << [relative_path.freeze, size].freeze
+        offset += ENTRY_SIZE + length
+      end
+
+      entries.freeze
+    end
+
+    def self.valid_path?(relative_path)
+      segments = relative_path.split '/', -1
+
+      !segments.empty? && !relative_path.include?("\0") &&
+        segments.none? { |s| s.empty? || s == '.' || s == '..' }
+    end
+
+  private
+
+    def manifest_received(tree)
+      tree.finish_manifest
+
+      if @on_recv_request.nil? || tree.entries.nil?
+        tree.reject
+      else
+        @on_recv_request.call tree
+      end
+
+      @in_trees.delete [tree.friend.number, tree.id] if tree.done?
+    end
+
+    def in_trees_count(friend_number)
+      @in_trees.count { |(number, _), _| number == friend_number }
+    end
+
+    def cancel(in_friend_file)
+      in_friend_file.control FileControl::CANCEL
+    rescue Friend::NotConnectedError
+      nil
+    end
+
+    def finish_in_file(friend_number, file_number, success)
+      tree, index = @in_files.delete [friend_number, file_number]
+      return false if tree.nil?
+      tree.file_finished index, success
+      @in_trees.delete [friend_number, tree.id] if tree.done?
+      true
+    end
+
+    def finish_out_file(friend_number, file_number, success)
+      tree, index = @out_files.delete [friend_number, file_number]
+      return false if tree.nil?
+      tree.file_finished index, success
+      @out_trees.delete tree if tree.done?
+      true
+    end
+  end
+end
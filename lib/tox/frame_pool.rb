@@ -0,0 +1,68 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Pool of received audio and video frames of an audio/video instance.
+  # Frames, their buffers and friend calls are reused between callbacks, so
+  # long calls do not allocate new strings for every frame.
+  #
+  # A frame goes back to the pool when the handler returns, unless the
+  # handler calls {AudioFrame#retain} or {VideoFrame#retain}. A retained
+  # frame goes back when it is released explicitly. Buffers of a frame are
+  # overwritten after it goes back, so the handler must not keep them.
+  #
+  class FramePool
+    using CoreExt
+
+    DEFAULT_MAX_FRAMES = 16
+
+    attr_reader :audio_video, :max_frames
+
+    def initialize(audio_video, max_frames = DEFAULT_MAX_FRAMES)
+      AudioVideo.ancestor_of! audio_video
+      Integer.ancestor_of! max_frames
+      raise 'Expected max frames to be positive' unless max_frames.positive?
+
+      @audio_video = audio_video
+      @max_frames = max_frames
+      @audio_frames = []
+      @video_frames = []
+      @friend_calls = {}
+    end
+
+    def size
+      @audio_frames.size + @video_frames.size
+    end
+
+    def friend_call(friend_number)
+      @friend_calls[friend_number] ||=
+        FriendCall.new audio_video, friend_number
+    end
+
+    def audio_frame
+      acquire(@audio_frames.pop || AudioFrame.new)
+    end
+
+    def video_frame
+      acquire(@video_frames.pop || VideoFrame.new)
+    end
+
+    # Called after the handler of the frame.
+    def recycle(frame)
+      frame.release unless frame.retained?
+    end
+
+    # Called by frames when they are released.
+    def put(frame)
+      frames = frame.is_a?(AudioFrame) ? @audio_frames : @video_frames
+      frames << frame if frames.size < max_frames
+    end
+
+  private
+
+    def acquire(frame)
+      frame.pool = self
+      frame
+    end
+  end
+end
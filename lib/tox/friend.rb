@@ -21,6 +21,30 @@ module Tox
 
     alias exists! exist!
 
+    # Files are only compressed for friends who have announced support
+    # ({FileCompression}), others receive them as they are.
+    def send_local_file(path, filename = File.basename(path),
+                        file_id: nil, compress: false)
+      raise ArgumentError, 'Compressed files have own file ids' if
+        compress && file_id
+      compress &&= client.file_compression.supported? number
+      send_local_file_with File.path(path), String(filename), file_id, compress
+    end
+
+    def send_tree(path, &block)
+      client.file_trees.send_tree self, path, &block
+    end
+
+    def sync_file(path, filename = File.basename(path), &block)
+      client.file_syncs.send_file self, File.path(path), String(filename),
+                                  &block
+    end
+
+    # Bit rates are in kbit/sec, nil disables sending of the kind.
+    def call(audio_bit_rate: nil, video_bit_rate: nil)
+      call_with client.audio_video, audio_bit_rate, video_bit_rate
+    end
+
     def ==(other)
       return false unless self.class == other.class
       client == other.client &&
@@ -7,6 +7,32 @@ module Tox
   class FriendCall
     using CoreExt
 
+    DEFAULT_JITTER_BUFFER_LATENCY = 0.06
+    JITTER_BUFFER_LATENCIES = (0.02..1.0).freeze
+
+    # Limits of bit rate control in kbit/sec.
+    DEFAULT_AUDIO_BIT_RATES = (16..64).freeze
+    DEFAULT_VIDEO_BIT_RATES = (200..5000).freeze
+    BIT_RATE_CONTROL_BIT_RATES = (0...(2**32 - 1)).freeze
+
+    # Opus bit rate of recordings in kbit/sec.
+    DEFAULT_RECORDING_BIT_RATE = 32
+    RECORDING_BIT_RATES = (6..510).freeze
+
+    # Mean energy of frames in dBFS under which they are silent, and
+    # seconds of silence which are still sent after sound.
+    DEFAULT_VOICE_GATE_THRESHOLD = -45
+    VOICE_GATE_THRESHOLDS = (-96..0).freeze
+    DEFAULT_VOICE_GATE_HANGOVER = 0.3
+    VOICE_GATE_HANGOVERS = (0.0..10.0).freeze
+
+    # Target frames per second of video queues, and queued frames after
+    # which the oldest is dropped.
+    DEFAULT_VIDEO_QUEUE_FRAME_RATE = 30
+    VIDEO_QUEUE_FRAME_RATES = (1..60).freeze
+    DEFAULT_VIDEO_QUEUE_DEPTH = 2
+    VIDEO_QUEUE_DEPTHS = (1..16).freeze
+
     attr_reader :audio_video, :friend_number
 
     def initialize(audio_video, friend_number)
@@ -14,6 +40,112 @@ module Tox
       self.friend_number = friend_number
     end
 
+    # Sends an Ogg Opus file to the call natively in 20 ms frames, paced by
+    # {AudioVideo#iterate}. The stream replaces the previous one and stops
+    # at the end of the file unless it loops, when the call ends or when
+    # {#stop_stream} is called.
+    def stream_file(path, loop: true)
+      stream_file_with File.path(path), loop
+    end
+
+    # Received audio frames of the friend are queued until the latency in
+    # seconds is buffered, then {AudioVideo#on_audio_frame} gets a frame
+    # every 20 ms from {AudioVideo#iterate}. Gaps are concealed. The jitter
+    # buffer is dropped when the call ends.
+    def enable_jitter_buffer(latency: DEFAULT_JITTER_BUFFER_LATENCY)
+      Numeric.ancestor_of! latency
+      unless JITTER_BUFFER_LATENCIES.cover? latency
+        raise ArgumentError, 'Invalid latency'
+      end
+      enable_jitter_buffer_with latency
+    end
+
+    # Bit rates start at the maximums and are adjusted by
+    # {AudioVideo#iterate} between the limits in kbit/sec, following send
+    # failures, bit rates suggested by toxav and the time it takes to send
+    # video frames. Kinds with nil limits, disabled in the call or set with
+    # {#audio_bit_rate=} or {#video_bit_rate=} are left alone. The control
+    # is dropped when the call ends.
+    def enable_bit_rate_control(audio: DEFAULT_AUDIO_BIT_RATES,
+                                video: DEFAULT_VIDEO_BIT_RATES)
+      audio_min, audio_max = bit_rate_limits! audio
+      video_min, video_max = bit_rate_limits! video
+      enable_bit_rate_control_with audio_min, audio_max, video_min, video_max
+    end
+
+    # Received audio of the friend is written to an Ogg Opus file, encoded
+    # on a native thread. It is recorded as {AudioVideo#on_audio_frame}
+    # gets it, after the jitter buffer if there is one. The recording
+    # replaces the previous one and is finished in the background when the
+    # call ends; {#stop_recording} waits for it to be written.
+    def record_to(path, bit_rate: DEFAULT_RECORDING_BIT_RATE)
+      Integer.ancestor_of! bit_rate
+      unless RECORDING_BIT_RATES.cover? bit_rate
+        raise ArgumentError, 'Invalid bit rate'
+      end
+      record_to_with File.path(path), bit_rate
+    end
+
+    # Silent audio frames are not sent by {#send_audio_frame}, which returns
+    # false for them, nor by {#stream_file}, once the hangover after the
+    # last frame of sound has passed. The gate is dropped when the call
+    # ends.
+    def enable_voice_gate(threshold: DEFAULT_VOICE_GATE_THRESHOLD,
+                          hangover: DEFAULT_VOICE_GATE_HANGOVER)
+      Numeric.ancestor_of! threshold
+      Numeric.ancestor_of! hangover
+      unless VOICE_GATE_THRESHOLDS.cover? threshold
+        raise ArgumentError, 'Invalid threshold'
+      end
+      unless VOICE_GATE_HANGOVERS.cover? hangover
+        raise ArgumentError, 'Invalid hangover'
+      end
+      enable_voice_gate_with threshold, hangover
+    end
+
+    # Frames received from the friend are forwarded natively to the sink
+    # call by the iteration they arrive in, audio after the jitter buffer
+    # if there is one. The sends of a frame run on threads of the
+    # audio/video instance, without the GVL. Sinks are held back by their
+    # own call controls and voice gates, and skip video first when they are
+    # congested, backing off longer while they stay congested. Both calls
+    # must have been answered or started here. Sinks are removed when their
+    # calls end, the relay when the call of the friend ends or when
+    # {#stop_relay} is called. Returns false when the sink was already
+    # there.
+    def add_relay_sink(sink)
+      relay_sink! sink
+      add_relay_sink_with sink.friend_number
+    end
+
+    def remove_relay_sink(sink)
+      relay_sink! sink
+      remove_relay_sink_with sink.friend_number
+    end
+
+    def relay_sinks
+      relay_sink_numbers.map { |number| FriendCall.new audio_video, number }
+    end
+
+    # Video frames given to {#queue_video_frame} are copied and sent by
+    # {AudioVideo#iterate} at the frame rate, encoded on native threads
+    # without the GVL. Only the newest frame is sent when several are due,
+    # the older ones are dropped as late, as is the oldest when the queue
+    # is full. The queue replaces the previous one and is dropped when the
+    # call ends.
+    def enable_video_queue(frame_rate: DEFAULT_VIDEO_QUEUE_FRAME_RATE,
+                           depth: DEFAULT_VIDEO_QUEUE_DEPTH)
+      Integer.ancestor_of! frame_rate
+      Integer.ancestor_of! depth
+      unless VIDEO_QUEUE_FRAME_RATES.cover? frame_rate
+        raise ArgumentError, 'Invalid frame rate'
+      end
+      unless VIDEO_QUEUE_DEPTHS.cover? depth
+        raise ArgumentError, 'Invalid depth'
+      end
+      enable_video_queue_with frame_rate, depth
+    end
+
     def ==(other)
       self.class == other.class &&
         audio_video == other.audio_video &&
@@ -34,5 +166,30 @@ module Tox
       end
       @friend_number = value
     end
+
+    # Limits of a kind, as [min, max], zeros when it is nil.
+    def bit_rate_limits!(value)
+      return [0, 0] if value.nil?
+      Range.ancestor_of! value
+      min = value.first
+      max = value.last
+      Integer.ancestor_of! min
+      Integer.ancestor_of! max
+      max -= 1 if value.exclude_end?
+      unless min.positive? && min <= max &&
+             BIT_RATE_CONTROL_BIT_RATES.cover?(max)
+        raise ArgumentError, 'Invalid bit rates'
+      end
+      [min, max]
+    end
+
+    def relay_sink!(sink)
+      FriendCall.ancestor_of! sink
+      unless sink.audio_video == audio_video
+        raise ArgumentError, 'Sink is in other audio/video'
+      end
+      return unless sink.friend_number == friend_number
+      raise ArgumentError, 'Sink is the source'
+    end
   end
 end
@@ -18,6 +18,16 @@ module Tox
       friend.client
     end
 
+    def compressed?
+      !original_size.nil?
+    end
+
+    # Compressed transfers are streams, so their size in
+    # {Client#on_file_recv_request} is unknown (2**64 - 1).
+    def original_size
+      Compression.original_size file_id
+    end
+
     def ==(other)
       self.class == other.class &&
         friend == other.friend &&
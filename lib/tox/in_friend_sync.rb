@@ -0,0 +1,170 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Incoming delta transfer ({Client#on_sync_recv_request}). An accepted
+  # file replaces the local copy atomically once the delta has been applied
+  # and checked, keeping its permissions. The sync finishes once the sender
+  # has been told the result.
+  #
+  class InFriendSync
+    using CoreExt
+
+    attr_reader :friend, :id, :size, :filename, :path
+
+    def initialize(friend, id, size, filename)
+      Friend.ancestor_of! friend
+      String.ancestor_of! id
+      Integer.ancestor_of! size
+      String.ancestor_of! filename
+      @friend = friend
+      @id = id.dup_and_freeze
+      @size = size
+      @filename = filename.dup_and_freeze
+      @path = nil
+      @state = :new
+      @success = nil
+      @dir = nil
+      @block_size = nil
+      @on_finish = nil
+    end
+
+    def client
+      friend.client
+    end
+
+    def done?
+      @state == :done
+    end
+
+    def success?
+      @success == true
+    end
+
+    # The file at the path, if any, is the old copy which the delta is made
+    # against. Its signature is made by the next iteration of the client.
+    def accept(path, &block)
+      raise 'Sync has already been accepted or rejected' unless @state == :new
+      @path = File.expand_path(path).freeze
+      @on_finish = block
+      @state = :sign
+      self
+    end
+
+    def reject
+      raise 'Sync has already been accepted or rejected' unless @state == :new
+      @state = :reject
+      self
+    end
+
+    # Makes the signature or applies the received delta, then sends the
+    # signature, the rejection or the acknowledgement of the applied delta.
+    # Yields the started signature file.
+    #
+    # Both read or write whole files, so they run here, after tox_iterate,
+    # rather than in the callbacks it calls.
+    def pump
+      sign if @state == :sign
+      apply if @state == :apply
+
+      case @state
+      when :signature
+        yield friend.send_local_file(
+          signature_path,
+          filename,
+          file_id: FileSyncs.file_id(id, FileSyncs::SIGNATURE),
+        )
+        @state = :delta
+      when :reject
+        friend.send_lossless_packet FileSyncs.reject_packet id
+        finish false
+      when :ack
+        friend.send_lossless_packet FileSyncs.ack_packet id
+        finish true
+      end
+    rescue OutFriendFile::TooManyError, Friend::NotConnectedError,
+           SendQueueError
+      nil
+    rescue SystemCallError
+      finish false
+    end
+
+    def file_requested(in_friend_file)
+      return cancel in_friend_file unless @state == :delta
+      in_friend_file.receive_to delta_path
+      in_friend_file.control FileControl::RESUME
+      @state = :receiving
+    rescue SystemCallError, Friend::NotConnectedError
+      cancel in_friend_file
+      finish false
+    end
+
+    def file_received(success)
+      return finish false unless success && @state == :receiving
+      @state = :apply
+    end
+
+    def file_sent(success)
+      finish false unless success
+    end
+
+    # The local copy has already been replaced once the delta is applied,
+    # even if the acknowledgement can not be sent any more.
+    def fail!
+      finish @state == :ack
+      true
+    end
+
+  private
+
+    def sign
+      @dir = Dir.mktmpdir 'tox-sync'
+      File.binwrite signature_path, signature
+      @state = :signature
+    rescue SystemCallError
+      @state = :reject
+    end
+
+    def signature
+      basis = File.file? path
+      @block_size = Delta.block_size basis ? File.size(path) : 0
+      return Delta.empty_signature @block_size unless basis
+      Delta.signature path, @block_size
+    end
+
+    # The delta must use the block size of the signature.
+    def apply
+      out_path = "#{path}.#{SecureRandom.hex 4}.part"
+      basis_path = File.file?(path) ? path : nil
+      Delta.patch basis_path, delta_path, out_path, @block_size
+      File.rename out_path, path
+      @state = :ack
+    rescue Delta::CorruptError, SystemCallError
+      FileUtils.rm_f out_path
+      @state = :reject
+    end
+
+    def signature_path
+      File.join @dir, 'signature'
+    end
+
+    def delta_path
+      File.join @dir, 'delta'
+    end
+
+    def cancel(in_friend_file)
+      in_friend_file.control FileControl::CANCEL
+    rescue Friend::NotConnectedError
+      nil
+    end
+
+    def finish(success)
+      return if done?
+      @state = :done
+      @success = success
+      FileUtils.remove_entry @dir unless @dir.nil?
+      @dir = nil
+      @on_finish&.call self
+    end
+  end
+end
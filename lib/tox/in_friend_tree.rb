@@ -0,0 +1,141 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Incoming directory transfer ({Client#on_tree_recv_request}). Files which
+  # arrive before the tree is accepted stay paused until then.
+  #
+  class InFriendTree
+    using CoreExt
+
+    attr_reader :friend, :id, :entries, :dir, :received_count, :failed_count
+
+    def initialize(friend, id)
+      Friend.ancestor_of! friend
+      String.ancestor_of! id
+      @friend = friend
+      @id = id.dup_and_freeze
+      @manifest = String.new
+      @next_seq = 0
+      @entries = nil
+      @dir = nil
+      @state = :manifest
+      @pending = {}
+      @received_count = 0
+      @failed_count = 0
+      @on_finish = nil
+    end
+
+    def client
+      friend.client
+    end
+
+    def size
+      entries.size
+    end
+
+    def bytesize
+      entries.inject(0) { |sum, (_, size)| sum + size }
+    end
+
+    def done?
+      !entries.nil? && received_count + failed_count == size
+    end
+
+    def accept(dir, &block)
+      raise 'Tree has already been accepted or rejected' unless @state == :new
+      @dir = File.expand_path(dir).freeze
+      FileUtils.mkdir_p @dir
+      @state = :accepted
+      @on_finish = block
+      @pending.each { |index, in_friend_file| start index, in_friend_file }
+      @pending.clear
+      finish if done?
+      self
+    end
+
+    def reject
+      @state = :rejected
+      @pending.each_value { |in_friend_file| fail_file in_friend_file }
+      @pending.clear
+      client.file_trees.tree_rejected self
+      self
+    end
+
+    def receive_manifest(seq, data)
+      return if @manifest.nil?
+      if seq == @next_seq &&
+         @manifest.bytesize + data.bytesize <= FileTrees::MAX_MANIFEST_SIZE
+        @manifest << data
+        @next_seq += 1
+      else
+        @manifest = nil
+      end
+    end
+
+    def finish_manifest
+      @entries = FileTrees.parse_manifest @manifest unless @manifest.nil?
+      @manifest = nil
+      @state = :new
+    end
+
+    def file_requested(index, in_friend_file)
+      if entries.nil? || index >= size
+        cancel in_friend_file
+      elsif @state == :rejected
+        fail_file in_friend_file
+      elsif @state == :accepted
+        start index, in_friend_file
+      else
+        @pending[index] = in_friend_file
+      end
+    end
+
+    def file_finished(_index, success)
+      if success
+        @received_count += 1
+      else
+        @failed_count += 1
+      end
+      finish if done?
+    end
+
+    def fail!
+      @entries ||= [].freeze
+      @pending.clear
+      @failed_count = size - received_count
+      finish
+      true
+    end
+
+  private
+
+    def start(index, in_friend_file)
+      path = File.join dir, entries[index].first
+      FileUtils.mkdir_p File.dirname path
+      in_friend_file.receive_to path
+      in_friend_file.control FileControl::RESUME
+    rescue SystemCallError, Friend::NotConnectedError
+      fail_file in_friend_file
+    end
+
+    def fail_file(in_friend_file)
+      cancel in_friend_file
+      @failed_count += 1
+      finish if done?
+    end
+
+    def cancel(in_friend_file)
+      in_friend_file.control FileControl::CANCEL
+    rescue Friend::NotConnectedError
+      nil
+    end
+
+    def finish
+      return if @on_finish.nil?
+      on_finish = @on_finish
+      @on_finish = nil
+      on_finish.call self
+    end
+  end
+end
@@ -0,0 +1,139 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Outgoing delta transfer ({Friend#sync_file}). It only succeeds once the
+  # receiver has acknowledged the applied delta.
+  #
+  class OutFriendSync
+    using CoreExt
+
+    attr_reader :friend, :path, :filename, :id, :size, :delta_size
+
+    def initialize(friend, path, filename, &block)
+      Friend.ancestor_of! friend
+      String.ancestor_of! filename
+      @friend = friend
+      @path = File.expand_path(path).freeze
+      raise ArgumentError, "Expected #{@path} to be a file" unless
+        File.file? @path
+      @filename = filename.dup_and_freeze
+      @id = SecureRandom.random_bytes(FileSyncs::ID_SIZE).freeze
+      @size = File.size @path
+      @delta_size = nil
+      @state = :offer
+      @success = nil
+      @dir = nil
+      @on_finish = block
+    end
+
+    def client
+      friend.client
+    end
+
+    def done?
+      @state == :done
+    end
+
+    def success?
+      @success == true
+    end
+
+    # Sends the offer, or generates and sends the delta once the signature
+    # has been received. Yields the started delta file.
+    #
+    # The delta is generated here, after tox_iterate, rather than in the
+    # callback of the signature, as the whole file is read.
+    def pump
+      generate if @state == :generate
+
+      case @state
+      when :offer
+        friend.send_lossless_packet(
+          FileSyncs.offer_packet(id, size, filename),
+        )
+        @state = :signature
+      when :delta
+        yield friend.send_local_file(
+          delta_path,
+          filename,
+          file_id: FileSyncs.file_id(id, FileSyncs::DELTA),
+        )
+        @state = :sending
+      end
+    rescue OutFriendFile::TooManyError, Friend::NotConnectedError,
+           SendQueueError
+      nil
+    rescue SystemCallError
+      finish false
+    end
+
+    def file_requested(in_friend_file)
+      return cancel in_friend_file unless @state == :signature
+      @dir = Dir.mktmpdir 'tox-sync'
+      in_friend_file.receive_to signature_path
+      in_friend_file.control FileControl::RESUME
+      @state = :receiving
+    rescue SystemCallError, Friend::NotConnectedError
+      cancel in_friend_file
+      finish false
+    end
+
+    def file_received(success)
+      return finish false unless success && @state == :receiving
+      @state = :generate
+    end
+
+    def file_sent(success)
+      return finish false unless success
+      @state = :ack if @state == :sending
+    end
+
+    # The acknowledgement can overtake the end of the delta file.
+    def acknowledged
+      finish true if %i[sending ack].include? @state
+    end
+
+    def rejected
+      finish false
+    end
+
+    def fail!
+      finish false
+      true
+    end
+
+  private
+
+    def generate
+      signature = File.binread signature_path
+      @delta_size = Delta.generate path, signature, delta_path
+      @state = :delta
+    rescue SystemCallError, ArgumentError
+      finish false
+    end
+
+    def signature_path
+      File.join @dir, 'signature'
+    end
+
+    def delta_path
+      File.join @dir, 'delta'
+    end
+
+    def cancel(in_friend_file)
+      in_friend_file.control FileControl::CANCEL
+    rescue Friend::NotConnectedError
+      nil
+    end
+
+    def finish(success)
+      return if done?
+      @state = :done
+      @success = success
+      FileUtils.remove_entry @dir unless @dir.nil?
+      @dir = nil
+      @on_finish&.call self
+    end
+  end
+end
@@ -0,0 +1,121 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Outgoing directory transfer ({Friend#send_tree}).
+  #
+  class OutFriendTree
+    using CoreExt
+
+    MAX_FILENAME_SIZE = 255
+
+    attr_reader :friend, :path, :id, :entries, :sent_count, :failed_count
+
+    def initialize(friend, path, &block)
+      Friend.ancestor_of! friend
+      @friend = friend
+      @path = File.expand_path(path).freeze
+      raise Errno::ENOTDIR, @path unless File.directory? @path
+      @id = SecureRandom.random_bytes(FileTrees::ID_SIZE).freeze
+      @entries = scan
+      @packets = FileTrees.manifest_packets id, entries
+      @next_packet = 0
+      @next_file = 0
+      @sent_count = 0
+      @failed_count = 0
+      @on_finish = block
+    end
+
+    def client
+      friend.client
+    end
+
+    def size
+      entries.size
+    end
+
+    def done?
+      @next_packet == @packets.size && sent_count + failed_count == size
+    end
+
+    # Sends what the friend can take now: the rest of the manifest, then
+    # files until toxcore refuses more concurrent transfers. Yields every
+    # started file with the index of its entry.
+    def pump(&block)
+      send_manifest && send_files(&block)
+      finish if done?
+    rescue Friend::NotConnectedError, SendQueueError
+      nil
+    end
+
+    def file_finished(index, success)
+      return unless index < @next_file
+      if success
+        @sent_count += 1
+      else
+        @failed_count += 1
+      end
+      finish if done?
+    end
+
+    def fail!
+      @next_packet = @packets.size
+      @next_file = size
+      @failed_count = size - sent_count
+      finish
+      true
+    end
+
+  private
+
+    def scan
+      prefix_size = path.bytesize + 1
+      result = []
+      Find.find path do |file|
+        stat = File.lstat file
+        result << [file.byteslice(prefix_size..-1), stat.size] if stat.file?
+      end
+      result.sort.map(&:freeze).freeze
+    end
+
+    def send_manifest
+      while @next_packet < @packets.size
+        friend.send_lossless_packet @packets[@next_packet]
+        @next_packet += 1
+      end
+      true
+    end
+
+    def send_files
+      while @next_file < size
+        file = send_file @next_file
+        return if file == false
+        yield file, @next_file unless file.nil?
+        @next_file += 1
+      end
+    end
+
+    # Returns false when toxcore has no free transfer slot, and nil when the
+    # file can not be sent at all.
+    def send_file(index)
+      relative_path = entries[index].first
+      friend.send_local_file(
+        File.join(path, relative_path),
+        File.basename(relative_path).byteslice(0, MAX_FILENAME_SIZE),
+        file_id: FileTrees.file_id(id, index),
+      )
+    rescue OutFriendFile::TooManyError
+      false
+    rescue SystemCallError, ArgumentError
+      @failed_count += 1
+      nil
+    end
+
+    def finish
+      return if @on_finish.nil?
+      on_finish = @on_finish
+      @on_finish = nil
+      on_finish.call self
+    end
+  end
+end
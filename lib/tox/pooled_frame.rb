@@ -0,0 +1,40 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Module for frames that are reused by a {FramePool}.
+  #
+  module PooledFrame
+    using CoreExt
+
+    attr_reader :pool
+
+    def initialize
+      @pool = nil
+      @retained = false
+    end
+
+    def pool=(value)
+      FramePool.ancestor_of! value unless value.nil?
+      @pool = value
+      @retained = false
+    end
+
+    def retained?
+      @retained
+    end
+
+    def retain
+      @retained = true
+      self
+    end
+
+    def release
+      pool = @pool
+      @pool = nil
+      @retained = false
+      pool&.put self
+      nil
+    end
+  end
+end
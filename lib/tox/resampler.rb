@@ -0,0 +1,46 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Streaming converter of audio frames to another sampling rate and number
+  # of channels. The polyphase filter keeps the last input samples between
+  # frames, so frames of one stream must go through the same resampler.
+  #
+  class Resampler
+    using CoreExt
+
+    VALID_CHANNELS = [1, 2].freeze
+
+    attr_reader :input_sampling_rate, :input_channels,
+                :output_sampling_rate, :output_channels
+
+    def initialize(input_sampling_rate, input_channels,
+                   output_sampling_rate, output_channels)
+      @input_sampling_rate  = sampling_rate! input_sampling_rate
+      @input_channels       = channels! input_channels
+      @output_sampling_rate = sampling_rate! output_sampling_rate
+      @output_channels      = channels! output_channels
+
+      initialize_with input_sampling_rate, input_channels,
+                      output_sampling_rate, output_channels
+    end
+
+  private
+
+    def sampling_rate!(value)
+      Integer.ancestor_of! value
+      unless AudioFrame::VALID_SAMPLING_RATES.include? value
+        raise ArgumentError, 'Invalid sampling rate'
+      end
+      value
+    end
+
+    def channels!(value)
+      Integer.ancestor_of! value
+      unless VALID_CHANNELS.include? value
+        raise ArgumentError, 'Invalid channels'
+      end
+      value
+    end
+  end
+end
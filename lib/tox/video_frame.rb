@@ -2,50 +2,65 @@
 
 module Tox
   ##
-  # Video frame.
+  # Video frame in the I420 layout. Frames of other pixel formats are
+  # converted with {.from_rgb}, {.from_rgba} and {.from_nv12}; the sizes of
+  # converted and scaled frames must be even. Planes are available in
+  # place to other extensions through {#plane}.
   #
   class VideoFrame
     using CoreExt
 
-    attr_reader :y_plane, :u_plane, :v_plane
+    include PooledFrame
 
-    def initialize
-      @y_plane = ''
-      @u_plane = ''
-      @v_plane = ''
-    end
+    MAX_SIZE = 2**16 - 2
 
-    def y_plane=(value)
-      String.ancestor_of! value
-      @y_plane = value
+    def self.from_rgb(data, width, height)
+      size! width, height
+      data! data, width * height * 3
+      from_packed_with data, 3, width, height
     end
 
-    def u_plane=(value)
-      String.ancestor_of! value
-      @u_plane = value
+    # Alpha is ignored.
+    def self.from_rgba(data, width, height)
+      size! width, height
+      data! data, width * height * 4
+      from_packed_with data, 4, width, height
     end
 
-    def v_plane=(value)
-      String.ancestor_of! value
-      @v_plane = value
+    # Luma plane followed by interleaved chroma planes.
+    def self.from_nv12(data, width, height)
+      size! width, height
+      data! data, width * height * 3 / 2
+      from_nv12_with data, width, height
     end
 
-    def valid?
-      y_plane_size_valid? && u_plane_size_valid? && v_plane_size_valid?
+    def self.valid_size?(width, height)
+      Integer.ancestor_of! width
+      Integer.ancestor_of! height
+      [width, height].all? { |v| v.positive? && v.even? && v <= MAX_SIZE }
     end
 
-  private
+    def self.size!(width, height)
+      raise ArgumentError, 'Invalid frame size' unless valid_size? width, height
+    end
 
-    def y_plane_size_valid?
-      y_plane.bytesize == width * height
+    def self.data!(data, bytesize)
+      String.ancestor_of! data
+      raise ArgumentError, 'Invalid data size' unless data.bytesize == bytesize
     end
 
-    def u_plane_size_valid?
-      u_plane.bytesize == (width / 2) * (height / 2)
+    private_class_method :size!, :data!
+
+    def plane(name)
+      VideoPlane.new self, name
     end
 
-    def v_plane_size_valid?
-      v_plane.bytesize == (width / 2) * (height / 2)
+    def scale(width, height)
+      unless self.class.valid_size? width, height
+        raise ArgumentError, 'Invalid frame size'
+      end
+      raise 'Invalid frame' unless valid?
+      scale_with width, height
     end
   end
 end
@@ -0,0 +1,57 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Gallery view compositor for group video calls. The latest frame of every
+  # source (usually a friend number) is kept natively and scaled into its
+  # cell of the grid, keeping its aspect ratio, only when a new frame
+  # arrives or the grid changes. Missing columns or rows are chosen so
+  # every source gets a cell; sources beyond a fixed grid are not shown.
+  #
+  # Call {#tick} from the iteration loop and {#compose} a frame for every
+  # listener when it returns true, so frames are sent at the frame rate.
+  #
+  class VideoMosaic
+    using CoreExt
+
+    attr_reader :frame_rate
+
+    def initialize(width, height, columns: nil, rows: nil, frame_rate: 15)
+      unless VideoFrame.valid_size? width, height
+        raise ArgumentError, 'Invalid frame size'
+      end
+
+      @frame_rate = frame_rate! frame_rate
+
+      initialize_with width, height, grid!(columns), grid!(rows),
+                      (1_000_000 / @frame_rate).round
+    end
+
+    # Leaves out the tile of the given source, usually the listener. The
+    # frame is reused when given.
+    def compose(video_frame = nil, except: nil)
+      VideoFrame.ancestor_of! video_frame unless video_frame.nil?
+      Integer.ancestor_of! except unless except.nil?
+      compose_with video_frame || VideoFrame.new, except
+    end
+
+  private
+
+    def grid!(value)
+      return if value.nil?
+      Integer.ancestor_of! value
+      unless value.positive? && value <= VideoFrame::MAX_SIZE / 2
+        raise ArgumentError, 'Invalid grid size'
+      end
+      value
+    end
+
+    def frame_rate!(value)
+      Numeric.ancestor_of! value
+      unless value.positive? && value <= 1000
+        raise ArgumentError, 'Invalid frame rate'
+      end
+      value.to_r
+    end
+  end
+end
@@ -0,0 +1,41 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Plane of a video frame. Since Ruby 3.0 its bytes are exposed in place
+  # through the memory view protocol as rows of unsigned bytes, so other
+  # extensions can work on them without copying.
+  #
+  class VideoPlane
+    using CoreExt
+
+    NAMES = %i[y u v].freeze
+
+    attr_reader :frame, :name
+
+    def initialize(frame, name)
+      VideoFrame.ancestor_of! frame
+      raise ArgumentError, 'Invalid plane name' unless NAMES.include? name
+      @frame = frame
+      @name = name
+    end
+
+    def width
+      name == :y ? frame.width : frame.width / 2
+    end
+
+    def height
+      name == :y ? frame.height : frame.height / 2
+    end
+
+    def data
+      frame.public_send :"#{name}_plane"
+    end
+
+    def ==(other)
+      self.class == other.class &&
+        frame.equal?(other.frame) &&
+        name == other.name
+    end
+  end
+end
@@ -0,0 +1,103 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # WAVE file of 16-bit PCM. Readers map the whole file and copy samples
+  # straight into the PCM of an {AudioFrame}, which can be passed in again
+  # to reuse its string. Writers fill in the sizes of the header when the
+  # file is closed.
+  #
+  class WavFile
+    using CoreExt
+
+    VALID_CHANNELS = [1, 2].freeze
+
+    # Frames are read in lengths which toxav can send by default.
+    DEFAULT_AUDIO_LENGTH = 20
+
+    class FormatError < RuntimeError; end
+
+    private_class_method :new
+
+    def self.open(path, &block)
+      opened new(path), :open_with, path, &block
+    end
+
+    def self.create(path, sampling_rate = 48_000, channels = 2, &block)
+      Integer.ancestor_of! sampling_rate
+      Integer.ancestor_of! channels
+
+      unless AudioFrame::VALID_SAMPLING_RATES.include? sampling_rate
+        raise ArgumentError, 'Invalid sampling rate'
+      end
+
+      unless VALID_CHANNELS.include? channels
+        raise ArgumentError, 'Invalid channels'
+      end
+
+      opened new(path), :create_with, path, sampling_rate, channels, &block
+    end
+
+    def self.opened(file, method_name, *args)
+      begin
+        file.send method_name, *args
+
+        unless AudioFrame::VALID_SAMPLING_RATES.include? file.sampling_rate
+          raise FormatError, 'Unsupported sampling rate'
+        end
+      rescue StandardError
+        file.close
+        raise
+      end
+
+      return file unless block_given?
+
+      begin
+        yield file
+      ensure
+        file.close
+      end
+    end
+
+    private_class_method :opened
+
+    attr_reader :path
+
+    def initialize(path)
+      String.ancestor_of! path
+      @path = path
+    end
+
+    # Sample count of frames of the given length in milliseconds.
+    def frame_sample_count(audio_length = DEFAULT_AUDIO_LENGTH)
+      (sampling_rate * audio_length / 1000).to_i
+    end
+
+    # The last frame can be shorter, so it is not always valid to send.
+    # Returns nil after it.
+    def read_frame(audio_frame = nil, sample_count: frame_sample_count)
+      AudioFrame.ancestor_of! audio_frame unless audio_frame.nil?
+      Integer.ancestor_of! sample_count
+      raise ArgumentError, 'Invalid sample count' unless sample_count.positive?
+      read_frame_with audio_frame || AudioFrame.new, sample_count
+    end
+
+    def write_frame(audio_frame)
+      AudioFrame.ancestor_of! audio_frame
+      write_frame_with audio_frame
+    end
+
+    # Yields the same frame every time when one is given.
+    def each_frame(audio_frame = nil, sample_count: frame_sample_count)
+      unless block_given?
+        return enum_for :each_frame, audio_frame, sample_count: sample_count
+      end
+
+      while (frame = read_frame audio_frame, sample_count: sample_count)
+        yield frame
+      end
+
+      self
+    end
+  end
+end
@@ -0,0 +1,93 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # YUV4MPEG2 video file of I420 frames. Readers map the whole file and
+  # copy every frame straight into the planes of a {VideoFrame}, which can
+  # be passed in again to reuse its strings. Only 8-bit 4:2:0 files with
+  # even frame sizes are supported.
+  #
+  class Y4MFile
+    using CoreExt
+
+    DEFAULT_FRAME_RATE = 30
+
+    class FormatError < RuntimeError; end
+
+    private_class_method :new
+
+    def self.open(path, &block)
+      opened new(path), :open_with, path, &block
+    end
+
+    def self.create(path, width, height,
+                    frame_rate: DEFAULT_FRAME_RATE, &block)
+      unless VideoFrame.valid_size? width, height
+        raise ArgumentError, 'Invalid frame size'
+      end
+
+      frame_rate = frame_rate! frame_rate
+
+      opened new(path), :create_with, path, width, height,
+             frame_rate.numerator, frame_rate.denominator, &block
+    end
+
+    def self.opened(file, method_name, *args)
+      begin
+        file.send method_name, *args
+      rescue StandardError
+        file.close
+        raise
+      end
+
+      return file unless block_given?
+
+      begin
+        yield file
+      ensure
+        file.close
+      end
+    end
+
+    def self.frame_rate!(value)
+      Numeric.ancestor_of! value
+      value = value.to_r
+      unless value.positive? &&
+             [value.numerator, value.denominator].max <= 2**32 - 1
+        raise ArgumentError, 'Invalid frame rate'
+      end
+      value
+    end
+
+    private_class_method :opened, :frame_rate!
+
+    attr_reader :path
+
+    def initialize(path)
+      String.ancestor_of! path
+      @path = path
+    end
+
+    # Returns nil after the last frame.
+    def read_frame(video_frame = nil)
+      VideoFrame.ancestor_of! video_frame unless video_frame.nil?
+      read_frame_with video_frame || VideoFrame.new
+    end
+
+    def write_frame(video_frame)
+      VideoFrame.ancestor_of! video_frame
+      write_frame_with video_frame
+    end
+
+    # Yields the same frame every time when one is given.
+    def each_frame(video_frame = nil)
+      return enum_for :each_frame, video_frame unless block_given?
+
+      while (frame = read_frame video_frame)
+        yield frame
+      end
+
+      self
+    end
+  end
+end
@@ -0,0 +1,324 @@
+# frozen_string_literal: true
+
+require 'network_helper'
+
+require 'fileutils'
+
+RSpec.describe 'Calls between two clients', type: :integration do
+  let(:sender) { new_client }
+  let(:receiver) { new_client }
+
+  let(:dir) { Dir.mktmpdir 'tox-calls' }
+
+  let(:audio_frames) { [] }
+
+  let(:receiver_call) { Tox::FriendCall.new receiver.audio_video, 0 }
+
+  before do
+    sender.friend_add_norequest receiver.public_key
+    receiver.friend_add_norequest sender.public_key
+
+    receiver.audio_video.on_call do |friend_call_request|
+      friend_call_request.answer 48, 0
+    end
+
+    receiver.audio_video.on_audio_frame do |_friend_call, audio_frame|
+      audio_frames << audio_frame
+    end
+  end
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  def new_client
+    options = Tox::Options.new
+    options.local_discovery_enabled = false
+
+    Tox::Client.new(options).tap do |client|
+      bootstrap_nodes.each do |node|
+        client.bootstrap '127.0.0.1', node.port, node.public_key
+      end
+    end
+  end
+
+  def clients
+    [sender, receiver]
+  end
+
+  def iterate
+    intervals = clients.flat_map { |c| [c, c.audio_video] }
+                       .map(&:iteration_interval)
+    sleep intervals.min
+    clients.each(&:iterate)
+    clients.each { |client| client.audio_video.iterate }
+  end
+
+  def iterate_until(timeout = 30)
+    deadline = Time.now + timeout
+
+    until yield
+      raise Timeout::Error, 'call did not progress' if Time.now > deadline
+      iterate
+    end
+  end
+
+  def call
+    friend = sender.friend sender.friend_numbers.first
+    friend_call = nil
+    answered = false
+
+    sender.audio_video.on_call_state_change do |_friend_call, state|
+      answered ||= state.accepting_audio? || state.sending_audio?
+    end
+
+    iterate_until do
+      begin
+        friend_call = friend.call audio_bit_rate: 48
+      rescue Tox::Friend::NotConnectedError
+        false
+      end
+    end
+
+    iterate_until { answered }
+
+    iterate_until do
+      friend_call.send_audio_frame audio_frame
+      audio_frames.any?
+    end
+
+    friend_call
+  end
+
+  def audio_frame
+    Tox::AudioFrame.new.tap do |frame|
+      frame.pcm           = Array.new(1920) { |i| (i % 64) * 256 }.pack 's*'
+      frame.sample_count  = 960
+      frame.channels      = 2
+      frame.sampling_rate = 48_000
+    end
+  end
+
+  # Granule positions of the pages of an Ogg file.
+  def granule_positions(path)
+    data = File.binread path
+    offset = 0
+    positions = []
+
+    while offset < data.bytesize
+      expect(data.byteslice(offset, 4)).to eq 'OggS'
+      positions << data.byteslice(offset + 6, 8).unpack('Q<').first
+      segments = data.byteslice(offset + 27, data.getbyte(offset + 26)).bytes
+      offset += 27 + segments.size + segments.reduce(0, :+)
+    end
+
+    positions
+  end
+
+  describe 'holding media' do
+    let(:friend_call) { call }
+
+    let(:sent) { [] }
+
+    def hold(control)
+      friend_call.control control
+      10.times { iterate }
+      audio_frames.clear
+
+      25.times do
+        sent << friend_call.send_audio_frame(audio_frame)
+        iterate
+      end
+    end
+
+    def sends_again
+      iterate_until do
+        friend_call.send_audio_frame audio_frame
+        audio_frames.any?
+      end
+    end
+
+    context 'when audio is muted' do
+      before { hold Tox::CallControl::MUTE_AUDIO }
+
+      it 'does not send audio frames' do
+        expect(sent).to eq [false] * 25
+        expect(audio_frames).to eq []
+      end
+
+      it 'sends them again after unmuting' do
+        friend_call.control Tox::CallControl::UNMUTE_AUDIO
+        sends_again
+        expect(friend_call.audio_muted?).to eq false
+      end
+    end
+
+    context 'when call is paused' do
+      before { hold Tox::CallControl::PAUSE }
+
+      it 'does not send audio frames' do
+        expect(sent).to eq [false] * 25
+        expect(audio_frames).to eq []
+      end
+
+      it 'sends them again after resuming' do
+        friend_call.control Tox::CallControl::RESUME
+        sends_again
+        expect(friend_call.paused?).to eq false
+      end
+    end
+  end
+
+  describe 'relay' do
+    let(:listener) { new_client }
+
+    let(:listener_frames) { [] }
+
+    let(:sink) { Tox::FriendCall.new receiver.audio_video, 1 }
+
+    def clients
+      [sender, receiver, listener]
+    end
+
+    # Calls the listener from the receiver, which relays the sender.
+    def call_listener
+      friend = receiver.friend 1
+      answered = false
+
+      receiver.audio_video.on_call_state_change do |friend_call, state|
+        next unless friend_call == sink
+        answered ||= state.accepting_audio? || state.sending_audio?
+      end
+
+      iterate_until do
+        begin
+          friend.call audio_bit_rate: 48
+        rescue Tox::Friend::NotConnectedError
+          false
+        end
+      end
+
+      iterate_until { answered }
+    end
+
+    def relay_audio(friend_call)
+      iterate_until do
+        friend_call.send_audio_frame audio_frame
+        listener_frames.any?
+      end
+    end
+
+    before do
+      receiver.friend_add_norequest listener.public_key
+      listener.friend_add_norequest receiver.public_key
+
+      listener.audio_video.on_call do |friend_call_request|
+        friend_call_request.answer 48, 0
+      end
+
+      listener.audio_video.on_audio_frame do |_friend_call, audio_frame|
+        listener_frames << audio_frame
+      end
+    end
+
+    it 'forwards audio of the source to the sink' do
+      friend_call = call
+      call_listener
+
+      expect(receiver_call.add_relay_sink(sink)).to eq true
+      expect(receiver_call.add_relay_sink(sink)).to eq false
+
+      relay_audio friend_call
+
+      expect(listener_frames.first.sampling_rate).to eq 48_000
+      expect(listener_frames.first.channels).to eq 2
+      expect(receiver_call.relay_stats).to include(
+        sinks: 1,
+        audio_failed: 0,
+        video_frames: 0,
+      )
+      expect(receiver_call.relay_stats[:audio_sent]).to be >= 1
+    end
+
+    it 'removes sinks whose calls end' do
+      call
+      call_listener
+      receiver_call.add_relay_sink sink
+
+      listener_call = Tox::FriendCall.new listener.audio_video, 0
+      listener_call.control Tox::CallControl::CANCEL
+
+      iterate_until { receiver_call.relay_sinks.empty? }
+      expect(receiver_call.relay_stats).to include sinks: 0
+    end
+
+    it 'is dropped when the call of the source ends' do
+      friend_call = call
+      call_listener
+      receiver_call.add_relay_sink sink
+
+      friend_call.control Tox::CallControl::CANCEL
+
+      iterate_until { receiver_call.relay_stats.nil? }
+      expect(receiver_call.stop_relay).to eq false
+    end
+
+    context 'when sink is not in call' do
+      it 'raises' do
+        call
+        expect { receiver_call.add_relay_sink sink }.to \
+          raise_error RuntimeError, 'sink is not in call'
+      end
+    end
+  end
+
+  describe 'recording' do
+    let(:path) { File.join dir, 'call.opus' }
+
+    let(:frame_count) { 75 }
+
+    let(:stats) { [] }
+
+    before do
+      friend_call = call
+
+      receiver_call.record_to path
+      audio_frames.clear
+
+      frame_count.times do
+        friend_call.send_audio_frame audio_frame
+        iterate
+      end
+
+      iterate_until { audio_frames.size >= frame_count }
+
+      stats << receiver_call.recording_stats
+      receiver_call.stop_recording
+    end
+
+    it 'records every received frame' do
+      expect(stats.first).to include(
+        received: audio_frames.size,
+        dropped: 0,
+        sampling_rate: 48_000,
+        channels: 2,
+        error: nil,
+      )
+    end
+
+    it 'writes an Ogg Opus file of the received audio' do
+      opus_file = OpusFile.new path
+      expect(opus_file.channel_count(-1)).to eq 2
+      expect(opus_file.pcm_total(-1)).to eq audio_frames.size * 960
+    end
+
+    it 'positions pages after the pre-skip' do
+      pre_skip = File.binread(path, 2, 28 + 10).unpack('v').first
+      positions = granule_positions path
+
+      expect(positions.first(2)).to eq [0, 0]
+      expect(positions.drop(2)).to eq positions.drop(2).sort
+      expect(positions.last).to eq pre_skip + audio_frames.size * 960
+    end
+  end
+end
@@ -0,0 +1,292 @@
+# frozen_string_literal: true
+
+require 'network_helper'
+
+require 'fileutils'
+
+RSpec.describe 'File transfer between two clients', type: :integration do
+  let(:sender)   { new_client }
+  let(:receiver) { new_client }
+
+  let(:dir)  { Dir.mktmpdir 'tox-file-transfer' }
+  let(:path) { File.join dir, 'data' }
+  let(:data) { 'abc' }
+
+  before do
+    File.binwrite path, data
+
+    sender.friend_add_norequest receiver.public_key
+    receiver.friend_add_norequest sender.public_key
+  end
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  def new_client
+    options = Tox::Options.new
+    options.local_discovery_enabled = false
+
+    Tox::Client.new(options).tap do |client|
+      bootstrap_nodes.each do |node|
+        client.bootstrap '127.0.0.1', node.port, node.public_key
+      end
+    end
+  end
+
+  def iterate_until(timeout = 30)
+    deadline = Time.now + timeout
+
+    until yield
+      raise Timeout::Error, 'transfer did not finish' if Time.now > deadline
+      sleep [sender, receiver].map(&:iteration_interval).min
+      sender.iterate
+      receiver.iterate
+    end
+  end
+
+  def send_file
+    friend = sender.friend sender.friend_numbers.first
+
+    iterate_until do
+      begin
+        friend.send_local_file path
+      rescue Tox::Friend::NotConnectedError
+        false
+      end
+    end
+  end
+
+  describe 'digest' do
+    let(:digests) { [] }
+
+    before do
+      receiver.on_file_recv_request do |in_friend_file, _kind, _size, _name|
+        in_friend_file.enable_digest
+        in_friend_file.control Tox::FileControl::RESUME
+      end
+
+      receiver.on_file_recv_chunk do |in_friend_file, _position, chunk|
+        digests << in_friend_file.digest if chunk.empty?
+      end
+
+      send_file
+      iterate_until { digests.any? }
+    end
+
+    it 'is SHA-256 of received data' do
+      expect(digests.first.unpack('H*').first).to eq(
+        'ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad',
+      )
+    end
+  end
+
+  describe 'receiving to local file' do
+    let(:data) { SecureRandom.random_bytes size }
+    let(:size) { 1000 }
+
+    let(:received_path) { File.join dir, 'received' }
+
+    let(:finished)  { [] }
+    let(:cancelled) { [] }
+
+    before do
+      receiver.on_file_recv_request do |in_friend_file, _kind, _size, _name|
+        in_friend_file.receive_to received_path
+        in_friend_file.control Tox::FileControl::RESUME
+      end
+
+      receiver.on_file_recv_chunk do |in_friend_file, _position, chunk|
+        finished << in_friend_file if chunk.empty?
+      end
+
+      receiver.on_file_recv_control do |in_friend_file, file_control|
+        cancelled << in_friend_file if file_control == Tox::FileControl::CANCEL
+      end
+
+      send_file
+      iterate_until { finished.any? || cancelled.any? }
+    end
+
+    it 'writes the whole file' do
+      expect(finished.size).to eq 1
+      expect(File.binread(received_path)).to eq data
+    end
+
+    context 'when file is larger than write buffers' do
+      let(:size) { 300_000 }
+
+      it 'writes the whole file' do
+        expect(File.binread(received_path)).to eq data
+      end
+    end
+
+    context 'when file can not be written' do
+      let(:received_path) { '/dev/full' }
+
+      it 'reports transfer as cancelled' do
+        expect(cancelled.size).to eq 1
+        expect(finished).to eq []
+      end
+
+      context 'when file is larger than write buffers' do
+        let(:size) { 300_000 }
+
+        it 'reports transfer as cancelled' do
+          expect(cancelled.size).to eq 1
+          expect(finished).to eq []
+        end
+      end
+    end
+  end
+
+  describe 'compressed transfer' do
+    let :data do
+      Array.new(20_000) { |i| "line #{i}: #{'foo' * (i % 10)}\n" }.join
+    end
+
+    let(:received_path) { File.join dir, 'received' }
+
+    let(:requests) { [] }
+    let(:finished) { [] }
+
+    before do
+      receiver.accept_compressed_files = true
+
+      receiver.on_file_recv_request do |in_friend_file, _kind, size, _name|
+        requests << [in_friend_file.compressed?, size]
+        in_friend_file.receive_to received_path
+        in_friend_file.control Tox::FileControl::RESUME
+      end
+
+      receiver.on_file_recv_chunk do |in_friend_file, _position, chunk|
+        finished << in_friend_file if chunk.empty?
+      end
+
+      friend = sender.friend sender.friend_numbers.first
+
+      iterate_until { sender.file_compression.supported? friend.number }
+
+      friend.send_local_file path, compress: true
+      iterate_until { finished.any? }
+    end
+
+    it 'is sent as stream' do
+      expect(requests).to eq [[true, 2**64 - 1]]
+    end
+
+    it 'writes the original file' do
+      expect(finished.first.original_size).to eq data.bytesize
+      expect(File.binread(received_path)).to eq data
+    end
+  end
+
+  describe 'compressed transfer to receiver without support' do
+    let(:requests) { [] }
+
+    before do
+      sender.accept_compressed_files = true
+
+      receiver.on_file_recv_request do |in_friend_file, _kind, size, _name|
+        requests << [in_friend_file.compressed?, size]
+      end
+
+      # The receiver has heard the announcement of the sender by then, so
+      # an announcement of its own would have arrived too.
+      iterate_until do
+        receiver.file_compression.supported? receiver.friend_numbers.first
+      end
+
+      friend = sender.friend sender.friend_numbers.first
+      friend.send_local_file path, compress: true
+      iterate_until { requests.any? }
+    end
+
+    it 'is sent uncompressed' do
+      expect(requests).to eq [[false, data.bytesize]]
+    end
+  end
+
+  describe 'sync' do
+    let(:data) { SecureRandom.random_bytes 100_000 }
+
+    let(:old_data) do
+      data.byteslice(0, 50_000) + 'changed' + data.byteslice(50_000..-1)
+    end
+
+    let(:old_path) { File.join dir, 'old' }
+
+    let(:finished) { [] }
+
+    before do
+      File.binwrite old_path, old_data
+      File.chmod 0o750, old_path
+
+      receiver.on_sync_recv_request do |sync|
+        sync.accept(old_path) { |s| finished << s }
+      end
+
+      friend = sender.friend sender.friend_numbers.first
+      friend.sync_file(path) { |s| finished << s }
+
+      iterate_until { finished.size == 2 }
+    end
+
+    it 'succeeds on both sides' do
+      expect(finished.map(&:success?)).to eq [true, true]
+    end
+
+    it 'finishes the sender after the receiver' do
+      expect(finished.map(&:class))
+        .to eq [Tox::InFriendSync, Tox::OutFriendSync]
+    end
+
+    it 'replaces the old copy and keeps its permissions' do
+      expect(File.binread(old_path)).to eq data
+      expect(File.stat(old_path).mode & 0o777).to eq 0o750
+    end
+  end
+
+  describe 'avatar' do
+    let(:avatar) { SecureRandom.random_bytes 1000 }
+    let(:avatar_cache) { Tox::AvatarCache.new File.join(dir, 'avatars') }
+
+    let(:avatars)  { [] }
+    let(:requests) { [] }
+
+    before do
+      sender.avatar = avatar
+      avatar_cache.store avatar
+
+      receiver.avatar_cache = avatar_cache
+
+      receiver.on_friend_avatar do |friend, hash|
+        avatars << [friend.number, hash]
+      end
+
+      receiver.on_file_recv_request do |in_friend_file, *|
+        requests << in_friend_file
+      end
+
+      friend = sender.friend sender.friend_numbers.first
+
+      iterate_until do
+        begin
+          friend.send_avatar
+        rescue Tox::Friend::NotConnectedError
+          false
+        end
+      end
+
+      iterate_until { avatars.any? }
+    end
+
+    it 'passes hash of cached avatar to Ruby' do
+      expect(avatars).to eq [[receiver.friend_numbers.first, Tox.hash(avatar)]]
+    end
+
+    it 'does not request cached avatar' do
+      expect(requests).to eq []
+    end
+  end
+end
@@ -198,4 +198,165 @@ RSpec.describe Tox::AudioFrame do
       end
     end
   end
+
+  describe '#rms' do
+    let(:pcm) { ([16_384, -16_384] * 480).pack 's*' }
+    let(:sample_count) { 480 }
+    let(:channels) { 2 }
+    let(:sampling_rate) { 48_000 }
+
+    specify do
+      expect(subject.rms).to eq 0.5
+    end
+
+    context 'when PCM is shorter than sample count' do
+      let(:pcm) { [16_384].pack 's*' }
+
+      specify do
+        expect(subject.rms).to eq 0.5
+      end
+    end
+
+    context 'when PCM is empty' do
+      let(:pcm) { '' }
+
+      specify do
+        expect(subject.rms).to eq 0.0
+      end
+    end
+  end
+
+  # Samples go through SIMD in blocks of eight, the rest one by one, so the
+  # frames are long enough for both.
+  describe '#peak' do
+    let :pcm do
+      samples = [0] * 20
+      samples[3]  = 100
+      samples[5]  = -8192
+      samples[10] = 4096
+      samples[14] = -32_768
+      samples.pack 's*'
+    end
+
+    let(:sample_count) { 20 }
+    let(:channels) { 1 }
+    let(:sampling_rate) { 8_000 }
+
+    specify do
+      expect(subject.peak).to eq 32_767 / 32_768.0
+    end
+
+    context 'when sample count excludes the loudest sample' do
+      let(:sample_count) { 12 }
+
+      specify do
+        expect(subject.peak).to eq 0.25
+      end
+    end
+
+    context 'when the loudest sample is one of the rest' do
+      let :pcm do
+        samples = [-8192] * 16 + [0, 0, 16_384, 0]
+        samples.pack 's*'
+      end
+
+      specify do
+        expect(subject.peak).to eq 0.5
+      end
+    end
+  end
+
+  describe '#clipped_count' do
+    let :pcm do
+      samples = [1000] * 20
+      samples[1]  = 32_767
+      samples[6]  = -32_768
+      samples[9]  = -32_767
+      samples[12] = 32_766
+      samples[18] = 32_767
+      samples.pack 's*'
+    end
+
+    let(:sample_count) { 20 }
+    let(:channels) { 1 }
+    let(:sampling_rate) { 8_000 }
+
+    specify do
+      expect(subject.clipped_count).to eq 4
+    end
+
+    context 'when sample count excludes the rest' do
+      let(:sample_count) { 16 }
+
+      specify do
+        expect(subject.clipped_count).to eq 3
+      end
+    end
+  end
+
+  describe 'memory view' do
+    let(:pcm) { [1, 2, 3, 4, -5, 6].pack 's*' }
+    let(:sample_count) { 3 }
+    let(:channels) { 2 }
+    let(:sampling_rate) { 8_000 }
+
+    before do
+      require 'fiddle'
+      skip 'Memory views require Ruby 3.0' unless defined? Fiddle::MemoryView
+    end
+
+    specify do
+      view = Fiddle::MemoryView.new subject
+      expect(view.format).to eq 's'
+      expect(view.shape).to eq [3, 2]
+      expect(view.strides).to eq [4, 2]
+      expect(view[2, 0]).to eq(-5)
+      view.release
+    end
+
+    it 'locks PCM until released' do
+      view = Fiddle::MemoryView.new subject
+      expect { subject.pcm << 'x' }.to raise_error RuntimeError
+      view.release
+      expect { subject.pcm << 'x' }.not_to raise_error
+    end
+
+    it 'is read-only for frozen PCM' do
+      subject.pcm = pcm.dup.freeze
+      view = Fiddle::MemoryView.new subject
+      expect(view).to be_readonly
+      view.release
+    end
+
+    context 'when PCM is shorter than sample count' do
+      let(:sample_count) { 4 }
+
+      specify do
+        expect { Fiddle::MemoryView.new subject }.to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#convert' do
+    let(:pcm) { ([100, 300] * 480).pack 's*' }
+    let(:sample_count) { 480 }
+    let(:channels) { 2 }
+    let(:sampling_rate) { 48_000 }
+
+    specify do
+      result = subject.convert rate: 16_000, channels: 1
+      expect(result.sampling_rate).to eq 16_000
+      expect(result.channels).to eq 1
+      expect(result.sample_count).to eq 160
+    end
+
+    specify do
+      result = subject.convert channels: 1
+      expect(result.pcm.unpack('s*').uniq).to eq [200]
+    end
+
+    specify do
+      expect(subject.convert.pcm).to eq pcm
+    end
+  end
 end
@@ -0,0 +1,73 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox.const_get(:AudioMeter) do
+  subject { described_class.new }
+
+  # Frames of 20 ms of mono audio at 8 kHz.
+  def audio_frame(samples)
+    Tox::AudioFrame.new.tap do |frame|
+      frame.pcm           = samples.pack 's*'
+      frame.sample_count  = 160
+      frame.channels      = 1
+      frame.sampling_rate = 8_000
+    end
+  end
+
+  let(:loud_frame)   { audio_frame [16_384, -16_384] * 80 }
+  let(:silent_frame) { audio_frame [0] * 160 }
+
+  describe '#push' do
+    context 'when frame is not an audio frame' do
+      specify do
+        expect { subject.push :foobar }.to raise_error TypeError
+      end
+    end
+
+    context 'when frame is invalid' do
+      specify do
+        expect { subject.push Tox::AudioFrame.new }.to \
+          raise_error ArgumentError, 'audio frame is invalid'
+      end
+    end
+  end
+
+  describe '#stats' do
+    specify do
+      expect(subject.stats).to eq rms: 0.0, peak: 0.0, frames: 0, clipped: 0
+    end
+
+    it 'measures pushed frames' do
+      subject.push loud_frame
+      expect(subject.stats).to eq rms: 0.5, peak: 0.5, frames: 1, clipped: 0
+    end
+
+    it 'counts clipped samples of every frame' do
+      samples = [0] * 160
+      samples[2]  = 32_767
+      samples[9]  = -32_768
+      samples[13] = -32_767
+      samples[159] = 32_767
+
+      subject.push audio_frame(samples)
+      subject.push audio_frame(samples)
+
+      expect(subject.stats).to include peak: 32_767 / 32_768.0, clipped: 8
+    end
+
+    it 'averages the last 50 frames' do
+      subject.push loud_frame
+      49.times { subject.push silent_frame }
+
+      stats = subject.stats
+      expect(stats[:rms]).to be_within(1e-9).of(0.5 * Math.sqrt(1 / 50.0))
+      expect(stats).to include peak: 0.5, frames: 50
+    end
+
+    it 'forgets older frames' do
+      subject.push loud_frame
+      50.times { subject.push silent_frame }
+
+      expect(subject.stats).to eq rms: 0.0, peak: 0.0, frames: 51, clipped: 0
+    end
+  end
+end
@@ -0,0 +1,128 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::AudioMixer do
+  subject { described_class.new sampling_rate, channels }
+
+  let(:sampling_rate) { 48_000 }
+  let(:channels) { 2 }
+
+  def audio_frame(samples, frame_sampling_rate = sampling_rate)
+    Tox::AudioFrame.new.tap do |frame|
+      frame.pcm           = samples.pack 's*'
+      frame.sample_count  = samples.size / channels
+      frame.channels      = channels
+      frame.sampling_rate = frame_sampling_rate
+    end
+  end
+
+  describe '#initialize' do
+    context 'when sampling rate is invalid' do
+      let(:sampling_rate) { 44_100 }
+
+      specify do
+        expect { subject }.to \
+          raise_error ArgumentError, 'Invalid sampling rate'
+      end
+    end
+
+    context 'when channels are invalid' do
+      let(:channels) { 3 }
+
+      specify do
+        expect { subject }.to raise_error ArgumentError, 'Invalid channels'
+      end
+    end
+  end
+
+  describe '#sampling_rate' do
+    specify do
+      expect(subject.sampling_rate).to eq sampling_rate
+    end
+  end
+
+  describe '#channels' do
+    specify do
+      expect(subject.channels).to eq channels
+    end
+  end
+
+  describe '#sample_count' do
+    specify do
+      expect(subject.sample_count(20)).to eq 960
+    end
+  end
+
+  describe '#push' do
+    specify do
+      subject.push 1, audio_frame([0] * 1920)
+      expect(subject.sources).to eq [1]
+      expect(subject.buffered(1)).to eq 960
+    end
+
+    context 'when frame has another sampling rate' do
+      specify do
+        expect { subject.push 1, audio_frame([0] * 960, 24_000) }.to \
+          raise_error ArgumentError
+      end
+    end
+
+    context 'when source is far ahead of the mix' do
+      specify do
+        20.times { subject.push 1, audio_frame([0] * 1920) }
+        expect(subject.buffered(1)).to eq 9600
+      end
+    end
+  end
+
+  describe '#delete' do
+    before do
+      subject.push 1, audio_frame([0] * 1920)
+    end
+
+    specify do
+      expect(subject.delete(1)).to eq true
+      expect(subject.sources).to eq []
+    end
+
+    specify do
+      expect(subject.delete(2)).to eq false
+    end
+  end
+
+  describe '#mix' do
+    let(:samples) { [[1000] * 8, [-200] * 8, [32_000] * 8] }
+
+    before do
+      samples.each_with_index do |source_samples, source|
+        subject.push source, audio_frame(source_samples)
+      end
+    end
+
+    let :mixes do
+      result = {}
+      subject.mix 4 do |source, frame|
+        result[source] = frame.pcm.unpack 's*'
+      end
+      result
+    end
+
+    it 'mixes all other sources' do
+      expect(mixes[0]).to eq [31_800] * 8
+      expect(mixes[1]).to eq [32_767] * 8
+      expect(mixes[2]).to eq [800] * 8
+    end
+
+    it 'consumes buffered samples' do
+      mixes
+      expect(subject.buffered(0)).to eq 0
+    end
+
+    context 'when source has not enough samples' do
+      let(:samples) { [[1000] * 8, [-200] * 4] }
+
+      specify do
+        expect(mixes[0]).to eq [-200] * 4 + [0] * 4
+      end
+    end
+  end
+end
@@ -49,6 +49,26 @@ RSpec.describe Tox::AudioVideo do
     end
   end
 
+  describe '#frame_pool' do
+    specify do
+      expect(subject.frame_pool).to eq nil
+    end
+  end
+
+  describe '#frame_pool=' do
+    specify do
+      subject.frame_pool = true
+      expect(subject.frame_pool).to be_instance_of Tox::FramePool
+      expect(subject.frame_pool.audio_video).to equal subject
+    end
+
+    specify do
+      subject.frame_pool = true
+      subject.frame_pool = false
+      expect(subject.frame_pool).to eq nil
+    end
+  end
+
   describe '#pointer' do
     specify do
       expect(subject.pointer).to be_kind_of Integer
@@ -0,0 +1,126 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::AvatarCache do
+  subject { described_class.new dir }
+
+  let(:dir) { File.join tmpdir, 'avatars' }
+
+  let!(:tmpdir) { Dir.mktmpdir }
+
+  let(:data) { SecureRandom.random_bytes rand 1..1000 }
+
+  after do
+    FileUtils.remove_entry tmpdir
+  end
+
+  describe '#initialize' do
+    context 'when directory has invalid type' do
+      let(:dir) { :foobar }
+
+      specify do
+        expect { subject }.to raise_error(
+          TypeError,
+          "Expected #{String}, got #{dir.class}",
+        )
+      end
+    end
+
+    it 'creates the directory' do
+      expect { subject }.to change { File.directory? dir }.from(false).to(true)
+    end
+  end
+
+  describe '#store' do
+    it 'returns hash of data' do
+      expect(subject.store(data)).to eq Tox.hash data
+    end
+
+    it 'writes data to file named by hash' do
+      subject.store data
+      expect(File.binread(subject.path(Tox.hash(data)))).to eq data
+    end
+
+    it 'leaves no temporary files behind' do
+      subject.store data
+      expect(Dir[File.join(dir, '*')]).to eq [subject.path(Tox.hash(data))]
+    end
+
+    context 'when data has invalid type' do
+      specify do
+        expect { subject.store :foobar }.to raise_error TypeError
+      end
+    end
+  end
+
+  describe '#include?' do
+    specify do
+      expect(subject.include?(Tox.hash(data))).to eq false
+    end
+
+    context 'when data was stored' do
+      before do
+        subject.store data
+      end
+
+      specify do
+        expect(subject.include?(Tox.hash(data))).to eq true
+      end
+
+      it 'is visible to other instance with the same directory' do
+        expect(described_class.new(dir).include?(Tox.hash(data))).to eq true
+      end
+    end
+
+    context 'when hash has invalid size' do
+      specify do
+        expect { subject.include? 'foo' }.to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#path' do
+    it 'returns file name from upper case hex of hash' do
+      expect(subject.path(Tox.hash(data))).to \
+        eq File.join dir, Tox.hash(data).unpack('H*').first.upcase
+    end
+  end
+
+  describe '#[]' do
+    specify do
+      expect(subject[Tox.hash(data)]).to eq nil
+    end
+
+    context 'when data was stored' do
+      before do
+        subject.store data
+      end
+
+      specify do
+        expect(subject[Tox.hash(data)]).to eq data
+      end
+
+      it 'reads data stored by other instance' do
+        expect(described_class.new(dir)[Tox.hash(data)]).to eq data
+      end
+    end
+
+    context 'when more avatars were stored than memory holds' do
+      let(:avatars) do
+        Array.new(described_class::MEMORY_SIZE + 1) { |i| "avatar #{i}" }
+      end
+
+      before do
+        avatars.each { |avatar| subject.store avatar }
+        avatars.each { |avatar| File.unlink subject.path Tox.hash avatar }
+      end
+
+      it 'forgets the least recently used one' do
+        expect(subject[Tox.hash(avatars.first)]).to eq nil
+      end
+
+      it 'keeps the most recently used ones in memory' do
+        expect(subject[Tox.hash(avatars.last)]).to eq avatars.last
+      end
+    end
+  end
+end
@@ -0,0 +1,145 @@
+# frozen_string_literal: true
+
+require 'support/bit_rate_control'
+
+RSpec.describe Tox.const_get(:BitRateControl) do
+  subject { described_class.new audio: 16..64, video: 200..5000 }
+
+  def congest(kind, time)
+    3.times { subject.failed kind }
+    subject.update time
+  end
+
+  describe '#initialize' do
+    context 'when limits are invalid' do
+      specify do
+        expect { described_class.new audio: 0..1 }.to \
+          raise_error ArgumentError, 'Invalid bit rates'
+      end
+    end
+  end
+
+  describe '#hold' do
+    context 'when kind is invalid' do
+      specify do
+        expect { subject.hold :foobar, 1 }.to \
+          raise_error ArgumentError, 'Invalid kind'
+      end
+    end
+
+    context 'when bit rate is invalid' do
+      specify do
+        expect { subject.hold :audio, -1 }.to \
+          raise_error ArgumentError, 'Invalid bit rate'
+      end
+    end
+  end
+
+  describe '#update' do
+    it 'starts at the maximums' do
+      expect(subject.update(0)).to eq audio: 64, video: 5000
+    end
+
+    it 'waits for the interval' do
+      subject.update 0
+      3.times { subject.failed :video }
+      expect(subject.update(0.5)).to eq({})
+    end
+
+    it 'ignores single failures' do
+      subject.update 0
+      2.times { subject.failed :video }
+      expect(subject.update(1)).to eq({})
+    end
+
+    it 'decreases video on video congestion' do
+      subject.update 0
+      expect(congest(:video, 1)).to eq video: 3750
+    end
+
+    it 'decreases both on audio congestion' do
+      subject.update 0
+      expect(congest(:audio, 1)).to eq audio: 48, video: 3750
+    end
+
+    it 'follows lower suggested bit rates' do
+      subject.update 0
+      subject.suggested :video, 1000
+      expect(subject.update(1)).to eq video: 1000
+    end
+
+    it 'does not go under the minimum' do
+      subject.update 0
+      (1..20).each { |time| congest :video, time }
+      expect(subject.stats[:video_bit_rate]).to eq 200
+    end
+
+    it 'increases after a quiet period' do
+      subject.update 0
+      congest :video, 1
+      expect((2..7).map { |time| subject.update time }).to eq [
+        {}, {}, {}, {}, { video: 4050 }, { video: 4350 },
+      ]
+    end
+
+    it 'decreases video when frames take too long to send' do
+      subject.update 0
+      (1..10).each { |index| subject.video_sent 0.035, index * 0.04 }
+      expect(subject.update(1)).to eq video: 3750
+      expect(subject.stats[:overloads]).to eq 1
+    end
+
+    it 'keeps video when frames are sent in time' do
+      subject.update 0
+      (1..10).each { |index| subject.video_sent 0.01, index * 0.04 }
+      expect(subject.update(1)).to eq({})
+    end
+
+    context 'when video has no limits' do
+      subject { described_class.new video: nil }
+
+      it 'leaves video alone' do
+        expect(subject.update(0)).to eq audio: 64
+      end
+    end
+
+    context 'when video is disabled' do
+      before { subject.hold :video, 0 }
+
+      it 'does not enable it' do
+        expect(subject.update(0)).to eq audio: 64
+        expect(congest(:audio, 1)).to eq audio: 48
+        expect(subject.stats[:video_bit_rate]).to eq 0
+      end
+    end
+
+    context 'when audio is set' do
+      before do
+        subject.update 0
+        subject.hold :audio, 32
+      end
+
+      it 'leaves it alone' do
+        expect(congest(:audio, 1)).to eq video: 3750
+        expect(subject.stats[:audio_bit_rate]).to eq 32
+      end
+    end
+  end
+
+  describe '#stats' do
+    it 'counts failures and changes' do
+      subject.update 0
+      congest :video, 1
+
+      expect(subject.stats).to eq(
+        audio_bit_rate: 64,
+        video_bit_rate: 3750,
+        failures: 3,
+        suggestions: 0,
+        overloads: 0,
+        decreases: 1,
+        increases: 0,
+      )
+    end
+  end
+end
@@ -0,0 +1,45 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::CallControl do
+  describe '::RESUME' do
+    specify do
+      expect(described_class::RESUME).to eq :resume
+    end
+  end
+
+  describe '::PAUSE' do
+    specify do
+      expect(described_class::PAUSE).to eq :pause
+    end
+  end
+
+  describe '::CANCEL' do
+    specify do
+      expect(described_class::CANCEL).to eq :cancel
+    end
+  end
+
+  describe '::MUTE_AUDIO' do
+    specify do
+      expect(described_class::MUTE_AUDIO).to eq :mute_audio
+    end
+  end
+
+  describe '::UNMUTE_AUDIO' do
+    specify do
+      expect(described_class::UNMUTE_AUDIO).to eq :unmute_audio
+    end
+  end
+
+  describe '::HIDE_VIDEO' do
+    specify do
+      expect(described_class::HIDE_VIDEO).to eq :hide_video
+    end
+  end
+
+  describe '::SHOW_VIDEO' do
+    specify do
+      expect(described_class::SHOW_VIDEO).to eq :show_video
+    end
+  end
+end
@@ -0,0 +1,150 @@
+# frozen_string_literal: true
+
+require 'support/call_stats'
+
+RSpec.describe Tox.const_get(:CallStats) do
+  subject { described_class.new 64, 1000 }
+
+  # Sends audio frames of 20 ms, one every 20 ms from the time on.
+  def send_audio(count, time)
+    count.times do |i|
+      sent = time + i * 0.02
+      subject.sent :audio, sent, sent, duration: 0.02
+    end
+  end
+
+  describe '#initialize' do
+    context 'when bit rate is invalid' do
+      specify do
+        expect { described_class.new(-1, 1000) }.to \
+          raise_error ArgumentError, 'Invalid bit rate'
+      end
+    end
+  end
+
+  describe '#sent' do
+    it 'counts sent frames and send times' do
+      subject.sent :audio, 1, 1.002, duration: 0.02
+      subject.sent :audio, 1.02, 1.026, duration: 0.02
+      subject.sent :video, 1, 1.01
+
+      stats = subject.stats 2
+      expect(stats[:duration]).to eq 2.0
+      expect(stats[:audio]).to include sent: 2, received: 0
+      expect(stats[:audio][:send_time]).to be_within(0.000001).of 0.008
+      expect(stats[:audio][:max_send_time]).to be_within(0.000001).of 0.006
+      expect(stats[:video]).to include sent: 1, received: 0
+    end
+
+    it 'counts errors apart from sent frames' do
+      subject.sent :audio, 1, 1.001, duration: 0.02, error: :rtp_failed
+      subject.sent :audio, 1, 1.001, duration: 0.02, error: :sync
+
+      stats = subject.stats(2)[:audio]
+      expect(stats[:sent]).to eq 0
+      expect(stats[:errors]).to include rtp_failed: 1, sync: 1, invalid: 0
+      expect(stats[:send_time]).to be_within(0.000001).of 0.002
+    end
+
+    context 'when kind is invalid' do
+      specify do
+        expect { subject.sent :foobar, 1, 1 }.to \
+          raise_error ArgumentError, 'Invalid kind'
+      end
+    end
+
+    context 'when error is invalid' do
+      specify do
+        expect { subject.sent :audio, 1, 1, error: :foobar }.to \
+          raise_error ArgumentError, 'Invalid error'
+      end
+    end
+  end
+
+  describe '#received' do
+    it 'counts received frames' do
+      3.times { |i| subject.received :audio, 1 + i * 0.02, duration: 0.02 }
+      subject.received :video, 1
+
+      stats = subject.stats 2
+      expect(stats[:audio]).to include sent: 0, received: 3
+      expect(stats[:video]).to include sent: 0, received: 1
+    end
+
+    it 'has no jitter for audio arriving in time' do
+      5.times { |i| subject.received :audio, 1 + i * 0.02, duration: 0.02 }
+      expect(subject.stats(2)[:audio][:jitter]).to eq 0.0
+    end
+
+    # J += (|D| - J) / 16 with D the interval less the frame duration.
+    it 'smooths audio jitter like RTP' do
+      subject.received :audio, 1,    duration: 0.02
+      subject.received :audio, 1.02, duration: 0.02
+      subject.received :audio, 1.05, duration: 0.02
+      expect(subject.stats(2)[:audio][:jitter]).to \
+        be_within(0.000001).of 0.000625
+
+      subject.received :audio, 1.07, duration: 0.02
+      expect(subject.stats(2)[:audio][:jitter]).to \
+        be_within(0.000001).of 0.000586
+    end
+
+    it 'measures video jitter against the mean interval' do
+      subject.received :video, 1
+      subject.received :video, 1.1
+      subject.received :video, 1.2
+      expect(subject.stats(2)[:video][:jitter]).to eq 0.0
+
+      subject.received :video, 1.35
+      expect(subject.stats(2)[:video][:jitter]).to \
+        be_within(0.000001).of 0.003125
+    end
+  end
+
+  describe '#stats' do
+    it 'has no estimated bit rate before the first window ends' do
+      send_audio 25, 0
+      expect(subject.stats(0.9)[:audio]).to include(
+        bit_rate:           64,
+        estimated_bit_rate: 0,
+      )
+    end
+
+    it 'scales the bit rate by the audio sent in the last window' do
+      send_audio 25, 0
+      expect(subject.stats(1)[:audio][:estimated_bit_rate]).to eq 32
+    end
+
+    it 'covers the whole window with any video frame' do
+      subject.sent :video, 0.5, 0.5
+      expect(subject.stats(1)[:video][:estimated_bit_rate]).to eq 1000
+    end
+
+    it 'rolls the window over with the first frame after it' do
+      send_audio 50, 0
+      send_audio 10, 1
+      expect(subject.stats(1.5)[:audio][:estimated_bit_rate]).to eq 64
+      expect(subject.stats(2)[:audio][:estimated_bit_rate]).to eq 12
+    end
+
+    it 'has no estimated bit rate after an empty window' do
+      send_audio 50, 0
+      expect(subject.stats(1)[:audio][:estimated_bit_rate]).to eq 64
+      expect(subject.stats(2)[:audio][:estimated_bit_rate]).to eq 0
+    end
+
+    it 'has no estimated bit rate when the last window ended long ago' do
+      send_audio 50, 0
+      expect(subject.stats(2.5)[:audio][:estimated_bit_rate]).to eq 0
+    end
+
+    it 'uses the changed bit rate' do
+      subject.change_bit_rate :audio, 32
+      send_audio 50, 0
+      expect(subject.stats(1)[:audio]).to include(
+        bit_rate:           32,
+        estimated_bit_rate: 32,
+      )
+    end
+  end
+end
@@ -55,6 +55,151 @@ RSpec.describe Tox::Client do
     end
   end
 
+  describe '#avatar_cache' do
+    specify do
+      expect(subject.avatar_cache).to eq nil
+    end
+  end
+
+  describe '#avatar_cache=' do
+    let(:avatar_cache) { Tox::AvatarCache.new Dir.mktmpdir }
+
+    after do
+      FileUtils.remove_entry avatar_cache.dir
+    end
+
+    specify do
+      subject.avatar_cache = avatar_cache
+      expect(subject.avatar_cache).to equal avatar_cache
+    end
+
+    it 'accepts nil' do
+      subject.avatar_cache = avatar_cache
+      subject.avatar_cache = nil
+      expect(subject.avatar_cache).to eq nil
+    end
+
+    context 'when invalid value given' do
+      specify do
+        expect { subject.avatar_cache = :foobar }.to raise_error TypeError
+      end
+    end
+  end
+
+  describe '#avatar' do
+    let(:avatar) { SecureRandom.random_bytes rand 1..65_536 }
+
+    specify do
+      expect(subject.avatar).to eq nil
+    end
+
+    context 'when it was set' do
+      before do
+        subject.avatar = avatar
+      end
+
+      specify do
+        expect(subject.avatar).to eq avatar
+      end
+
+      specify do
+        expect(subject.avatar_hash).to eq Tox.hash avatar
+      end
+    end
+
+    context 'when it was reset' do
+      before do
+        subject.avatar = avatar
+        subject.avatar = nil
+      end
+
+      specify do
+        expect(subject.avatar).to eq nil
+      end
+
+      specify do
+        expect(subject.avatar_hash).to eq nil
+      end
+    end
+  end
+
+  describe '#avatar=' do
+    context 'when invalid value given' do
+      specify do
+        expect { subject.avatar = :foobar }.to raise_error TypeError
+      end
+    end
+
+    context 'when avatar is empty' do
+      specify do
+        expect { subject.avatar = '' }.to raise_error ArgumentError
+      end
+    end
+
+    context 'when avatar is too large' do
+      specify do
+        expect { subject.avatar = "\x00" * 65_537 }.to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#file_io_backend' do
+    specify do
+      expect(subject.file_io_backend).to eq(Tox::FileIOBackend::PREAD)
+        .or eq(Tox::FileIOBackend::IO_URING)
+    end
+  end
+
+  describe '#file_io_backend=' do
+    it 'can select the fallback backend' do
+      subject.file_io_backend = Tox::FileIOBackend::PREAD
+      expect(subject.file_io_backend).to eq Tox::FileIOBackend::PREAD
+    end
+
+    context 'when invalid value given' do
+      specify do
+        expect { subject.file_io_backend = :foobar }.to raise_error(
+          ArgumentError,
+          "Invalid value from #{Tox::FileIOBackend}",
+        )
+      end
+    end
+  end
+
+  describe '#accept_compressed_files' do
+    specify do
+      expect(subject.accept_compressed_files).to eq false
+    end
+  end
+
+  describe '#accept_compressed_files=' do
+    it 'enables compression support' do
+      subject.accept_compressed_files = true
+      expect(subject.accept_compressed_files).to eq true
+      expect(subject.file_compression.enabled?).to eq true
+    end
+  end
+
+  describe '#file_trees' do
+    specify do
+      expect(subject.file_trees).to be_instance_of Tox::FileTrees
+    end
+
+    specify do
+      expect(subject.file_trees.client).to equal subject
+    end
+  end
+
+  describe '#file_syncs' do
+    specify do
+      expect(subject.file_syncs).to be_instance_of Tox::FileSyncs
+    end
+
+    specify do
+      expect(subject.file_syncs.client).to equal subject
+    end
+  end
+
   describe '#iteration_interval' do
     specify do
       expect(subject.iteration_interval).to be_instance_of Float
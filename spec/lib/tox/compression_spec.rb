@@ -0,0 +1,86 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::Compression do
+  let(:dir) { Dir.mktmpdir }
+
+  let(:source_path)     { File.join dir, 'source' }
+  let(:compressed_path) { File.join dir, 'compressed' }
+  let(:target_path)     { File.join dir, 'target' }
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  describe '::original_size' do
+    let :file_id do
+      described_class::MAGIC + [123_456].pack('Q>') +
+        "\x00" * (32 - described_class::MAGIC.bytesize - 8)
+    end
+
+    specify do
+      expect(described_class.original_size(file_id)).to eq 123_456
+    end
+
+    context 'when file id is not compressed' do
+      specify do
+        expect(described_class.original_size("\x00" * 32)).to eq nil
+      end
+    end
+  end
+
+  describe '::compress_file' do
+    let :data do
+      Array.new(rand(1000..2000)) { |i| "line #{i}: #{'foo' * (i % 10)}\n" }
+        .join
+    end
+
+    before do
+      File.binwrite source_path, data
+    end
+
+    it 'returns original size' do
+      expect(described_class.compress_file(source_path, compressed_path)).to \
+        eq data.bytesize
+    end
+
+    it 'compresses data' do
+      described_class.compress_file source_path, compressed_path
+      expect(File.size(compressed_path)).to be < data.bytesize / 2
+    end
+
+    it 'can be decompressed' do
+      described_class.compress_file source_path, compressed_path
+      described_class.decompress_file compressed_path, target_path
+      expect(File.binread(target_path)).to eq data
+    end
+
+    context 'when data is incompressible' do
+      let(:data) { SecureRandom.random_bytes rand(100_000..200_000) }
+
+      it 'can be decompressed' do
+        described_class.compress_file source_path, compressed_path
+        described_class.decompress_file compressed_path, target_path
+        expect(File.binread(target_path)).to eq data
+      end
+    end
+
+    context 'when file does not exist' do
+      specify do
+        expect do
+          described_class.compress_file File.join(dir, 'foo'), compressed_path
+        end.to raise_error Errno::ENOENT
+      end
+    end
+  end
+
+  describe '::decompress_file' do
+    context 'when stream is malformed' do
+      specify do
+        File.binwrite compressed_path, "\x00\x00\x00\x05hello"
+        expect do
+          described_class.decompress_file compressed_path, target_path
+        end.to raise_error ArgumentError
+      end
+    end
+  end
+end
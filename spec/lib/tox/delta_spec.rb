@@ -0,0 +1,187 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::Delta do
+  let(:dir) { Dir.mktmpdir }
+
+  let(:basis_path) { File.join dir, 'basis' }
+  let(:new_path)   { File.join dir, 'new' }
+  let(:delta_path) { File.join dir, 'delta' }
+  let(:out_path)   { File.join dir, 'out' }
+
+  let(:basis) { SecureRandom.random_bytes rand 100_000..200_000 }
+
+  let :changed do
+    result = basis.dup
+    result[rand(0...50_000), 10] = SecureRandom.random_bytes 20
+    result + SecureRandom.random_bytes(100)
+  end
+
+  let(:block_size) { described_class.block_size basis.bytesize }
+
+  before do
+    File.binwrite basis_path, basis
+    File.binwrite new_path, changed
+  end
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  describe '::block_size' do
+    specify do
+      expect(described_class.block_size(0)).to \
+        eq described_class::MIN_BLOCK_SIZE
+    end
+
+    specify do
+      expect(described_class.block_size(1 << 40)).to \
+        eq described_class::MAX_BLOCK_SIZE
+    end
+
+    specify do
+      expect(described_class.block_size(100_000_000)).to eq 10_240
+    end
+  end
+
+  describe '::signature' do
+    specify do
+      expect(described_class.signature(basis_path, block_size).bytesize).to \
+        eq 4 + basis.bytesize / block_size * (4 + described_class::STRONG_SIZE)
+    end
+
+    context 'when file does not exist' do
+      specify do
+        expect { described_class.signature File.join(dir, 'foo'), block_size }
+          .to raise_error Errno::ENOENT
+      end
+    end
+
+    context 'when block size is invalid' do
+      specify do
+        expect { described_class.signature basis_path, 0 }
+          .to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '::generate' do
+    let(:signature) { described_class.signature basis_path, block_size }
+
+    it 'sends only changed blocks' do
+      expect(described_class.generate(new_path, signature, delta_path)).to \
+        be < 4 * block_size
+    end
+
+    it 'returns delta size' do
+      expect(described_class.generate(new_path, signature, delta_path)).to \
+        eq File.size delta_path
+    end
+
+    context 'when signature is invalid' do
+      specify do
+        expect { described_class.generate new_path, 'foo', delta_path }
+          .to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '::patch' do
+    def patch
+      described_class.patch basis_path, delta_path, out_path, block_size
+    end
+
+    # Delta of a new file of the size with the instructions, which can not
+    # be checked by its digest before it has been applied.
+    def write_delta(size, *instructions, delta_block_size: block_size)
+      File.binwrite(
+        delta_path,
+        [delta_block_size, size].pack('NQ>') + "\0" * 32 + instructions.join,
+      )
+    end
+
+    def copy(index, count)
+      ['C', index, count].pack 'aNN'
+    end
+
+    def literal(data)
+      ['L', data.bytesize].pack('aN') + data
+    end
+
+    it 'reconstructs the new file' do
+      signature = described_class.signature basis_path, block_size
+      described_class.generate new_path, signature, delta_path
+      described_class.patch basis_path, delta_path, out_path, block_size
+      expect(File.binread(out_path)).to eq changed
+    end
+
+    it 'works without basis file' do
+      signature = described_class.empty_signature block_size
+      described_class.generate new_path, signature, delta_path
+      described_class.patch nil, delta_path, out_path, block_size
+      expect(File.binread(out_path)).to eq changed
+    end
+
+    it 'keeps permissions of basis file' do
+      File.chmod 0o750, basis_path
+      signature = described_class.signature basis_path, block_size
+      described_class.generate new_path, signature, delta_path
+      described_class.patch basis_path, delta_path, out_path, block_size
+      expect(File.stat(out_path).mode & 0o777).to eq 0o750
+    end
+
+    context 'when basis file has changed' do
+      specify do
+        signature = described_class.signature basis_path, block_size
+        described_class.generate new_path, signature, delta_path
+        File.binwrite basis_path, basis.reverse
+        expect { patch }.to raise_error described_class::CorruptError
+      end
+    end
+
+    context 'when delta is malformed' do
+      specify do
+        File.binwrite delta_path, 'foobar'
+        expect { patch }.to raise_error described_class::CorruptError
+      end
+    end
+
+    context 'when delta has another block size than the signature' do
+      specify do
+        write_delta block_size, copy(0, 1), delta_block_size: block_size * 2
+        expect { patch }.to raise_error described_class::CorruptError
+      end
+    end
+
+    context 'when delta copies past the basis file' do
+      it 'writes nothing' do
+        write_delta 2**63, copy(0, 2**32 - 1)
+        expect { patch }.to raise_error described_class::CorruptError
+        expect(File.size(out_path)).to eq 0
+      end
+    end
+
+    context 'when delta copies more than the size of the new file' do
+      it 'writes nothing' do
+        write_delta block_size - 1, copy(0, 1)
+        expect { patch }.to raise_error described_class::CorruptError
+        expect(File.size(out_path)).to eq 0
+      end
+    end
+
+    context 'when delta inserts more than the size of the new file' do
+      it 'stops before the literal' do
+        write_delta block_size + 1, copy(0, 1), literal('foo')
+        expect { patch }.to raise_error described_class::CorruptError
+        expect(File.size(out_path)).to eq block_size
+      end
+    end
+
+    context 'when block size is invalid' do
+      specify do
+        expect do
+          described_class.patch basis_path, delta_path, out_path, 0
+        end.to raise_error ArgumentError
+      end
+    end
+  end
+end
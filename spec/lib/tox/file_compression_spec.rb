@@ -0,0 +1,114 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::FileCompression do
+  subject { described_class.new client }
+
+  let(:client) { Tox::Client.new }
+
+  describe '#initialize' do
+    context 'when client has invalid type' do
+      specify do
+        expect { described_class.new :foobar }.to raise_error(
+          TypeError,
+          "Expected #{Tox::Client}, got #{:foobar.inspect}",
+        )
+      end
+    end
+  end
+
+  describe '#client' do
+    specify do
+      expect(subject.client).to equal client
+    end
+  end
+
+  describe '#enabled?' do
+    specify do
+      expect(subject.enabled?).to eq false
+    end
+  end
+
+  describe '#enabled=' do
+    specify do
+      subject.enabled = true
+      expect(subject.enabled?).to eq true
+    end
+  end
+
+  describe '#supported?' do
+    specify do
+      expect(subject.supported?(0)).to eq false
+    end
+  end
+
+  describe '#packet' do
+    context 'when packet is not an announcement' do
+      specify do
+        expect(subject.packet(0, "\x01foobar")).to eq false
+      end
+    end
+
+    context 'when announcement is received' do
+      before do
+        subject.packet 0, described_class.announcement_packet
+      end
+
+      it 'marks friend as supporting compression' do
+        expect(subject.supported?(0)).to eq true
+        expect(subject.supported?(1)).to eq false
+      end
+    end
+
+    context 'when announcement has other version' do
+      before do
+        subject.packet 0, [described_class::PACKET_ID, 2].pack('CC')
+      end
+
+      specify do
+        expect(subject.supported?(0)).to eq false
+      end
+    end
+
+    context 'when support is withdrawn' do
+      before do
+        subject.packet 0, described_class.announcement_packet
+        subject.packet 0, described_class.announcement_packet(
+          described_class::NONE,
+        )
+      end
+
+      it 'forgets support' do
+        expect(subject.supported?(0)).to eq false
+      end
+    end
+  end
+
+  describe '#friend_connection_status_change' do
+    before do
+      subject.packet 0, described_class.announcement_packet
+    end
+
+    context 'when friend goes offline' do
+      it 'forgets support' do
+        subject.friend_connection_status_change 0, Tox::ConnectionStatus::NONE
+        expect(subject.supported?(0)).to eq false
+      end
+    end
+
+    context 'when friend connects' do
+      it 'keeps support' do
+        subject.friend_connection_status_change 0, Tox::ConnectionStatus::UDP
+        expect(subject.supported?(0)).to eq true
+      end
+    end
+  end
+
+  describe '::announcement_packet' do
+    specify do
+      expect(described_class.announcement_packet.bytes).to eq [
+        described_class::PACKET_ID,
+        described_class::VERSION,
+      ]
+    end
+  end
+end
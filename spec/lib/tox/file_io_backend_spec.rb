@@ -0,0 +1,15 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::FileIOBackend do
+  describe '::PREAD' do
+    specify do
+      expect(described_class::PREAD).to eq :pread
+    end
+  end
+
+  describe '::IO_URING' do
+    specify do
+      expect(described_class::IO_URING).to eq :io_uring
+    end
+  end
+end
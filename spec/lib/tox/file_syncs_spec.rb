@@ -0,0 +1,106 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::FileSyncs do
+  subject { described_class.new client }
+
+  let(:client) { Tox::Client.new }
+
+  let(:id) { SecureRandom.random_bytes described_class::ID_SIZE }
+
+  describe '#initialize' do
+    context 'when client has invalid type' do
+      specify do
+        expect { described_class.new :foobar }.to raise_error(
+          TypeError,
+          "Expected #{Tox::Client}, got #{:foobar.inspect}",
+        )
+      end
+    end
+  end
+
+  describe '#client' do
+    specify do
+      expect(subject.client).to equal client
+    end
+  end
+
+  describe '#packet' do
+    context 'when packet is not a sync packet' do
+      specify do
+        expect(subject.packet(0, "\x01foobar")).to eq false
+      end
+    end
+
+    context 'when offer is received' do
+      it 'passes it to the callback' do
+        offers = []
+        subject.on_recv_request { |sync| offers << sync }
+
+        subject.packet 0, described_class.offer_packet(id, 123, 'foo.txt')
+
+        expect(offers.size).to eq 1
+        expect(offers.first.id).to eq id
+        expect(offers.first.size).to eq 123
+        expect(offers.first.filename).to eq 'foo.txt'
+      end
+    end
+
+    context 'when acknowledgement is received' do
+      let(:dir) { Dir.mktmpdir }
+      let(:path) { File.join dir, 'foo.txt' }
+
+      let(:friend) { Tox::Friend.new client, 0 }
+
+      let(:finished) { [] }
+
+      let :sync do
+        subject.send_file(friend, path, 'foo.txt') { |s| finished << s }
+      end
+
+      before do
+        File.binwrite path, 'foo'
+      end
+
+      after do
+        FileUtils.remove_entry dir
+      end
+
+      it 'does not finish the sync before delta has been sent' do
+        subject.packet 0, described_class.ack_packet(sync.id)
+        expect(finished).to eq []
+      end
+    end
+  end
+
+  describe '::file_id' do
+    specify do
+      expect(described_class.file_id(id, described_class::DELTA)).to eq(
+        id + "\x02" + "\x00" * 23,
+      )
+    end
+  end
+
+  describe '::offer_packet' do
+    specify do
+      expect(described_class.offer_packet(id, 258, 'foo').bytesize).to eq(
+        described_class::OFFER_SIZE + 3,
+      )
+    end
+  end
+
+  describe '::reject_packet' do
+    specify do
+      expect(described_class.reject_packet(id)).to eq(
+        [described_class::PACKET_ID, described_class::REJECT].pack('CC') + id,
+      )
+    end
+  end
+
+  describe '::ack_packet' do
+    specify do
+      expect(described_class.ack_packet(id)).to eq(
+        [described_class::PACKET_ID, described_class::ACK].pack('CC') + id,
+      )
+    end
+  end
+end
@@ -0,0 +1,165 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::FileTrees do
+  subject { described_class.new client }
+
+  let(:client) { Tox::Client.new }
+
+  let(:id) { SecureRandom.random_bytes described_class::ID_SIZE }
+
+  describe '#initialize' do
+    context 'when client has invalid type' do
+      specify do
+        expect { described_class.new :foobar }.to raise_error(
+          TypeError,
+          "Expected #{Tox::Client}, got #{:foobar.inspect}",
+        )
+      end
+    end
+  end
+
+  describe '#client' do
+    specify do
+      expect(subject.client).to equal client
+    end
+  end
+
+  describe '#packet' do
+    context 'when packet is not a manifest' do
+      specify do
+        expect(subject.packet(0, "\x01foobar")).to eq false
+      end
+    end
+
+    context 'when friend sends more trees than allowed' do
+      let(:requests) { [] }
+
+      let(:packets) do
+        Array.new(described_class::MAX_IN_TREES + 1) do
+          id = SecureRandom.random_bytes described_class::ID_SIZE
+          described_class.manifest_packets(id, [['foo', 1]]).first
+        end
+      end
+
+      it 'ignores trees over the limit' do
+        subject.on_recv_request { |tree| requests << tree }
+        packets.each { |packet| subject.packet 0, packet }
+        expect(requests.size).to eq described_class::MAX_IN_TREES
+      end
+
+      it 'does not count rejected trees' do
+        subject.on_recv_request { |tree| requests << tree.reject }
+        packets.each { |packet| subject.packet 0, packet }
+        expect(requests.size).to eq packets.size
+      end
+
+      it 'counts trees of every friend separately' do
+        subject.on_recv_request { |tree| requests << tree }
+        packets.each_with_index { |packet, i| subject.packet i % 2, packet }
+        expect(requests.size).to eq packets.size
+      end
+    end
+  end
+
+  describe '::file_id' do
+    specify do
+      expect(described_class.file_id(id, 258)).to eq(
+        id + "\x00\x00\x01\x02" + "\x00" * 20,
+      )
+    end
+  end
+
+  describe '::manifest_packets' do
+    let(:entries) do
+      Array.new(rand(200..300)) do |i|
+        ["dir#{i % 7}/file#{i}", rand(0..(1 << 40))]
+      end
+    end
+
+    let(:packets) { described_class.manifest_packets id, entries }
+
+    it 'splits manifest into lossless packets' do
+      expect(packets.size).to be > 1
+      expect(packets.map(&:bytesize).max).to eq described_class::MAX_PACKET_SIZE
+    end
+
+    it 'can be parsed back' do
+      data = packets.map do |packet|
+        packet.byteslice described_class::HEADER_SIZE..-1
+      end.join
+
+      expect(described_class.parse_manifest(data)).to eq entries
+    end
+
+    context 'when there are no entries' do
+      specify do
+        expect(described_class.manifest_packets(id, []).size).to eq 1
+      end
+    end
+
+    context 'when there are too many entries' do
+      let(:entries) do
+        Array.new(described_class::MAX_ENTRIES + 1) { |i| ["file#{i}", i] }
+      end
+
+      specify do
+        expect { packets }.to raise_error ArgumentError, 'Manifest is too large'
+      end
+    end
+  end
+
+  describe '::parse_manifest' do
+    context 'when manifest is truncated' do
+      specify do
+        data = [123, 10].pack(described_class::ENTRY_FORMAT) + 'foo'
+        expect(described_class.parse_manifest(data)).to eq nil
+      end
+    end
+
+    context 'when manifest has too many entries' do
+      specify do
+        entry = [1, 3].pack(described_class::ENTRY_FORMAT) + 'foo'
+        data = entry * (described_class::MAX_ENTRIES + 1)
+        expect(described_class.parse_manifest(data)).to eq nil
+      end
+    end
+
+    context 'when manifest is too large' do
+      specify do
+        path = 'f' * 1000
+        entry = [1, path.bytesize].pack(described_class::ENTRY_FORMAT) + path
+        data = entry * (described_class::MAX_MANIFEST_SIZE / entry.bytesize + 1)
+        expect(described_class.parse_manifest(data)).to eq nil
+      end
+    end
+
+    context 'when path escapes directory' do
+      specify do
+        data = [123, 6].pack(described_class::ENTRY_FORMAT) + '../foo'
+        expect(described_class.parse_manifest(data)).to eq nil
+      end
+    end
+  end
+
+  describe '::valid_path?' do
+    specify do
+      expect(described_class.valid_path?('foo/bar.txt')).to eq true
+    end
+
+    specify do
+      expect(described_class.valid_path?('')).to eq false
+    end
+
+    specify do
+      expect(described_class.valid_path?('/etc/passwd')).to eq false
+    end
+
+    specify do
+      expect(described_class.valid_path?('foo/../../bar')).to eq false
+    end
+
+    specify do
+      expect(described_class.valid_path?('foo//bar')).to eq false
+    end
+  end
+end
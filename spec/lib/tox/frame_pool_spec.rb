@@ -0,0 +1,114 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::FramePool do
+  subject { described_class.new audio_video, max_frames }
+
+  let(:audio_video) { Tox::AudioVideo.new client }
+  let(:client) { Tox::Client.new }
+  let(:max_frames) { 2 }
+
+  describe '#initialize' do
+    context 'when audio/video has invalid type' do
+      let(:audio_video) { :foobar }
+
+      specify do
+        expect { subject }.to raise_error(
+          TypeError,
+          "Expected #{Tox::AudioVideo}, got #{audio_video.class}",
+        )
+      end
+    end
+
+    context 'when max frames is not positive' do
+      let(:max_frames) { 0 }
+
+      specify do
+        expect { subject }.to raise_error(
+          RuntimeError,
+          'Expected max frames to be positive',
+        )
+      end
+    end
+  end
+
+  describe '#size' do
+    specify do
+      expect(subject.size).to eq 0
+    end
+  end
+
+  describe '#friend_call' do
+    specify do
+      expect(subject.friend_call(1)).to \
+        eq Tox::FriendCall.new audio_video, 1
+    end
+
+    specify do
+      expect(subject.friend_call(1)).to equal subject.friend_call(1)
+    end
+  end
+
+  describe '#audio_frame' do
+    specify do
+      expect(subject.audio_frame).to be_instance_of Tox::AudioFrame
+    end
+
+    specify do
+      expect(subject.audio_frame.pool).to equal subject
+    end
+
+    specify do
+      frame = subject.audio_frame
+      subject.recycle frame
+      expect(subject.audio_frame).to equal frame
+    end
+  end
+
+  describe '#video_frame' do
+    specify do
+      expect(subject.video_frame).to be_instance_of Tox::VideoFrame
+    end
+
+    specify do
+      frame = subject.video_frame
+      subject.recycle frame
+      expect(subject.video_frame).to equal frame
+    end
+  end
+
+  describe '#recycle' do
+    let!(:frame) { subject.audio_frame }
+
+    specify do
+      subject.recycle frame
+      expect(subject.size).to eq 1
+      expect(frame.pool).to eq nil
+    end
+
+    context 'when frame was retained' do
+      before do
+        frame.retain
+      end
+
+      specify do
+        subject.recycle frame
+        expect(subject.size).to eq 0
+        expect(frame.pool).to equal subject
+      end
+
+      specify do
+        subject.recycle frame
+        frame.release
+        expect(subject.size).to eq 1
+      end
+    end
+
+    context 'when pool is full' do
+      specify do
+        frames = Array.new(max_frames + 1) { subject.audio_frame }
+        frames.each { |f| subject.recycle f }
+        expect(subject.size).to eq max_frames
+      end
+    end
+  end
+end
@@ -64,6 +64,531 @@ RSpec.describe Tox::FriendCall do
     end
   end
 
+  describe '#control' do
+    context 'when call control is invalid' do
+      specify do
+        expect { subject.control :foobar }.to raise_error ArgumentError
+      end
+    end
+
+    context 'when friend is not in call' do
+      specify do
+        expect { subject.control Tox::CallControl::MUTE_AUDIO }.to \
+          raise_error RuntimeError
+        expect(subject.audio_muted?).to eq false
+      end
+    end
+  end
+
+  describe '#paused?' do
+    specify do
+      expect(subject.paused?).to eq false
+    end
+  end
+
+  describe '#audio_muted?' do
+    specify do
+      expect(subject.audio_muted?).to eq false
+    end
+  end
+
+  describe '#video_hidden?' do
+    specify do
+      expect(subject.video_hidden?).to eq false
+    end
+  end
+
+  describe '#stream_file' do
+    let(:path) { File.expand_path('../../../multimedia/opus.ogg', __dir__) }
+
+    specify do
+      expect(subject.stream_file(path)).to eq nil
+    end
+
+    specify do
+      subject.stream_file path
+      expect(subject).to be_streaming
+    end
+
+    context 'when file does not exist' do
+      let(:path) { File.join Dir.tmpdir, SecureRandom.hex }
+
+      specify do
+        expect { subject.stream_file path }.to raise_error Errno::ENOENT
+      end
+    end
+
+    context 'when file is not an Ogg Opus file' do
+      let(:path) { __FILE__ }
+
+      specify do
+        expect { subject.stream_file path }.to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#streaming?' do
+    specify do
+      expect(subject).not_to be_streaming
+    end
+  end
+
+  describe '#stop_stream' do
+    let(:path) { File.expand_path('../../../multimedia/opus.ogg', __dir__) }
+
+    specify do
+      expect(subject.stop_stream).to eq false
+    end
+
+    specify do
+      subject.stream_file path
+      expect(subject.stop_stream).to eq true
+      expect(subject).not_to be_streaming
+    end
+  end
+
+  describe '#enable_jitter_buffer' do
+    specify do
+      expect(subject.enable_jitter_buffer).to eq nil
+    end
+
+    specify do
+      subject.enable_jitter_buffer latency: 0.1
+      expect(subject.jitter_buffer_stats[:latency]).to be_within(0.001).of 0.1
+    end
+
+    context 'when latency is invalid' do
+      specify do
+        expect { subject.enable_jitter_buffer latency: 0.01 }.to \
+          raise_error ArgumentError, 'Invalid latency'
+      end
+    end
+  end
+
+  describe '#jitter_buffer_stats' do
+    specify do
+      expect(subject.jitter_buffer_stats).to eq nil
+    end
+
+    context 'when jitter buffer is enabled' do
+      before do
+        subject.enable_jitter_buffer
+      end
+
+      specify do
+        expect(subject.jitter_buffer_stats).to include(
+          buffered:  0.0,
+          jitter:    0.0,
+          received:  0,
+          played:    0,
+          concealed: 0,
+          underruns: 0,
+          dropped:   0,
+        )
+      end
+    end
+  end
+
+  describe '#disable_jitter_buffer' do
+    specify do
+      expect(subject.disable_jitter_buffer).to eq false
+    end
+
+    specify do
+      subject.enable_jitter_buffer
+      expect(subject.disable_jitter_buffer).to eq true
+      expect(subject.jitter_buffer_stats).to eq nil
+    end
+  end
+
+  describe '#audio_bit_rate=' do
+    context 'when friend is not in call' do
+      specify do
+        expect { subject.audio_bit_rate = 32 }.to raise_error RuntimeError
+      end
+    end
+  end
+
+  describe '#video_bit_rate=' do
+    context 'when friend is not in call' do
+      specify do
+        expect { subject.video_bit_rate = 1000 }.to raise_error RuntimeError
+      end
+    end
+  end
+
+  describe '#enable_bit_rate_control' do
+    specify do
+      expect(subject.enable_bit_rate_control).to eq nil
+    end
+
+    specify do
+      subject.enable_bit_rate_control audio: 8...48, video: nil
+      expect(subject.bit_rate_control_stats).to include(
+        audio_bit_rate: 47,
+        video_bit_rate: 0,
+      )
+    end
+
+    context 'when bit rates are invalid' do
+      specify do
+        expect { subject.enable_bit_rate_control audio: 0..64 }.to \
+          raise_error ArgumentError, 'Invalid bit rates'
+      end
+
+      specify do
+        expect { subject.enable_bit_rate_control video: 500..100 }.to \
+          raise_error ArgumentError, 'Invalid bit rates'
+      end
+
+      specify do
+        expect { subject.enable_bit_rate_control audio: 64 }.to \
+          raise_error TypeError
+      end
+    end
+  end
+
+  describe '#bit_rate_control_stats' do
+    specify do
+      expect(subject.bit_rate_control_stats).to eq nil
+    end
+
+    context 'when bit rate control is enabled' do
+      before do
+        subject.enable_bit_rate_control
+      end
+
+      specify do
+        expect(subject.bit_rate_control_stats).to include(
+          audio_bit_rate: described_class::DEFAULT_AUDIO_BIT_RATES.max,
+          video_bit_rate: described_class::DEFAULT_VIDEO_BIT_RATES.max,
+          failures:       0,
+          suggestions:    0,
+          overloads:      0,
+          decreases:      0,
+          increases:      0,
+        )
+      end
+    end
+  end
+
+  describe '#disable_bit_rate_control' do
+    specify do
+      expect(subject.disable_bit_rate_control).to eq false
+    end
+
+    specify do
+      subject.enable_bit_rate_control
+      expect(subject.disable_bit_rate_control).to eq true
+      expect(subject.bit_rate_control_stats).to eq nil
+    end
+  end
+
+  describe '#record_to' do
+    let(:path) { File.join Dir.tmpdir, "#{SecureRandom.hex}.opus" }
+
+    after do
+      FileUtils.rm_f path
+    end
+
+    specify do
+      expect(subject.record_to(path)).to eq nil
+    end
+
+    specify do
+      subject.record_to path, bit_rate: 16
+      expect(subject.recording_stats).to include(received: 0, error: nil)
+      expect(File).to exist path
+    end
+
+    context 'when directory does not exist' do
+      let(:path) { File.join Dir.tmpdir, SecureRandom.hex, 'call.opus' }
+
+      specify do
+        expect { subject.record_to path }.to raise_error Errno::ENOENT
+      end
+    end
+
+    context 'when bit rate is invalid' do
+      specify do
+        expect { subject.record_to path, bit_rate: 1000 }.to \
+          raise_error ArgumentError, 'Invalid bit rate'
+      end
+    end
+  end
+
+  describe '#recording_stats' do
+    specify do
+      expect(subject.recording_stats).to eq nil
+    end
+  end
+
+  describe '#stop_recording' do
+    let(:path) { File.join Dir.tmpdir, "#{SecureRandom.hex}.opus" }
+
+    after do
+      FileUtils.rm_f path
+    end
+
+    specify do
+      expect(subject.stop_recording).to eq false
+    end
+
+    specify do
+      subject.record_to path
+      expect(subject.stop_recording).to eq true
+      expect(subject.recording_stats).to eq nil
+    end
+  end
+
+  describe '#enable_voice_gate' do
+    specify do
+      expect(subject.enable_voice_gate).to eq nil
+    end
+
+    context 'when threshold is invalid' do
+      specify do
+        expect { subject.enable_voice_gate threshold: 10 }.to \
+          raise_error ArgumentError, 'Invalid threshold'
+      end
+    end
+
+    context 'when hangover is invalid' do
+      specify do
+        expect { subject.enable_voice_gate hangover: -1 }.to \
+          raise_error ArgumentError, 'Invalid hangover'
+      end
+    end
+
+    context 'when frames are silent' do
+      let :audio_frame do
+        Tox::AudioFrame.new.tap do |frame|
+          frame.pcm           = ([0] * 1920).pack 's*'
+          frame.sample_count  = 960
+          frame.channels      = 2
+          frame.sampling_rate = 48_000
+        end
+      end
+
+      before do
+        subject.enable_voice_gate hangover: 0
+      end
+
+      it 'does not send them' do
+        expect(subject.send_audio_frame(audio_frame)).to eq false
+        expect(subject.voice_gate_stats).to \
+          eq passed: 0, suppressed: 1, open: false
+      end
+    end
+
+    context 'when frames are loud' do
+      let :audio_frame do
+        Tox::AudioFrame.new.tap do |frame|
+          frame.pcm           = ([8000, -8000] * 960).pack 's*'
+          frame.sample_count  = 960
+          frame.channels      = 2
+          frame.sampling_rate = 48_000
+        end
+      end
+
+      before do
+        subject.enable_voice_gate hangover: 0
+      end
+
+      it 'passes them to toxav, which has no call' do
+        expect { subject.send_audio_frame audio_frame }.to \
+          raise_error RuntimeError
+        expect(subject.voice_gate_stats).to \
+          eq passed: 1, suppressed: 0, open: true
+      end
+    end
+
+    context 'when silence follows sound' do
+      let :loud_frame do
+        Tox::AudioFrame.new.tap do |frame|
+          frame.pcm           = ([8000, -8000] * 960).pack 's*'
+          frame.sample_count  = 960
+          frame.channels      = 2
+          frame.sampling_rate = 48_000
+        end
+      end
+
+      let :silent_frame do
+        Tox::AudioFrame.new.tap do |frame|
+          frame.pcm           = ([0] * 1920).pack 's*'
+          frame.sample_count  = 960
+          frame.channels      = 2
+          frame.sampling_rate = 48_000
+        end
+      end
+
+      before do
+        subject.enable_voice_gate hangover: 0.05
+      end
+
+      # Frames which pass the gate fail in toxav, there is no call.
+      def send_frame(frame)
+        subject.send_audio_frame frame
+      rescue RuntimeError
+        true
+      end
+
+      it 'sends the frames of the hangover' do
+        sent = [loud_frame, *([silent_frame] * 4)].map { |f| send_frame f }
+        expect(sent).to eq [true, true, true, true, false]
+        expect(subject.voice_gate_stats).to \
+          eq passed: 4, suppressed: 1, open: false
+      end
+
+      it 'opens again on sound' do
+        [loud_frame, *([silent_frame] * 4)].each { |f| send_frame f }
+        expect(send_frame(loud_frame)).to eq true
+        expect(subject.voice_gate_stats).to \
+          eq passed: 5, suppressed: 1, open: true
+      end
+    end
+  end
+
+  describe '#voice_gate_stats' do
+    specify do
+      expect(subject.voice_gate_stats).to eq nil
+    end
+  end
+
+  describe '#disable_voice_gate' do
+    specify do
+      expect(subject.disable_voice_gate).to eq false
+    end
+
+    specify do
+      subject.enable_voice_gate
+      expect(subject.disable_voice_gate).to eq true
+      expect(subject.voice_gate_stats).to eq nil
+    end
+  end
+
+  describe '#audio_level_stats' do
+    specify do
+      expect(subject.audio_level_stats).to eq nil
+    end
+  end
+
+  describe '#add_relay_sink' do
+    let(:sink) { described_class.new audio_video, rand(20..30) }
+
+    context 'when friend is not in call' do
+      specify do
+        expect { subject.add_relay_sink sink }.to \
+          raise_error RuntimeError, 'friend is not in call'
+        expect(subject.relay_stats).to eq nil
+      end
+    end
+
+    it 'raises when sink is the source' do
+      expect { subject.add_relay_sink subject }.to raise_error ArgumentError
+    end
+
+    context 'when sink is in other audio/video' do
+      let(:sink) { described_class.new Tox::AudioVideo.new(client), 20 }
+
+      specify do
+        expect { subject.add_relay_sink sink }.to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#remove_relay_sink' do
+    let(:sink) { described_class.new audio_video, rand(20..30) }
+
+    it 'returns false when there is no relay' do
+      expect(subject.remove_relay_sink(sink)).to eq false
+    end
+  end
+
+  describe '#relay_sinks' do
+    specify do
+      expect(subject.relay_sinks).to eq []
+    end
+  end
+
+  describe '#relay_stats' do
+    specify do
+      expect(subject.relay_stats).to eq nil
+    end
+  end
+
+  describe '#stop_relay' do
+    it 'returns false when there is no relay' do
+      expect(subject.stop_relay).to eq false
+    end
+  end
+
+  describe '#enable_video_queue' do
+    specify do
+      expect(subject.enable_video_queue).to eq nil
+    end
+
+    specify do
+      subject.enable_video_queue frame_rate: 15, depth: 4
+      expect(subject.video_queue_stats).to include(
+        frame_rate: 15,
+        max_depth:  4,
+        depth:      0,
+        queued:     0,
+        sent:       0,
+        failed:     0,
+        dropped:    0,
+      )
+    end
+
+    context 'when frame rate is invalid' do
+      specify do
+        expect { subject.enable_video_queue frame_rate: 0 }.to \
+          raise_error ArgumentError, 'Invalid frame rate'
+      end
+    end
+
+    context 'when depth is invalid' do
+      specify do
+        expect { subject.enable_video_queue depth: 17 }.to \
+          raise_error ArgumentError, 'Invalid depth'
+      end
+    end
+  end
+
+  describe '#queue_video_frame' do
+    let(:video_frame) { Tox::VideoFrame.from_rgb "\x80".b * 4 * 2 * 3, 4, 2 }
+
+    it 'raises when video queue is not enabled' do
+      expect { subject.queue_video_frame video_frame }.to \
+        raise_error RuntimeError, 'video queue is not enabled'
+    end
+  end
+
+  describe '#video_queue_stats' do
+    specify do
+      expect(subject.video_queue_stats).to eq nil
+    end
+  end
+
+  describe '#disable_video_queue' do
+    specify do
+      expect(subject.disable_video_queue).to eq false
+    end
+
+    specify do
+      subject.enable_video_queue
+      expect(subject.disable_video_queue).to eq true
+      expect(subject.video_queue_stats).to eq nil
+    end
+  end
+
+  describe '#stats' do
+    it 'returns nil when there was no call' do
+      expect(subject.stats).to eq nil
+    end
+  end
+
   describe '#==' do
     let(:same_friend) { described_class.new audio_video, friend_number }
     let(:with_other_av) { described_class.new other_audio_video, friend_number }
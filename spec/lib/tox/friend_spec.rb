@@ -62,6 +62,70 @@ RSpec.describe Tox::Friend do
     end
   end
 
+  describe '#call' do
+    context 'when friend does not exist' do
+      specify do
+        expect { subject.call audio_bit_rate: 48 }.to raise_error(
+          Tox::Friend::NotFoundError,
+          'toxav_call() failed with TOXAV_ERR_CALL_FRIEND_NOT_FOUND',
+        )
+      end
+    end
+  end
+
+  describe '#send_local_file' do
+    context 'when file does not exist' do
+      specify do
+        path = File.join(Dir.tmpdir, SecureRandom.hex)
+        expect { subject.send_local_file path }.to raise_error Errno::ENOENT
+      end
+    end
+
+    context 'when path is a directory' do
+      specify do
+        expect { subject.send_local_file Dir.tmpdir }
+          .to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#send_local_file with compression' do
+    context 'when file does not exist' do
+      specify do
+        path = File.join Dir.tmpdir, SecureRandom.hex
+        expect { subject.send_local_file path, compress: true }
+          .to raise_error Errno::ENOENT
+      end
+    end
+
+    context 'when file id is given' do
+      specify do
+        expect do
+          subject.send_local_file __FILE__, compress: true,
+                                            file_id: "\x00" * 32
+        end.to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#send_tree' do
+    context 'when directory does not exist' do
+      specify do
+        expect { subject.send_tree File.join(Dir.tmpdir, SecureRandom.hex) }
+          .to raise_error Errno::ENOTDIR
+      end
+    end
+  end
+
+  describe '#sync_file' do
+    context 'when file does not exist' do
+      specify do
+        expect { subject.sync_file File.join(Dir.tmpdir, SecureRandom.hex) }
+          .to raise_error ArgumentError
+      end
+    end
+  end
+
   describe '#==' do
     let(:same_friend) { described_class.new client, friend_number }
     let(:with_other_client) { described_class.new other_client, friend_number }
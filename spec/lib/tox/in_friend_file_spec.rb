@@ -76,6 +76,54 @@ RSpec.describe Tox::InFriendFile do
     end
   end
 
+  describe '#digest' do
+    specify do
+      expect(subject.digest).to eq nil
+    end
+
+    context 'when digest was enabled' do
+      before do
+        subject.enable_digest
+      end
+
+      it 'returns nil until the transfer is finished' do
+        expect(subject.digest).to eq nil
+      end
+    end
+  end
+
+  describe '#enable_digest' do
+    specify do
+      expect(subject.enable_digest).to equal subject
+    end
+
+    it 'can be called more than once' do
+      subject.enable_digest
+      expect { subject.enable_digest }.not_to raise_error
+    end
+  end
+
+  describe '#receive_to' do
+    let(:dir) { Dir.mktmpdir }
+
+    after do
+      FileUtils.remove_entry dir
+    end
+
+    it 'creates the file' do
+      path = File.join(dir, 'file')
+      expect(subject.receive_to(path)).to equal subject
+      expect(File.file?(path)).to eq true
+    end
+
+    context 'when directory does not exist' do
+      specify do
+        expect { subject.receive_to File.join(dir, 'foo', 'bar') }.to \
+          raise_error Errno::ENOENT
+      end
+    end
+  end
+
   describe '#==' do
     let(:same) { described_class.new friend, file_number }
     let(:with_other_friend) { described_class.new other_friend, file_number }
@@ -0,0 +1,57 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::InFriendSync do
+  subject { described_class.new friend, id, 123, 'foo.txt' }
+
+  let(:client) { Tox::Client.new }
+  let(:friend) { Tox::Friend.new client, 0 }
+
+  let(:id) { SecureRandom.random_bytes Tox::FileSyncs::ID_SIZE }
+
+  let(:dir) { Dir.mktmpdir }
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  describe '#initialize' do
+    context 'when friend has invalid type' do
+      specify do
+        expect { described_class.new :foobar, id, 123, 'foo.txt' }
+          .to raise_error(
+            TypeError,
+            "Expected #{Tox::Friend}, got #{:foobar.inspect}",
+          )
+      end
+    end
+  end
+
+  describe '#accept' do
+    it 'sets the path' do
+      subject.accept File.join(dir, 'foo.txt')
+      expect(subject.path).to eq File.join(dir, 'foo.txt')
+    end
+
+    context 'when sync has been rejected' do
+      specify do
+        subject.reject
+        expect { subject.accept File.join(dir, 'foo.txt') }
+          .to raise_error RuntimeError
+      end
+    end
+  end
+
+  describe '#fail!' do
+    it 'finishes the sync once' do
+      finished = []
+      subject.accept(File.join(dir, 'foo.txt')) { |s| finished << s }
+
+      subject.fail!
+      subject.fail!
+
+      expect(subject.done?).to eq true
+      expect(subject.success?).to eq false
+      expect(finished).to eq [subject]
+    end
+  end
+end
@@ -0,0 +1,106 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::InFriendTree do
+  subject { described_class.new friend, id }
+
+  let(:client) { Tox::Client.new }
+  let(:friend) { Tox::Friend.new client, 0 }
+
+  let(:id) { SecureRandom.random_bytes Tox::FileTrees::ID_SIZE }
+
+  let(:entries) { [['foo/bar.txt', 123], ['baz.txt', 456]] }
+
+  let(:packets) { Tox::FileTrees.manifest_packets id, entries }
+
+  def receive(packets)
+    packets.each do |packet|
+      _, _, seq, = packet.unpack Tox::FileTrees::HEADER_FORMAT
+      subject.receive_manifest seq,
+                               packet.byteslice(Tox::FileTrees::HEADER_SIZE..-1)
+    end
+    subject.finish_manifest
+  end
+
+  describe '#initialize' do
+    context 'when friend has invalid type' do
+      specify do
+        expect { described_class.new :foobar, id }.to raise_error(
+          TypeError,
+          "Expected #{Tox::Friend}, got #{:foobar.inspect}",
+        )
+      end
+    end
+  end
+
+  describe '#entries' do
+    specify do
+      receive packets
+      expect(subject.entries).to eq entries
+    end
+
+    context 'when packets are out of order' do
+      let(:entries) do
+        Array.new(300) { |i| ["file#{i}", i] }
+      end
+
+      specify do
+        receive packets.reverse
+        expect(subject.entries).to eq nil
+      end
+    end
+
+    context 'when manifest is larger than allowed' do
+      specify do
+        packet = packets.first
+        (Tox::FileTrees::MAX_MANIFEST_SIZE / packet.bytesize + 1).times do |seq|
+          subject.receive_manifest seq, packet
+        end
+        subject.finish_manifest
+        expect(subject.entries).to eq nil
+      end
+    end
+  end
+
+  describe '#size' do
+    specify do
+      receive packets
+      expect(subject.size).to eq 2
+    end
+  end
+
+  describe '#bytesize' do
+    specify do
+      receive packets
+      expect(subject.bytesize).to eq 579
+    end
+  end
+
+  describe '#accept' do
+    let(:dir) { File.join Dir.tmpdir, SecureRandom.hex }
+
+    after do
+      FileUtils.remove_entry dir if File.exist? dir
+    end
+
+    it 'creates the directory' do
+      receive packets
+      subject.accept dir
+      expect(File.directory?(dir)).to eq true
+    end
+
+    context 'when manifest has not been received' do
+      specify do
+        expect { subject.accept dir }.to raise_error RuntimeError
+      end
+    end
+  end
+
+  describe '#fail!' do
+    it 'fails the rest of files' do
+      receive packets
+      subject.fail!
+      expect(subject.done?).to eq true
+      expect(subject.failed_count).to eq 2
+    end
+  end
+end
@@ -0,0 +1,151 @@
+# frozen_string_literal: true
+
+require 'support/jitter_buffer'
+
+RSpec.describe Tox.const_get(:JitterBuffer) do
+  subject { described_class.new latency: 0.06 }
+
+  let(:frame_duration) { 0.02 }
+
+  # Frames of 20 ms whose samples are all their sequence number plus 1000,
+  # so concealed frames (faded copies) stand out.
+  def audio_frame(sequence)
+    Tox::AudioFrame.new.tap do |frame|
+      frame.pcm           = ([1000 + sequence] * 960).pack 's*'
+      frame.sample_count  = 960
+      frame.channels      = 1
+      frame.sampling_rate = 48_000
+    end
+  end
+
+  def push_all(sequences)
+    sequences.each_with_index do |sequence, index|
+      subject.push audio_frame(sequence), index * frame_duration, sequence
+    end
+  end
+
+  def play(count, from)
+    Array.new count do |index|
+      subject.pop(from + index * frame_duration)&.pcm&.unpack('s')&.first
+    end
+  end
+
+  describe '#initialize' do
+    context 'when latency is invalid' do
+      specify do
+        expect { described_class.new latency: 0.01 }.to \
+          raise_error ArgumentError, 'Invalid latency'
+      end
+    end
+  end
+
+  describe '#push' do
+    context 'when sequence is invalid' do
+      specify do
+        expect { subject.push audio_frame(0), 0, -1 }.to \
+          raise_error ArgumentError, 'Invalid sequence'
+      end
+    end
+
+    context 'when frame is not an audio frame' do
+      specify do
+        expect { subject.push :foobar, 0 }.to raise_error TypeError
+      end
+    end
+  end
+
+  describe '#pop' do
+    it 'waits until latency is buffered' do
+      push_all [0, 1]
+      expect(subject.pop(1)).to eq nil
+    end
+
+    it 'plays frames on schedule' do
+      push_all [0, 1, 2]
+      expect(play(2, 0.04)).to eq [1000, 1001]
+      expect(subject.pop(0.065)).to eq nil
+    end
+
+    context 'when frames arrive out of order' do
+      before do
+        push_all [0, 2, 1, 4, 3]
+      end
+
+      it 'plays them in order' do
+        expect(play(5, 0.08)).to eq [1000, 1001, 1002, 1003, 1004]
+      end
+
+      it 'does not conceal or drop them' do
+        play 5, 0.08
+        expect(subject.stats).to include played: 5, concealed: 0, dropped: 0
+      end
+    end
+
+    context 'when frames are duplicated' do
+      before do
+        push_all [0, 1, 1, 2, 0, 3]
+      end
+
+      it 'plays them once' do
+        expect(play(4, 0.1)).to eq [1000, 1001, 1002, 1003]
+      end
+
+      it 'drops duplicates' do
+        play 4, 0.1
+        expect(subject.stats).to include received: 6, concealed: 0, dropped: 2
+      end
+    end
+
+    context 'when frame is missing' do
+      before do
+        push_all [0, 1, 3, 4]
+      end
+
+      it 'conceals it with faded previous frame' do
+        expect(play(4, 0.06)).to eq [1000, 1001, 500, 1003]
+      end
+
+      it 'counts concealment' do
+        play 4, 0.06
+        expect(subject.stats).to include played: 4, concealed: 1, dropped: 0
+      end
+
+      context 'when it arrives after its place has been concealed' do
+        before do
+          play 3, 0.06
+          subject.push audio_frame(2), 0.1, 2
+        end
+
+        it 'drops it' do
+          expect(play(1, 0.12)).to eq [1003]
+          expect(subject.stats).to include concealed: 1, dropped: 1
+        end
+      end
+    end
+
+    context 'when frames run out' do
+      before do
+        push_all [0, 1, 2]
+        play 3, 0.04
+      end
+
+      it 'conceals a few frames, then refills' do
+        expect(play(6, 0.1)).to eq [501, 250, 125, 62, 31, nil]
+        expect(subject.stats).to include concealed: 5, underruns: 1
+      end
+    end
+  end
+
+  describe '#stats' do
+    specify do
+      expect(subject.stats).to include(
+        latency:   0.06,
+        buffered:  0.0,
+        received:  0,
+        played:    0,
+        concealed: 0,
+        dropped:   0,
+      )
+    end
+  end
+end
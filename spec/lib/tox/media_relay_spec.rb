@@ -0,0 +1,129 @@
+# frozen_string_literal: true
+
+require 'support/media_relay'
+
+RSpec.describe Tox.const_get(:MediaRelay) do
+  subject { described_class.new }
+
+  before do
+    [1, 2, 3].each { |sink| subject.add_sink sink }
+  end
+
+  # Asks every sink in order, like a video frame does.
+  def video_frame
+    subject.video_received
+    subject.video_order.select { |sink| subject.video_due? sink }
+  end
+
+  describe '#add_sink' do
+    it 'adds sink once' do
+      expect(subject.add_sink(4)).to eq true
+      expect(subject.add_sink(4)).to eq false
+      expect(subject.sinks).to eq [1, 2, 3, 4]
+    end
+
+    context 'when sink is invalid' do
+      specify do
+        expect { subject.add_sink(-1) }.to \
+          raise_error ArgumentError, 'Invalid sink'
+      end
+    end
+  end
+
+  describe '#remove_sink' do
+    it 'removes added sink' do
+      expect(subject.remove_sink(2)).to eq true
+      expect(subject.remove_sink(2)).to eq false
+      expect(subject.sinks).to eq [1, 3]
+    end
+  end
+
+  describe '#video_due?' do
+    it 'sends every frame to every sink' do
+      expect(Array.new(3) { video_frame }).to eq [[1, 2, 3]] * 3
+    end
+
+    it 'backs off after congestion' do
+      subject.video_sent 2, true
+      expect(Array.new(2) { video_frame }).to eq [[1, 3], [1, 2, 3]]
+
+      subject.video_sent 2, true
+      expect(Array.new(3) { video_frame }).to eq [[1, 3], [1, 3], [1, 2, 3]]
+    end
+
+    it 'backs off after audio congestion' do
+      subject.audio_sent 3, true
+      expect(video_frame).to eq [1, 2]
+    end
+
+    it 'halves the backoff on sent frames' do
+      3.times { subject.video_sent 2, true }
+      4.times { video_frame }
+
+      2.times { subject.video_sent 2, false }
+      subject.video_sent 2, true
+      expect(Array.new(3) { video_frame }).to eq [[1, 3], [1, 3], [1, 2, 3]]
+    end
+
+    it 'backs off up to the maximum' do
+      10.times { subject.video_sent 2, true }
+      frames = Array.new(65) { video_frame }
+      expect(frames.count { |sinks| sinks.include? 2 }).to eq 1
+      expect(frames.last).to eq [1, 2, 3]
+    end
+
+    context 'when sink is not there' do
+      specify do
+        expect { subject.video_due? 4 }.to \
+          raise_error ArgumentError, 'Invalid sink'
+      end
+    end
+  end
+
+  describe '#video_left' do
+    it 'starts the next frame with the first sink left' do
+      subject.video_received
+      subject.video_left 2
+      subject.video_left 3
+      expect(subject.video_order).to eq [2, 3, 1]
+    end
+
+    it 'keeps the order while frames are in time' do
+      subject.video_received
+      subject.video_left 3
+      video_frame
+      expect(subject.video_order).to eq [3, 1, 2]
+    end
+
+    it 'keeps the order valid when sinks are removed' do
+      subject.video_received
+      subject.video_left 3
+      subject.remove_sink 1
+      expect(subject.video_order).to eq [3, 2]
+    end
+  end
+
+  describe '#stats' do
+    it 'counts frames, sends and drops' do
+      subject.audio_received
+      subject.audio_sent 1, false
+      subject.audio_sent 2, true
+
+      video_frame
+      subject.video_sent 1, false
+      subject.video_left 3
+      video_frame
+
+      expect(subject.stats).to eq(
+        sinks: 3,
+        audio_frames: 1,
+        video_frames: 2,
+        audio_sent: 1,
+        video_sent: 1,
+        audio_failed: 1,
+        video_failed: 0,
+        video_dropped: 2,
+      )
+    end
+  end
+end
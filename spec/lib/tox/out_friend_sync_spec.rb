@@ -0,0 +1,63 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::OutFriendSync do
+  subject { described_class.new friend, path, 'foo.txt' }
+
+  let(:client) { Tox::Client.new }
+  let(:friend) { Tox::Friend.new client, 0 }
+
+  let(:dir) { Dir.mktmpdir }
+  let(:path) { File.join dir, 'foo.txt' }
+
+  before do
+    File.binwrite path, 'a' * 123
+  end
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  describe '#initialize' do
+    context 'when friend has invalid type' do
+      specify do
+        expect { described_class.new :foobar, path, 'foo.txt' }.to raise_error(
+          TypeError,
+          "Expected #{Tox::Friend}, got #{:foobar.inspect}",
+        )
+      end
+    end
+
+    context 'when path is a directory' do
+      specify do
+        expect { described_class.new friend, dir, 'foo' }
+          .to raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#size' do
+    specify do
+      expect(subject.size).to eq 123
+    end
+  end
+
+  describe '#id' do
+    specify do
+      expect(subject.id.bytesize).to eq Tox::FileSyncs::ID_SIZE
+    end
+  end
+
+  describe '#rejected' do
+    it 'finishes the sync once' do
+      finished = []
+      sync = described_class.new(friend, path, 'foo.txt') { |s| finished << s }
+
+      sync.rejected
+      sync.fail!
+
+      expect(sync.done?).to eq true
+      expect(sync.success?).to eq false
+      expect(finished).to eq [sync]
+    end
+  end
+end
@@ -0,0 +1,69 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::OutFriendTree do
+  subject { described_class.new friend, dir }
+
+  let(:client) { Tox::Client.new }
+  let(:friend) { Tox::Friend.new client, 0 }
+
+  let(:dir) { Dir.mktmpdir }
+
+  before do
+    FileUtils.mkdir_p File.join(dir, 'foo', 'bar')
+    File.binwrite File.join(dir, 'foo', 'bar', 'car.txt'), 'a' * 123
+    File.binwrite File.join(dir, 'foo', 'baz.txt'), 'b' * 456
+    File.binwrite File.join(dir, 'qux.txt'), ''
+  end
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  describe '#initialize' do
+    context 'when friend has invalid type' do
+      specify do
+        expect { described_class.new :foobar, dir }.to raise_error(
+          TypeError,
+          "Expected #{Tox::Friend}, got #{:foobar.inspect}",
+        )
+      end
+    end
+
+    context 'when path is not a directory' do
+      specify do
+        expect { described_class.new friend, File.join(dir, 'qux.txt') }
+          .to raise_error Errno::ENOTDIR
+      end
+    end
+  end
+
+  describe '#entries' do
+    specify do
+      expect(subject.entries).to eq [
+        ['foo/bar/car.txt', 123],
+        ['foo/baz.txt',     456],
+        ['qux.txt',         0],
+      ]
+    end
+  end
+
+  describe '#id' do
+    specify do
+      expect(subject.id.bytesize).to eq Tox::FileTrees::ID_SIZE
+    end
+  end
+
+  describe '#fail!' do
+    it 'finishes the tree once' do
+      finished = []
+      tree = described_class.new(friend, dir) { |t| finished << t }
+
+      tree.fail!
+      tree.fail!
+
+      expect(tree.done?).to eq true
+      expect(tree.failed_count).to eq 3
+      expect(finished).to eq [tree]
+    end
+  end
+end
@@ -0,0 +1,98 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::Resampler do
+  subject do
+    described_class.new input_sampling_rate, input_channels,
+                        output_sampling_rate, output_channels
+  end
+
+  let(:input_sampling_rate) { 48_000 }
+  let(:input_channels) { 2 }
+  let(:output_sampling_rate) { 16_000 }
+  let(:output_channels) { 1 }
+
+  def audio_frame(samples, sampling_rate, channels)
+    Tox::AudioFrame.new.tap do |frame|
+      frame.pcm           = samples.pack 's*'
+      frame.sample_count  = samples.size / channels
+      frame.channels      = channels
+      frame.sampling_rate = sampling_rate
+    end
+  end
+
+  def tone(sampling_rate, sample_count, offset = 0)
+    Array.new sample_count do |i|
+      (10_000 * Math.sin(2 * Math::PI * 1000 * (i + offset) / sampling_rate))
+        .round
+    end
+  end
+
+  describe '#initialize' do
+    context 'when sampling rate is invalid' do
+      let(:output_sampling_rate) { 44_100 }
+
+      specify do
+        expect { subject }.to \
+          raise_error ArgumentError, 'Invalid sampling rate'
+      end
+    end
+
+    context 'when channels are invalid' do
+      let(:input_channels) { 0 }
+
+      specify do
+        expect { subject }.to raise_error ArgumentError, 'Invalid channels'
+      end
+    end
+  end
+
+  describe '#process' do
+    let(:frame) { audio_frame [0] * 1920, 48_000, 2 }
+
+    specify do
+      result = subject.process frame
+      expect(result).to be_instance_of Tox::AudioFrame
+      expect(result.sampling_rate).to eq 16_000
+      expect(result.channels).to eq 1
+      expect(result.sample_count).to eq 320
+      expect(result).to be_valid
+    end
+
+    context 'when frame has another format' do
+      let(:frame) { audio_frame [0] * 960, 24_000, 2 }
+
+      specify do
+        expect { subject.process frame }.to raise_error ArgumentError
+      end
+    end
+
+    context 'with a stream of frames' do
+      let(:input_channels) { 1 }
+      let(:output_sampling_rate) { 48_000 }
+
+      let :output do
+        Array.new 10 do |k|
+          samples = tone input_sampling_rate, 320, k * 320
+          subject.process(audio_frame(samples, input_sampling_rate, 1))
+                 .pcm.unpack('s*')
+        end.flatten
+      end
+
+      let(:input_sampling_rate) { 16_000 }
+
+      it 'keeps the rate' do
+        expect(output.size).to eq 9600
+      end
+
+      it 'keeps the amplitude' do
+        expect(output.drop(100).max).to be_within(100).of 10_000
+      end
+    end
+  end
+
+  describe '#reset' do
+    specify do
+      expect(subject.reset).to eq nil
+    end
+  end
+end
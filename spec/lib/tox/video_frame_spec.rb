@@ -193,4 +193,113 @@ RSpec.describe Tox::VideoFrame do
       end
     end
   end
+
+  describe '.from_rgb' do
+    let(:rgb) { [200, 200, 200].pack('C*') * (4 * 2) }
+
+    specify do
+      frame = described_class.from_rgb rgb, 4, 2
+      expect(frame.valid?).to eq true
+      expect(frame.y_plane.bytes.uniq).to eq [188]
+      expect(frame.u_plane.bytes.uniq).to eq [128]
+      expect(frame.v_plane.bytes.uniq).to eq [128]
+    end
+
+    it 'converts pure red' do
+      frame = described_class.from_rgb [255, 0, 0].pack('C*') * 4, 2, 2
+      expect(frame.y_plane.bytes).to eq [82] * 4
+      expect(frame.u_plane.bytes).to eq [90]
+      expect(frame.v_plane.bytes).to eq [240]
+    end
+
+    context 'when data size is invalid' do
+      specify do
+        expect { described_class.from_rgb rgb + "\0", 4, 2 }.to \
+          raise_error ArgumentError, 'Invalid data size'
+      end
+    end
+
+    context 'when size is odd' do
+      specify do
+        expect { described_class.from_rgb rgb, 8, 1 }.to \
+          raise_error ArgumentError, 'Invalid frame size'
+      end
+    end
+  end
+
+  describe '.from_rgba' do
+    let(:rgb)  { SecureRandom.random_bytes 32 * 4 * 3 }
+    let(:rgba) { rgb.scan(/.../mn).map { |pixel| pixel + "\xff".b }.join }
+
+    it 'ignores alpha' do
+      rgb_frame  = described_class.from_rgb  rgb,  32, 4
+      rgba_frame = described_class.from_rgba rgba, 32, 4
+
+      expect(rgba_frame.y_plane).to eq rgb_frame.y_plane
+      expect(rgba_frame.u_plane).to eq rgb_frame.u_plane
+      expect(rgba_frame.v_plane).to eq rgb_frame.v_plane
+    end
+  end
+
+  describe '.from_nv12' do
+    let(:y_plane) { SecureRandom.random_bytes 64 * 4 }
+    let(:u_plane) { SecureRandom.random_bytes 32 * 2 }
+    let(:v_plane) { SecureRandom.random_bytes 32 * 2 }
+
+    let :nv12 do
+      y_plane + u_plane.bytes.zip(v_plane.bytes).flatten.pack('C*')
+    end
+
+    specify do
+      frame = described_class.from_nv12 nv12, 64, 4
+      expect(frame.y_plane).to eq y_plane
+      expect(frame.u_plane).to eq u_plane
+      expect(frame.v_plane).to eq v_plane
+    end
+  end
+
+  describe '#plane' do
+    specify do
+      expect(subject.plane(:u)).to eq Tox::VideoPlane.new subject, :u
+    end
+  end
+
+  describe '#scale' do
+    let(:width)  { 64 }
+    let(:height) { 48 }
+
+    let(:y_plane) { SecureRandom.random_bytes width * height }
+    let(:u_plane) { SecureRandom.random_bytes((width / 2) * (height / 2)) }
+    let(:v_plane) { SecureRandom.random_bytes((width / 2) * (height / 2)) }
+
+    specify do
+      frame = subject.scale 32, 24
+      expect(frame).to be_instance_of described_class
+      expect(frame.width).to eq 32
+      expect(frame.height).to eq 24
+      expect(frame.valid?).to eq true
+    end
+
+    it 'copies frame of the same size' do
+      frame = subject.scale width, height
+      expect(frame.y_plane).to eq y_plane
+      expect(frame.u_plane).to eq u_plane
+      expect(frame.v_plane).to eq v_plane
+    end
+
+    context 'when size is odd' do
+      specify do
+        expect { subject.scale 33, 24 }.to \
+          raise_error ArgumentError, 'Invalid frame size'
+      end
+    end
+
+    context 'when frame is invalid' do
+      let(:y_plane) { '' }
+
+      specify do
+        expect { subject.scale 32, 24 }.to raise_error RuntimeError
+      end
+    end
+  end
 end
@@ -0,0 +1,153 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::VideoMosaic do
+  subject { described_class.new width, height, **options }
+
+  let(:width) { 8 }
+  let(:height) { 4 }
+  let(:options) { {} }
+
+  def video_frame(frame_width, frame_height, luma)
+    Tox::VideoFrame.new.tap do |frame|
+      frame.width   = frame_width
+      frame.height  = frame_height
+      frame.y_plane = ([luma] * (frame_width * frame_height)).pack 'C*'
+      frame.u_plane = "\x80" * (frame_width * frame_height / 4)
+      frame.v_plane = "\x80" * (frame_width * frame_height / 4)
+    end
+  end
+
+  def luma_rows(frame)
+    frame.y_plane.unpack('C*').each_slice(frame.width).to_a
+  end
+
+  describe '#initialize' do
+    context 'when size is odd' do
+      let(:width) { 7 }
+
+      specify do
+        expect { subject }.to raise_error ArgumentError, 'Invalid frame size'
+      end
+    end
+
+    context 'when grid is invalid' do
+      let(:options) { { columns: 0 } }
+
+      specify do
+        expect { subject }.to raise_error ArgumentError, 'Invalid grid size'
+      end
+    end
+
+    context 'when frame rate is invalid' do
+      let(:options) { { frame_rate: 0 } }
+
+      specify do
+        expect { subject }.to raise_error ArgumentError, 'Invalid frame rate'
+      end
+    end
+  end
+
+  describe '#columns' do
+    specify do
+      expect(subject.columns).to eq nil
+    end
+
+    context 'when grid is fixed' do
+      let(:options) { { columns: 2, rows: 1 } }
+
+      specify do
+        expect(subject.columns).to eq 2
+        expect(subject.rows).to eq 1
+      end
+    end
+  end
+
+  describe '#frame_rate' do
+    specify do
+      expect(subject.frame_rate).to eq 15
+    end
+  end
+
+  describe '#push' do
+    specify do
+      subject.push 1, video_frame(4, 4, 100)
+      expect(subject.sources).to eq [1]
+    end
+
+    context 'when frame is invalid' do
+      specify do
+        expect { subject.push 1, Tox::VideoFrame.new }.to \
+          raise_error ArgumentError
+      end
+    end
+  end
+
+  describe '#delete' do
+    before do
+      subject.push 1, video_frame(4, 4, 100)
+      subject.push 2, video_frame(4, 4, 100)
+      subject.push 3, video_frame(4, 4, 100)
+    end
+
+    specify do
+      expect(subject.delete(2)).to eq true
+      expect(subject.sources).to eq [1, 3]
+    end
+
+    specify do
+      expect(subject.delete(4)).to eq false
+    end
+  end
+
+  describe '#tick' do
+    specify do
+      expect(subject.tick).to eq true
+      expect(subject.tick).to eq false
+    end
+  end
+
+  describe '#compose' do
+    it 'returns black frame without sources' do
+      frame = subject.compose
+      expect(frame.width).to eq width
+      expect(frame.y_plane.unpack('C*').uniq).to eq [16]
+      expect(frame.u_plane.unpack('C*').uniq).to eq [128]
+    end
+
+    context 'when there are sources' do
+      before do
+        subject.push 1, video_frame(8, 8, 200)
+        subject.push 2, video_frame(16, 16, 100)
+      end
+
+      it 'lays out tiles in grid' do
+        expect(luma_rows(subject.compose)).to eq \
+          [[200, 200, 200, 200, 100, 100, 100, 100]] * 4
+      end
+
+      it 'leaves out the excepted source' do
+        expect(luma_rows(subject.compose(except: 1))).to eq \
+          [[100, 100, 100, 100, 16, 16, 16, 16]] * 4
+      end
+
+      it 'reuses the given frame' do
+        frame = Tox::VideoFrame.new
+        expect(subject.compose(frame)).to equal frame
+        expect(frame.y_plane.bytesize).to eq width * height
+      end
+    end
+
+    context 'when aspect ratio differs from the cell' do
+      let(:options) { { columns: 1, rows: 1 } }
+
+      before do
+        subject.push 1, video_frame(4, 4, 200)
+      end
+
+      it 'keeps aspect ratio' do
+        expect(luma_rows(subject.compose)).to eq \
+          [[16, 16, 200, 200, 200, 200, 16, 16]] * 4
+      end
+    end
+  end
+end
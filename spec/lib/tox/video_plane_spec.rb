@@ -0,0 +1,95 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::VideoPlane do
+  subject { described_class.new frame, name }
+
+  let(:frame) { Tox::VideoFrame.from_rgb "\x80".b * 4 * 2 * 3, 4, 2 }
+  let(:name) { :y }
+
+  describe '#initialize' do
+    specify do
+      expect { described_class.new frame, :w }.to \
+        raise_error ArgumentError, 'Invalid plane name'
+    end
+
+    specify do
+      expect { described_class.new Tox::AudioFrame.new, :y }.to \
+        raise_error TypeError
+    end
+  end
+
+  describe '#width' do
+    specify do
+      expect(subject.width).to eq 4
+    end
+
+    context 'when plane is chroma' do
+      let(:name) { :v }
+
+      specify do
+        expect(subject.width).to eq 2
+      end
+    end
+  end
+
+  describe '#height' do
+    specify do
+      expect(subject.height).to eq 2
+    end
+
+    context 'when plane is chroma' do
+      let(:name) { :u }
+
+      specify do
+        expect(subject.height).to eq 1
+      end
+    end
+  end
+
+  describe '#data' do
+    specify do
+      expect(subject.data).to equal frame.y_plane
+    end
+  end
+
+  describe 'memory view' do
+    before do
+      require 'fiddle'
+      skip 'Memory views require Ruby 3.0' unless defined? Fiddle::MemoryView
+    end
+
+    specify do
+      view = Fiddle::MemoryView.new subject
+      expect(view.format).to eq 'C'
+      expect(view.shape).to eq [2, 4]
+      expect(view.strides).to eq [4, 1]
+      expect(view.to_s).to eq frame.y_plane
+      view.release
+    end
+
+    it 'locks the plane until released' do
+      view = Fiddle::MemoryView.new subject
+      expect { frame.y_plane << 'x' }.to raise_error RuntimeError
+      view.release
+      expect { frame.y_plane << 'x' }.not_to raise_error
+    end
+
+    context 'when plane is chroma' do
+      let(:name) { :u }
+
+      specify do
+        view = Fiddle::MemoryView.new subject
+        expect(view.shape).to eq [1, 2]
+        view.release
+      end
+    end
+
+    context 'when frame is empty' do
+      let(:frame) { Tox::VideoFrame.new }
+
+      specify do
+        expect { Fiddle::MemoryView.new subject }.to raise_error ArgumentError
+      end
+    end
+  end
+end
@@ -0,0 +1,141 @@
+# frozen_string_literal: true
+
+require 'support/video_queue'
+
+RSpec.describe Tox.const_get(:VideoQueue) do
+  subject { described_class.new frame_rate: 10, depth: 2 }
+
+  # A 2x2 frame whose bytes all are the value.
+  def video_frame(value)
+    Tox::VideoFrame.new.tap do |frame|
+      frame.width   = 2
+      frame.height  = 2
+      frame.y_plane = value.chr * 4
+      frame.u_plane = value.chr
+      frame.v_plane = value.chr
+    end
+  end
+
+  def push(*values)
+    values.each { |value| subject.push video_frame value }
+  end
+
+  # Value of the taken frame, nil when none is taken.
+  def taken
+    subject.taken&.y_plane&.getbyte(0)
+  end
+
+  # Takes a frame at the time and gives it back, returns its value.
+  def send_at(time)
+    frame = subject.take time
+    subject.done
+    frame&.y_plane&.getbyte(0)
+  end
+
+  describe '#initialize' do
+    context 'when depth is invalid' do
+      specify do
+        expect { described_class.new depth: 0 }.to \
+          raise_error ArgumentError, 'Invalid depth'
+      end
+    end
+  end
+
+  describe '#push' do
+    it 'keeps the newest frames when the queue is full' do
+      push 1, 2, 3
+      expect(subject.stats).to include depth: 2, queued: 3, dropped: 1
+      expect(send_at(0)).to eq 3
+    end
+
+    context 'when frame is invalid' do
+      specify do
+        frame = video_frame(1).tap { |f| f.y_plane = '' }
+        expect { subject.push frame }.to \
+          raise_error RuntimeError, 'video frame is invalid'
+      end
+    end
+  end
+
+  describe '#take' do
+    it 'takes the newest frame and drops the older ones' do
+      push 1, 2
+      expect(send_at(0)).to eq 2
+      expect(subject.stats).to include depth: 0, queued: 2, dropped: 1
+    end
+
+    it 'waits for the next frame to be due' do
+      push 1
+      expect(send_at(0)).to eq 1
+      push 2
+      expect(send_at(0.05)).to eq nil
+      expect(send_at(0.1)).to eq 2
+    end
+
+    it 'starts the schedule again after falling behind' do
+      push 1
+      send_at 0
+      push 2
+      expect(send_at(0.5)).to eq 2
+      push 3
+      expect(send_at(0.55)).to eq nil
+      expect(send_at(0.6)).to eq 3
+    end
+
+    it 'waits for the taken frame to be given back' do
+      push 1
+      subject.take 0
+      push 2
+      expect(subject.take(1)).to eq nil
+      subject.done
+      expect(send_at(1)).to eq 2
+    end
+
+    it 'keeps the taken frame while frames are pushed' do
+      push 1
+      subject.take 0
+      push 2, 3, 4, 5
+      expect(taken).to eq 1
+    end
+
+    context 'when queue is empty' do
+      specify do
+        expect(subject.take(0)).to eq nil
+      end
+    end
+  end
+
+  describe '#done' do
+    it 'counts sent and failed frames' do
+      push 1
+      subject.take 0
+      expect(subject.done).to eq true
+      push 2
+      subject.take 1
+      subject.done failed: true
+      expect(subject.stats).to include sent: 1, failed: 1
+    end
+
+    it 'reuses the buffer of the taken frame' do
+      push 1
+      send_at 0
+      push 2, 3
+      expect(send_at(1)).to eq 3
+    end
+
+    context 'when no frame is taken' do
+      specify do
+        expect(subject.done).to eq false
+      end
+    end
+  end
+
+  describe '#clear' do
+    it 'throws frames away without dropping them' do
+      push 1, 2
+      subject.clear
+      expect(subject.take(0)).to eq nil
+      expect(subject.stats).to include depth: 0, dropped: 0
+    end
+  end
+end
@@ -0,0 +1,97 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::WavFile do
+  let(:dir) { Dir.mktmpdir }
+  let(:path) { File.join dir, 'audio.wav' }
+
+  let(:sampling_rate) { 16_000 }
+  let(:channels) { 1 }
+
+  let(:samples) { Array.new(420) { |index| index - 210 } }
+
+  def audio_frame(samples)
+    Tox::AudioFrame.new.tap do |frame|
+      frame.pcm           = samples.pack 's<*'
+      frame.sample_count  = samples.size / channels
+      frame.channels      = channels
+      frame.sampling_rate = sampling_rate
+    end
+  end
+
+  before do
+    described_class.create path, sampling_rate, channels do |file|
+      file.write_frame audio_frame samples[0...320]
+      file.write_frame audio_frame samples[320..-1]
+    end
+  end
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  describe '::create' do
+    it 'writes header with sizes' do
+      data = File.binread path
+      expect(data.bytesize).to eq 44 + 840
+      expect(data.unpack('a4Va4a4VvvVVvva4V')).to eq [
+        'RIFF', 876, 'WAVE', 'fmt ', 16, 1, 1, 16_000, 32_000, 2, 16,
+        'data', 840,
+      ]
+    end
+
+    it 'raises when sampling rate is invalid' do
+      expect { described_class.create path, 44_100, 2 }.to \
+        raise_error ArgumentError, 'Invalid sampling rate'
+    end
+
+    it 'raises when frame format does not match' do
+      described_class.create path, 48_000, 2 do |file|
+        expect { file.write_frame audio_frame samples }.to \
+          raise_error ArgumentError, 'Frame format does not match'
+      end
+    end
+  end
+
+  describe '::open' do
+    it 'reads header' do
+      described_class.open path do |file|
+        expect(file.sampling_rate).to eq sampling_rate
+        expect(file.channels).to eq channels
+        expect(file.sample_count).to eq 420
+      end
+    end
+
+    it 'reads frames of 20 ms' do
+      described_class.open path do |file|
+        frames = file.each_frame.to_a
+        expect(frames.map(&:sample_count)).to eq [320, 100]
+        expect(frames.first).to be_valid
+        expect(frames.map(&:pcm).join.unpack('s<*')).to eq samples
+      end
+    end
+
+    it 'reuses given frame' do
+      described_class.open path do |file|
+        frame = Tox::AudioFrame.new
+        expect(file.read_frame(frame, sample_count: 10)).to equal frame
+        pcm = frame.pcm
+        file.read_frame frame, sample_count: 10
+        expect(frame.pcm).to equal pcm
+        expect(frame.pcm.unpack('s<*')).to eq samples[10...20]
+      end
+    end
+
+    it 'returns nil after the last frame' do
+      described_class.open path do |file|
+        file.read_frame sample_count: 1000
+        expect(file.read_frame).to eq nil
+      end
+    end
+
+    it 'raises when format is unsupported' do
+      File.binwrite path, File.binread(path).tap { |data| data[34] = "\x08" }
+      expect { described_class.open path }.to \
+        raise_error described_class::FormatError, 'Unsupported format'
+    end
+  end
+end
@@ -0,0 +1,126 @@
+# frozen_string_literal: true
+
+RSpec.describe Tox::Y4MFile do
+  let(:dir) { Dir.mktmpdir }
+  let(:path) { File.join dir, 'video.y4m' }
+
+  let(:width) { 4 }
+  let(:height) { 2 }
+
+  let :frames do
+    Array.new 3 do |index|
+      Tox::VideoFrame.new.tap do |frame|
+        frame.width   = width
+        frame.height  = height
+        frame.y_plane = SecureRandom.random_bytes width * height
+        frame.u_plane = SecureRandom.random_bytes width * height / 4
+        frame.v_plane = [index, index].pack('C*')
+      end
+    end
+  end
+
+  after do
+    FileUtils.remove_entry dir
+  end
+
+  def planes(frame)
+    [frame.y_plane, frame.u_plane, frame.v_plane]
+  end
+
+  describe '::create' do
+    it 'writes header and frames' do
+      described_class.create path, width, height do |file|
+        frames.each { |frame| file.write_frame frame }
+      end
+
+      data = File.binread path
+      expect(data).to start_with "YUV4MPEG2 W4 H2 F30:1 Ip A1:1 C420jpeg\n"
+      expect(data.scan('FRAME').size).to eq 3
+    end
+
+    it 'raises when frame size is invalid' do
+      expect { described_class.create path, 3, 2 }.to \
+        raise_error ArgumentError, 'Invalid frame size'
+    end
+
+    it 'raises when frame rate is invalid' do
+      expect { described_class.create path, 4, 2, frame_rate: 0 }.to \
+        raise_error ArgumentError, 'Invalid frame rate'
+    end
+
+    it 'raises when frame size does not match' do
+      described_class.create path, 8, 2 do |file|
+        expect { file.write_frame frames.first }.to \
+          raise_error ArgumentError, 'Frame size does not match'
+      end
+    end
+  end
+
+  describe '::open' do
+    before do
+      described_class.create path, width, height,
+                             frame_rate: Rational(30_000, 1001) do |file|
+        frames.each { |frame| file.write_frame frame }
+      end
+    end
+
+    it 'reads header' do
+      described_class.open path do |file|
+        expect(file.width).to eq width
+        expect(file.height).to eq height
+        expect(file.frame_rate).to eq Rational(30_000, 1001)
+      end
+    end
+
+    it 'reads frames' do
+      described_class.open path do |file|
+        expect(file.each_frame.map { |frame| planes frame }).to \
+          eq frames.map { |frame| planes frame }
+      end
+    end
+
+    it 'reuses given frame' do
+      described_class.open path do |file|
+        frame = Tox::VideoFrame.new
+        expect(file.read_frame(frame)).to equal frame
+        y_plane = frame.y_plane
+        file.read_frame frame
+        expect(frame.y_plane).to equal y_plane
+        expect(planes(frame)).to eq planes(frames[1])
+      end
+    end
+
+    it 'returns nil after the last frame' do
+      described_class.open path do |file|
+        3.times { file.read_frame }
+        expect(file.read_frame).to eq nil
+        file.rewind
+        expect(planes(file.read_frame)).to eq planes(frames.first)
+      end
+    end
+
+    it 'raises when colorspace is unsupported' do
+      File.binwrite path, "YUV4MPEG2 W2 H2 C444\nFRAME\n"
+      expect { described_class.open path }.to \
+        raise_error described_class::FormatError, 'Unsupported colorspace'
+    end
+
+    it 'raises when frame is truncated' do
+      File.binwrite path, "YUV4MPEG2 W2 H2\nFRAME\nabc"
+      described_class.open path do |file|
+        expect { file.read_frame }.to \
+          raise_error described_class::FormatError, 'Truncated frame'
+      end
+    end
+  end
+
+  describe '#close' do
+    it 'closes file' do
+      file = described_class.create path, width, height
+      file.close
+      expect(file).to be_closed
+      expect { file.write_frame frames.first }.to \
+        raise_error IOError, 'closed file'
+    end
+  end
+end
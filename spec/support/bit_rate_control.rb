@@ -0,0 +1,80 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Spec-only wrapper of the native control of
+  # {FriendCall#enable_bit_rate_control}, private in the gem. Times and
+  # durations are in seconds of a monotonic clock, bit rates in kbit/sec.
+  # Kinds are :audio and :video.
+  #
+  class BitRateControl
+    using CoreExt
+
+    KINDS = %i[audio video].freeze
+    BIT_RATES = (0...(2**32 - 1)).freeze
+
+    # Kinds with nil limits are held.
+    def initialize(audio: FriendCall::DEFAULT_AUDIO_BIT_RATES,
+                   video: FriendCall::DEFAULT_VIDEO_BIT_RATES)
+      audio_min, audio_max = limits! audio
+      video_min, video_max = limits! video
+      initialize_with audio_min, audio_max, video_min, video_max
+    end
+
+    # The kind was set to the bit rate elsewhere, zero disables it. It is
+    # not changed any more.
+    def hold(kind, bit_rate)
+      Integer.ancestor_of! bit_rate
+      raise ArgumentError, 'Invalid bit rate' unless BIT_RATES.cover? bit_rate
+      hold_with kind_index!(kind), bit_rate
+    end
+
+    # Sending a frame of the kind failed.
+    def failed(kind)
+      failed_with kind_index!(kind)
+    end
+
+    # toxav suggested a bit rate for the kind.
+    def suggested(kind, bit_rate)
+      Integer.ancestor_of! bit_rate
+      raise ArgumentError, 'Invalid bit rate' unless BIT_RATES.cover? bit_rate
+      suggested_with kind_index!(kind), bit_rate
+    end
+
+    # A video frame took the duration to send, starting at the time.
+    def video_sent(duration, time)
+      Numeric.ancestor_of! duration
+      raise ArgumentError, 'Invalid duration' if duration.negative?
+      time! time
+      video_sent_with duration, time
+    end
+
+  private
+
+    # Limits of a kind, as [min, max], zeros when it is nil.
+    def limits!(value)
+      return [0, 0] if value.nil?
+      Range.ancestor_of! value
+      min = value.first
+      max = value.last
+      Integer.ancestor_of! min
+      Integer.ancestor_of! max
+      max -= 1 if value.exclude_end?
+      unless min.positive? && min <= max && BIT_RATES.cover?(max)
+        raise ArgumentError, 'Invalid bit rates'
+      end
+      [min, max]
+    end
+
+    def kind_index!(kind)
+      index = KINDS.index kind
+      raise ArgumentError, 'Invalid kind' if index.nil?
+      index
+    end
+
+    def time!(time)
+      Numeric.ancestor_of! time
+      raise ArgumentError, 'Invalid time' if time.negative?
+    end
+  end
+end
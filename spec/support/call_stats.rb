@@ -0,0 +1,69 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Spec-only wrapper of the native call stats of {FriendCall#stats},
+  # private in the gem. Times and durations are in seconds of a monotonic
+  # clock, bit rates in kbit/sec. Kinds are :audio and :video.
+  #
+  class CallStats
+    using CoreExt
+
+    KINDS = %i[audio video].freeze
+    BIT_RATES = (0...(2**32)).freeze
+
+    # The call started at the time with the bit rates, zero disables a kind.
+    def initialize(audio_bit_rate, video_bit_rate, time = 0)
+      bit_rate! audio_bit_rate
+      bit_rate! video_bit_rate
+      time! time
+      initialize_with audio_bit_rate, video_bit_rate, time
+    end
+
+    def change_bit_rate(kind, bit_rate)
+      bit_rate! bit_rate
+      change_bit_rate_with kind_index!(kind), bit_rate
+    end
+
+    # A frame of the kind was given to toxav at "started" and the send
+    # returned at "finished" with the error, nil when it was sent. Audio
+    # frames cover the duration, video frames none.
+    def sent(kind, started, finished, duration: 0, error: nil)
+      time! started
+      time! finished
+      duration! duration
+      Symbol.ancestor_of! error unless error.nil?
+      sent_with kind_index!(kind), error, started, finished, duration
+    end
+
+    # A frame of the kind covering the duration arrived at the time.
+    def received(kind, time, duration: 0)
+      time! time
+      duration! duration
+      received_with kind_index!(kind), time, duration
+    end
+
+  private
+
+    def kind_index!(kind)
+      index = KINDS.index kind
+      raise ArgumentError, 'Invalid kind' if index.nil?
+      index
+    end
+
+    def bit_rate!(bit_rate)
+      Integer.ancestor_of! bit_rate
+      raise ArgumentError, 'Invalid bit rate' unless BIT_RATES.cover? bit_rate
+    end
+
+    def time!(time)
+      Numeric.ancestor_of! time
+      raise ArgumentError, 'Invalid time' if time.negative?
+    end
+
+    def duration!(duration)
+      Numeric.ancestor_of! duration
+      raise ArgumentError, 'Invalid duration' if duration.negative?
+    end
+  end
+end
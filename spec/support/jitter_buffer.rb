@@ -0,0 +1,34 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Spec-only wrapper of the native jitter buffer of
+  # {FriendCall#enable_jitter_buffer}, which the gem keeps private. Times
+  # are in seconds of a monotonic clock. Frames with sequence numbers (one
+  # per 20 ms frame) are put back in order; without them they are played
+  # in the order they are pushed.
+  #
+  class JitterBuffer
+    using CoreExt
+
+    def initialize(latency: FriendCall::DEFAULT_JITTER_BUFFER_LATENCY)
+      Numeric.ancestor_of! latency
+      unless FriendCall::JITTER_BUFFER_LATENCIES.cover? latency
+        raise ArgumentError, 'Invalid latency'
+      end
+      initialize_with latency
+    end
+
+    SEQUENCES = (0...(2**64 - 1)).freeze
+
+    def push(audio_frame, time, sequence = nil)
+      Numeric.ancestor_of! time
+      raise ArgumentError, 'Invalid time' if time.negative?
+      unless sequence.nil?
+        Integer.ancestor_of! sequence
+        raise ArgumentError, 'Invalid sequence' unless SEQUENCES.cover? sequence
+      end
+      push_with audio_frame, time, sequence
+    end
+  end
+end
@@ -0,0 +1,64 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Spec-only wrapper of the bookkeeping of the relays of
+  # {FriendCall#add_relay_sink}, private in the gem, for checking which
+  # sinks get video. Sinks are friend numbers.
+  #
+  class MediaRelay
+    using CoreExt
+
+    FRIEND_NUMBERS = (0...(2**32)).freeze
+
+    # Returns false when the sink was already there.
+    def add_sink(sink)
+      friend_number! sink
+      add_sink_with sink
+    end
+
+    # Returns false when the sink was not there.
+    def remove_sink(sink)
+      friend_number! sink
+      remove_sink_with sink
+    end
+
+    # Sending an audio frame to the sink succeeded or failed because of
+    # congestion.
+    def audio_sent(sink, congested)
+      sink_index! sink
+      audio_sent_with sink, congested
+    end
+
+    def video_sent(sink, congested)
+      sink_index! sink
+      video_sent_with sink, congested
+    end
+
+    # Whether the current video frame is sent to the sink, false while it
+    # backs off after congestion. Sinks are asked in {#video_order}.
+    def video_due?(sink)
+      video_due_with sink_index!(sink)
+    end
+
+    # The sink was due but the budget of the current video frame ran out.
+    def video_left(sink)
+      sink_index! sink
+      video_left_with sink
+    end
+
+  private
+
+    def friend_number!(sink)
+      Integer.ancestor_of! sink
+      raise ArgumentError, 'Invalid sink' unless FRIEND_NUMBERS.cover? sink
+    end
+
+    def sink_index!(sink)
+      friend_number! sink
+      index = sinks.index sink
+      raise ArgumentError, 'Invalid sink' if index.nil?
+      index
+    end
+  end
+end
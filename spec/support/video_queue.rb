@@ -0,0 +1,54 @@
+# frozen_string_literal: true
+
+module Tox
+  ##
+  # Spec-only wrapper of the native video queue of
+  # {FriendCall#enable_video_queue}, private in the gem. Times are in
+  # seconds of a monotonic clock.
+  #
+  class VideoQueue
+    using CoreExt
+
+    def initialize(frame_rate: FriendCall::DEFAULT_VIDEO_QUEUE_FRAME_RATE,
+                   depth: FriendCall::DEFAULT_VIDEO_QUEUE_DEPTH)
+      Integer.ancestor_of! frame_rate
+      Integer.ancestor_of! depth
+      unless FriendCall::VIDEO_QUEUE_FRAME_RATES.cover? frame_rate
+        raise ArgumentError, 'Invalid frame rate'
+      end
+      unless FriendCall::VIDEO_QUEUE_DEPTHS.cover? depth
+        raise ArgumentError, 'Invalid depth'
+      end
+      initialize_with frame_rate, depth
+    end
+
+    # Takes the newest frame when one is due at the time, like
+    # {AudioVideo#iterate} does to send it, and returns it. Returns nil
+    # when none is due or the frame taken last was not given back with
+    # {#done}.
+    def take(time)
+      Numeric.ancestor_of! time
+      raise ArgumentError, 'Invalid time' if time.negative?
+      taken if take_with time
+    end
+
+    # The taken frame as its buffer holds it now, nil when none is taken.
+    def taken
+      width, height, y_plane, u_plane, v_plane = taken_planes
+      return if width.nil?
+      VideoFrame.new.tap do |frame|
+        frame.width   = width
+        frame.height  = height
+        frame.y_plane = y_plane
+        frame.u_plane = u_plane
+        frame.v_plane = v_plane
+      end
+    end
+
+    # Gives the taken frame back, counted as sent or failed. Returns false
+    # when none is taken.
+    def done(failed: false)
+      done_with failed
+    end
+  end
+end